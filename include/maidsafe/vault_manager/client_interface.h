@@ -37,6 +37,7 @@
 #include "maidsafe/passport/passport.h"
 #include "maidsafe/routing/bootstrap_file_operations.h"
 
+#include "maidsafe/vault_manager/resource_limits.h"
 #include "maidsafe/vault_manager/rpc_helper.h"
 #include "maidsafe/vault_manager/utils.h"
 
@@ -48,6 +49,9 @@ class TcpConnection;
 
 class ClientInterface {
  public:
+  typedef std::function<void(const NonEmptyString& label, uint64_t bytes_moved,
+                             uint64_t total_bytes)> MoveProgressFunctor;
+
   explicit ClientInterface(const passport::Maid& maid);
 
   std::future<routing::BootstrapContacts> GetBootstrapContacts();
@@ -55,8 +59,22 @@ class ClientInterface {
   std::future<std::unique_ptr<passport::PmidAndSigner>> TakeOwnership(const NonEmptyString& label,
       const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage);
 
+  // As above, but also replaces the vault's resource limits.
+  std::future<std::unique_ptr<passport::PmidAndSigner>> TakeOwnership(const NonEmptyString& label,
+      const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage,
+      const ResourceLimits& resource_limits);
+
   std::future<std::unique_ptr<passport::PmidAndSigner>> StartVault(
-      const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage);
+      const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage,
+      const ResourceLimits& resource_limits = ResourceLimits{});
+
+  // Only available for vaults owned by this client.
+  std::future<ResourceUsage> GetResourceUsage(const NonEmptyString& label);
+
+  // Invoked as a vault owned by this client reports progress moving its chunkstore, as requested
+  // via TakeOwnership with a different vault_dir.  While the move progresses, the TakeOwnership
+  // future doesn't time out.
+  void SetMoveChunkstoreProgressFunctor(MoveProgressFunctor on_move_progress);
 
 #ifdef TESTING
   // This function sets up global variables specifying:
@@ -79,6 +97,7 @@ class ClientInterface {
 
  private:
   typedef detail::PromiseAndTimer<std::unique_ptr<passport::PmidAndSigner>> VaultRequest;
+  typedef detail::PromiseAndTimer<ResourceUsage> UsageRequest;
 
   ClientInterface(const ClientInterface&) = delete;
   ClientInterface(ClientInterface&&) = delete;
@@ -87,8 +106,12 @@ class ClientInterface {
   std::shared_ptr<TcpConnection> ConnectToVaultManager();
   std::future<std::unique_ptr<passport::PmidAndSigner>> AddVaultRequest(
       const NonEmptyString& label);
+  // Must be called with mutex_ held.
+  void ArmVaultRequestTimer(const NonEmptyString& label, std::shared_ptr<VaultRequest> request);
   void HandleReceivedMessage(const std::string& wrapped_message);
   void HandleVaultRunningResponse(const std::string& message);
+  void HandleVaultUsageResponse(const std::string& message);
+  void HandleMoveChunkstoreProgress(const std::string& message);
   void HandleBootstrapContactsResponse(const std::string& message);
   void InvokeCallBack(const std::string& message, std::function<void(std::string)>& callback);
   void HandleLogMessage(const std::string& message);
@@ -97,7 +120,9 @@ class ClientInterface {
   std::mutex mutex_;
   std::function<void(std::string)> on_challenge_;
   std::function<void(std::string)> on_bootstrap_contacts_response_;
+  MoveProgressFunctor on_move_progress_;
   std::map<NonEmptyString, std::shared_ptr<VaultRequest>> ongoing_vault_requests_;
+  std::multimap<NonEmptyString, std::shared_ptr<UsageRequest>> ongoing_usage_requests_;
   AsioService asio_service_;
   std::shared_ptr<TcpConnection> tcp_connection_;
   // We need to ensure the connection is closed in the event of the constructor throwing, or the
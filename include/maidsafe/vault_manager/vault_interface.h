@@ -19,6 +19,7 @@
 #ifndef MAIDSAFE_VAULT_MANAGER_VAULT_INTERFACE_H_
 #define MAIDSAFE_VAULT_MANAGER_VAULT_INTERFACE_H_
 
+#include <chrono>
 #include <condition_variable>
 #include <cstdint>
 #include <functional>
@@ -27,6 +28,9 @@
 #include <mutex>
 #include <string>
 
+#include "boost/asio/steady_timer.hpp"
+#include "boost/filesystem/path.hpp"
+
 #include "maidsafe/common/asio_service.h"
 #include "maidsafe/common/on_scope_exit.h"
 #include "maidsafe/common/rsa.h"
@@ -39,22 +43,72 @@ namespace maidsafe {
 
 namespace vault_manager {
 
+class SharedMemoryRing;
 class TcpConnection;
 class VaultInterface;
 
 typedef uint16_t Port;
 
+#ifndef MAIDSAFE_WIN32
+// The descriptor of a connected socket inherited from the VaultManager when it spawned this process.
+struct InheritedChannel {
+  explicit InheritedChannel(int native_socket_in) : native_socket(native_socket_in) {}
+  int native_socket;
+};
+#endif
+
+// Fire-and-forget messages (bootstrap contacts and log messages) are sent via a shared memory ring
+// if the VaultManager provided one, otherwise via the TCP connection.  If the ring is full, the
+// message is dropped (see DroppedMessageCount) rather than sent via TCP, which could overtake those
+// still in the ring.  Once the ring has been abandoned (see below), all are sent in order via TCP.
+//
+// If the VaultManager provided an address to reconnect to (i.e. it may hand over to a successor),
+// losing the connection other than while stopping doesn't end the vault.  Instead it keeps trying
+// to reconnect for kVaultReconnectTimeout, using TCP only from then on.  Messages sent while
+// disconnected are lost.
+//
+// The VaultManager's health probes are answered automatically; a vault which stops answering is
+// deemed hung, and is killed and restarted.
 class VaultInterface {
  public:
+  typedef std::function<void(uint64_t bytes_moved, uint64_t total_bytes)> MoveProgressFunctor;
+  // Should move the chunkstore to 'new_vault_dir' while the vault keeps serving requests, returning
+  // once the vault uses the new location, or throw leaving the vault using the old one.  It's run
+  // on its own thread and may report progress as often as it likes.
+  typedef std::function<void(const boost::filesystem::path& new_vault_dir,
+                             DiskUsage max_disk_usage, MoveProgressFunctor report_progress)>
+      MoveChunkstoreFunctor;
+
+  // Connects as directed by 'vault_manager_argument', the first positional argument which the
+  // VaultManager passes to each vault it starts: its TCP port, or if it opted into another
+  // VaultChannel, the path of its Unix domain socket or the inherited channel.  Throws if the
+  // argument is none of these.
+  static std::unique_ptr<VaultInterface> MakeUnique(const std::string& vault_manager_argument);
+
   explicit VaultInterface(Port vault_manager_port);
+#ifndef MAIDSAFE_WIN32
+  // Connects via the VaultManager's Unix domain socket.
+  explicit VaultInterface(const boost::filesystem::path& vault_manager_socket_path);
+  // Takes ownership of the inherited channel rather than connecting back to the VaultManager.
+  explicit VaultInterface(InheritedChannel vault_manager_channel);
+#endif
+  // Waits for any chunkstore move in progress to finish.
+  ~VaultInterface();
 
+  // Reflects any chunkstore move completed since the vault started.
   VaultConfig GetConfiguration();
 
+  // Until this is set, the VaultManager moves the chunkstore by restarting the vault.
+  void SetMoveChunkstoreFunctor(MoveChunkstoreFunctor move_chunkstore);
+
   // Doesn't throw.
   int WaitForExit();
 
   void SendBootstrapContactToVaultManager(const routing::BootstrapContact& contact);
+  void SendLogMessageToVaultManager(const std::string& log_message);
   void SendJoined();
+  // The number of fire-and-forget messages dropped since the shared memory ring was full.
+  uint64_t DroppedMessageCount();
 
 #ifdef TESTING
   void KillConnection();
@@ -67,18 +121,47 @@ class VaultInterface {
   VaultInterface(VaultInterface&&) = delete;
   VaultInterface& operator=(VaultInterface) = delete;
 
+  explicit VaultInterface(
+      std::function<std::shared_ptr<TcpConnection>(AsioService&)> connect_to_vault_manager);
   void HandleReceivedMessage(const std::string& wrapped_message);
   void OnConnectionClosed();
 
+  std::shared_ptr<TcpConnection> Connection();
+  // Must be called with connection_mutex_ held.
+  void ScheduleReconnect();
+  void Reconnect();
+
   void HandleVaultStartedResponse(const std::string& message);
+  // Opens the shared memory ring and records the reconnect address, if provided.
+  void ApplyConnectionDetails(const std::string& vault_started_response);
   void HandleVaultShutdownRequest();
+  // Answered here on the io thread, so this only shows that the vault's connection is serviced.
+  void HandleHealthProbe(const std::string& message);
+  void HandleMoveChunkstoreRequest(const std::string& message);
+  void MoveChunkstore(MoveChunkstoreFunctor move_chunkstore, boost::filesystem::path new_vault_dir,
+                      DiskUsage max_disk_usage);
 
   std::promise<int> exit_code_promise_;
   std::once_flag exit_code_flag_;
-  Port vault_manager_port_;
   std::function<void(std::string)> on_vault_started_response_;
+  // Guards vault_config_ once it's been received, along with the chunkstore move members.
+  std::mutex mutex_;
   std::unique_ptr<VaultConfig> vault_config_;
+  MoveChunkstoreFunctor move_chunkstore_;
+  std::future<void> chunkstore_move_;
+  // Guards ring_ and dropped_message_count_.
+  std::mutex ring_mutex_;
+  std::unique_ptr<SharedMemoryRing> ring_;
+  uint64_t dropped_message_count_;
+  // Guards tcp_connection_ once the constructor has completed, along with the reconnect members.
+  std::mutex connection_mutex_;
+  // Empty unless the VaultManager has provided one.
+  std::string reconnect_address_;
+  // Set once the vault has been asked to stop, or is being destroyed.
+  bool exiting_;
+  std::chrono::steady_clock::time_point reconnect_deadline_;
   AsioService asio_service_;
+  std::unique_ptr<boost::asio::steady_timer> reconnect_timer_;
   std::shared_ptr<TcpConnection> tcp_connection_;
   // We need to ensure the connection is closed in the event of the constructor throwing, or the
   // asio_service destructor will hang.
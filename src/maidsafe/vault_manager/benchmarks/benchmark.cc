@@ -0,0 +1,166 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/benchmarks/benchmark.h"
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <thread>
+
+#include "boost/exception/diagnostic_information.hpp"
+
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace benchmark {
+
+namespace {
+
+std::vector<std::pair<std::string, BenchmarkFunctor>>& Registry() {
+  static std::vector<std::pair<std::string, BenchmarkFunctor>> registry;
+  return registry;
+}
+
+std::string Quoted(const std::string& input) {
+  std::string output{ "\"" };
+  for (char c : input) {
+    if (c == '"' || c == '\\')
+      output += '\\';
+    output += c;
+  }
+  return output + "\"";
+}
+
+double Percentile(const std::vector<double>& sorted_samples, double percentile) {
+  size_t index{ static_cast<size_t>(percentile / 100.0 * (sorted_samples.size() - 1) + 0.5) };
+  return sorted_samples[std::min(index, sorted_samples.size() - 1)];
+}
+
+void WriteJson(const std::vector<Reporter::Result>& results, std::ostream& output) {
+  char date[32] = {};
+  std::time_t now{ std::time(nullptr) };
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+  output << "{\n  \"context\": {\n    \"date\": " << Quoted(date)
+         << ",\n    \"hardware_concurrency\": " << std::thread::hardware_concurrency()
+#ifdef NDEBUG
+         << ",\n    \"build_type\": \"release\"\n  },\n";
+#else
+         << ",\n    \"build_type\": \"debug\"\n  },\n";
+#endif
+  output << "  \"benchmarks\": [";
+  for (size_t i(0); i < results.size(); ++i) {
+    output << (i == 0 ? "\n" : ",\n") << "    {\n      \"name\": " << Quoted(results[i].name);
+    for (const auto& metric : results[i].metrics)
+      output << ",\n      " << Quoted(metric.first) << ": " << metric.second;
+    output << "\n    }";
+  }
+  output << "\n  ]\n}\n";
+}
+
+}  // unnamed namespace
+
+Reporter::Reporter(std::string benchmark_name)
+    : kBenchmarkName_(std::move(benchmark_name)), results_() {}
+
+void Reporter::StartResult(const std::string& label) {
+  Result result;
+  result.name = label.empty() ? kBenchmarkName_ : kBenchmarkName_ + "/" + label;
+  results_.push_back(std::move(result));
+}
+
+void Reporter::AddMetric(const std::string& metric, double value) {
+  if (results_.empty())
+    StartResult(std::string{});
+  results_.back().metrics.emplace_back(metric, value);
+}
+
+void Reporter::AddSamples(const std::string& metric, std::vector<double> samples) {
+  AddMetric(metric + "_count", static_cast<double>(samples.size()));
+  if (samples.empty())
+    return;
+  std::sort(std::begin(samples), std::end(samples));
+  AddMetric(metric + "_mean",
+            std::accumulate(std::begin(samples), std::end(samples), 0.0) / samples.size());
+  AddMetric(metric + "_p50", Percentile(samples, 50));
+  AddMetric(metric + "_p90", Percentile(samples, 90));
+  AddMetric(metric + "_p99", Percentile(samples, 99));
+  AddMetric(metric + "_max", samples.back());
+}
+
+bool Register(const std::string& name, BenchmarkFunctor benchmark) {
+  Registry().emplace_back(name, benchmark);
+  return true;
+}
+
+int RunAll(int argc, char* argv[]) {
+  auto unuseds(log::Logging::Instance().Initialise(argc, argv));
+  std::string filter, output_path;
+  for (size_t i(1); i < unuseds.size(); ++i) {
+    std::string arg{ &unuseds[i][0] };
+    if (arg.compare(0, 9, "--filter=") == 0) {
+      filter = arg.substr(9);
+    } else if (arg.compare(0, 9, "--output=") == 0) {
+      output_path = arg.substr(9);
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--filter=<substring>] [--output=<file.json>]\n";
+      return 1;
+    }
+  }
+
+  std::vector<Reporter::Result> results;
+  int failures{ 0 };
+  for (const auto& name_and_benchmark : Registry()) {
+    if (name_and_benchmark.first.find(filter) == std::string::npos)
+      continue;
+    std::cerr << "Running " << name_and_benchmark.first << "..." << std::endl;
+    Reporter reporter{ name_and_benchmark.first };
+    try {
+      name_and_benchmark.second(reporter);
+    }
+    catch (const std::exception& e) {
+      std::cerr << name_and_benchmark.first << " failed: " << boost::diagnostic_information(e);
+      ++failures;
+    }
+    results.insert(std::end(results), std::begin(reporter.Results()),
+                   std::end(reporter.Results()));
+  }
+
+  if (output_path.empty()) {
+    WriteJson(results, std::cout);
+  } else {
+    std::ofstream output{ output_path.c_str() };
+    WriteJson(results, output);
+    if (!output.good()) {
+      std::cerr << "Failed to write " << output_path << '\n';
+      return 1;
+    }
+  }
+  return failures == 0 ? 0 : 1;
+}
+
+}  // namespace benchmark
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,85 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_BENCHMARKS_BENCHMARK_H_
+#define MAIDSAFE_VAULT_MANAGER_BENCHMARKS_BENCHMARK_H_
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace benchmark {
+
+// Collects the results reported by a single benchmark.  A benchmark may report several results,
+// e.g. one per message size, each of which is named '<benchmark name>/<label>'.
+class Reporter {
+ public:
+  struct Result {
+    std::string name;
+    std::vector<std::pair<std::string, double>> metrics;
+  };
+
+  explicit Reporter(std::string benchmark_name);
+
+  // Starts a new result; subsequent metrics are added to it.
+  void StartResult(const std::string& label);
+  void AddMetric(const std::string& metric, double value);
+  // Adds '<metric>_count', '<metric>_mean', '<metric>_p50', '<metric>_p90', '<metric>_p99' and
+  // '<metric>_max'.
+  void AddSamples(const std::string& metric, std::vector<double> samples);
+  const std::vector<Result>& Results() const { return results_; }
+
+ private:
+  const std::string kBenchmarkName_;
+  std::vector<Result> results_;
+};
+
+typedef std::function<void(Reporter&)> BenchmarkFunctor;
+
+// Returns true so that it can be used to initialise a namespace-scope constant.
+bool Register(const std::string& name, BenchmarkFunctor benchmark);
+
+// Runs all registered benchmarks whose names contain the '--filter' argument (if given), and writes
+// the results as JSON to the '--output' file (or stdout).
+int RunAll(int argc, char* argv[]);
+
+template <typename Duration>
+double ToMicroseconds(Duration duration) {
+  return std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(duration).count();
+}
+
+}  // namespace benchmark
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#define MAIDSAFE_VAULT_MANAGER_BENCHMARK(name)                                               \
+  void Benchmark##name(::maidsafe::vault_manager::benchmark::Reporter& reporter);           \
+  const bool kBenchmark##name##Registered{                                                   \
+      ::maidsafe::vault_manager::benchmark::Register(#name, Benchmark##name) };             \
+  void Benchmark##name(::maidsafe::vault_manager::benchmark::Reporter& reporter)
+
+#endif  // MAIDSAFE_VAULT_MANAGER_BENCHMARKS_BENCHMARK_H_
@@ -0,0 +1,126 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/vault_manager/benchmarks/benchmark.h"
+#include "maidsafe/vault_manager/config.h"
+#include "maidsafe/vault_manager/interprocess_messages.pb.h"
+#include "maidsafe/vault_manager/utils.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace benchmark {
+
+namespace {
+
+const int kIterations(20000);
+
+// Reports the mean cost of wrapping and unwrapping 'payload' as 'type'.
+void MeasureWrapAndUnwrap(Reporter& reporter, MessageType type, const std::string& payload) {
+  std::ostringstream label;
+  label << type;
+  reporter.StartResult(label.str());
+  reporter.AddMetric("payload_size", static_cast<double>(payload.size()));
+
+  std::string wrapped;
+  auto start(std::chrono::steady_clock::now());
+  for (int i(0); i < kIterations; ++i)
+    wrapped = WrapMessage(std::make_pair(payload, type));
+  reporter.AddMetric("wrap_ns", ToMicroseconds(std::chrono::steady_clock::now() - start) * 1000.0 /
+                                kIterations);
+
+  MessageAndType unwrapped;
+  start = std::chrono::steady_clock::now();
+  for (int i(0); i < kIterations; ++i)
+    unwrapped = UnwrapMessage(wrapped);
+  reporter.AddMetric("unwrap_ns", ToMicroseconds(std::chrono::steady_clock::now() - start) *
+                                  1000.0 / kIterations);
+}
+
+// As above, and also reports the mean cost of parsing the unwrapped payload.
+template <typename ProtobufMessage>
+void Measure(Reporter& reporter, MessageType type, const ProtobufMessage& message) {
+  std::string payload{ message.SerializeAsString() };
+  MeasureWrapAndUnwrap(reporter, type, payload);
+  auto start(std::chrono::steady_clock::now());
+  for (int i(0); i < kIterations; ++i)
+    ParseProto<ProtobufMessage>(payload);
+  reporter.AddMetric("parse_ns", ToMicroseconds(std::chrono::steady_clock::now() - start) *
+                                 1000.0 / kIterations);
+}
+
+}  // unnamed namespace
+
+// Payload sizes approximate those of real messages.
+MAIDSAFE_VAULT_MANAGER_BENCHMARK(WrapUnwrapParse) {
+  MeasureWrapAndUnwrap(reporter, MessageType::kValidateConnectionRequest, std::string{});
+  {
+    protobuf::Challenge message;
+    message.set_plaintext(RandomString(150));
+    Measure(reporter, MessageType::kChallenge, message);
+  }
+  {
+    protobuf::ChallengeResponse message;
+    message.set_public_maid_name(RandomString(64));
+    message.set_public_maid_value(RandomString(600));
+    message.set_signature(RandomString(512));
+    Measure(reporter, MessageType::kChallengeResponse, message);
+  }
+  {
+    protobuf::StartVaultRequest message;
+    message.set_label(RandomString(24));
+    message.set_vault_dir(RandomString(60));
+    message.set_max_disk_usage(RandomUint32());
+    Measure(reporter, MessageType::kStartVaultRequest, message);
+  }
+  {
+    protobuf::VaultStarted message;
+    message.set_process_id(RandomUint32());
+    Measure(reporter, MessageType::kVaultStarted, message);
+  }
+  {
+    protobuf::VaultStartedResponse message;
+    message.set_aes256key(RandomString(32));
+    message.set_aes256iv(RandomString(16));
+    message.set_encrypted_pmid(RandomString(2500));
+    message.set_vault_dir(RandomString(60));
+    message.set_max_disk_usage(RandomUint32());
+    message.set_serialised_bootstrap_contacts(RandomString(1500));
+    Measure(reporter, MessageType::kVaultStartedResponse, message);
+  }
+  {
+    protobuf::BootstrapContact message;
+    message.set_serialised_contact(RandomString(30));
+    Measure(reporter, MessageType::kBootstrapContact, message);
+  }
+  MeasureWrapAndUnwrap(reporter, MessageType::kLogMessage, RandomString(200));
+}
+
+}  // namespace benchmark
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
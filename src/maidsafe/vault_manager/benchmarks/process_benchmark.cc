@@ -0,0 +1,81 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/on_scope_exit.h"
+#include "maidsafe/common/process.h"
+#include "maidsafe/passport/passport.h"
+
+#include "maidsafe/vault_manager/client_interface.h"
+#include "maidsafe/vault_manager/utils.h"
+#include "maidsafe/vault_manager/vault_manager.h"
+#include "maidsafe/vault_manager/benchmarks/benchmark.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace benchmark {
+
+#ifdef TESTING
+// Measures the time from a client's StartVault request until it receives the VaultRunningResponse,
+// i.e. the spawn of 'dummy_vault', its VaultStarted message and the VaultManager's bookkeeping.
+// Pmids are generated up front so that key generation isn't included.
+MAIDSAFE_VAULT_MANAGER_BENCHMARK(VaultSpawn) {
+  const int kVaultCount(20);
+  fs::path test_env_root_dir{ fs::temp_directory_path() /
+                              fs::unique_path("MaidSafe_BenchVaultManager_%%%%-%%%%") };
+  fs::create_directories(test_env_root_dir);
+  on_scope_exit remove_test_dir{ [&] {
+    boost::system::error_code ignored_ec;
+    fs::remove_all(test_env_root_dir, ignored_ec);
+  } };
+  test::SetEnvironment(Port{ 7788 }, test_env_root_dir,
+                       process::GetOtherExecutablePath(fs::path{ "dummy_vault" }),
+                       routing::BootstrapContact{}, kVaultCount);
+
+  std::vector<double> samples;
+  {
+    VaultManager vault_manager;
+    ClientInterface client_interface{ passport::CreateMaidAndSigner().first };
+    for (int i(0); i < kVaultCount; ++i) {
+      fs::path vault_dir{ test_env_root_dir / ("vault_" + std::to_string(i)) };
+      fs::create_directories(vault_dir);
+      auto start(std::chrono::steady_clock::now());
+      client_interface.StartVault(vault_dir, DiskUsage{ 1 << 30 }, i).get();
+      samples.push_back(ToMicroseconds(std::chrono::steady_clock::now() - start));
+    }
+  }
+  reporter.AddSamples("spawn_to_running_us", samples);
+}
+#endif
+
+}  // namespace benchmark
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
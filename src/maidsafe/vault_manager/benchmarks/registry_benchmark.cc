@@ -0,0 +1,104 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/vault_manager/benchmarks/benchmark.h"
+#include "maidsafe/vault_manager/vault_info.h"
+#include "maidsafe/vault_manager/vault_registry.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace benchmark {
+
+namespace {
+
+struct Entry {
+  VaultInfo info;
+  ProcessId process_id;
+};
+
+double NanosecondsPerOp(std::chrono::steady_clock::duration duration, size_t op_count) {
+  return ToMicroseconds(duration) * 1000.0 / static_cast<double>(op_count);
+}
+
+}  // unnamed namespace
+
+// Reports the mean cost of each ProcessManager registry operation as the number of managed vaults
+// grows; these should stay roughly constant.
+MAIDSAFE_VAULT_MANAGER_BENCHMARK(VaultRegistryScaling) {
+  for (size_t vault_count : { 16U, 256U, 1024U, 4096U }) {
+    std::vector<NonEmptyString> labels;
+    for (size_t i(0); i < vault_count; ++i)
+      labels.push_back(NonEmptyString{ "vault_" + std::to_string(i) });
+
+    VaultRegistry<Entry> registry;
+    std::vector<VaultRegistry<Entry>::iterator> entries;
+    auto start(std::chrono::steady_clock::now());
+    for (size_t i(0); i < vault_count; ++i) {
+      Entry entry;
+      entry.info.label = labels[i];
+      entry.info.vault_dir = "/vaults/" + labels[i].string();
+      entry.process_id = 0;
+      entries.push_back(registry.Add(entry));
+    }
+    const auto kAddDuration(std::chrono::steady_clock::now() - start);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i(0); i < vault_count; ++i)
+      registry.SetProcessId(entries[i], 1000 + i);
+    const auto kSetProcessIdDuration(std::chrono::steady_clock::now() - start);
+
+    size_t found(0);
+    start = std::chrono::steady_clock::now();
+    for (const auto& label : labels)
+      found += (registry.FindByLabel(label) != std::end(registry)) ? 1 : 0;
+    const auto kFindByLabelDuration(std::chrono::steady_clock::now() - start);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i(0); i < vault_count; ++i)
+      found += (registry.FindByProcessId(1000 + i) != std::end(registry)) ? 1 : 0;
+    const auto kFindByProcessIdDuration(std::chrono::steady_clock::now() - start);
+
+    start = std::chrono::steady_clock::now();
+    for (auto itr : entries)
+      registry.Erase(itr);
+    const auto kEraseDuration(std::chrono::steady_clock::now() - start);
+
+    reporter.StartResult(std::to_string(vault_count) + "_vaults");
+    reporter.AddMetric("add_ns", NanosecondsPerOp(kAddDuration, vault_count));
+    reporter.AddMetric("set_process_id_ns", NanosecondsPerOp(kSetProcessIdDuration, vault_count));
+    reporter.AddMetric("find_by_label_ns", NanosecondsPerOp(kFindByLabelDuration, vault_count));
+    reporter.AddMetric("find_by_process_id_ns",
+                       NanosecondsPerOp(kFindByProcessIdDuration, vault_count));
+    reporter.AddMetric("erase_ns", NanosecondsPerOp(kEraseDuration, vault_count));
+    reporter.AddMetric("found", static_cast<double>(found));
+  }
+}
+
+}  // namespace benchmark
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,82 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_WIN32
+
+#include <sys/wait.h>
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "boost/asio/io_service.hpp"
+
+#include "maidsafe/vault_manager/benchmarks/benchmark.h"
+#include "maidsafe/vault_manager/spawn.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace benchmark {
+
+namespace {
+
+const int kSpawnCount(200);
+
+// Reports how long the spawning thread is blocked per spawn, i.e. excluding the child's run time.
+void MeasureSpawn(Reporter& reporter, const std::string& label,
+                  const std::function<boost::process::child()>& spawn) {
+  std::vector<double> samples;
+  for (int i(0); i < kSpawnCount; ++i) {
+    auto start(std::chrono::steady_clock::now());
+    boost::process::child child{ spawn() };
+    samples.push_back(ToMicroseconds(std::chrono::steady_clock::now() - start));
+    waitpid(child.pid, nullptr, 0);
+  }
+  reporter.StartResult(label);
+  reporter.AddSamples("spawn_us", samples);
+}
+
+}  // unnamed namespace
+
+// Compares posix_spawn with fork and exec as this process' resident memory grows, since fork has
+// to copy the page tables.
+MAIDSAFE_VAULT_MANAGER_BENCHMARK(VaultSpawnMethods) {
+  boost::asio::io_service io_service;
+  const std::vector<std::string> kArgs{ "sh", "-c", ":" };
+  std::vector<char> ballast;
+  for (size_t ballast_mib : { 0U, 64U, 512U }) {
+    ballast.resize(ballast_mib << 20);
+    std::memset(ballast.data(), 1, ballast.size());  // Ensure the pages are resident.
+    const std::string kSuffix{ "/" + std::to_string(ballast_mib) + "MiB_resident" };
+    MeasureSpawn(reporter, "posix_spawn" + kSuffix, [&] { return PosixSpawn("/bin/sh", kArgs); });
+    MeasureSpawn(reporter, "fork_exec" + kSuffix,
+                 [&] { return ForkAndExec(io_service, "/bin/sh", kArgs); });
+  }
+}
+
+}  // namespace benchmark
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif
@@ -0,0 +1,219 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/on_scope_exit.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/vault_manager/benchmarks/benchmark.h"
+#include "maidsafe/vault_manager/config.h"
+#include "maidsafe/vault_manager/tcp_connection.h"
+#include "maidsafe/vault_manager/tcp_listener.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace benchmark {
+
+namespace {
+
+// Counts received messages and allows waiting for a given total.
+class Counter {
+ public:
+  Counter() : mutex_(), cond_var_(), count_(0) {}
+
+  void Increment() {
+    {
+      std::lock_guard<std::mutex> lock{ mutex_ };
+      ++count_;
+    }
+    cond_var_.notify_all();
+  }
+
+  bool WaitFor(uint64_t target) {
+    std::unique_lock<std::mutex> lock{ mutex_ };
+    return cond_var_.wait_for(lock, std::chrono::seconds(60), [&] { return count_ >= target; });
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cond_var_;
+  uint64_t count_;
+};
+
+}  // unnamed namespace
+
+MAIDSAFE_VAULT_MANAGER_BENCHMARK(RoundTripLatency) {
+  AsioService client_asio_service{ 1 }, server_asio_service{ 1 };
+  std::promise<TcpConnectionPtr> server_promise;
+  TcpListenerPtr listener{ TcpListener::MakeShared(server_asio_service,
+      [&](TcpConnectionPtr connection) { server_promise.set_value(connection); }, Port{ 7777 }) };
+  on_scope_exit stop_listening{ [listener] { listener->StopListening(); } };
+
+  Counter counter;
+  TcpConnectionPtr client{ TcpConnection::MakeShared(client_asio_service,
+                                                     listener->ListeningPort()) };
+  client->Start([&](const std::string&) { counter.Increment(); }, [] {});
+  TcpConnectionPtr server{ server_promise.get_future().get() };
+  // The server echoes every message back.
+  std::weak_ptr<TcpConnection> weak_server{ server };
+  server->Start([weak_server](const std::string& message) {
+                  if (TcpConnectionPtr server_connection = weak_server.lock())
+                    server_connection->Send(message);
+                },
+                [] {});
+  on_scope_exit close_connections{ [client, server] {
+    client->Close();
+    server->Close();
+  } };
+
+  std::vector<size_t> sizes{ 16, 1024, 64 * 1024, 1024 * 1024, TcpConnection::MaxMessageSize() };
+  uint64_t received{ 0 };
+  for (size_t size : sizes) {
+    // Aim for roughly 256 MiB of traffic per size, between 20 and 2000 round trips.
+    size_t iterations{ std::max<size_t>(20, std::min<size_t>(2000, (256 << 20) / size)) };
+    std::string message{ RandomString(size) };
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    for (size_t i(0); i < iterations; ++i) {
+      auto start(std::chrono::steady_clock::now());
+      client->Send(message);
+      if (!counter.WaitFor(++received))
+        BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::timed_out));
+      samples.push_back(ToMicroseconds(std::chrono::steady_clock::now() - start));
+    }
+    reporter.StartResult(std::to_string(size));
+    reporter.AddMetric("message_size", static_cast<double>(size));
+    reporter.AddSamples("round_trip_us", samples);
+  }
+}
+
+MAIDSAFE_VAULT_MANAGER_BENCHMARK(FanIn) {
+  // Many clients each send a burst of messages to a single server connection per client.
+  const size_t kMessagesPerClient(2000), kMessageSize(1024);
+  const std::string kMessage(RandomString(kMessageSize));
+  for (size_t client_count : std::vector<size_t>{ 1, 8, 64 }) {
+    AsioService client_asio_service{ 2 };
+    AsioService server_asio_service{ std::max(2U, std::thread::hardware_concurrency()) };
+    Counter counter, connected;
+    std::mutex mutex;
+    std::vector<TcpConnectionPtr> server_connections;
+    TcpListenerPtr listener{ TcpListener::MakeShared(server_asio_service,
+        [&](TcpConnectionPtr connection) {
+          connection->Start([&](const std::string&) { counter.Increment(); }, [] {});
+          {
+            std::lock_guard<std::mutex> lock{ mutex };
+            server_connections.push_back(connection);
+          }
+          connected.Increment();
+        },
+        Port{ 7777 }) };
+
+    std::vector<TcpConnectionPtr> clients;
+    on_scope_exit cleanup{ [&] {
+      listener->StopListening();
+      for (auto& client : clients)
+        client->Close();
+      std::lock_guard<std::mutex> lock{ mutex };
+      for (auto& server_connection : server_connections)
+        server_connection->Close();
+    } };
+    for (size_t i(0); i < client_count; ++i) {
+      clients.push_back(TcpConnection::MakeShared(client_asio_service, listener->ListeningPort()));
+      clients.back()->Start([](const std::string&) {}, [] {});
+    }
+    if (!connected.WaitFor(client_count))
+      BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::timed_out));
+
+    auto start(std::chrono::steady_clock::now());
+    for (size_t i(0); i < kMessagesPerClient; ++i) {
+      for (auto& client : clients)
+        client->Send(kMessage);
+    }
+    if (!counter.WaitFor(client_count * kMessagesPerClient))
+      BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::timed_out));
+    double elapsed_us{ ToMicroseconds(std::chrono::steady_clock::now() - start) };
+
+    double message_count{ static_cast<double>(client_count * kMessagesPerClient) };
+    reporter.StartResult(std::to_string(client_count) + "_clients");
+    reporter.AddMetric("client_count", static_cast<double>(client_count));
+    reporter.AddMetric("message_size", static_cast<double>(kMessageSize));
+    reporter.AddMetric("elapsed_us", elapsed_us);
+    reporter.AddMetric("messages_per_second", message_count * 1e6 / elapsed_us);
+    reporter.AddMetric("megabytes_per_second", message_count * kMessageSize / elapsed_us);
+  }
+}
+
+MAIDSAFE_VAULT_MANAGER_BENCHMARK(BatchedSend) {
+  // A burst of small messages sent one message per write, and with the default batching.
+  const size_t kMessageCount(20000), kMessageSize(200);
+  const std::string kMessage(RandomString(kMessageSize));
+  for (size_t max_batch_messages : std::vector<size_t>{ 1, kMaxSendBatchMessages }) {
+    AsioService client_asio_service{ 1 }, server_asio_service{ 1 };
+    Counter counter;
+    std::promise<TcpConnectionPtr> server_promise;
+    TcpListenerPtr listener{ TcpListener::MakeShared(server_asio_service,
+        [&](TcpConnectionPtr connection) { server_promise.set_value(connection); },
+        Port{ 7777 }) };
+    on_scope_exit stop_listening{ [listener] { listener->StopListening(); } };
+
+    TcpConnectionPtr client{ TcpConnection::MakeShared(client_asio_service,
+                                                       listener->ListeningPort()) };
+    client->Start([](const std::string&) {}, [] {});
+    TcpConnectionPtr server{ server_promise.get_future().get() };
+    server->Start([&](const std::string&) { counter.Increment(); }, [] {});
+    on_scope_exit close_connections{ [client, server] {
+      client->Close();
+      server->Close();
+    } };
+    client->SetSendBatchLimits(kMaxSendBatchBytes, max_batch_messages);
+
+    auto start(std::chrono::steady_clock::now());
+    for (size_t i(0); i < kMessageCount; ++i)
+      client->Send(kMessage);
+    if (!counter.WaitFor(kMessageCount))
+      BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::timed_out));
+    double elapsed_us{ ToMicroseconds(std::chrono::steady_clock::now() - start) };
+
+    TcpConnection::SendStats stats{ client->GetSendStats() };
+    reporter.StartResult(max_batch_messages == 1 ? "unbatched" : "batched");
+    reporter.AddMetric("max_batch_messages", static_cast<double>(max_batch_messages));
+    reporter.AddMetric("message_size", static_cast<double>(kMessageSize));
+    reporter.AddMetric("write_count", static_cast<double>(stats.write_count));
+    reporter.AddMetric("elapsed_us", elapsed_us);
+    reporter.AddMetric("messages_per_second", kMessageCount * 1e6 / elapsed_us);
+  }
+}
+
+}  // namespace benchmark
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
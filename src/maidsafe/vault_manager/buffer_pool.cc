@@ -0,0 +1,96 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/buffer_pool.h"
+
+#include <algorithm>
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+const size_t BufferPool::kMinClassSize;
+
+BufferPool::BufferPool(size_t max_buffer_size, size_t max_pooled_bytes)
+    : kMaxBufferSize_(std::max(max_buffer_size, kMinClassSize)),
+      kMaxPooledBytes_(max_pooled_bytes),
+      mutex_(),
+      free_buffers_([this]()->size_t {
+        size_t class_count{ 1 };
+        while (ClassSize(class_count - 1) < kMaxBufferSize_)
+          ++class_count;
+        return class_count;
+      }()),
+      pooled_bytes_(0),
+      stats_() {}
+
+std::string BufferPool::Acquire(size_t size) {
+  size_t class_index{ 0 };
+  while (ClassSize(class_index) < size && class_index + 1 < free_buffers_.size())
+    ++class_index;
+
+  std::string buffer;
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    // Any buffer in a class at least as large as 'size' will do, but we only check the smallest
+    // suitable class to avoid holding on to the larger buffers for small messages.
+    auto& free_list(free_buffers_[class_index]);
+    if (size <= ClassSize(class_index) && !free_list.empty()) {
+      buffer.swap(free_list.back());
+      free_list.pop_back();
+      pooled_bytes_ -= buffer.capacity();
+      ++stats_.hits;
+    } else {
+      ++stats_.misses;
+    }
+  }
+
+  if (buffer.capacity() < size)
+    buffer.reserve(std::max(size, std::min(ClassSize(class_index), kMaxBufferSize_)));
+  buffer.resize(size);
+  return buffer;
+}
+
+void BufferPool::Release(std::string buffer) {
+  const size_t capacity{ buffer.capacity() };
+  if (capacity < kMinClassSize)
+    return;
+
+  // Place the buffer in the largest class which it can fully satisfy.
+  size_t class_index{ 0 };
+  while (class_index + 1 < free_buffers_.size() && ClassSize(class_index + 1) <= capacity)
+    ++class_index;
+
+  buffer.clear();
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  if (pooled_bytes_ + capacity > kMaxPooledBytes_) {
+    ++stats_.discards;
+    return;
+  }
+  pooled_bytes_ += capacity;
+  free_buffers_[class_index].emplace_back(std::move(buffer));
+}
+
+BufferPool::Stats BufferPool::GetStats() const {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  return stats_;
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
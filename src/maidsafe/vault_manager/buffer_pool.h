@@ -0,0 +1,72 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_BUFFER_POOL_H_
+#define MAIDSAFE_VAULT_MANAGER_BUFFER_POOL_H_
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// A pool of reusable std::string buffers, bucketed in power-of-two size classes from
+// 'kMinClassSize' up to 'max_buffer_size'.  Released buffers are retained (as long as the total
+// capacity held doesn't exceed 'max_pooled_bytes') so that subsequent requests for a buffer of a
+// similar size don't need a heap allocation.  Thread-safe.
+class BufferPool {
+ public:
+  struct Stats {
+    Stats() : hits(0), misses(0), discards(0) {}
+    uint64_t hits;  // Acquire satisfied by a pooled buffer.
+    uint64_t misses;  // Acquire needed a new allocation.
+    uint64_t discards;  // Release freed the buffer since the pool was full.
+  };
+
+  static const size_t kMinClassSize = 64;
+
+  BufferPool(size_t max_buffer_size, size_t max_pooled_bytes);
+
+  // Returns a buffer of exactly 'size' bytes with unspecified contents.
+  std::string Acquire(size_t size);
+  // Returns 'buffer' to the pool, or frees it if the pool is full or the buffer is too small.
+  void Release(std::string buffer);
+  Stats GetStats() const;
+
+ private:
+  BufferPool(const BufferPool&) = delete;
+  BufferPool(BufferPool&&) = delete;
+  BufferPool& operator=(BufferPool) = delete;
+
+  size_t ClassSize(size_t class_index) const { return kMinClassSize << class_index; }
+
+  const size_t kMaxBufferSize_, kMaxPooledBytes_;
+  mutable std::mutex mutex_;
+  std::vector<std::vector<std::string>> free_buffers_;
+  size_t pooled_bytes_;
+  Stats stats_;
+};
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_BUFFER_POOL_H_
@@ -29,12 +29,18 @@ namespace maidsafe {
 
 namespace vault_manager {
 
-ClientConnections::ClientConnections(boost::asio::io_service& io_service)
-    : io_service_(io_service), unvalidated_clients_(), clients_() {}
+ClientConnections::ClientConnections(boost::asio::io_service& io_service,
+                                     WorkerPool& verification_pool)
+    : timer_wheel_(GetTimerWheel(io_service)),
+      verification_pool_(verification_pool),
+      mutex_(),
+      unvalidated_clients_(),
+      clients_() {}
 
 std::shared_ptr<ClientConnections> ClientConnections::MakeShared(
-    boost::asio::io_service& io_service) {
-  return std::shared_ptr<ClientConnections>{ new ClientConnections{ io_service } };
+    boost::asio::io_service& io_service, WorkerPool& verification_pool) {
+  return std::shared_ptr<ClientConnections>{
+      new ClientConnections{ io_service, verification_pool } };
 }
 
 ClientConnections::~ClientConnections() {
@@ -42,46 +48,84 @@ ClientConnections::~ClientConnections() {
 }
 
 void ClientConnections::Add(TcpConnectionPtr connection, const asymm::PlainText& challenge) {
+  TimerWheel::TimeoutId timeout{ timer_wheel_.Arm(kRpcTimeout, [connection] {
+    LOG(kWarning) << "Timed out waiting for Client to validate.";
+    connection->Close();
+  }) };
+  std::lock_guard<std::mutex> lock{ mutex_ };
   assert(clients_.find(connection) == std::end(clients_));
-  TimerPtr timer{ std::make_shared<Timer>(io_service_, kRpcTimeout) };
-  timer->async_wait([=](const boost::system::error_code& error_code) {
-    if (error_code && error_code == boost::asio::error::operation_aborted) {
-      LOG(kVerbose) << "Client connection timer cancelled OK.";
-    } else {
-      LOG(kWarning) << "Timed out waiting for Client to validate.";
-      connection->Close();
-    }
-  });
-  bool result{ unvalidated_clients_.emplace(connection, std::make_pair(challenge, timer)).second };
+  bool result{
+      unvalidated_clients_.emplace(connection, std::make_pair(challenge, timeout)).second };
   assert(result);
   static_cast<void>(result);
 }
 
 void ClientConnections::Validate(TcpConnectionPtr connection, const passport::PublicMaid& maid,
                                  const asymm::Signature& signature) {
-  auto itr(unvalidated_clients_.find(connection));
-  if (itr == std::end(unvalidated_clients_)) {
-    LOG(kError) << "Unvalidated Client TCP connection not found.";
-    BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::connection_not_found));
+  asymm::PlainText challenge;
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    auto itr(unvalidated_clients_.find(connection));
+    if (itr == std::end(unvalidated_clients_)) {
+      LOG(kError) << "Unvalidated Client TCP connection not found.";
+      BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::connection_not_found));
+    }
+    challenge = itr->second.first;
   }
 
-  on_scope_exit cleanup{ [this, itr] { itr->first->Close(); } };
+  // Any request the client sends straight after its challenge response mustn't be handled until
+  // the client has been validated.
+  connection->PauseReceiving();
+  std::weak_ptr<ClientConnections> this_weak_ptr{ shared_from_this() };
+  if (!verification_pool_.Submit([this_weak_ptr, connection, challenge, maid, signature] {
+        if (auto this_ptr = this_weak_ptr.lock())
+          this_ptr->CheckChallengeResponse(connection, challenge, maid, signature);
+      })) {
+    LOG(kError) << "Too many Client challenge responses are awaiting verification.";
+    connection->Close();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unable_to_handle_request));
+  }
+}
+
+void ClientConnections::CheckChallengeResponse(TcpConnectionPtr connection,
+                                               const asymm::PlainText& challenge,
+                                               const passport::PublicMaid& maid,
+                                               const asymm::Signature& signature) {
+  {
+    // Skip the check if the connection timed out or closed while queued.
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    if (unvalidated_clients_.find(connection) == std::end(unvalidated_clients_))
+      return;
+  }
+
+  on_scope_exit cleanup{ [connection] { connection->Close(); } };
 
-  if (asymm::CheckSignature(itr->second.first, signature, maid.public_key())) {
+  if (asymm::CheckSignature(challenge, signature, maid.public_key())) {
     LOG(kSuccess) << "Client " << DebugId(maid.name().value) << " TCP connection validated.";
   } else {
     LOG(kError) << "Client TCP connection validation failed.";
-    BOOST_THROW_EXCEPTION(MakeError(AsymmErrors::invalid_signature));
+    return;
   }
 
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  // The connection could have timed out or closed while the signature was being checked.
+  auto itr(unvalidated_clients_.find(connection));
+  if (itr == std::end(unvalidated_clients_)) {
+    LOG(kWarning) << "Client TCP connection removed during validation.";
+    return;
+  }
   bool result{ clients_.emplace(connection, maid.name()).second };
+  timer_wheel_.Cancel(itr->second.second);
   unvalidated_clients_.erase(itr);
   cleanup.Release();
   assert(result);
   static_cast<void>(result);
+  // Passes on any messages held back since the challenge response, via the connection's strand.
+  connection->ResumeReceiving();
 }
 
 bool ClientConnections::Remove(TcpConnectionPtr connection) {
+  std::lock_guard<std::mutex> lock{ mutex_ };
   auto itr(clients_.find(connection));
   if (itr != std::end(clients_)) {
     clients_.erase(itr);
@@ -90,6 +134,7 @@ bool ClientConnections::Remove(TcpConnectionPtr connection) {
 
   auto unvalidated_itr(unvalidated_clients_.find(connection));
   if (unvalidated_itr != std::end(unvalidated_clients_)) {
+    timer_wheel_.Cancel(unvalidated_itr->second.second);
     unvalidated_clients_.erase(unvalidated_itr);
     return true;
   }
@@ -98,6 +143,7 @@ bool ClientConnections::Remove(TcpConnectionPtr connection) {
 }
 
 void ClientConnections::CloseAll() {
+  std::lock_guard<std::mutex> lock{ mutex_ };
   for (auto connection : unvalidated_clients_)
     connection.first->Close();
   for (auto connection : clients_)
@@ -105,6 +151,7 @@ void ClientConnections::CloseAll() {
 }
 
 ClientConnections::MaidName ClientConnections::FindValidated(TcpConnectionPtr connection) const {
+  std::lock_guard<std::mutex> lock{ mutex_ };
   auto itr(clients_.find(connection));
   if (itr == std::end(clients_)) {
     auto unvalidated_itr(unvalidated_clients_.find(connection));
@@ -120,6 +167,7 @@ ClientConnections::MaidName ClientConnections::FindValidated(TcpConnectionPtr co
 }
 
 TcpConnectionPtr ClientConnections::FindValidated(MaidName maid_name) const {
+  std::lock_guard<std::mutex> lock{ mutex_ };
   auto itr(std::find_if(std::begin(clients_), std::end(clients_),
                         [&maid_name](const std::pair<TcpConnectionPtr, MaidName> client) {
                           return client.second == maid_name;
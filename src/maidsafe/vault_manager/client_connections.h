@@ -21,6 +21,7 @@
 
 #include <map>
 #include <memory>
+#include <mutex>
 #include <utility>
 
 #include "boost/asio/io_service.hpp"
@@ -29,17 +30,28 @@
 #include "maidsafe/passport/types.h"
 
 #include "maidsafe/vault_manager/config.h"
+#include "maidsafe/vault_manager/timer_wheel.h"
+#include "maidsafe/vault_manager/worker_pool.h"
 
 namespace maidsafe {
 
 namespace vault_manager {
 
-class ClientConnections {
+// Thread-safe.  The challenge signature check in 'Validate' is done on 'verification_pool' so that
+// a burst of clients connecting doesn't tie up the AsioService threads (and hence vaults' messages)
+// behind the RSA checks.
+class ClientConnections : public std::enable_shared_from_this<ClientConnections> {
  public:
   typedef passport::PublicMaid::Name MaidName;
-  static std::shared_ptr<ClientConnections> MakeShared(boost::asio::io_service& io_service);
+  // 'verification_pool' must outlive this.
+  static std::shared_ptr<ClientConnections> MakeShared(boost::asio::io_service& io_service,
+                                                       WorkerPool& verification_pool);
   ~ClientConnections();
   void Add(TcpConnectionPtr connection, const asymm::PlainText& challenge);
+  // Must be called from the connection's MessageReceivedFunctor.  The connection's further messages
+  // are held back until the signature has been checked, after which they're passed on if it's
+  // valid; otherwise the connection is closed.  Throws if the connection isn't awaiting validation
+  // or the verification pool's queue is full, in which case the connection is closed.
   void Validate(TcpConnectionPtr connection, const passport::PublicMaid& maid,
                 const asymm::Signature& signature);
   bool Remove(TcpConnectionPtr connection);
@@ -48,10 +60,16 @@ class ClientConnections {
   TcpConnectionPtr FindValidated(MaidName maid_name) const;
 
  private:
-  explicit ClientConnections(boost::asio::io_service& io_service);
+  ClientConnections(boost::asio::io_service& io_service, WorkerPool& verification_pool);
 
-  boost::asio::io_service& io_service_;
-  std::map<TcpConnectionPtr, std::pair<asymm::PlainText, TimerPtr>,
+  // Runs on a thread of 'verification_pool_'.
+  void CheckChallengeResponse(TcpConnectionPtr connection, const asymm::PlainText& challenge,
+                              const passport::PublicMaid& maid, const asymm::Signature& signature);
+
+  TimerWheel& timer_wheel_;
+  WorkerPool& verification_pool_;
+  mutable std::mutex mutex_;
+  std::map<TcpConnectionPtr, std::pair<asymm::PlainText, TimerWheel::TimeoutId>,
            std::owner_less<TcpConnectionPtr>> unvalidated_clients_;
   std::map<TcpConnectionPtr, MaidName, std::owner_less<TcpConnectionPtr>> clients_;
 };
@@ -55,6 +55,9 @@ ClientInterface::ClientInterface(const passport::Maid& maid)
       mutex_(),
       on_challenge_(),
       on_bootstrap_contacts_response_(),
+      on_move_progress_(),
+      ongoing_vault_requests_(),
+      ongoing_usage_requests_(),
       asio_service_(1),
       tcp_connection_(ConnectToVaultManager()),
       connection_closer_([&] { tcp_connection_->Close(); }) {
@@ -66,13 +69,26 @@ ClientInterface::ClientInterface(const passport::Maid& maid)
 }
 
 std::shared_ptr<TcpConnection> ClientInterface::ConnectToVaultManager() {
+#ifndef MAIDSAFE_WIN32
+  try {
+    boost::filesystem::path socket_path{ GetLocalSocketPath() };
+    TcpConnectionPtr tcp_connection{ TcpConnection::MakeShared(asio_service_, socket_path) };
+    tcp_connection->Start([this](const std::string& message) { HandleReceivedMessage(message); },
+                          [this] {});  // FIXME OnConnectionClosed
+    LOG(kSuccess) << "Connected to VaultManager which is listening on " << socket_path;
+    return tcp_connection;
+  } catch (const std::exception& e) {
+    LOG(kVerbose) << "Failed to connect to VaultManager via Unix domain socket, trying TCP: "
+                  << boost::diagnostic_information(e);
+  }
+#endif
   unsigned attempts{ 0 };
   Port initial_port{ GetInitialListeningPort() };
   Port port{ initial_port };
   while (attempts <= kMaxRangeAboveDefaultPort && port <= std::numeric_limits<Port>::max()) {
     try {
       TcpConnectionPtr tcp_connection{ TcpConnection::MakeShared(asio_service_, port) };
-      tcp_connection->Start([this](std::string message) { HandleReceivedMessage(message); },
+      tcp_connection->Start([this](const std::string& message) { HandleReceivedMessage(message); },
                             [this] {});  // FIXME OnConnectionClosed
       LOG(kSuccess) << "Connected to VaultManager which is listening on port " << port;
       return tcp_connection;
@@ -101,36 +117,70 @@ std::future<std::unique_ptr<passport::PmidAndSigner>> ClientInterface::TakeOwner
   return AddVaultRequest(label);
 }
 
+std::future<std::unique_ptr<passport::PmidAndSigner>> ClientInterface::TakeOwnership(
+    const NonEmptyString& label, const boost::filesystem::path& vault_dir,
+    DiskUsage max_disk_usage, const ResourceLimits& resource_limits) {
+  SendTakeOwnershipRequest(tcp_connection_, label, vault_dir, max_disk_usage, &resource_limits);
+  return AddVaultRequest(label);
+}
+
 std::future<std::unique_ptr<passport::PmidAndSigner>> ClientInterface::StartVault(
-    const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage) {
+    const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage,
+    const ResourceLimits& resource_limits) {
   NonEmptyString label{ GenerateLabel() };
-  SendStartVaultRequest(tcp_connection_, label, vault_dir, max_disk_usage);
+  SendStartVaultRequest(tcp_connection_, label, vault_dir, max_disk_usage, resource_limits);
   return AddVaultRequest(label);
 }
 
-std::future<std::unique_ptr<passport::PmidAndSigner>> ClientInterface::AddVaultRequest(
-    const NonEmptyString& label) {
-  std::shared_ptr<VaultRequest> request(std::make_shared<VaultRequest>(asio_service_.service()));
-  request->timer.async_wait([request, label, this](const boost::system::error_code& ec) {
-    if (ec && ec == boost::asio::error::operation_aborted) {
-      LOG(kVerbose) << "Timer cancelled. OK";
-      return;
-    }
-    LOG(kWarning) << "Timer expired - i.e. timed out for label: " << label.string();
+std::future<ResourceUsage> ClientInterface::GetResourceUsage(const NonEmptyString& label) {
+  std::shared_ptr<UsageRequest> request(std::make_shared<UsageRequest>(asio_service_.service()));
+  {
     std::lock_guard<std::mutex> lock{ mutex_ };
-    if (ec)
-      request->SetException(ec);
-    else
+    request->timeout = request->timer_wheel.Arm(kRpcTimeout, [request, label, this] {
+      LOG(kWarning) << "Timed out waiting for usage of vault " << label.string();
+      std::lock_guard<std::mutex> lock{ mutex_ };
       request->SetException(MakeError(VaultManagerErrors::timed_out));
-    ongoing_vault_requests_.erase(label);
-  });
+      auto range(ongoing_usage_requests_.equal_range(label));
+      for (auto itr(range.first); itr != range.second; ++itr) {
+        if (itr->second == request) {
+          ongoing_usage_requests_.erase(itr);
+          break;
+        }
+      }
+    });
+    ongoing_usage_requests_.insert(std::make_pair(label, request));
+  }
+  SendVaultUsageRequest(tcp_connection_, label);
+  return request->promise.get_future();
+}
 
+void ClientInterface::SetMoveChunkstoreProgressFunctor(MoveProgressFunctor on_move_progress) {
   std::lock_guard<std::mutex> lock{ mutex_ };
+  on_move_progress_ = on_move_progress;
+}
+
+std::future<std::unique_ptr<passport::PmidAndSigner>> ClientInterface::AddVaultRequest(
+    const NonEmptyString& label) {
+  std::shared_ptr<VaultRequest> request(std::make_shared<VaultRequest>(asio_service_.service()));
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  ArmVaultRequestTimer(label, request);
   LOG(kVerbose) << "Added request for vault label:" << label.string();
   ongoing_vault_requests_.insert(std::make_pair(label, request));
   return request->promise.get_future();
 }
 
+void ClientInterface::ArmVaultRequestTimer(const NonEmptyString& label,
+                                           std::shared_ptr<VaultRequest> request) {
+  request->timeout = request->timer_wheel.Arm(kRpcTimeout, [request, label, this] {
+    LOG(kWarning) << "Timer expired - i.e. timed out for label: " << label.string();
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    request->SetException(MakeError(VaultManagerErrors::timed_out));
+    auto itr(ongoing_vault_requests_.find(label));
+    if (itr != std::end(ongoing_vault_requests_) && itr->second == request)
+      ongoing_vault_requests_.erase(itr);
+  });
+}
+
 void ClientInterface::HandleReceivedMessage(const std::string& wrapped_message) {
   try {
     MessageAndType message_and_type{ UnwrapMessage(wrapped_message) };
@@ -145,6 +195,12 @@ void ClientInterface::HandleReceivedMessage(const std::string& wrapped_message)
       case MessageType::kVaultRunningResponse:
         HandleVaultRunningResponse(message_and_type.first);
         break;
+      case MessageType::kVaultUsageResponse:
+        HandleVaultUsageResponse(message_and_type.first);
+        break;
+      case MessageType::kMoveChunkstoreProgress:
+        HandleMoveChunkstoreProgress(message_and_type.first);
+        break;
       case MessageType::kLogMessage:
         HandleLogMessage(message_and_type.first);
         break;
@@ -182,13 +238,52 @@ void ClientInterface::HandleVaultRunningResponse(const std::string& message) {
     else
       itr->second->SetException(*error);
 
-    itr->second->timer.cancel();
+    itr->second->timer_wheel.Cancel(itr->second->timeout);
     ongoing_vault_requests_.erase(itr);
   } else {
     LOG(kWarning) << "No pending requests in map";
   }
 }
 
+void ClientInterface::HandleMoveChunkstoreProgress(const std::string& message) {
+  protobuf::MoveChunkstoreProgress progress{
+      ParseProto<protobuf::MoveChunkstoreProgress>(message) };
+  NonEmptyString label{ progress.label() };
+  MoveProgressFunctor on_move_progress;
+  {
+    // A move can take much longer than kRpcTimeout, so restart the timeout on each report.
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    auto itr(ongoing_vault_requests_.find(label));
+    if (itr != std::end(ongoing_vault_requests_))
+      itr->second->timer_wheel.Rearm(itr->second->timeout, kRpcTimeout);
+    on_move_progress = on_move_progress_;
+  }
+  LOG(kVerbose) << "Vault " << label.string() << " has moved " << progress.bytes_moved() << " of "
+                << progress.total_bytes() << " bytes of its chunkstore.";
+  if (on_move_progress)
+    on_move_progress(label, progress.bytes_moved(), progress.total_bytes());
+}
+
+void ClientInterface::HandleVaultUsageResponse(const std::string& message) {
+  NonEmptyString label{ ParseProto<protobuf::VaultUsageResponse>(message).label() };
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  auto range(ongoing_usage_requests_.equal_range(label));
+  if (range.first == range.second)
+    LOG(kWarning) << "No pending usage requests for vault " << label.string();
+  for (auto itr(range.first); itr != range.second; ++itr) {
+    try {
+      itr->second->ParseAndSetValue(message);
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Got error for usage of vault " << label.string() << ": "
+                  << boost::diagnostic_information(e);
+      itr->second->SetException(std::current_exception());
+    }
+    itr->second->timer_wheel.Cancel(itr->second->timeout);
+  }
+  ongoing_usage_requests_.erase(range.first, range.second);
+}
+
 void ClientInterface::InvokeCallBack(const std::string& message,
                                      std::function<void(std::string)>& callback) {
   if (callback) {
@@ -24,10 +24,42 @@ namespace vault_manager {
 
 const std::string kConfigFilename("vault_manager_config.dat");
 const std::string kBootstrapFilename("bootstrap.dat");
+const std::string kLocalSocketFilename("vault_manager.sock");
+const std::string kHandoffSocketFilename("vault_manager_handoff.sock");
+const std::string kInheritedChannelArgPrefix("fd:");
+const int kInheritedChannelDescriptor(3);
 const unsigned kMaxRangeAboveDefaultPort(100);
 const std::chrono::seconds kRpcTimeout(2);
+const size_t kMaxPendingConnections(256);
+const size_t kMaxPendingConnectionsPerUser(64);
+const size_t kMaxPendingConnectionsPerProcess(8);
+const size_t kMaxUnidentifiedMessageSize(4096);
+const size_t kVerificationThreads(2);
+const size_t kMaxQueuedVerifications(256);
+const size_t kVerificationBatchSize(16);
 const std::chrono::seconds kVaultStopTimeout(10);
+const std::chrono::seconds kVaultTerminateTimeout(2);
+const std::chrono::seconds kVaultUpgradeHealthTimeout(120);
+const std::chrono::seconds kVaultReconnectTimeout(30);
+const std::chrono::milliseconds kVaultReconnectInterval(500);
+const std::chrono::seconds kHandoffTimeout(30);
+const std::chrono::seconds kVaultHealthProbeInterval(5);
+const std::chrono::seconds kMaxVaultHealthProbeRoundTrip(2);
+const int kMaxMissedVaultHealthProbes(3);
 const int kMaxVaultRestarts(5);
+const std::chrono::milliseconds kVaultRestartInitialBackoff(500);
+const std::chrono::milliseconds kVaultRestartMaxBackoff(60000);
+const std::chrono::minutes kVaultCrashWindow(10);
+const int kMaxConcurrentVaultRestarts(4);
+const size_t kMaxSendBatchBytes(1024 * 1024);
+// Each message needs two buffers, and asio passes at most 64 buffers to a single write syscall.
+const size_t kMaxSendBatchMessages(32);
+const size_t kMaxPooledBytesPerConnection(64 * 1024);
+const size_t kRingCapacity(1024 * 1024);
+const std::chrono::milliseconds kRingDrainInterval(10);
+const size_t kRingDrainBatchSize(256);
+const std::chrono::milliseconds kTimerWheelTick(50);
+const size_t kTimerWheelSlots(1024);
 
 }  // namespace vault_manager
 
@@ -40,7 +40,8 @@ class TcpListener;
 typedef uint16_t Port;
 typedef std::shared_ptr<TcpConnection> TcpConnectionPtr;
 typedef std::shared_ptr<TcpListener> TcpListenerPtr;
-typedef std::function<void(std::string)> MessageReceivedFunctor;
+// The message is only valid for the duration of the call; its buffer is then reused.
+typedef std::function<void(const std::string&)> MessageReceivedFunctor;
 typedef std::function<void(TcpConnectionPtr)> NewConnectionFunctor;
 typedef std::function<void()> ConnectionClosedFunctor;
 typedef boost::asio::steady_timer Timer;
@@ -48,10 +49,64 @@ typedef std::shared_ptr<Timer> TimerPtr;
 
 extern const std::string kConfigFilename;
 extern const std::string kBootstrapFilename;
+// The VaultManager also listens on a Unix domain socket of this name (other than on Windows).
+extern const std::string kLocalSocketFilename;
+// A VaultManager being replaced hands its vaults over to its successor via a Unix domain socket of
+// this name (only on Linux).
+extern const std::string kHandoffSocketFilename;
+// A vault's positional argument starting with this is followed by the descriptor of its inherited
+// channel to the VaultManager.
+extern const std::string kInheritedChannelArgPrefix;
+// The descriptor number at which a spawned vault inherits its channel.
+extern const int kInheritedChannelDescriptor;
 extern const unsigned kMaxRangeAboveDefaultPort;
 extern const std::chrono::seconds kRpcTimeout;
+// The defaults for admitting connections which haven't yet identified themselves; see
+// AdmissionPolicy.
+extern const size_t kMaxPendingConnections;
+extern const size_t kMaxPendingConnectionsPerUser;
+extern const size_t kMaxPendingConnectionsPerProcess;
+extern const size_t kMaxUnidentifiedMessageSize;
+// The number of threads checking clients' challenge responses, how many responses may be queued for
+// them, and how many each thread takes from the queue at once.
+extern const size_t kVerificationThreads;
+extern const size_t kMaxQueuedVerifications;
+extern const size_t kVerificationBatchSize;
+// How long vaults are given to exit once asked to stop, and (other than on Windows) how long those
+// still running are then given after SIGTERM before being killed.
 extern const std::chrono::seconds kVaultStopTimeout;
+extern const std::chrono::seconds kVaultTerminateTimeout;
+// How long each batch of vaults restarted during a rolling upgrade has to rejoin the network.
+extern const std::chrono::seconds kVaultUpgradeHealthTimeout;
+// How long a vault which has lost its connection keeps trying (at the given interval) to reconnect
+// to a VaultManager, and how long a VaultManager waits for each vault handed over to it to do so.
+extern const std::chrono::seconds kVaultReconnectTimeout;
+extern const std::chrono::milliseconds kVaultReconnectInterval;
+// How long a VaultManager waits for its predecessor to hand over its vaults.
+extern const std::chrono::seconds kHandoffTimeout;
+// The defaults for probing running vaults to detect hangs; see HealthPolicy.
+extern const std::chrono::seconds kVaultHealthProbeInterval;
+extern const std::chrono::seconds kMaxVaultHealthProbeRoundTrip;
+extern const int kMaxMissedVaultHealthProbes;
+// The defaults for restarting vaults which exit unexpectedly; see RestartPolicy.
 extern const int kMaxVaultRestarts;
+extern const std::chrono::milliseconds kVaultRestartInitialBackoff;
+extern const std::chrono::milliseconds kVaultRestartMaxBackoff;
+extern const std::chrono::minutes kVaultCrashWindow;
+extern const int kMaxConcurrentVaultRestarts;
+extern const size_t kMaxSendBatchBytes;
+extern const size_t kMaxSendBatchMessages;
+// The most buffer capacity each TcpConnection keeps pooled while idle.  Buffers of messages larger
+// than this are freed once used.
+extern const size_t kMaxPooledBytesPerConnection;
+// Size of the shared memory ring via which a vault sends fire-and-forget messages, and how often
+// and in what batches the VaultManager drains these.
+extern const size_t kRingCapacity;
+extern const std::chrono::milliseconds kRingDrainInterval;
+extern const size_t kRingDrainBatchSize;
+// The resolution and number of slots of each io_service's TimerWheel.
+extern const std::chrono::milliseconds kTimerWheelTick;
+extern const size_t kTimerWheelSlots;
 
 DEFINE_OSTREAMABLE_ENUM_VALUES(MessageType, int32_t,
     (ValidateConnectionRequest)
@@ -69,10 +124,33 @@ DEFINE_OSTREAMABLE_ENUM_VALUES(MessageType, int32_t,
     (BootstrapContactsResponse)
     (JoinedNetwork)
     (BootstrapContact)
-    (LogMessage))
+    (LogMessage)
+    (VaultUsageRequest)
+    (VaultUsageResponse)
+    (MoveChunkstoreRequest)
+    (MoveChunkstoreProgress)
+    (MoveChunkstoreResponse)
+    (VaultReconnected)
+    (HealthProbe)
+    (HealthProbeResponse))
 
 typedef std::pair<std::string, MessageType> MessageAndType;
 
+// What a spawned vault is given as its first positional argument to reach the VaultManager.  Every
+// vault understands a TCP port, so that's the default; the alternatives have to be opted into, as
+// only vaults built against this version's VaultInterface can parse them.  If the chosen one isn't
+// available (e.g. on Windows), vaults are given the port instead.  Only with kLocalSocket can the
+// process ID a vault claims on connecting back be checked, and kInheritedChannel needs no check;
+// with kTcpPort, a process connecting before the vault could pass itself off as it.
+enum class VaultChannel {
+  kTcpPort,
+  // The path of the VaultManager's Unix domain socket.
+  kLocalSocket,
+  // kInheritedChannelArgPrefix and the descriptor of one end of a socketpair, the other end of
+  // which the VaultManager keeps.  The vault doesn't connect back at all.
+  kInheritedChannel
+};
+
 }  // namespace vault_manager
 
 }  // namespace maidsafe
@@ -18,7 +18,10 @@
 
 #include "maidsafe/vault_manager/config_file_handler.h"
 
+#include <algorithm>
+#include <future>
 #include <string>
+#include <thread>
 
 #include "boost/filesystem/operations.hpp"
 
@@ -112,11 +115,21 @@ void ConfigFileHandler::CreateConfigFile() {
 
 std::vector<VaultInfo> ConfigFileHandler::ReadConfigFile() const {
   protobuf::VaultManagerConfig config{ ParseConfigFile(config_file_path_, mutex_) };
-  std::vector<VaultInfo> vaults;
-  for (int i(0); i != config.vault_info_size(); ++i) {
-    vaults.emplace_back();
-    FromProtobuf(kSymmKey_, kSymmIv_, config.vault_info(i), vaults.back());
+  const int kVaultCount{ config.vault_info_size() };
+  std::vector<VaultInfo> vaults(kVaultCount);
+  // Decrypting each vault's keys dominates reading a large config, so spread it across the cores.
+  const int kWorkerCount{ std::min(kVaultCount,
+      static_cast<int>(std::max(std::thread::hardware_concurrency(), 1U))) };
+  std::vector<std::future<void>> workers;
+  for (int worker(0); worker < kWorkerCount; ++worker) {
+    workers.emplace_back(std::async(std::launch::async, [&, worker] {
+      for (int i(worker); i < kVaultCount; i += kWorkerCount)
+        FromProtobuf(kSymmKey_, kSymmIv_, config.vault_info(i), vaults[i]);
+    }));
   }
+  // Any outstanding workers are joined by their futures' destructors if this throws.
+  for (auto& worker : workers)
+    worker.get();
   return vaults;
 }
 
@@ -56,21 +56,26 @@ void SendChallengeResponse(TcpConnectionPtr connection, const passport::PublicMa
 }
 
 void SendStartVaultRequest(TcpConnectionPtr connection, const NonEmptyString& vault_label,
-                           const fs::path& vault_dir, DiskUsage max_disk_usage) {
+                           const fs::path& vault_dir, DiskUsage max_disk_usage,
+                           const ResourceLimits& resource_limits) {
   protobuf::StartVaultRequest message;
   message.set_label(vault_label.string());
   message.set_vault_dir(vault_dir.string());
   message.set_max_disk_usage(max_disk_usage.data);
+  ToProtobuf(resource_limits, message.mutable_resource_limits());
   connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
                    MessageType::kStartVaultRequest)));
 }
 
 void SendTakeOwnershipRequest(TcpConnectionPtr connection, const NonEmptyString& vault_label,
-                              const fs::path& vault_dir, DiskUsage max_disk_usage) {
+                              const fs::path& vault_dir, DiskUsage max_disk_usage,
+                              const ResourceLimits* const resource_limits) {
   protobuf::TakeOwnershipRequest message;
   message.set_label(vault_label.string());
   message.set_vault_dir(vault_dir.string());
   message.set_max_disk_usage(max_disk_usage.data);
+  if (resource_limits)
+    ToProtobuf(*resource_limits, message.mutable_resource_limits());
   connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
                    MessageType::kTakeOwnershipRequest)));
 }
@@ -99,16 +104,21 @@ void SendVaultRunningResponse(TcpConnectionPtr connection, const NonEmptyString&
                    MessageType::kVaultRunningResponse)));
 }
 
-void SendVaultStarted(TcpConnectionPtr connection) {
+void SendVaultStarted(TcpConnectionPtr connection, bool request_shared_memory_ring) {
   protobuf::VaultStarted message;
   message.set_process_id(process::GetProcessId());
+  if (request_shared_memory_ring)
+    message.set_request_shared_memory_ring(true);
+  message.set_answers_health_probes(true);
   connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
                                               MessageType::kVaultStarted)));
 }
 
 void SendVaultStartedResponse(VaultInfo& vault_info, crypto::AES256Key symm_key,
                               crypto::AES256InitialisationVector symm_iv,
-                              const routing::BootstrapContacts& bootstrap_contacts) {
+                              const routing::BootstrapContacts& bootstrap_contacts,
+                              const std::string& shared_memory_ring_name,
+                              const std::string& reconnect_address) {
   protobuf::VaultStartedResponse message;
   message.set_aes256key(symm_key.string());
   message.set_aes256iv(symm_iv.string());
@@ -123,10 +133,22 @@ void SendVaultStartedResponse(VaultInfo& vault_info, crypto::AES256Key symm_key,
   if (!serialised_public_pmids.empty())
     message.set_serialised_public_pmids(serialised_public_pmids);
 #endif
+  if (!shared_memory_ring_name.empty())
+    message.set_shared_memory_ring_name(shared_memory_ring_name);
+  if (!reconnect_address.empty())
+    message.set_reconnect_address(reconnect_address);
   vault_info.tcp_connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
                                                              MessageType::kVaultStartedResponse)));
 }
 
+void SendVaultReconnected(TcpConnectionPtr connection) {
+  protobuf::VaultReconnected message;
+  message.set_process_id(process::GetProcessId());
+  message.set_answers_health_probes(true);
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kVaultReconnected)));
+}
+
 void SendBootstrapContact(TcpConnectionPtr connection,
                           const routing::BootstrapContact& bootstrap_contact) {
   protobuf::BootstrapContact message;
@@ -159,6 +181,20 @@ void SendVaultShutdownRequest(TcpConnectionPtr connection) {
   connection->Send(WrapMessage(std::make_pair(std::string{}, MessageType::kVaultShutdownRequest)));
 }
 
+void SendHealthProbe(TcpConnectionPtr connection, uint64_t sequence) {
+  protobuf::HealthProbe message;
+  message.set_sequence(sequence);
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kHealthProbe)));
+}
+
+void SendHealthProbeResponse(TcpConnectionPtr connection, uint64_t sequence) {
+  protobuf::HealthProbeResponse message;
+  message.set_sequence(sequence);
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kHealthProbeResponse)));
+}
+
 void SendMaxDiskUsageUpdate(TcpConnectionPtr connection, DiskUsage max_disk_usage) {
   protobuf::MaxDiskUsageUpdate message;
   message.set_max_disk_usage(max_disk_usage.data);
@@ -170,6 +206,61 @@ void SendLogMessage(TcpConnectionPtr connection, const std::string log_message)
   connection->Send(WrapMessage(std::make_pair(log_message, MessageType::kLogMessage)));
 }
 
+void SendVaultUsageRequest(TcpConnectionPtr connection, const NonEmptyString& vault_label) {
+  protobuf::VaultUsageRequest message;
+  message.set_label(vault_label.string());
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kVaultUsageRequest)));
+}
+
+void SendVaultUsageResponse(TcpConnectionPtr connection, const NonEmptyString& vault_label,
+                            const ResourceUsage* const usage, const maidsafe_error* const error) {
+  protobuf::VaultUsageResponse message;
+  message.set_label(vault_label.string());
+  if (error) {
+    assert(!usage);
+    message.set_serialised_maidsafe_error(Serialise(*error).data);
+  } else {
+    assert(usage);
+    message.set_cpu_time_usec(usage->cpu_time_usec);
+    message.set_memory_bytes(usage->memory_bytes);
+    message.set_io_read_bytes(usage->io_read_bytes);
+    message.set_io_write_bytes(usage->io_write_bytes);
+  }
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kVaultUsageResponse)));
+}
+
+void SendMoveChunkstoreRequest(TcpConnectionPtr connection, const fs::path& vault_dir,
+                               DiskUsage max_disk_usage) {
+  protobuf::MoveChunkstoreRequest message;
+  message.set_vault_dir(vault_dir.string());
+  message.set_max_disk_usage(max_disk_usage.data);
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kMoveChunkstoreRequest)));
+}
+
+void SendMoveChunkstoreProgress(TcpConnectionPtr connection, uint64_t bytes_moved,
+                                uint64_t total_bytes, const NonEmptyString* const vault_label) {
+  protobuf::MoveChunkstoreProgress message;
+  if (vault_label)
+    message.set_label(vault_label->string());
+  message.set_bytes_moved(bytes_moved);
+  message.set_total_bytes(total_bytes);
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kMoveChunkstoreProgress)));
+}
+
+void SendMoveChunkstoreResponse(TcpConnectionPtr connection, const fs::path& vault_dir,
+                                const maidsafe_error* const error) {
+  protobuf::MoveChunkstoreResponse message;
+  message.set_vault_dir(vault_dir.string());
+  if (error)
+    message.set_serialised_maidsafe_error(Serialise(*error).data);
+  connection->Send(WrapMessage(std::make_pair(message.SerializeAsString(),
+                                              MessageType::kMoveChunkstoreResponse)));
+}
+
 #ifdef TESTING
 void SendStartVaultRequest(TcpConnectionPtr connection, const NonEmptyString& vault_label,
                            const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage,
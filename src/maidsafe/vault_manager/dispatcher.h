@@ -31,6 +31,8 @@
 #include "maidsafe/passport/passport.h"
 #include "maidsafe/routing/bootstrap_file_operations.h"
 
+#include "maidsafe/vault_manager/resource_limits.h"
+
 namespace maidsafe {
 
 namespace vault_manager {
@@ -47,20 +49,27 @@ void SendChallengeResponse(TcpConnectionPtr connection, const passport::PublicMa
                            const asymm::Signature& signature);
 
 void SendStartVaultRequest(TcpConnectionPtr connection, const NonEmptyString& vault_label,
-                           const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage);
+                           const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage,
+                           const ResourceLimits& resource_limits = ResourceLimits{});
 
+// If 'resource_limits' is null, the vault's current limits are kept.
 void SendTakeOwnershipRequest(TcpConnectionPtr connection, const NonEmptyString& vault_label,
-                              const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage);
+                              const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage,
+                              const ResourceLimits* const resource_limits = nullptr);
 
 void SendVaultRunningResponse(TcpConnectionPtr connection, const NonEmptyString& vault_label,
                               const passport::PmidAndSigner* const pmid_and_signer,
                               const maidsafe_error* const error = nullptr);
 
-void SendVaultStarted(TcpConnectionPtr connection);
+void SendVaultStarted(TcpConnectionPtr connection, bool request_shared_memory_ring = false);
 
 void SendVaultStartedResponse(VaultInfo& vault_info, crypto::AES256Key symm_key,
                               crypto::AES256InitialisationVector symm_iv,
-                              const routing::BootstrapContacts& bootstrap_contacts);
+                              const routing::BootstrapContacts& bootstrap_contacts,
+                              const std::string& shared_memory_ring_name = std::string{},
+                              const std::string& reconnect_address = std::string{});
+
+void SendVaultReconnected(TcpConnectionPtr connection);
 
 void SendJoinedNetwork(TcpConnectionPtr connection);
 
@@ -74,10 +83,32 @@ void SendBootstrapContactsResponse(TcpConnectionPtr connection,
 
 void SendVaultShutdownRequest(TcpConnectionPtr connection);
 
+void SendHealthProbe(TcpConnectionPtr connection, uint64_t sequence);
+
+void SendHealthProbeResponse(TcpConnectionPtr connection, uint64_t sequence);
+
 void SendMaxDiskUsageUpdate(TcpConnectionPtr connection, DiskUsage max_disk_usage);
 
 void SendLogMessage(TcpConnectionPtr connection, const std::string log_message);
 
+void SendVaultUsageRequest(TcpConnectionPtr connection, const NonEmptyString& vault_label);
+
+void SendVaultUsageResponse(TcpConnectionPtr connection, const NonEmptyString& vault_label,
+                            const ResourceUsage* const usage,
+                            const maidsafe_error* const error = nullptr);
+
+void SendMoveChunkstoreRequest(TcpConnectionPtr connection,
+                               const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage);
+
+// The vault leaves 'vault_label' unset; the VaultManager sets it when forwarding to the owner.
+void SendMoveChunkstoreProgress(TcpConnectionPtr connection, uint64_t bytes_moved,
+                                uint64_t total_bytes,
+                                const NonEmptyString* const vault_label = nullptr);
+
+void SendMoveChunkstoreResponse(TcpConnectionPtr connection,
+                                const boost::filesystem::path& vault_dir,
+                                const maidsafe_error* const error = nullptr);
+
 #ifdef TESTING
 void SendStartVaultRequest(TcpConnectionPtr connection, const NonEmptyString& vault_label,
                            const boost::filesystem::path& vault_dir, DiskUsage max_disk_usage,
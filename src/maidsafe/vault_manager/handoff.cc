@@ -0,0 +1,362 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/handoff.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#ifdef MAIDSAFE_LINUX
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/make_unique.h"
+#include "maidsafe/common/on_scope_exit.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/vault_manager/utils.h"
+#include "maidsafe/vault_manager/vault_info.pb.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace {
+
+#ifdef MAIDSAFE_LINUX
+// The kernel accepts at most 253 descriptors per message, so they're sent in batches.  Each batch
+// is attached to a header giving the number of descriptors and the size of any state following the
+// header.  Only the final header is followed by the (always non-empty) serialised state.
+const size_t kMaxDescriptorsPerMessage(250);
+// Sent by the successor once it owns everything handed over.
+const char kAcknowledgement('A');
+
+struct FrameHeader {
+  uint32_t state_size;
+  uint32_t descriptor_count;
+};
+
+void CloseDescriptor(int& descriptor) {
+  if (descriptor != -1)
+    close(descriptor);
+  descriptor = -1;
+}
+
+// 'error_number' is 0 if the connection was closed.
+void ThrowReceiveError(int error_number) {
+  LOG(kError) << "Failed receiving handoff: "
+              << (error_number == 0 ? "connection closed" : std::strerror(error_number));
+  if (error_number == EAGAIN || error_number == EWOULDBLOCK)
+    BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::timed_out));
+  BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::connection_aborted));
+}
+
+void WriteAll(int native_socket, const char* data, size_t size) {
+  while (size != 0U) {
+    ssize_t written{ send(native_socket, data, size, MSG_NOSIGNAL) };
+    if (written == -1) {
+      if (errno == EINTR)
+        continue;
+      LOG(kError) << "Failed sending handoff: " << std::strerror(errno);
+      BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::connection_aborted));
+    }
+    data += written;
+    size -= static_cast<size_t>(written);
+  }
+}
+
+void ReadAll(int native_socket, char* data, size_t size) {
+  while (size != 0U) {
+    ssize_t received{ recv(native_socket, data, size, 0) };
+    if (received == -1 && errno == EINTR)
+      continue;
+    if (received <= 0)
+      ThrowReceiveError(received == 0 ? 0 : errno);
+    data += received;
+    size -= static_cast<size_t>(received);
+  }
+}
+
+void SendFrame(int native_socket, const std::string& state, const int* descriptors,
+               size_t descriptor_count) {
+  FrameHeader header{ static_cast<uint32_t>(state.size()),
+                      static_cast<uint32_t>(descriptor_count) };
+  iovec io_vector{ &header, sizeof(header) };
+  msghdr message;
+  std::memset(&message, 0, sizeof(message));
+  message.msg_iov = &io_vector;
+  message.msg_iovlen = 1;
+  std::vector<char> control;
+  if (descriptor_count != 0U) {
+    control.resize(CMSG_SPACE(descriptor_count * sizeof(int)));
+    message.msg_control = control.data();
+    message.msg_controllen = control.size();
+    cmsghdr* control_header{ CMSG_FIRSTHDR(&message) };
+    control_header->cmsg_level = SOL_SOCKET;
+    control_header->cmsg_type = SCM_RIGHTS;
+    control_header->cmsg_len = CMSG_LEN(descriptor_count * sizeof(int));
+    std::memcpy(CMSG_DATA(control_header), descriptors, descriptor_count * sizeof(int));
+  }
+  ssize_t sent{ -1 };
+  do {
+    sent = sendmsg(native_socket, &message, MSG_NOSIGNAL);
+  } while (sent == -1 && errno == EINTR);
+  if (sent == -1) {
+    LOG(kError) << "Failed sending handoff: " << std::strerror(errno);
+    BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::connection_aborted));
+  }
+  // The descriptors are attached to the first byte, so the rest of the header can follow normally.
+  WriteAll(native_socket, reinterpret_cast<const char*>(&header) + sent,
+           sizeof(header) - static_cast<size_t>(sent));
+  WriteAll(native_socket, state.data(), state.size());
+}
+
+// Appends the frame's descriptors to 'descriptors' and returns its state, if any.
+std::string ReceiveFrame(int native_socket, std::vector<int>& descriptors) {
+  FrameHeader header;
+  iovec io_vector{ &header, sizeof(header) };
+  std::vector<char> control(CMSG_SPACE(kMaxDescriptorsPerMessage * sizeof(int)));
+  msghdr message;
+  std::memset(&message, 0, sizeof(message));
+  message.msg_iov = &io_vector;
+  message.msg_iovlen = 1;
+  message.msg_control = control.data();
+  message.msg_controllen = control.size();
+  ssize_t received{ -1 };
+  do {
+    received = recvmsg(native_socket, &message, MSG_CMSG_CLOEXEC);
+  } while (received == -1 && errno == EINTR);
+  if (received <= 0)
+    ThrowReceiveError(received == 0 ? 0 : errno);
+  for (cmsghdr* control_header(CMSG_FIRSTHDR(&message)); control_header != nullptr;
+       control_header = CMSG_NXTHDR(&message, control_header)) {
+    if (control_header->cmsg_level != SOL_SOCKET || control_header->cmsg_type != SCM_RIGHTS)
+      continue;
+    size_t count{ (control_header->cmsg_len - CMSG_LEN(0)) / sizeof(int) };
+    const unsigned char* data{ CMSG_DATA(control_header) };
+    for (size_t i(0); i != count; ++i) {
+      int descriptor;
+      std::memcpy(&descriptor, data + i * sizeof(int), sizeof(int));
+      descriptors.push_back(descriptor);
+    }
+  }
+  if ((message.msg_flags & MSG_CTRUNC) != 0) {
+    LOG(kError) << "Handoff descriptors were truncated.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  }
+  ReadAll(native_socket, reinterpret_cast<char*>(&header) + received,
+          sizeof(header) - static_cast<size_t>(received));
+  std::string state(header.state_size, '\0');
+  ReadAll(native_socket, &state[0], state.size());
+  return state;
+}
+
+// Returns the descriptor at 'index', leaving -1 in its place so that it's not closed with the rest.
+int TakeDescriptor(std::vector<int>& descriptors, uint32_t index) {
+  if (index >= descriptors.size() || descriptors[index] == -1) {
+    LOG(kError) << "Handoff refers to a missing descriptor.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  }
+  int descriptor{ descriptors[index] };
+  descriptors[index] = -1;
+  return descriptor;
+}
+#endif
+
+}  // unnamed namespace
+
+Handoff::Handoff() : vaults(), listener(-1), local_listener(-1), handoff_listener(-1) {}
+
+Handoff::Handoff(Handoff&& other)
+    : vaults(std::move(other.vaults)),
+      listener(other.listener),
+      local_listener(other.local_listener),
+      handoff_listener(other.handoff_listener) {
+  other.vaults.clear();
+  other.listener = other.local_listener = other.handoff_listener = -1;
+}
+
+Handoff::~Handoff() {
+#ifdef MAIDSAFE_LINUX
+  CloseDescriptor(listener);
+  CloseDescriptor(local_listener);
+  CloseDescriptor(handoff_listener);
+  for (auto& vault : vaults)
+    CloseDescriptor(vault.pidfd);
+#endif
+}
+
+#ifdef MAIDSAFE_LINUX
+void SendHandoff(int native_socket, const Handoff& handoff) {
+  // protobuf::VaultInfo only holds Pmids in encrypted form, so a key and IV are sent with them.
+  // This protects nothing; only the same user can connect to the handoff socket.
+  const crypto::AES256Key kSymmKey{ RandomString(crypto::AES256_KeySize) };
+  const crypto::AES256InitialisationVector kSymmIv{ RandomString(crypto::AES256_IVSize) };
+  protobuf::HandoffState state;
+  state.set_aes256key(kSymmKey.string());
+  state.set_aes256iv(kSymmIv.string());
+  std::vector<int> descriptors;
+  auto add_descriptor([&descriptors](int descriptor) {
+    descriptors.push_back(descriptor);
+    return static_cast<uint32_t>(descriptors.size() - 1);
+  });
+  if (handoff.listener != -1)
+    state.set_listener_index(add_descriptor(handoff.listener));
+  if (handoff.local_listener != -1)
+    state.set_local_listener_index(add_descriptor(handoff.local_listener));
+  if (handoff.handoff_listener != -1)
+    state.set_handoff_listener_index(add_descriptor(handoff.handoff_listener));
+  for (const auto& vault : handoff.vaults) {
+    if (vault.pidfd == -1) {
+      ToProtobuf(kSymmKey, kSymmIv, vault.info, state.add_stopped_vault_info());
+      continue;
+    }
+    protobuf::HandedOffVault* handed_off{ state.add_vault() };
+    ToProtobuf(kSymmKey, kSymmIv, vault.info, handed_off->mutable_vault_info());
+    handed_off->set_process_id(vault.process_id);
+    handed_off->set_pidfd_index(add_descriptor(vault.pidfd));
+    handed_off->set_executable_path(vault.executable_path.string());
+    if (vault.stopping)
+      handed_off->set_stopping(true);
+    if (vault.restarting)
+      handed_off->set_restarting(true);
+  }
+
+  // The socket may have been set non-blocking by asio.
+  int flags{ fcntl(native_socket, F_GETFL) };
+  if (flags == -1 || fcntl(native_socket, F_SETFL, flags & ~O_NONBLOCK) == -1) {
+    LOG(kError) << "Failed to make handoff socket blocking: " << std::strerror(errno);
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unknown));
+  }
+  const std::string kSerialisedState{ state.SerializeAsString() };
+  // The final frame carries the state, so at least one frame is sent even with no descriptors.
+  size_t sent{ 0 };
+  do {
+    size_t count{ std::min(kMaxDescriptorsPerMessage, descriptors.size() - sent) };
+    bool last{ sent + count == descriptors.size() };
+    SendFrame(native_socket, last ? kSerialisedState : std::string{},
+              descriptors.data() + sent, count);
+    sent += count;
+  } while (sent != descriptors.size());
+
+  // Until the successor confirms it owns everything sent, the caller may still reclaim it.
+  timeval timeout{ static_cast<time_t>(kHandoffTimeout.count()), 0 };
+  setsockopt(native_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  char acknowledgement{ 0 };
+  ReadAll(native_socket, &acknowledgement, 1);
+  if (acknowledgement != kAcknowledgement) {
+    LOG(kError) << "Successor didn't acknowledge the handoff.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  }
+  LOG(kInfo) << "Handed over " << handoff.vaults.size() << " vault(s).";
+}
+
+Handoff ReceiveHandoff(int native_socket) {
+  std::vector<int> descriptors;
+  on_scope_exit close_descriptors{ [&descriptors] {
+    for (auto& descriptor : descriptors)
+      CloseDescriptor(descriptor);
+  } };
+  std::string serialised_state;
+  while (serialised_state.empty())
+    serialised_state = ReceiveFrame(native_socket, descriptors);
+
+  protobuf::HandoffState state;
+  if (!state.ParseFromString(serialised_state)) {
+    LOG(kError) << "Failed to parse handoff.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  }
+  const crypto::AES256Key kSymmKey{ state.aes256key() };
+  const crypto::AES256InitialisationVector kSymmIv{ state.aes256iv() };
+  Handoff handoff;
+  if (state.has_listener_index())
+    handoff.listener = TakeDescriptor(descriptors, state.listener_index());
+  if (state.has_local_listener_index())
+    handoff.local_listener = TakeDescriptor(descriptors, state.local_listener_index());
+  if (state.has_handoff_listener_index())
+    handoff.handoff_listener = TakeDescriptor(descriptors, state.handoff_listener_index());
+  for (const auto& handed_off : state.vault()) {
+    HandedOffVault vault;
+    FromProtobuf(kSymmKey, kSymmIv, handed_off.vault_info(), vault.info);
+    vault.process_id = handed_off.process_id();
+    vault.pidfd = TakeDescriptor(descriptors, handed_off.pidfd_index());
+    vault.executable_path = handed_off.executable_path();
+    vault.stopping = handed_off.stopping();
+    vault.restarting = handed_off.restarting();
+    handoff.vaults.push_back(std::move(vault));
+  }
+  for (const auto& vault_info : state.stopped_vault_info()) {
+    HandedOffVault vault;
+    FromProtobuf(kSymmKey, kSymmIv, vault_info, vault.info);
+    handoff.vaults.push_back(std::move(vault));
+  }
+  // Until this is received, the predecessor may yet reclaim everything, so if it can't be sent, all
+  // the descriptors are closed as 'handoff' is destroyed.
+  WriteAll(native_socket, &kAcknowledgement, 1);
+  LOG(kInfo) << "Received " << handoff.vaults.size() << " vault(s) by handoff.";
+  return handoff;
+}
+#endif
+
+std::unique_ptr<Handoff> ReceiveHandoff(const fs::path& handoff_socket_path) {
+#ifndef MAIDSAFE_LINUX
+  static_cast<void>(handoff_socket_path);
+  return nullptr;
+#else
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (handoff_socket_path.empty() ||
+      handoff_socket_path.string().size() >= sizeof(address.sun_path)) {
+    return nullptr;
+  }
+  std::strcpy(address.sun_path, handoff_socket_path.c_str());
+  int native_socket{ socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0) };
+  if (native_socket == -1) {
+    LOG(kError) << "Failed to create handoff socket: " << std::strerror(errno);
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unknown));
+  }
+  on_scope_exit close_socket{ [native_socket] { close(native_socket); } };
+  if (connect(native_socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+    // Usually ENOENT or ECONNREFUSED, meaning there's no VaultManager to take over from.
+    LOG(kVerbose) << "No VaultManager to take over from: " << std::strerror(errno);
+    return nullptr;
+  }
+  timeval timeout{ static_cast<time_t>(kHandoffTimeout.count()), 0 };
+  setsockopt(native_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  LOG(kInfo) << "Taking over from the VaultManager listening on " << handoff_socket_path;
+  return maidsafe::make_unique<Handoff>(ReceiveHandoff(native_socket));
+#endif
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,77 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_HANDOFF_H_
+#define MAIDSAFE_VAULT_MANAGER_HANDOFF_H_
+
+#include <memory>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/vault_manager/process_manager.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// A VaultManager being replaced (e.g. to upgrade it) can hand over to its successor, so that its
+// vaults keep running.  The successor connects to the predecessor's handoff socket and receives its
+// listening sockets, the pidfds of its running vaults and the details of all its vaults.  The
+// predecessor then closes its connections to the vaults, each of which reconnects via the listening
+// sockets now owned by the successor.  If the handoff fails before the successor acknowledges it,
+// the predecessor reclaims everything and carries on.
+//
+// The handoff socket only accepts connections from the same user, which is its only protection;
+// the Pmids are sent effectively in the clear.
+//
+// Only supported on Linux, where the descriptors are passed as SCM_RIGHTS ancillary data.
+
+// Owns all of its descriptors, closing any still set (i.e. not -1) when destroyed.
+struct Handoff {
+  Handoff();
+  Handoff(Handoff&& other);
+  ~Handoff();
+
+  std::vector<HandedOffVault> vaults;
+  int listener, local_listener, handoff_listener;
+
+ private:
+  Handoff(const Handoff&) = delete;
+  Handoff& operator=(Handoff) = delete;
+};
+
+#ifdef MAIDSAFE_LINUX
+// Both block and throw on failure.  The descriptors sent remain owned by 'handoff'.  SendHandoff
+// waits up to kHandoffTimeout for ReceiveHandoff to acknowledge having received everything, and
+// only once it returns are the vaults the successor's.
+void SendHandoff(int native_socket, const Handoff& handoff);
+Handoff ReceiveHandoff(int native_socket);
+#endif
+
+// Connects to the VaultManager listening on 'handoff_socket_path' and receives its vaults.  Returns
+// null if no VaultManager is listening there, and always other than on Linux.  Throws if the
+// handoff fails part way (e.g. the other VaultManager refused or couldn't release its vaults), in
+// which case the other VaultManager keeps everything.
+std::unique_ptr<Handoff> ReceiveHandoff(const boost::filesystem::path& handoff_socket_path);
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_HANDOFF_H_
@@ -18,7 +18,11 @@
 
 #include "maidsafe/vault_manager/new_connections.h"
 
-#include <future>
+#include <utility>
+
+#ifndef MAIDSAFE_WIN32
+#include <unistd.h>
+#endif
 
 #include "maidsafe/common/error.h"
 #include "maidsafe/common/log.h"
@@ -30,41 +34,152 @@ namespace maidsafe {
 
 namespace vault_manager {
 
-NewConnections::NewConnections(boost::asio::io_service& io_service)
-    : io_service_(io_service), connections_() {}
+namespace {
+
+template <typename Key>
+size_t PendingCount(const std::map<Key, size_t>& pending_counts, Key key) {
+  auto itr(pending_counts.find(key));
+  return itr == std::end(pending_counts) ? 0 : itr->second;
+}
+
+bool IsOwnUser(uint32_t user_id) {
+#ifdef MAIDSAFE_WIN32
+  static_cast<void>(user_id);
+  return false;
+#else
+  return user_id == static_cast<uint32_t>(geteuid());
+#endif
+}
 
-std::shared_ptr<NewConnections> NewConnections::MakeShared(boost::asio::io_service& io_service) {
-  return std::shared_ptr<NewConnections>{ new NewConnections{ io_service } };
+}  // unnamed namespace
+
+AdmissionPolicy::AdmissionPolicy()
+    : max_pending(kMaxPendingConnections),
+      max_pending_per_user(kMaxPendingConnectionsPerUser),
+      max_pending_per_process(kMaxPendingConnectionsPerProcess),
+      exempt_own_user(true),
+      max_message_size(kMaxUnidentifiedMessageSize),
+      when_full(WhenFull::kDefer) {}
+
+NewConnections::NewConnections(boost::asio::io_service& io_service,
+                               AdmissionPolicy admission_policy,
+                               CapacityFunctor on_capacity_changed)
+    : timer_wheel_(GetTimerWheel(io_service)),
+      kAdmissionPolicy_(std::move(admission_policy)),
+      kOnCapacityChanged_(std::move(on_capacity_changed)),
+      mutex_(),
+      connections_(),
+      pending_per_user_(),
+      pending_per_process_(),
+      at_capacity_(false),
+      stats_() {}
+
+std::shared_ptr<NewConnections> NewConnections::MakeShared(boost::asio::io_service& io_service,
+                                                           AdmissionPolicy admission_policy,
+                                                           CapacityFunctor on_capacity_changed) {
+  return std::shared_ptr<NewConnections>{
+      new NewConnections{ io_service, admission_policy, on_capacity_changed } };
 }
 
 NewConnections::~NewConnections() {
   assert(connections_.empty());
 }
 
-void NewConnections::Add(TcpConnectionPtr connection) {
-  TimerPtr timer{ std::make_shared<Timer>(io_service_, kRpcTimeout) };
-  timer->async_wait([connection](const boost::system::error_code& error_code) {
-    if (error_code && error_code == boost::asio::error::operation_aborted) {
-      LOG(kVerbose) << "New connection timer cancelled OK.";
-    } else {
-      LOG(kWarning) << "Timed out waiting for new connection to identify itself.";
-      connection->Close();
+bool NewConnections::Add(TcpConnectionPtr connection) {
+  const TcpConnection::PeerCredentials kCredentials{ connection->GetPeerCredentials() };
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  if (!Admit(kCredentials))
+    return false;
+
+  connection->SetMaxMessageSize(kAdmissionPolicy_.max_message_size);
+  std::weak_ptr<NewConnections> this_weak_ptr{ shared_from_this() };
+  Pending pending{ timer_wheel_.Arm(kRpcTimeout, [this_weak_ptr, connection] {
+    LOG(kWarning) << "Timed out waiting for new connection to identify itself.";
+    if (auto this_ptr = this_weak_ptr.lock()) {
+      std::lock_guard<std::mutex> lock{ this_ptr->mutex_ };
+      ++this_ptr->stats_.timed_out;
     }
-  });
-  bool result{ connections_.emplace(connection, timer).second };
+    connection->Close();
+  }), kCredentials };
+  bool result{ connections_.emplace(connection, pending).second };
   assert(result);
   static_cast<void>(result);
+  ++stats_.admitted;
+  if (kAdmissionPolicy_.when_full == AdmissionPolicy::WhenFull::kDefer && kOnCapacityChanged_ &&
+      !at_capacity_ && connections_.size() >= kAdmissionPolicy_.max_pending) {
+    at_capacity_ = true;
+    kOnCapacityChanged_(false);
+  }
+  return true;
+}
+
+bool NewConnections::Admit(const TcpConnection::PeerCredentials& credentials) {
+  if (connections_.size() >= kAdmissionPolicy_.max_pending) {
+    ++stats_.rejected_full;
+    LOG(kWarning) << "Rejecting new connection: " << connections_.size()
+                  << " connections are already waiting to identify themselves.";
+    return false;
+  }
+  if (credentials.valid &&
+      !(kAdmissionPolicy_.exempt_own_user && IsOwnUser(credentials.user_id)) &&
+      PendingCount(pending_per_user_, credentials.user_id) >=
+          kAdmissionPolicy_.max_pending_per_user) {
+    ++stats_.rejected_per_user;
+    LOG(kWarning) << "Rejecting new connection: user " << credentials.user_id
+                  << " already has too many connections waiting to identify themselves.";
+    return false;
+  }
+  if (credentials.process_id != 0 &&
+      PendingCount(pending_per_process_, credentials.process_id) >=
+          kAdmissionPolicy_.max_pending_per_process) {
+    ++stats_.rejected_per_process;
+    LOG(kWarning) << "Rejecting new connection: process " << credentials.process_id
+                  << " already has too many connections waiting to identify themselves.";
+    return false;
+  }
+  if (credentials.valid)
+    ++pending_per_user_[credentials.user_id];
+  if (credentials.process_id != 0)
+    ++pending_per_process_[credentials.process_id];
+  return true;
+}
+
+void NewConnections::Release(const TcpConnection::PeerCredentials& credentials) {
+  if (credentials.valid && --pending_per_user_[credentials.user_id] == 0)
+    pending_per_user_.erase(credentials.user_id);
+  if (credentials.process_id != 0 && --pending_per_process_[credentials.process_id] == 0)
+    pending_per_process_.erase(credentials.process_id);
 }
 
 bool NewConnections::Remove(TcpConnectionPtr connection) {
-  return connections_.erase(connection) == 1U;
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  auto itr(connections_.find(connection));
+  if (itr == std::end(connections_))
+    return false;
+  timer_wheel_.Cancel(itr->second.timeout);
+  Release(itr->second.credentials);
+  connections_.erase(itr);
+  connection->SetMaxMessageSize(TcpConnection::MaxMessageSize());
+  if (at_capacity_ && connections_.size() < kAdmissionPolicy_.max_pending) {
+    at_capacity_ = false;
+    kOnCapacityChanged_(true);
+  }
+  return true;
 }
 
 void NewConnections::CloseAll() {
+  std::lock_guard<std::mutex> lock{ mutex_ };
   for (auto connection : connections_)
     connection.first->Close();
 }
 
+NewConnections::Stats NewConnections::GetStats() const {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  Stats stats{ stats_ };
+  stats.pending = connections_.size();
+  return stats;
+}
+
 }  //  namespace vault_manager
 
 }  //  namespace maidsafe
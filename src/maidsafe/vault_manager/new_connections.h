@@ -19,30 +19,100 @@
 #ifndef MAIDSAFE_VAULT_MANAGER_NEW_CONNECTIONS_H_
 #define MAIDSAFE_VAULT_MANAGER_NEW_CONNECTIONS_H_
 
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 
 #include "boost/asio/io_service.hpp"
 
 #include "maidsafe/vault_manager/config.h"
+#include "maidsafe/vault_manager/tcp_connection.h"
+#include "maidsafe/vault_manager/timer_wheel.h"
 
 namespace maidsafe {
 
 namespace vault_manager {
 
+// Governs admission of connections which haven't yet identified themselves as a client or vault.
+// The defaults are from config.h.
+struct AdmissionPolicy {
+  enum class WhenFull {
+    // Connections beyond 'max_pending' are accepted and closed straight away.
+    kShed,
+    // Once 'max_pending' is reached, the capacity functor passed to NewConnections is invoked so
+    // that the listeners can stop accepting; further connections then wait in the listen backlog.
+    // Any connection already being accepted by then is still shed, as are all surplus connections
+    // if there's no capacity functor.
+    kDefer
+  };
+
+  AdmissionPolicy();
+  size_t max_pending;
+  // Only enforced where the peer's credentials are known, i.e. for Unix domain sockets (and for the
+  // process ID, only on Linux).
+  size_t max_pending_per_user, max_pending_per_process;
+  // If set (the default), 'max_pending_per_user' doesn't apply to the user this process runs as,
+  // since all vaults (e.g. reconnecting en masse after a handoff) and usually the local client run
+  // as that user.  'max_pending_per_process' still applies.
+  bool exempt_own_user;
+  // Until removed from NewConnections, a connection is closed if it sends a larger message.
+  size_t max_message_size;
+  WhenFull when_full;
+};
+
+// Holds connections until they identify themselves, closing any which take longer than
+// kRpcTimeout.  Thread-safe.
 class NewConnections : public std::enable_shared_from_this<NewConnections> {
  public:
-  static std::shared_ptr<NewConnections> MakeShared(boost::asio::io_service& io_service);
+  // Invoked with 'false' once the policy's 'max_pending' is reached and with 'true' once there's
+  // room again.  Only used if the policy's 'when_full' is kDefer.  Invoked with an internal lock
+  // held, so mustn't call back into this NewConnections.
+  typedef std::function<void(bool available)> CapacityFunctor;
+
+  struct Stats {
+    Stats()
+        : admitted(0), rejected_full(0), rejected_per_user(0), rejected_per_process(0),
+          timed_out(0), pending(0) {}
+    uint64_t admitted, rejected_full, rejected_per_user, rejected_per_process, timed_out;
+    size_t pending;
+  };
+
+  static std::shared_ptr<NewConnections> MakeShared(
+      boost::asio::io_service& io_service, AdmissionPolicy admission_policy = AdmissionPolicy{},
+      CapacityFunctor on_capacity_changed = nullptr);
   ~NewConnections();
-  void Add(TcpConnectionPtr connection);
+  // Returns false (without closing the connection) if the policy's limits don't allow 'connection'
+  // to be admitted.  Otherwise limits the size of messages it may send until removed.  Must be
+  // called before 'connection' is started.
+  bool Add(TcpConnectionPtr connection);
+  // Lifts the message size limit set by Add.
   bool Remove(TcpConnectionPtr connection);
   void CloseAll();
+  Stats GetStats() const;
 
  private:
-  explicit NewConnections(boost::asio::io_service& io_service);
-
-  boost::asio::io_service& io_service_;
-  std::map<TcpConnectionPtr, TimerPtr, std::owner_less<TcpConnectionPtr>> connections_;
+  struct Pending {
+    TimerWheel::TimeoutId timeout;
+    TcpConnection::PeerCredentials credentials;
+  };
+
+  NewConnections(boost::asio::io_service& io_service, AdmissionPolicy admission_policy,
+                 CapacityFunctor on_capacity_changed);
+  // Must be called with mutex_ held.  Returns false if a limit has been reached.
+  bool Admit(const TcpConnection::PeerCredentials& credentials);
+  void Release(const TcpConnection::PeerCredentials& credentials);
+
+  TimerWheel& timer_wheel_;
+  const AdmissionPolicy kAdmissionPolicy_;
+  const CapacityFunctor kOnCapacityChanged_;
+  mutable std::mutex mutex_;
+  std::map<TcpConnectionPtr, Pending, std::owner_less<TcpConnectionPtr>> connections_;
+  std::map<uint32_t, size_t> pending_per_user_;
+  std::map<uint64_t, size_t> pending_per_process_;
+  bool at_capacity_;
+  Stats stats_;
 };
 
 }  // namespace vault_manager
@@ -0,0 +1,296 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/placement.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+#ifdef MAIDSAFE_LINUX
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace {
+
+#ifdef MAIDSAFE_LINUX
+// From <numaif.h>, to avoid depending on libnuma.
+const int kMpolDefault(0);
+const int kMpolPreferred(1);
+
+std::vector<int> GetThreadCpus() {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  std::vector<int> cpus;
+  if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) != 0)
+    return cpus;
+  for (int cpu(0); cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &cpu_set))
+      cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+bool SetThreadCpus(const std::vector<int>& cpus) {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu : cpus) {
+    if (cpu < CPU_SETSIZE)
+      CPU_SET(cpu, &cpu_set);
+  }
+  if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) == 0)
+    return true;
+  LOG(kWarning) << "Failed to set CPU affinity: " << std::strerror(errno);
+  return false;
+}
+
+bool SetThreadMemoryPolicy(int mode, const std::vector<int>& nodes) {
+  const size_t kBitsPerWord(8 * sizeof(unsigned long));  // NOLINT
+  int max_node{ nodes.empty() ? 0 : *std::max_element(std::begin(nodes), std::end(nodes)) };
+  std::vector<unsigned long> node_mask(max_node / kBitsPerWord + 1, 0);  // NOLINT
+  for (int node : nodes)
+    node_mask[node / kBitsPerWord] |= 1UL << (node % kBitsPerWord);
+  if (syscall(SYS_set_mempolicy, mode, mode == kMpolDefault ? nullptr : node_mask.data(),
+              mode == kMpolDefault ? 0 : node_mask.size() * kBitsPerWord + 1) == 0) {
+    return true;
+  }
+  LOG(kWarning) << "Failed to set NUMA memory policy: " << std::strerror(errno);
+  return false;
+}
+#endif
+
+CpuTopology SingleNodeTopology() {
+  CpuTopology topology;
+  std::vector<int> cpus(std::max(std::thread::hardware_concurrency(), 1U));
+  for (size_t i(0); i < cpus.size(); ++i)
+    cpus[i] = static_cast<int>(i);
+  topology.node_cpus.push_back(cpus);
+  return topology;
+}
+
+std::vector<int> Subtract(const std::vector<int>& cpus, const std::set<int>& excluded) {
+  std::vector<int> result;
+  std::copy_if(std::begin(cpus), std::end(cpus), std::back_inserter(result),
+               [&excluded](int cpu) { return excluded.count(cpu) == 0; });
+  return result;
+}
+
+}  // unnamed namespace
+
+CpuTopology ReadCpuTopology() {
+#ifdef MAIDSAFE_LINUX
+  return ReadCpuTopology(fs::path{ "/sys/devices/system/node" });
+#else
+  return SingleNodeTopology();
+#endif
+}
+
+CpuTopology ReadCpuTopology(const fs::path& nodes_dir) {
+  CpuTopology topology;
+  // The online nodes are in the same format as a CPU list, e.g. "0,2" if node 1 is offline.
+  try {
+    for (int node : ParseCpuList(ReadFile(nodes_dir / "online").string())) {
+      if (topology.node_cpus.size() <= static_cast<size_t>(node))
+        topology.node_cpus.resize(node + 1);
+      topology.node_cpus[node] = ParseCpuList(
+          ReadFile(nodes_dir / ("node" + std::to_string(node)) / "cpulist").string());
+    }
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << "Failed to read NUMA topology from " << nodes_dir << ": " << e.what();
+    return SingleNodeTopology();
+  }
+  if (std::all_of(std::begin(topology.node_cpus), std::end(topology.node_cpus),
+                  [](const std::vector<int>& cpus) { return cpus.empty(); })) {
+    return SingleNodeTopology();
+  }
+  return topology;
+}
+
+std::vector<int> ParseCpuList(const std::string& cpu_list) {
+  std::vector<int> cpus;
+  std::istringstream stream{ cpu_list };
+  std::string range;
+  while (std::getline(stream, range, ',')) {
+    range.erase(std::remove_if(std::begin(range), std::end(range), [](char c) {
+      return std::isspace(static_cast<unsigned char>(c)) != 0;
+    }), std::end(range));
+    if (range.empty())
+      continue;
+    size_t dash{ range.find('-') };
+    try {
+      int first{ std::stoi(range.substr(0, dash)) };
+      int last{ dash == std::string::npos ? first : std::stoi(range.substr(dash + 1)) };
+      if (first < 0 || last < first)
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+      for (int cpu(first); cpu <= last; ++cpu)
+        cpus.push_back(cpu);
+    }
+    catch (const std::logic_error&) {  // From std::stoi
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    }
+  }
+  return cpus;
+}
+
+PlacementEngine::PlacementEngine(PlacementPolicy policy, CpuTopology topology)
+    : kPolicy_(std::move(policy)), kTopology_(std::move(topology)) {
+  if (kPolicy_.cores_per_vault < 1) {
+    LOG(kError) << "Each vault needs at least one core.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+}
+
+std::vector<int> PlacementEngine::UsableCpus(int node) const {
+  const std::vector<int>& kCpus(kTopology_.node_cpus[node]);
+  if (!kPolicy_.reserve_manager_core || kCpus.empty())
+    return kCpus;
+  // The reserved CPU is on the first node which has any.
+  for (int earlier_node(0); earlier_node < node; ++earlier_node) {
+    if (!kTopology_.node_cpus[earlier_node].empty())
+      return kCpus;
+  }
+  return std::vector<int>(std::next(std::begin(kCpus)), std::end(kCpus));
+}
+
+Placement PlacementEngine::Place(const std::vector<Placement>& existing) const {
+  switch (kPolicy_.mode) {
+    case PlacementPolicy::Mode::kRoundRobinNode:
+      return PlaceOnLeastLoadedNode(existing);
+    case PlacementPolicy::Mode::kDedicatedCores: {
+      std::set<int> used_cpus;
+      for (const auto& placement : existing)
+        used_cpus.insert(std::begin(placement.cpus), std::end(placement.cpus));
+      Placement best;
+      size_t most_free{ 0 };
+      for (size_t node(0); node < kTopology_.node_cpus.size(); ++node) {
+        std::vector<int> free_cpus{ Subtract(UsableCpus(static_cast<int>(node)), used_cpus) };
+        if (free_cpus.size() > most_free) {
+          most_free = free_cpus.size();
+          best.cpus = free_cpus;
+          best.numa_nodes.assign(1, static_cast<int>(node));
+        }
+      }
+      if (most_free >= static_cast<size_t>(kPolicy_.cores_per_vault)) {
+        best.cpus.resize(kPolicy_.cores_per_vault);
+        return best;
+      }
+      LOG(kWarning) << "Too few spare cores to dedicate " << kPolicy_.cores_per_vault
+                    << " to another vault; sharing a node's cores instead.";
+      return PlaceOnLeastLoadedNode(existing);
+    }
+    case PlacementPolicy::Mode::kUnpinned:
+    default: {
+      Placement placement;
+      if (kPolicy_.reserve_manager_core) {
+        for (size_t node(0); node < kTopology_.node_cpus.size(); ++node) {
+          std::vector<int> cpus{ UsableCpus(static_cast<int>(node)) };
+          placement.cpus.insert(std::end(placement.cpus), std::begin(cpus), std::end(cpus));
+        }
+      }
+      return placement;
+    }
+  }
+}
+
+Placement PlacementEngine::PlaceOnLeastLoadedNode(const std::vector<Placement>& existing) const {
+  std::vector<size_t> vault_counts(kTopology_.node_cpus.size(), 0);
+  for (const auto& placement : existing) {
+    if (placement.numa_nodes.size() == 1U && IsValid(placement))
+      ++vault_counts[placement.numa_nodes.front()];
+  }
+  Placement placement;
+  size_t fewest{ std::numeric_limits<size_t>::max() };
+  for (size_t node(0); node < vault_counts.size(); ++node) {
+    std::vector<int> cpus{ UsableCpus(static_cast<int>(node)) };
+    if (!cpus.empty() && vault_counts[node] < fewest) {
+      fewest = vault_counts[node];
+      placement.cpus = cpus;
+      placement.numa_nodes.assign(1, static_cast<int>(node));
+    }
+  }
+  return placement;
+}
+
+bool PlacementEngine::IsValid(const Placement& placement) const {
+  std::set<int> all_cpus;
+  for (const auto& cpus : kTopology_.node_cpus)
+    all_cpus.insert(std::begin(cpus), std::end(cpus));
+  return std::all_of(std::begin(placement.cpus), std::end(placement.cpus),
+                     [&all_cpus](int cpu) { return all_cpus.count(cpu) != 0; }) &&
+         std::all_of(std::begin(placement.numa_nodes), std::end(placement.numa_nodes),
+                     [this](int node) {
+                       return node >= 0 &&
+                              static_cast<size_t>(node) < kTopology_.node_cpus.size() &&
+                              !kTopology_.node_cpus[node].empty();
+                     });
+}
+
+#ifdef MAIDSAFE_LINUX
+ScopedPlacement::ScopedPlacement(const Placement& placement)
+    : restore_cpus_(false), restore_memory_policy_(false), previous_cpus_() {
+  if (!placement.cpus.empty()) {
+    previous_cpus_ = GetThreadCpus();
+    restore_cpus_ = !previous_cpus_.empty() && SetThreadCpus(placement.cpus);
+  }
+  // Preferred rather than bound, so that a vault overflows onto other nodes rather than failing.
+  if (!placement.numa_nodes.empty())
+    restore_memory_policy_ = SetThreadMemoryPolicy(kMpolPreferred, placement.numa_nodes);
+}
+
+// The VaultManager's own threads are never placed, so restore the default memory policy.
+ScopedPlacement::~ScopedPlacement() {
+  if (restore_cpus_)
+    SetThreadCpus(previous_cpus_);
+  if (restore_memory_policy_)
+    SetThreadMemoryPolicy(kMpolDefault, std::vector<int>{});
+}
+#else
+ScopedPlacement::ScopedPlacement(const Placement& placement)
+    : restore_cpus_(false), restore_memory_policy_(false), previous_cpus_() {
+  if (!placement.cpus.empty() || !placement.numa_nodes.empty())
+    LOG(kWarning) << "Vault placement is only supported on Linux.";
+}
+
+ScopedPlacement::~ScopedPlacement() {}
+#endif
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
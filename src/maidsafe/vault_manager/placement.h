@@ -0,0 +1,113 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_PLACEMENT_H_
+#define MAIDSAFE_VAULT_MANAGER_PLACEMENT_H_
+
+#include <string>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// The CPUs a vault may run on and the NUMA nodes its memory should come from.  Empty means
+// unrestricted.
+struct Placement {
+  std::vector<int> cpus;
+  std::vector<int> numa_nodes;
+};
+
+struct PlacementPolicy {
+  enum class Mode {
+    kUnpinned,
+    // Each new vault is confined to the node with fewest vaults, sharing that node's CPUs.
+    kRoundRobinNode,
+    // Each new vault gets 'cores_per_vault' CPUs of its own, all on one node where possible.  Once
+    // there are no more spare CPUs, vaults are placed as for kRoundRobinNode.
+    kDedicatedCores
+  };
+
+  PlacementPolicy() : mode(Mode::kUnpinned), cores_per_vault(1), reserve_manager_core(false) {}
+
+  Mode mode;
+  int cores_per_vault;
+  // If true, the first CPU of the first node is left to the VaultManager (which isn't itself
+  // pinned).
+  bool reserve_manager_core;
+};
+
+// The CPUs of each NUMA node, indexed by node ID.  Node IDs needn't be contiguous, so nodes which
+// are absent or offline have no CPUs.
+struct CpuTopology {
+  std::vector<std::vector<int>> node_cpus;
+};
+
+// On Linux, read from sysfs.  Elsewhere (or if sysfs is unavailable) this is a single node with
+// std::thread::hardware_concurrency() CPUs.
+CpuTopology ReadCpuTopology();
+// Reads the nodes listed in 'nodes_dir'/online, laid out as /sys/devices/system/node.  Falls back
+// to a single node as above if that fails or no node has any CPUs.
+CpuTopology ReadCpuTopology(const boost::filesystem::path& nodes_dir);
+
+// Parses a kernel CPU list such as "0-3,8,10-11".  Throws on malformed input.
+std::vector<int> ParseCpuList(const std::string& cpu_list);
+
+// Chooses placements for new vaults.  Stateless - the placements of existing vaults are passed in,
+// so these can be restored from the config file and kept across restarts.
+class PlacementEngine {
+ public:
+  PlacementEngine(PlacementPolicy policy, CpuTopology topology);
+
+  Placement Place(const std::vector<Placement>& existing) const;
+  // Returns false if 'placement' refers to CPUs or nodes which don't exist (e.g. it was restored
+  // from the config file of a different machine).
+  bool IsValid(const Placement& placement) const;
+
+ private:
+  std::vector<int> UsableCpus(int node) const;
+  Placement PlaceOnLeastLoadedNode(const std::vector<Placement>& existing) const;
+
+  const PlacementPolicy kPolicy_;
+  const CpuTopology kTopology_;
+};
+
+// While in scope, the calling thread is bound to the placement's CPUs and prefers its nodes'
+// memory.  Both settings are inherited by processes spawned meanwhile, so a vault starts out
+// placed, rather than being moved once running.  A no-op other than on Linux.
+class ScopedPlacement {
+ public:
+  explicit ScopedPlacement(const Placement& placement);
+  ~ScopedPlacement();
+
+ private:
+  ScopedPlacement(const ScopedPlacement&) = delete;
+  ScopedPlacement(ScopedPlacement&&) = delete;
+  ScopedPlacement& operator=(ScopedPlacement) = delete;
+
+  bool restore_cpus_, restore_memory_policy_;
+  std::vector<int> previous_cpus_;
+};
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_PLACEMENT_H_
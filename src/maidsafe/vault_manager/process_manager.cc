@@ -19,32 +19,47 @@
 #include "maidsafe/vault_manager/process_manager.h"
 
 #include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
-#ifdef MAIDSAFE_BSD
-extern "C" char **environ;
+#ifndef MAIDSAFE_WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #endif
 
-#ifdef _MSC_VER
-#pragma warning(push)
-#pragma warning(disable : 4702)
+#ifdef MAIDSAFE_LINUX
+#include <sys/syscall.h>
+// Not yet defined by older headers; these values are common to all architectures.
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+#ifndef SYS_pidfd_send_signal
+#define SYS_pidfd_send_signal 424
 #endif
-#include "boost/process/execute.hpp"
-#ifdef _MSC_VER
-#pragma warning(pop)
+#ifndef P_PIDFD
+#define P_PIDFD 3
 #endif
-#include "boost/process/initializers.hpp"
+#endif
+
 #include "boost/process/mitigate.hpp"
 #include "boost/process/terminate.hpp"
 #include "boost/process/wait_for_exit.hpp"
 
 #include "maidsafe/common/log.h"
-#include "maidsafe/common/make_unique.h"
 #include "maidsafe/common/on_scope_exit.h"
 #include "maidsafe/common/process.h"
 #include "maidsafe/common/utils.h"
 
 #include "maidsafe/vault_manager/dispatcher.h"
+#include "maidsafe/vault_manager/spawn.h"
 #include "maidsafe/vault_manager/tcp_connection.h"
 #include "maidsafe/vault_manager/utils.h"
 #include "maidsafe/vault_manager/vault_info.pb.h"
@@ -58,63 +73,108 @@ namespace vault_manager {
 
 namespace {
 
-bool ConnectionsEqual(const TcpConnectionPtr& lhs, const TcpConnectionPtr& rhs) {
-  return !lhs.owner_before(rhs) && !rhs.owner_before(lhs);
+#ifdef MAIDSAFE_LINUX
+int PidfdOpen(pid_t process_id) {
+  return static_cast<int>(syscall(SYS_pidfd_open, process_id, 0));
 }
 
-void CheckNewVaultDoesntConflict(const VaultInfo& new_vault, const VaultInfo& existing_vault) {
-  if (new_vault.pmid_and_signer && existing_vault.pmid_and_signer &&
-      new_vault.pmid_and_signer->first.name() == existing_vault.pmid_and_signer->first.name()) {
-    LOG(kError) << "Vault process with Pmid "
-                << DebugId(new_vault.pmid_and_signer->first.name().value) << " already exists.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+// Opening a pidfd needs Linux 5.3 and waiting on one needs 5.4.  Waiting on a pidfd for this
+// process (which isn't our child) fails with ECHILD if it's supported, and EINVAL otherwise.
+bool PidfdsSupported() {
+  int pidfd{ PidfdOpen(getpid()) };
+  if (pidfd == -1) {
+    LOG(kInfo) << "pidfds unavailable (" << std::strerror(errno) << "); using SIGCHLD instead.";
+    return false;
   }
+  siginfo_t info;
+  bool supported{ waitid(static_cast<idtype_t>(P_PIDFD), pidfd, &info, WEXITED | WNOHANG) == -1 &&
+                  errno == ECHILD };
+  close(pidfd);
+  if (!supported)
+    LOG(kInfo) << "Can't wait on pidfds; using SIGCHLD instead.";
+  return supported;
+}
+#endif
 
-  if (new_vault.vault_dir == existing_vault.vault_dir) {
-    LOG(kError) << "Vault process with vault dir " << new_vault.vault_dir << " already exists.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+void ValidateVaultExecutable(const fs::path& vault_executable_path) {
+  boost::system::error_code ec;
+  if (!fs::exists(vault_executable_path, ec) || ec) {
+    LOG(kError) << vault_executable_path << " doesn't exist.  " << (ec ? ec.message() : "");
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
   }
-
-  if (new_vault.label == existing_vault.label) {
-    LOG(kError) << "Vault process with label " << new_vault.label.string() << " already exists.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+  if (!fs::is_regular_file(vault_executable_path, ec) || ec) {
+    LOG(kError) << vault_executable_path << " is not a regular file.  "
+                << (ec ? ec.message() : "");
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
   }
-
-  if (ConnectionsEqual(new_vault.tcp_connection, existing_vault.tcp_connection)) {
-    LOG(kError) << "Vault process with this tcp_connection already exists.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+  if (fs::is_symlink(vault_executable_path, ec) || ec) {
+    LOG(kError) << vault_executable_path << " is a symlink.  " << (ec ? ec.message() : "");
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
   }
 }
 
 }  // unnamed namespace
 
-ProcessManager::Child::Child(VaultInfo info, boost::asio::io_service &io_service, int restarts)
+RestartPolicy::RestartPolicy()
+    : initial_backoff(kVaultRestartInitialBackoff),
+      max_backoff(kVaultRestartMaxBackoff),
+      crash_window(kVaultCrashWindow),
+      max_crashes_in_window(kMaxVaultRestarts),
+      max_concurrent_restarts(kMaxConcurrentVaultRestarts) {}
+
+HealthPolicy::HealthPolicy()
+    : probe_interval(kVaultHealthProbeInterval),
+      max_round_trip(kMaxVaultHealthProbeRoundTrip),
+      max_missed_probes(kMaxMissedVaultHealthProbes) {}
+
+ProcessManager::Child::Child(VaultInfo info, boost::asio::io_service &io_service)
     : info(std::move(info)),
+      process_id(0),
       on_exit(),
-      timer(maidsafe::make_unique<Timer>(io_service)),
-      restart_count(restarts),
+      timeout(0),
+      crash_times(),
+      restarting(false),
+      executable_path(),
       process_args(),
       status(ProcessStatus::kBeforeStarted),
+      health(),
+      answers_health_probes(false),
+      awaited_probe(0),
+      probe_sent_time(),
 #ifdef MAIDSAFE_WIN32
-      process(PROCESS_INFORMATION()),
-      handle(io_service) {}
+      handle(io_service),
+      process(PROCESS_INFORMATION()) {}
+#elif defined MAIDSAFE_LINUX
+      pidfd(),
+      process(0) {
+  static_cast<void>(io_service);
+}
 #else
-      process(0) {}
+      process(0) {
+  static_cast<void>(io_service);
+}
 #endif
 
 ProcessManager::Child::Child(Child&& other)
     : info(std::move(other.info)),
+      process_id(std::move(other.process_id)),
       on_exit(std::move(other.on_exit)),
-      timer(std::move(other.timer)),
-      restart_count(std::move(other.restart_count)),
+      timeout(std::move(other.timeout)),
+      crash_times(std::move(other.crash_times)),
+      restarting(std::move(other.restarting)),
+      executable_path(std::move(other.executable_path)),
       process_args(std::move(other.process_args)),
       status(std::move(other.status)),
+      health(std::move(other.health)),
+      answers_health_probes(std::move(other.answers_health_probes)),
+      awaited_probe(std::move(other.awaited_probe)),
+      probe_sent_time(std::move(other.probe_sent_time)),
 #ifdef MAIDSAFE_WIN32
-      process(std::move(other.process)),
-      handle(std::move(other.handle)) {}
-#else
-      process(std::move(other.process)) {}
+      handle(std::move(other.handle)),
+#elif defined MAIDSAFE_LINUX
+      pidfd(std::move(other.pidfd)),
 #endif
+      process(std::move(other.process)) {}
 
 ProcessManager::Child& ProcessManager::Child::operator=(Child other) {
   swap(*this, other);
@@ -124,142 +184,522 @@ ProcessManager::Child& ProcessManager::Child::operator=(Child other) {
 void swap(ProcessManager::Child& lhs, ProcessManager::Child& rhs){
   using std::swap;
   swap(lhs.info, rhs.info);
+  swap(lhs.process_id, rhs.process_id);
   swap(lhs.on_exit, rhs.on_exit);
-  swap(lhs.timer, rhs.timer);
-  swap(lhs.restart_count, rhs.restart_count);
+  swap(lhs.timeout, rhs.timeout);
+  swap(lhs.crash_times, rhs.crash_times);
+  swap(lhs.restarting, rhs.restarting);
+  swap(lhs.executable_path, rhs.executable_path);
   swap(lhs.process_args, rhs.process_args);
   swap(lhs.status, rhs.status);
+  swap(lhs.health, rhs.health);
+  swap(lhs.answers_health_probes, rhs.answers_health_probes);
+  swap(lhs.awaited_probe, rhs.awaited_probe);
+  swap(lhs.probe_sent_time, rhs.probe_sent_time);
   swap(lhs.process, rhs.process);
 #ifdef MAIDSAFE_WIN32
   swap(lhs.handle, rhs.handle);
+#elif defined MAIDSAFE_LINUX
+  swap(lhs.pidfd, rhs.pidfd);
 #endif
 }
 
 
 
 ProcessManager::ProcessManager(boost::asio::io_service &io_service, fs::path vault_executable_path,
-                               Port listening_port)
+                               Port listening_port, fs::path local_socket_path,
+                               AdoptChannelFunctor adopt_channel,
+                               OnQuarantinedFunctor on_quarantined,
+                               OnUnexpectedExitFunctor on_unexpected_exit,
+                               RestartPolicy restart_policy, PlacementPolicy placement_policy,
+                               HealthPolicy health_policy)
     : io_service_(io_service),
 #ifndef MAIDSAFE_WIN32
-      signal_set_(io_service_, SIGCHLD),
+      signal_set_(io_service_),
+#endif
+#ifdef MAIDSAFE_LINUX
+      kUsePidfds_(PidfdsSupported()),
 #endif
       stop_all_flag_(),
+      mutex_(),
+      vault_erased_(),
+      stopping_all_(false),
       kListeningPort_(listening_port),
-      kVaultExecutablePath_(vault_executable_path),
-      vaults_() {
+      kLocalSocketPath_(local_socket_path),
+      kAdoptChannel_(adopt_channel),
+      kOnQuarantined_(on_quarantined),
+      kOnUnexpectedExit_(on_unexpected_exit),
+      kRestartPolicy_(restart_policy),
+      kPlacementEngine_(placement_policy, ReadCpuTopology()),
+      kHealthPolicy_(health_policy),
+      timer_wheel_(GetTimerWheel(io_service_)),
+      probe_timeout_(0),
+      next_probe_sequence_(1),
+      vault_executable_path_(vault_executable_path),
+      resource_controller_(),
+      vaults_(),
+      pending_restarts_(),
+      restarts_in_progress_(0) {
   static_assert(std::is_same<ProcessId, process::ProcessId>::value,
                 "process::ProcessId is statically checked as being of suitable size for holding a "
                 "pid_t or DWORD, so vault_manager::ProcessId should use the same type.");
-  boost::system::error_code ec;
-  if (!fs::exists(kVaultExecutablePath_, ec) || ec) {
-    LOG(kError) << kVaultExecutablePath_ << " doesn't exist.  " << (ec ? ec.message() : "");
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
-  }
-  if (!fs::is_regular_file(kVaultExecutablePath_, ec) || ec) {
-    LOG(kError) << kVaultExecutablePath_ << " is not a regular file.  " << (ec ? ec.message() : "");
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
-  }
-  if (fs::is_symlink(kVaultExecutablePath_, ec) || ec) {
-    LOG(kError) << kVaultExecutablePath_ << " is a symlink.  " << (ec ? ec.message() : "");
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
-  }
-  LOG(kVerbose) << "Vault executable found at " << kVaultExecutablePath_;
+  ValidateVaultExecutable(vault_executable_path_);
+  LOG(kVerbose) << "Vault executable found at " << vault_executable_path_;
+  if (kHealthPolicy_.probe_interval != std::chrono::milliseconds::zero())
+    ScheduleHealthProbes();
+#ifdef MAIDSAFE_LINUX
+  if (kUsePidfds_)
+    return;
+#endif
+#ifndef MAIDSAFE_WIN32
+  signal_set_.add(SIGCHLD);
+#endif
   InitSignalHandler();
 }
 
 std::shared_ptr<ProcessManager> ProcessManager::MakeShared(
     boost::asio::io_service& io_service, boost::filesystem::path vault_executable_path,
-    Port listening_port) {
+    Port listening_port, boost::filesystem::path local_socket_path,
+    AdoptChannelFunctor adopt_channel, OnQuarantinedFunctor on_quarantined,
+    OnUnexpectedExitFunctor on_unexpected_exit, RestartPolicy restart_policy,
+    PlacementPolicy placement_policy, HealthPolicy health_policy) {
   return std::shared_ptr<ProcessManager>{ new ProcessManager{ io_service, vault_executable_path,
-                                                              listening_port } };
+      listening_port, local_socket_path, adopt_channel, on_quarantined, on_unexpected_exit,
+      restart_policy, placement_policy, health_policy } };
 }
 
 ProcessManager::~ProcessManager() {
+  timer_wheel_.Cancel(probe_timeout_);
   assert(vaults_.empty());
 }
 
-void ProcessManager::StopAll() {
-  std::call_once(stop_all_flag_, [this] {
-    for (const auto& vault : vaults_)
-      StopProcess(vault.info.tcp_connection);
+StopAllReport ProcessManager::StopAll(std::chrono::steady_clock::duration deadline,
+                                      std::chrono::steady_clock::duration terminate_timeout) {
+  StopAllReport report;
+  std::call_once(stop_all_flag_, [&] {
+    const auto kStart(std::chrono::steady_clock::now());
+    std::unique_lock<std::mutex> lock{ mutex_ };
+    stopping_all_ = true;
+    timer_wheel_.Cancel(probe_timeout_);
+    // Vaults which aren't running can just be dropped.
+    pending_restarts_.clear();
+    auto itr(std::begin(vaults_));
+    while (itr != std::end(vaults_)) {
+      if (itr->status == ProcessStatus::kBackingOff ||
+          itr->status == ProcessStatus::kQuarantined) {
+        EraseVault(itr++);
+        continue;
+      }
+      // Vaults which haven't yet reported in are asked to stop as soon as they do.
+      if (itr->status != ProcessStatus::kStopping && itr->info.tcp_connection)
+        SendVaultShutdownRequest(itr->info.tcp_connection);
+      itr->status = ProcessStatus::kStopping;
+      // All vaults share the one deadline rather than each having its own timeout.
+      CancelTimeout(*itr);
+      ++itr;
+    }
+    report.vault_count = vaults_.size();
+    auto all_exited([this] { return vaults_.empty(); });
+
+    vault_erased_.wait_until(lock, kStart + deadline, all_exited);
+    size_t remaining{ vaults_.size() };
+    report.stopped = report.vault_count - remaining;
 #ifndef MAIDSAFE_WIN32
+    if (remaining != 0U) {
+      LOG(kWarning) << remaining << " vault(s) didn't stop in time; sending SIGTERM.";
+      for (auto vault_itr(std::begin(vaults_)); vault_itr != std::end(vaults_); ++vault_itr)
+        SignalProcess(vault_itr, SIGTERM);
+      vault_erased_.wait_for(lock, terminate_timeout, all_exited);
+      report.terminated = remaining - vaults_.size();
+      remaining = vaults_.size();
+    }
+#else
+    static_cast<void>(terminate_timeout);
+#endif
+    report.killed = remaining;
+    if (remaining != 0U) {
+      LOG(kWarning) << remaining << " vault(s) still running; killing them.";
+      std::vector<NonEmptyString> labels;
+      for (const auto& vault : vaults_)
+        labels.push_back(vault.info.label);
+      lock.unlock();
+      for (const auto& label : labels)
+        OnProcessExit(label, -1, true);
+    }
+#ifndef MAIDSAFE_WIN32
+    // Only now, as exits may have been notified via SIGCHLD until all vaults were removed.
     boost::system::error_code ignored_ec;
     signal_set_.cancel(ignored_ec);
 #endif
+    report.drain_time = std::chrono::steady_clock::now() - kStart;
   });
+  return report;
+}
+
+bool ProcessManager::CanHandOff() const {
+#ifdef MAIDSAFE_LINUX
+  return kUsePidfds_;
+#else
+  return false;
+#endif
+}
+
+std::vector<HandedOffVault> ProcessManager::ReleaseAll() {
+  if (!CanHandOff()) {
+    LOG(kError) << "Vaults can only be handed over on Linux with pidfds.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::uninitialised));
+  }
+  std::vector<HandedOffVault> released;
+#ifdef MAIDSAFE_LINUX
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  // Nothing is removed until all the pidfds have been duplicated.
+  on_scope_exit close_pidfds{ [&released] {
+    for (const auto& vault : released) {
+      if (vault.pidfd != -1)
+        close(vault.pidfd);
+    }
+  } };
+  for (const auto& vault : vaults_) {
+    HandedOffVault handed_off;
+    handed_off.info = vault.info;
+    handed_off.executable_path = vault.executable_path;
+    // Only a vault whose process hasn't yet exited has a pidfd.
+    if (vault.pidfd) {
+      handed_off.pidfd = fcntl(vault.pidfd->native_handle(), F_DUPFD_CLOEXEC, 0);
+      if (handed_off.pidfd == -1) {
+        LOG(kError) << "Failed to duplicate pidfd: " << std::strerror(errno);
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unknown));
+      }
+      handed_off.process_id = vault.process_id;
+      handed_off.stopping = vault.status == ProcessStatus::kStopping;
+      handed_off.restarting = vault.status == ProcessStatus::kRestarting;
+    }
+    released.push_back(std::move(handed_off));
+  }
+
+  stopping_all_ = true;
+  timer_wheel_.Cancel(probe_timeout_);
+  pending_restarts_.clear();
+  restarts_in_progress_ = 0;
+  // Unlike EraseVault, this leaves each vault's cgroup in place for the adopting ProcessManager.
+  while (!vaults_.empty()) {
+    auto itr(std::begin(vaults_));
+    CancelTimeout(*itr);
+    boost::system::error_code ignored_ec;
+    if (itr->pidfd)
+      itr->pidfd->close(ignored_ec);
+    vaults_.Erase(itr);
+  }
+  vault_erased_.notify_all();
+  close_pidfds.Release();
+  LOG(kInfo) << "Released " << released.size() << " vault(s) for handing over.";
+#endif
+  return released;
+}
+
+void ProcessManager::AdoptProcess(HandedOffVault vault) {
+#ifdef MAIDSAFE_LINUX
+  on_scope_exit close_pidfd{ [&vault] {
+    if (vault.pidfd != -1)
+      close(vault.pidfd);
+  } };
+#endif
+  if (!CanHandOff() || vault.pidfd == -1 || vault.process_id == 0) {
+    LOG(kError) << "Can't adopt vault: it's not running or vaults can't be handed over here.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  if (vault.info.vault_dir.empty() || !vault.info.label.IsInitialised() ||
+      !vault.info.pmid_and_signer) {
+    LOG(kError) << "Can't adopt vault: vault_dir path and/or vault label and/or Pmid is empty.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+#ifdef MAIDSAFE_LINUX
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  if (stopping_all_) {
+    LOG(kError) << "Can't adopt vault: all vaults are being stopped.";
+    BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::vault_terminated));
+  }
+  vault.info.tcp_connection.reset();
+  Child child{ vault.info, io_service_ };
+  child.executable_path =
+      vault.executable_path.empty() ? vault_executable_path_ : vault.executable_path;
+  child.process = bp::child(static_cast<pid_t>(vault.process_id));
+  auto itr(vaults_.Add(std::move(child)));
+  on_scope_exit strong_guarantee{ [this, itr] {
+    vaults_.Erase(itr);
+    vault_erased_.notify_all();
+  } };
+  vaults_.SetProcessId(itr, vault.process_id);
+  const int kNativePidfd{ vault.pidfd };
+  vault.pidfd = -1;  // Now owned by WatchPidfd.
+  WatchPidfd(itr, kNativePidfd);
+  resource_controller_.SetLimits(itr->info.label, itr->info.resource_limits, itr->process_id);
+
+  itr->status = vault.stopping ? ProcessStatus::kStopping :
+                vault.restarting ? ProcessStatus::kRestarting : ProcessStatus::kStarting;
+  NonEmptyString label{ itr->info.label };
+  const bool kAwaitingReconnect{ itr->status == ProcessStatus::kStarting };
+  ArmTimeout(*itr, kAwaitingReconnect ? kVaultReconnectTimeout : kVaultStopTimeout,
+             [this, label, kAwaitingReconnect] {
+               LOG(kWarning) << "Timed out waiting for adopted vault " << label.string() << " to "
+                             << (kAwaitingReconnect ? "reconnect" : "stop")
+                             << "; terminating now.";
+               OnProcessExit(label, -1, true);
+             });
+  strong_guarantee.Release();
+  LOG(kInfo) << "Adopted vault " << label.string() << " with process ID " << vault.process_id;
+#endif
+}
+
+void ProcessManager::ReclaimAll(std::vector<HandedOffVault> vaults) {
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    stopping_all_ = false;
+    if (kHealthPolicy_.probe_interval != std::chrono::milliseconds::zero())
+      ScheduleHealthProbes();
+  }
+  for (auto& vault : vaults) {
+    NonEmptyString label{ vault.info.label };
+    try {
+      if (vault.pidfd == -1)
+        RestoreProcess(std::move(vault.info));
+      else
+        AdoptProcess(std::move(vault));
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Failed to reclaim vault " << label.string() << ": "
+                  << boost::diagnostic_information(e);
+    }
+  }
+  LOG(kInfo) << "Reclaimed " << vaults.size() << " vault(s) which couldn't be handed over.";
 }
 
 std::vector<VaultInfo> ProcessManager::GetAll() const {
+  std::lock_guard<std::mutex> lock{ mutex_ };
   std::vector<VaultInfo> all_vaults;
   for (const auto& vault : vaults_)
     all_vaults.push_back(vault.info);
   return all_vaults;
 }
 
-void ProcessManager::AddProcess(VaultInfo info, int restart_count) {
+void ProcessManager::SetVaultExecutablePath(const fs::path& vault_executable_path) {
+  ValidateVaultExecutable(vault_executable_path);
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  vault_executable_path_ = vault_executable_path;
+}
+
+fs::path ProcessManager::VaultExecutablePath() const {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  return vault_executable_path_;
+}
+
+void ProcessManager::AddProcess(VaultInfo info) {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  auto itr(DoAddProcess(std::move(info)));
+  // Add offers strong exception guarantee - only need to cover subsequent calls.
+  on_scope_exit strong_guarantee{ [this, itr] { EraseVault(itr); } };
+  StartProcess(itr);
+  strong_guarantee.Release();
+}
+
+bool ProcessManager::RestoreProcess(VaultInfo info) {
+  std::vector<VaultInfo> quarantined;
+  on_scope_exit notify_quarantined{ [&] { NotifyQuarantined(quarantined); } };
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  auto itr(DoAddProcess(std::move(info)));
+  try {
+    StartProcess(itr);
+    return true;
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed starting vault " << itr->info.label.string() << ": "
+                << boost::diagnostic_information(e);
+    ScheduleRestart(itr, quarantined);
+    return false;
+  }
+}
+
+ProcessManager::Registry::iterator ProcessManager::DoAddProcess(VaultInfo info) {
   if (info.vault_dir.empty() || !info.label.IsInitialised() || !info.pmid_and_signer) {
     LOG(kError) << "Can't add vault: vault_dir path and/or vault label and/or Pmid is empty.";
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
   }
-  if (restart_count > kMaxVaultRestarts) {
-    LOG(kError) << "Can't add vault process - too many restarts.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  if (stopping_all_) {
+    LOG(kError) << "Can't add vault: all vaults are being stopped.";
+    BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::vault_terminated));
   }
-  for (const auto& vault : vaults_)
-    CheckNewVaultDoesntConflict(info, vault.info);
-
-  // emplace offers strong exception guarantee - only need to cover subsequent calls.
-  auto itr(vaults_.emplace(std::end(vaults_), Child{ info, io_service_, restart_count }));
-  on_scope_exit strong_guarantee{ [this, itr] { vaults_.erase(itr); } };
-  StartProcess(itr);
-  strong_guarantee.Release();
+  // A vault restored from the config file keeps its placement if that's still possible here.
+  bool has_placement{ !info.placement.cpus.empty() || !info.placement.numa_nodes.empty() };
+  if (!has_placement || !kPlacementEngine_.IsValid(info.placement)) {
+    std::vector<Placement> existing;
+    for (const auto& vault : vaults_)
+      existing.push_back(vault.info.placement);
+    info.placement = kPlacementEngine_.Place(existing);
+  }
+  Child child{ info, io_service_ };
+  child.executable_path = vault_executable_path_;
+  return vaults_.Add(std::move(child));
 }
 
-VaultInfo ProcessManager::HandleVaultStarted(TcpConnectionPtr connection, ProcessId process_id) {
-  auto itr(std::find_if(std::begin(vaults_), std::end(vaults_),
-                        [this, process_id](const Child& vault) {
-                          return GetProcessId(vault) == process_id;
-                        }));
+VaultInfo ProcessManager::HandleVaultStarted(TcpConnectionPtr connection, ProcessId process_id,
+                                             bool answers_health_probes) {
+  std::vector<VaultInfo> quarantined;
+  on_scope_exit notify_quarantined{ [&] { NotifyQuarantined(quarantined); } };
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  // A vault using an inherited channel is already bound to its connection.
+  auto itr(vaults_.FindByConnection(connection));
+  if (itr != std::end(vaults_)) {
+    if (itr->process_id != process_id) {
+      LOG(kError) << "Vault on inherited channel claims process ID " << process_id
+                  << " but is process ID " << itr->process_id;
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+    }
+  } else {
+    itr = vaults_.FindByProcessId(process_id);
+  }
   if (itr == std::end(vaults_)) {
     LOG(kError) << "Failed to find vault with process ID " << process_id << " in child processes.";
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
   }
-  itr->timer->cancel();
-  itr->info.tcp_connection = connection;
-  itr->status = ProcessStatus::kRunning;
+  vaults_.SetConnection(itr, connection);
+  itr->answers_health_probes = answers_health_probes;
+  itr->awaited_probe = 0;
+  itr->health.consecutive_missed = 0;
+  if (itr->status == ProcessStatus::kStopping) {
+    // Asked to stop (e.g. by StopAll) before reporting in; any stop timeout still applies.
+    SendVaultShutdownRequest(connection);
+  } else {
+    CancelTimeout(*itr);
+    itr->status = ProcessStatus::kRunning;
+  }
+  EndRestart(itr, quarantined);
   return itr->info;
 }
 
+void ProcessManager::HandleHealthProbeResponse(TcpConnectionPtr connection, uint64_t sequence) {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  auto itr(vaults_.FindByConnection(connection));
+  if (itr == std::end(vaults_) || sequence == 0 || itr->awaited_probe != sequence)
+    return;
+  itr->awaited_probe = 0;
+  auto& health(itr->health);
+  const auto kRoundTrip(std::chrono::steady_clock::now() - itr->probe_sent_time);
+  ++health.probes_answered;
+  health.last_round_trip = kRoundTrip;
+  health.max_round_trip = std::max(health.max_round_trip, kRoundTrip);
+  health.smoothed_round_trip = health.probes_answered == 1 ? kRoundTrip :
+      (health.smoothed_round_trip * 7 + kRoundTrip) / 8;
+  if (kRoundTrip > kHealthPolicy_.max_round_trip) {
+    LOG(kWarning) << "Vault " << itr->info.label.string() << " took "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(kRoundTrip).count()
+                  << " ms to answer a health probe.";
+    // Any resulting kill is left to the next round of probes, as we're on the vault's strand.
+    RecordMissedProbe(*itr);
+  } else {
+    health.consecutive_missed = 0;
+  }
+}
+
+VaultHealth ProcessManager::GetHealth(const NonEmptyString& label) const {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  return DoFind(label)->health;
+}
+
 void ProcessManager::AssignOwner(const NonEmptyString& label,
                                  const passport::PublicMaid::Name& owner_name,
                                  DiskUsage max_disk_usage) {
+  std::lock_guard<std::mutex> lock{ mutex_ };
   auto itr(DoFind(label));
   itr->info.owner_name = owner_name;
   itr->info.max_disk_usage = max_disk_usage;
 }
 
-void ProcessManager::StartProcess(std::vector<Child>::iterator itr) {
+void ProcessManager::SetVaultDir(const NonEmptyString& label, const fs::path& vault_dir) {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  vaults_.SetVaultDir(DoFind(label), vault_dir);
+}
+
+void ProcessManager::StartProcess(Registry::iterator itr) {
   if (itr->status != ProcessStatus::kBeforeStarted) {
     LOG(kError) << "Process has already been started.";
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
   }
 
-  std::vector<std::string> args{ 1, kVaultExecutablePath_.string() };
-  args.emplace_back(std::to_string(kListeningPort_));
-  args.emplace_back("--log_folder " + (itr->info.vault_dir / "logs").string());
+  std::vector<std::string> args{ 1, itr->executable_path.string() };
+#ifndef MAIDSAFE_WIN32
+  // Both ends are created close-on-exec, so no vault spawned meanwhile by another thread inherits
+  // them; the child's end is then inherited only as kInheritedChannelDescriptor (see PosixSpawn).
+  std::array<int, 2> channel{ { -1, -1 } };
+  on_scope_exit close_channel{ [&channel] {
+    for (int native_socket : channel) {
+      if (native_socket != -1)
+        close(native_socket);
+    }
+  } };
+  TcpConnectionPtr channel_connection;
+  if (kAdoptChannel_) {
+#ifdef SOCK_CLOEXEC
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, channel.data()) != 0) {
+#else
+    // Without SOCK_CLOEXEC (e.g. on OS X) there's a window in which the ends are inheritable.
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, channel.data()) != 0 ||
+        fcntl(channel[0], F_SETFD, FD_CLOEXEC) != 0 ||
+        fcntl(channel[1], F_SETFD, FD_CLOEXEC) != 0) {
+#endif
+      LOG(kError) << "Failed to create vault channel: " << std::strerror(errno);
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unknown));
+    }
+    channel_connection = kAdoptChannel_(channel[0]);
+    channel[0] = -1;  // Now owned by 'channel_connection'.
+    args.emplace_back(kInheritedChannelArgPrefix + std::to_string(kInheritedChannelDescriptor));
+  } else {
+    args.emplace_back(kLocalSocketPath_.empty() ? std::to_string(kListeningPort_) :
+                                                  kLocalSocketPath_.string());
+  }
+  on_scope_exit close_channel_connection{ [channel_connection] {
+    if (channel_connection)
+      channel_connection->Close();
+  } };
+  const int child_socket{ channel[1] };
+#else
+  args.emplace_back(kLocalSocketPath_.empty() ? std::to_string(kListeningPort_) :
+                                                kLocalSocketPath_.string());
+#endif
+  args.emplace_back("--log_folder");
+  args.emplace_back((itr->info.vault_dir / "logs").string());
   args.insert(std::end(args), std::begin(itr->process_args), std::end(itr->process_args));
 
   NonEmptyString label{ itr->info.label };
-  itr->process = bp::execute(
-      bp::initializers::run_exe(kVaultExecutablePath_),
-      bp::initializers::set_cmd_line(process::ConstructCommandLine(args)),
-#ifndef MAIDSAFE_WIN32
-      bp::initializers::notify_io_service(io_service_),
+  {
+    ScopedPlacement placement{ itr->info.placement };
+#ifdef MAIDSAFE_WIN32
+    itr->process = ForkAndExec(io_service_, itr->executable_path, args);
+#else
+    // Unlike fork, posix_spawn doesn't stall this thread for longer the more memory we use.
+    itr->process = PosixSpawn(itr->executable_path, args, child_socket);
+#endif
+  }
+#ifdef MAIDSAFE_WIN32
+  vaults_.SetProcessId(itr, static_cast<ProcessId>(itr->process.proc_info.dwProcessId));
+#else
+  vaults_.SetProcessId(itr, static_cast<ProcessId>(itr->process.pid));
 #endif
-      bp::initializers::throw_on_error(),
-      bp::initializers::inherit_env());
+#ifdef MAIDSAFE_LINUX
+  if (kUsePidfds_)
+    WatchPidfd(itr);
+#endif
+  // The vault may briefly run unconstrained until it has been moved into its cgroup.
+  resource_controller_.SetLimits(itr->info.label, itr->info.resource_limits, itr->process_id);
 
   itr->status = ProcessStatus::kStarting;
+#ifndef MAIDSAFE_WIN32
+  if (channel_connection) {
+    // The vault can't fail to connect, but it can still hang before reporting in, so the startup
+    // timer applies as for any other vault.
+    close_channel_connection.Release();
+    vaults_.SetConnection(itr, channel_connection);
+  }
+#endif
 
 #ifdef MAIDSAFE_WIN32
   HANDLE copied_handle;
@@ -267,20 +707,17 @@ void ProcessManager::StartProcess(std::vector<Child>::iterator itr) {
                   &copied_handle, 0, FALSE, DUPLICATE_SAME_ACCESS);
   itr->handle.assign(copied_handle);
   HANDLE native_handle{ itr->handle.native_handle() };
-  itr->handle.async_wait([this, label, native_handle](const boost::system::error_code&) {
+  itr->handle.async_wait([this, label, native_handle](const boost::system::error_code& ec) {
+    if (ec == boost::asio::error::operation_aborted)
+      return;
     DWORD exit_code;
     GetExitCodeProcess(native_handle, &exit_code);
     OnProcessExit(label, BOOST_PROCESS_EXITSTATUS(exit_code));
   });
 #endif
 
-  itr->timer->expires_from_now(kRpcTimeout);
-  itr->timer->async_wait([this, label](const boost::system::error_code& error_code) {
-    if (error_code && error_code == boost::asio::error::operation_aborted) {
-      LOG(kVerbose) << "New process timer cancelled OK.";
-      return;
-    }
-    LOG(kWarning) << "Timed out waiting for new process to connect via TCP.";
+  ArmTimeout(*itr, kRpcTimeout, [this, label] {
+    LOG(kWarning) << "Timed out waiting for new process to report in.";
     OnProcessExit(label, -1, true);
   });
 }
@@ -289,35 +726,117 @@ void ProcessManager::InitSignalHandler() {
 #ifndef MAIDSAFE_WIN32
   LOG(kVerbose) << "Initialising signal handler.";
   signal_set_.async_wait([this](const boost::system::error_code& error_code, int signum) {
-    if (error_code && error_code == boost::asio::error::operation_aborted) {
-      LOG(kVerbose) << "Cancelled waiting for SIGCHLD signal.";
+    if (error_code) {
+      if (error_code == boost::asio::error::operation_aborted)
+        LOG(kVerbose) << "Cancelled waiting for SIGCHLD signal.";
+      else
+        LOG(kError) << "Error waiting for SIGCHLD signal: " << error_code.message();
       return;
     }
 
-    if (signum != SIGCHLD) {
+    if (signum != SIGCHLD)
       LOG(kWarning) << "Process ID " << process::GetProcessId() << " received signal " << signum;
-      return;
+    else
+      ReapExitedChildren();
+    InitSignalHandler();
+  });
+#endif
+}
+
+#ifndef MAIDSAFE_WIN32
+void ProcessManager::ReapExitedChildren() {
+  std::vector<std::pair<NonEmptyString, int>> exited_vaults;
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    for (;;) {
+      int status{ 0 };
+      pid_t pid{ waitpid(-1, &status, WNOHANG) };
+      if (pid == 0)  // No further children have exited.
+        break;
+      if (pid == -1) {
+        if (errno == EINTR)
+          continue;
+        if (errno != ECHILD)
+          LOG(kError) << "Failed waiting for child processes: " << std::strerror(errno);
+        break;
+      }
+      auto child_itr(vaults_.FindByProcessId(static_cast<ProcessId>(pid)));
+      if (child_itr == std::end(vaults_)) {
+        LOG(kVerbose) << "Reaped process ID " << pid << " which isn't a vault.";
+        continue;
+      }
+      LOG(kWarning) << "Vault " << child_itr->info.label.string() << " with process ID " << pid
+                    << " has exited.";
+      exited_vaults.emplace_back(child_itr->info.label, BOOST_PROCESS_EXITSTATUS(status));
     }
+  }
 
-    int exit_code;
-    ProcessId process_id{ static_cast<ProcessId>(wait(&exit_code)) };
-    LOG(kWarning) << "Process ID " << process::GetProcessId() << " received SIGCHLD pid: "
-                  << process_id;
-    if (process_id == process::GetProcessId())
-      return;
+  for (const auto& exited_vault : exited_vaults)
+    OnProcessExit(exited_vault.first, exited_vault.second);
+}
+#endif
 
-    auto child_itr(std::find_if(std::begin(vaults_), std::end(vaults_),
-        [this, process_id](const Child& vault) { return GetProcessId(vault) == process_id; }));
-    if (child_itr == std::end(vaults_))
-      return;
+#ifdef MAIDSAFE_LINUX
+void ProcessManager::WatchPidfd(Registry::iterator itr, int native_pidfd) {
+  if (native_pidfd == -1)
+    native_pidfd = PidfdOpen(static_cast<pid_t>(itr->process_id));
+  if (native_pidfd == -1) {
+    LOG(kError) << "Failed to open pidfd for vault: " << std::strerror(errno);
+    // Nothing else would reap it, so don't leave it running.
+    boost::system::error_code ignored_ec;
+    bp::terminate(itr->process, ignored_ec);
+    waitpid(static_cast<pid_t>(itr->process_id), nullptr, 0);
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unknown));
+  }
+  try {
+    itr->pidfd =
+        std::make_shared<boost::asio::posix::stream_descriptor>(io_service_, native_pidfd);
+  }
+  catch (const std::exception&) {
+    close(native_pidfd);
+    throw;
+  }
+  // The handler keeps the pidfd open, so the process is still reaped if it only exits after being
+  // removed from vaults_ (e.g. once terminated after a timeout).
+  NonEmptyString label{ itr->info.label };
+  std::shared_ptr<boost::asio::posix::stream_descriptor> pidfd{ itr->pidfd };
+  pidfd->async_read_some(boost::asio::null_buffers(),
+      [this, label, pidfd](const boost::system::error_code& error_code, size_t) {
+        if (error_code) {
+          if (error_code != boost::asio::error::operation_aborted)
+            LOG(kError) << "Error waiting on pidfd: " << error_code.message();
+          return;
+        }
+        OnPidfdReadable(label, pidfd);
+      });
+}
 
-    OnProcessExit(child_itr->info.label, BOOST_PROCESS_EXITSTATUS(exit_code));
-    InitSignalHandler();
-  });
-#endif
+void ProcessManager::OnPidfdReadable(
+    const NonEmptyString& label, std::shared_ptr<boost::asio::posix::stream_descriptor> pidfd) {
+  // The process has exited, so this doesn't block.
+  siginfo_t info;
+  int exit_code{ -1 };
+  if (waitid(static_cast<idtype_t>(P_PIDFD), pidfd->native_handle(), &info, WEXITED) == 0) {
+    if (info.si_code == CLD_EXITED)
+      exit_code = info.si_status;
+  } else if (errno == ECHILD) {
+    LOG(kVerbose) << "Vault " << label.string() << " was adopted, so its exit code is unknown.";
+  } else {
+    LOG(kError) << "Failed to reap vault " << label.string() << ": " << std::strerror(errno);
+  }
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    auto child_itr(vaults_.FindByLabel(label));
+    // The vault may already have been removed, and a restarted one may since have taken its label.
+    if (child_itr == std::end(vaults_) || child_itr->pidfd != pidfd)
+      return;
+  }
+  OnProcessExit(label, exit_code);
 }
+#endif
 
 void ProcessManager::StopProcess(TcpConnectionPtr connection, OnExitFunctor on_exit_functor) {
+  std::lock_guard<std::mutex> lock{ mutex_ };
   auto itr(std::begin(vaults_));
   try {
     itr = DoFind(connection);
@@ -330,39 +849,53 @@ void ProcessManager::StopProcess(TcpConnectionPtr connection, OnExitFunctor on_e
   itr->status = ProcessStatus::kStopping;
   SendVaultShutdownRequest(itr->info.tcp_connection);
   NonEmptyString label{ itr->info.label };
-  itr->timer->expires_from_now(kVaultStopTimeout);
-  itr->timer->async_wait([this, label](const boost::system::error_code& error_code) {
-    if (error_code && error_code == boost::asio::error::operation_aborted) {
-      LOG(kVerbose) << "Vault termination timer cancelled OK.";
-      return;
-    }
+  ArmTimeout(*itr, kVaultStopTimeout, [this, label] {
     LOG(kWarning) << "Timed out waiting for Vault to stop; terminating now.";
     OnProcessExit(label, -1, true);
   });
 }
 
+bool ProcessManager::RestartVault(const NonEmptyString& label,
+                                  const fs::path& vault_executable_path) {
+  ValidateVaultExecutable(vault_executable_path);
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  auto itr(DoFind(label));
+  itr->executable_path = vault_executable_path;
+  if (itr->status != ProcessStatus::kRunning)
+    return false;
+  itr->status = ProcessStatus::kRestarting;
+  SendVaultShutdownRequest(itr->info.tcp_connection);
+  ArmTimeout(*itr, kVaultStopTimeout, [this, label] {
+    LOG(kWarning) << "Timed out waiting for vault " << label.string() << " to stop for restart; "
+                  << "terminating now.";
+    OnProcessExit(label, -1, true);
+  });
+  return true;
+}
+
 bool ProcessManager::HandleConnectionClosed(TcpConnectionPtr connection) {
+  NonEmptyString label;
   try {
-    OnProcessExit(DoFind(connection)->info.label, -1, true);
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    label = DoFind(connection)->info.label;
   }
   catch (const maidsafe_error& error) {
     if (error.code() == make_error_code(CommonErrors::no_such_element))
       return false;
     throw;
   }
+  OnProcessExit(label, -1, true);
   return true;
 }
 
 VaultInfo ProcessManager::Find(const NonEmptyString& label) const {
+  std::lock_guard<std::mutex> lock{ mutex_ };
   return DoFind(label)->info;
 }
 
-std::vector<ProcessManager::Child>::const_iterator ProcessManager::DoFind(
+ProcessManager::Registry::const_iterator ProcessManager::DoFind(
     const NonEmptyString& label) const {
-  auto itr(std::find_if(std::begin(vaults_), std::end(vaults_),
-                        [this, &label](const Child& vault) {
-                          return vault.info.label == label;
-                        }));
+  auto itr(vaults_.FindByLabel(label));
   if (itr == std::end(vaults_)) {
     LOG(kError) << "Vault process with label " << label.string() << " doesn't exist.";
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
@@ -370,11 +903,8 @@ std::vector<ProcessManager::Child>::const_iterator ProcessManager::DoFind(
   return itr;
 }
 
-std::vector<ProcessManager::Child>::iterator ProcessManager::DoFind(const NonEmptyString& label) {
-  auto itr(std::find_if(std::begin(vaults_), std::end(vaults_),
-                        [this, &label](const Child& vault) {
-                          return vault.info.label == label;
-                        }));
+ProcessManager::Registry::iterator ProcessManager::DoFind(const NonEmptyString& label) {
+  auto itr(vaults_.FindByLabel(label));
   if (itr == std::end(vaults_)) {
     LOG(kError) << "Vault process with label " << label.string() << " doesn't exist.";
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
@@ -383,37 +913,48 @@ std::vector<ProcessManager::Child>::iterator ProcessManager::DoFind(const NonEmp
 }
 
 VaultInfo ProcessManager::Find(TcpConnectionPtr connection) const {
+  std::lock_guard<std::mutex> lock{ mutex_ };
   return DoFind(connection)->info;
 }
 
-std::vector<ProcessManager::Child>::const_iterator ProcessManager::DoFind(
+void ProcessManager::SetResourceLimits(const NonEmptyString& label,
+                                       const ResourceLimits& resource_limits) {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  auto itr(DoFind(label));
+  itr->info.resource_limits = resource_limits;
+  resource_controller_.SetLimits(label, resource_limits, itr->process_id);
+}
+
+ResourceUsage ProcessManager::GetResourceUsage(const NonEmptyString& label) const {
+  ProcessId process_id{ 0 };
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    process_id = DoFind(label)->process_id;
+  }
+  return resource_controller_.GetUsage(label, process_id);
+}
+
+ProcessManager::Registry::const_iterator ProcessManager::DoFind(
     TcpConnectionPtr connection) const {
-  auto itr(std::find_if(std::begin(vaults_), std::end(vaults_),
-                        [this, connection](const Child& vault) {
-                          return ConnectionsEqual(vault.info.tcp_connection, connection);
-                        }));
+  auto itr(vaults_.FindByConnection(connection));
   if (itr == std::end(vaults_))
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
   return itr;
 }
 
-std::vector<ProcessManager::Child>::iterator ProcessManager::DoFind(
-    TcpConnectionPtr connection) {
-  auto itr(std::find_if(std::begin(vaults_), std::end(vaults_),
-                        [this, connection](const Child& vault) {
-                          return ConnectionsEqual(vault.info.tcp_connection, connection);
-                        }));
+ProcessManager::Registry::iterator ProcessManager::DoFind(TcpConnectionPtr connection) {
+  auto itr(vaults_.FindByConnection(connection));
   if (itr == std::end(vaults_))
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
   return itr;
 }
 
-ProcessId ProcessManager::GetProcessId(const Child& vault) const {
-#ifdef MAIDSAFE_WIN32
-  return static_cast<ProcessId>(vault.process.proc_info.dwProcessId);
-#else
-  return static_cast<ProcessId>(vault.process.pid);
-#endif
+void ProcessManager::EraseVault(Registry::iterator itr) {
+  NonEmptyString label{ itr->info.label };
+  CancelTimeout(*itr);
+  vaults_.Erase(itr);
+  resource_controller_.RemoveVault(label);
+  vault_erased_.notify_all();
 }
 
 bool ProcessManager::IsRunning(const Child& vault) const {
@@ -431,45 +972,102 @@ bool ProcessManager::IsRunning(const Child& vault) const {
 }
 
 void ProcessManager::OnProcessExit(const NonEmptyString& label, int exit_code, bool terminate) {
-  auto child_itr(std::find_if(std::begin(vaults_), std::end(vaults_),
-                  [this, &label](const Child& vault) { return vault.info.label == label; }));
-  if (child_itr == std::end(vaults_))
-    return;
+  OnExitFunctor on_exit;
+  bool unexpected{ false };
+  std::vector<VaultInfo> quarantined;
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    auto child_itr(vaults_.FindByLabel(label));
+    if (child_itr == std::end(vaults_) || child_itr->status == ProcessStatus::kBackingOff ||
+        child_itr->status == ProcessStatus::kQuarantined) {
+      return;
+    }
 
-  VaultInfo vault_info;
-  int restart_count{ -1 };
-  if (child_itr->status != ProcessStatus::kStopping) {  // Unexpected exit - try to restart.
-    restart_count = child_itr->restart_count;
-    vault_info = child_itr->info;
-    if (vault_info.tcp_connection) {
-      vault_info.tcp_connection->Close();
-      vault_info.tcp_connection.reset();
+    bool is_running{ IsRunning(*child_itr) };
+    LOG(kVerbose) << "On exit for Vault " << label.string() << std::boolalpha << "  Is running: "
+        << is_running << "   Exit code: " << exit_code << "   Terminate requested: " << terminate;
+    if (terminate && is_running)
+      TerminateProcess(child_itr);
+
+    if (child_itr->info.tcp_connection)
+      child_itr->info.tcp_connection->Close();
+
+    if (child_itr->status == ProcessStatus::kStopping) {
+      on_exit = child_itr->on_exit;
+      EndRestart(child_itr, quarantined);
+      EraseVault(child_itr);
+    } else {  // Unexpected exit - keep the vault, but detach it from the exited process.
+      vaults_.SetConnection(child_itr, nullptr);
+      vaults_.SetProcessId(child_itr, 0);
+#ifdef MAIDSAFE_WIN32
+      boost::system::error_code ignored_ec;
+      child_itr->handle.close(ignored_ec);
+#elif defined MAIDSAFE_LINUX
+      child_itr->pidfd.reset();
+#endif
+      if (child_itr->status == ProcessStatus::kRestarting) {
+        RestartExitedProcess(child_itr, quarantined);
+      } else {
+        unexpected = true;
+        ScheduleRestart(child_itr, quarantined);
+        EndRestart(child_itr, quarantined);
+      }
     }
   }
 
-  bool is_running{ IsRunning(*child_itr) };
-  LOG(kVerbose) << "On exit for Vault " << label.string() << std::boolalpha << "  Is running: "
-      << is_running << "   Exit code: " << exit_code << "   Terminate requested: " << terminate;
-  if (terminate && is_running)
-    TerminateProcess(child_itr);
-
-  if (child_itr->info.tcp_connection)
-    child_itr->info.tcp_connection->Close();
-
-  OnExitFunctor on_exit{ child_itr->on_exit };
-  vaults_.erase(child_itr);
-
+  if (unexpected && kOnUnexpectedExit_) {
+    try {
+      kOnUnexpectedExit_(label);
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Error executing on_unexpected_exit functor: "
+                  << boost::diagnostic_information(e);
+    }
+  }
   InvokeOnExitFunctor(on_exit, exit_code, terminate);
-  RestartIfRequired(restart_count, std::move(vault_info));
+  NotifyQuarantined(quarantined);
 }
 
-void ProcessManager::TerminateProcess(std::vector<Child>::iterator itr) {
+void ProcessManager::TerminateProcess(Registry::iterator itr) {
+#ifdef MAIDSAFE_LINUX
+  if (itr->pidfd)
+    return SignalProcess(itr, SIGKILL);
+#endif
   boost::system::error_code ec;
   bp::terminate(itr->process, ec);
   if (ec)
     LOG(kWarning) << "Error while terminating vault: " << ec.message();
 }
 
+#ifndef MAIDSAFE_WIN32
+void ProcessManager::SignalProcess(Registry::iterator itr, int signal_number) {
+#ifdef MAIDSAFE_LINUX
+  // Unlike a process ID, the pidfd can't refer to some other process if the vault has been reaped.
+  if (itr->pidfd) {
+    if (syscall(SYS_pidfd_send_signal, itr->pidfd->native_handle(), signal_number, nullptr, 0) != 0)
+      LOG(kWarning) << "Error signalling vault: " << std::strerror(errno);
+    return;
+  }
+#endif
+  if (itr->process_id != 0 && kill(static_cast<pid_t>(itr->process_id), signal_number) != 0)
+    LOG(kWarning) << "Error signalling vault: " << std::strerror(errno);
+}
+#endif
+
+void ProcessManager::RestartExitedProcess(Registry::iterator itr,
+                                          std::vector<VaultInfo>& quarantined) {
+  // This is a deliberate restart, so it's neither delayed nor counted as a crash.
+  CancelTimeout(*itr);
+  itr->status = ProcessStatus::kBeforeStarted;
+  try {
+    StartProcess(itr);
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed restarting vault: " << boost::diagnostic_information(e);
+    ScheduleRestart(itr, quarantined);
+  }
+}
+
 void ProcessManager::InvokeOnExitFunctor(OnExitFunctor on_exit, int exit_code, bool terminate) {
   if (!on_exit)
     return;
@@ -490,19 +1088,151 @@ void ProcessManager::InvokeOnExitFunctor(OnExitFunctor on_exit, int exit_code, b
   }
 }
 
-void ProcessManager::RestartIfRequired(int restart_count, VaultInfo vault_info) {
-  if (restart_count < 0 || restart_count >= kMaxVaultRestarts)
+void ProcessManager::ScheduleRestart(Registry::iterator itr,
+                                     std::vector<VaultInfo>& quarantined) {
+  const auto kNow(std::chrono::steady_clock::now());
+  itr->crash_times.push_back(kNow);
+  while (kNow - itr->crash_times.front() > kRestartPolicy_.crash_window)
+    itr->crash_times.pop_front();
+
+  const NonEmptyString label{ itr->info.label };
+  if (static_cast<int>(itr->crash_times.size()) > kRestartPolicy_.max_crashes_in_window) {
+    LOG(kError) << "Vault " << label.string() << " has exited unexpectedly "
+                << itr->crash_times.size() << " times recently; quarantining it.";
+    CancelTimeout(*itr);
+    itr->status = ProcessStatus::kQuarantined;
+    quarantined.push_back(itr->info);
     return;
+  }
 
-  LOG(kWarning) << "Restarting vault " << vault_info.label.string();
-  io_service_.post([vault_info, restart_count, this] {
+  const std::chrono::milliseconds kBackoff{ RestartBackoff(itr->crash_times.size()) };
+  LOG(kWarning) << "Restarting vault " << label.string() << " in " << kBackoff.count() << " ms.";
+  itr->status = ProcessStatus::kBackingOff;
+  ArmTimeout(*itr, kBackoff, [this, label] { QueueRestart(label); });
+}
+
+void ProcessManager::StartPendingRestarts(std::vector<VaultInfo>& quarantined) {
+  while (restarts_in_progress_ < kRestartPolicy_.max_concurrent_restarts &&
+         !pending_restarts_.empty()) {
+    auto itr(vaults_.FindByLabel(NonEmptyString{ pending_restarts_.front() }));
+    pending_restarts_.pop_front();
+    if (itr == std::end(vaults_) || itr->status != ProcessStatus::kBackingOff)
+      continue;
+    itr->status = ProcessStatus::kBeforeStarted;
     try {
-      AddProcess(std::move(vault_info), restart_count + 1);
+      StartProcess(itr);
+      itr->restarting = true;
+      ++restarts_in_progress_;
     }
     catch (const std::exception& e) {
       LOG(kError) << "Failed restarting vault: " << boost::diagnostic_information(e);
+      ScheduleRestart(itr, quarantined);
     }
-  });
+  }
+}
+
+void ProcessManager::EndRestart(Registry::iterator itr, std::vector<VaultInfo>& quarantined) {
+  if (!itr->restarting)
+    return;
+  itr->restarting = false;
+  --restarts_in_progress_;
+  StartPendingRestarts(quarantined);
+}
+
+std::chrono::milliseconds ProcessManager::RestartBackoff(size_t crash_count) const {
+  std::chrono::milliseconds backoff{ kRestartPolicy_.initial_backoff };
+  for (size_t i(1); i < crash_count && backoff < kRestartPolicy_.max_backoff; ++i)
+    backoff *= 2;
+  backoff = std::min(backoff, kRestartPolicy_.max_backoff);
+  // Spread out the restarts of vaults which crashed together.
+  const auto kHalf(backoff.count() / 2);
+  return std::chrono::milliseconds{ backoff.count() - kHalf + RandomUint32() % (kHalf + 1) };
+}
+
+void ProcessManager::QueueRestart(const NonEmptyString& label) {
+  std::vector<VaultInfo> quarantined;
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    pending_restarts_.push_back(label.string());
+    StartPendingRestarts(quarantined);
+  }
+  NotifyQuarantined(quarantined);
+}
+
+void ProcessManager::ArmTimeout(Child& vault, std::chrono::steady_clock::duration timeout,
+                                TimerWheel::ExpiryFunctor on_expiry) {
+  CancelTimeout(vault);
+  vault.timeout = timer_wheel_.Arm(timeout, std::move(on_expiry));
+}
+
+void ProcessManager::CancelTimeout(Child& vault) {
+  if (vault.timeout == 0)
+    return;
+  timer_wheel_.Cancel(vault.timeout);
+  vault.timeout = 0;
+}
+
+void ProcessManager::ScheduleHealthProbes() {
+  probe_timeout_ = timer_wheel_.Arm(kHealthPolicy_.probe_interval, [this] { ProbeVaults(); });
+}
+
+void ProcessManager::ProbeVaults() {
+  std::vector<NonEmptyString> hung_vaults;
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    if (stopping_all_)
+      return;
+    const auto kNow(std::chrono::steady_clock::now());
+    for (auto& vault : vaults_) {
+      if (vault.status != ProcessStatus::kRunning || !vault.answers_health_probes ||
+          !vault.info.tcp_connection) {
+        continue;
+      }
+      if (vault.awaited_probe != 0 && RecordMissedProbe(vault)) {
+        hung_vaults.push_back(vault.info.label);
+        continue;
+      }
+      if (vault.health.consecutive_missed > kHealthPolicy_.max_missed_probes) {
+        // Already deemed hung when a slow answer arrived.
+        hung_vaults.push_back(vault.info.label);
+        continue;
+      }
+      vault.awaited_probe = next_probe_sequence_++;
+      vault.probe_sent_time = kNow;
+      ++vault.health.probes_sent;
+      SendHealthProbe(vault.info.tcp_connection, vault.awaited_probe);
+    }
+    ScheduleHealthProbes();
+  }
+
+  // As the vaults are still kRunning, these count as crashes and so are restarted after a backoff.
+  for (const auto& label : hung_vaults)
+    OnProcessExit(label, -1, true);
+}
+
+bool ProcessManager::RecordMissedProbe(Child& vault) {
+  vault.awaited_probe = 0;
+  ++vault.health.probes_missed;
+  if (++vault.health.consecutive_missed <= kHealthPolicy_.max_missed_probes)
+    return false;
+  ++vault.health.hangs;
+  LOG(kError) << "Vault " << vault.info.label.string() << " has missed "
+              << vault.health.consecutive_missed << " health probes in a row; killing it.";
+  return true;
+}
+
+void ProcessManager::NotifyQuarantined(const std::vector<VaultInfo>& quarantined) const {
+  if (!kOnQuarantined_)
+    return;
+  for (const auto& vault_info : quarantined) {
+    try {
+      kOnQuarantined_(vault_info);
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Error executing on_quarantined functor: "
+                  << boost::diagnostic_information(e);
+    }
+  }
 }
 
 }  // namespace vault_manager
@@ -19,6 +19,10 @@
 #ifndef MAIDSAFE_VAULT_MANAGER_PROCESS_MANAGER_H_
 #define MAIDSAFE_VAULT_MANAGER_PROCESS_MANAGER_H_
 
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <future>
 #include <memory>
@@ -32,6 +36,9 @@
 #else
 #include "boost/asio/signal_set.hpp"
 #endif
+#ifdef MAIDSAFE_LINUX
+#include "boost/asio/posix/stream_descriptor.hpp"
+#endif
 #include "boost/filesystem/path.hpp"
 #include "boost/process/child.hpp"
 
@@ -40,85 +47,300 @@
 #include "maidsafe/passport/types.h"
 
 #include "maidsafe/vault_manager/config.h"
+#include "maidsafe/vault_manager/placement.h"
+#include "maidsafe/vault_manager/resource_limits.h"
+#include "maidsafe/vault_manager/timer_wheel.h"
 #include "maidsafe/vault_manager/vault_info.h"
+#include "maidsafe/vault_manager/vault_registry.h"
 
 namespace maidsafe {
 
 namespace vault_manager {
 
-typedef uint64_t ProcessId;
+// A vault which exits unexpectedly is restarted after a backoff, or if it has crashed too often
+// recently, is quarantined (i.e. kept but not restarted).  A vault which is kRestarting is started
+// again as soon as it exits.
+enum class ProcessStatus {
+  kBeforeStarted, kStarting, kRunning, kStopping, kBackingOff, kQuarantined, kRestarting
+};
+
+// Governs restarting vaults which exit unexpectedly.  The defaults are from config.h.
+struct RestartPolicy {
+  RestartPolicy();
+  // The backoff before the first restart is doubled for each subsequent crash within the window,
+  // up to 'max_backoff', and then randomised to between half of and the full amount.
+  std::chrono::milliseconds initial_backoff, max_backoff;
+  std::chrono::steady_clock::duration crash_window;
+  // A vault which crashes more often than this within 'crash_window' is quarantined.
+  int max_crashes_in_window;
+  // Restarts due beyond this limit are queued until a restarting vault reports in or exits, so that
+  // a mass crash doesn't cause a mass respawn.
+  int max_concurrent_restarts;
+};
+
+// Governs probing running vaults to detect any which have hung.  The defaults are from config.h.
+struct HealthPolicy {
+  HealthPolicy();
+  // Probing is disabled if this is zero.  All vaults are probed together each interval, and a probe
+  // not yet answered by the next one is missed.
+  std::chrono::milliseconds probe_interval;
+  // A probe answered more slowly than this also counts as missed.
+  std::chrono::milliseconds max_round_trip;
+  // A vault which misses more probes than this in a row is killed, then restarted as for a crash.
+  int max_missed_probes;
+};
 
-enum class ProcessStatus { kBeforeStarted, kStarting, kRunning, kStopping };
+// Health probe statistics for a vault, kept across its restarts.
+struct VaultHealth {
+  VaultHealth()
+      : probes_sent(0), probes_answered(0), probes_missed(0), consecutive_missed(0), hangs(0),
+        last_round_trip(), max_round_trip(), smoothed_round_trip() {}
+  uint64_t probes_sent, probes_answered, probes_missed;
+  int consecutive_missed;
+  // How many times the vault has been killed for missing too many probes.
+  int hangs;
+  // 'smoothed_round_trip' is weighted towards recent probes, as for TCP's SRTT.
+  std::chrono::steady_clock::duration last_round_trip, max_round_trip, smoothed_round_trip;
+};
+
+// The outcome of ProcessManager::StopAll.
+struct StopAllReport {
+  StopAllReport() : vault_count(0), stopped(0), terminated(0), killed(0), drain_time() {}
+  // Of the vaults running or starting, how many exited when asked, after SIGTERM (never on Windows)
+  // and only once killed.
+  size_t vault_count, stopped, terminated, killed;
+  std::chrono::steady_clock::duration drain_time;
+};
+
+// A vault released by one ProcessManager for adopting by another (see ReleaseAll).  'pidfd' is -1
+// (and 'process_id' 0) if the vault wasn't running, in which case it's simply added afresh.
+struct HandedOffVault {
+  HandedOffVault()
+      : info(), process_id(0), pidfd(-1), executable_path(), stopping(false), restarting(false) {}
+  VaultInfo info;
+  ProcessId process_id;
+  int pidfd;
+  boost::filesystem::path executable_path;
+  // Whether the vault had been asked to stop, or to stop in order to be restarted.
+  bool stopping, restarting;
+};
 
-// All functions provide the strong exception guarantee.
+// All functions provide the strong exception guarantee.  All public functions are thread-safe; the
+// lock is never held while invoking an on_exit functor, so these may safely call back into this.
 class ProcessManager {
  public:
   typedef std::function<void(maidsafe_error, int)> OnExitFunctor;
-  static std::shared_ptr<ProcessManager> MakeShared(boost::asio::io_service& io_service,
-                                                    boost::filesystem::path vault_executable_path,
-                                                    Port listening_port);
+  // Given the manager's end of a socketpair whose other end is inherited by a new vault, returns a
+  // started connection.
+  typedef std::function<TcpConnectionPtr(int native_socket)> AdoptChannelFunctor;
+  typedef std::function<void(const VaultInfo&)> OnQuarantinedFunctor;
+  typedef std::function<void(const NonEmptyString& label)> OnUnexpectedExitFunctor;
+  // If 'local_socket_path' is non-empty, vaults are told to connect to it rather than to
+  // 'listening_port'.  If 'adopt_channel' is set (ignored on Windows), vaults don't connect back at
+  // all; instead each inherits one end of a socketpair which is bound to its Child from the start.
+  // 'on_quarantined' is invoked (without the lock held) for each vault which gets quarantined, and
+  // 'on_unexpected_exit' for each vault which exits without having been asked to, before it's
+  // restarted.
+  // Vaults added without a placement are given one according to 'placement_policy'.
+  static std::shared_ptr<ProcessManager> MakeShared(
+      boost::asio::io_service& io_service, boost::filesystem::path vault_executable_path,
+      Port listening_port, boost::filesystem::path local_socket_path = boost::filesystem::path{},
+      AdoptChannelFunctor adopt_channel = nullptr, OnQuarantinedFunctor on_quarantined = nullptr,
+      OnUnexpectedExitFunctor on_unexpected_exit = nullptr,
+      RestartPolicy restart_policy = RestartPolicy{},
+      PlacementPolicy placement_policy = PlacementPolicy{},
+      HealthPolicy health_policy = HealthPolicy{});
   ~ProcessManager();
-  void StopAll();
+  // Asks all vaults to stop and blocks until they've exited.  Those still running after 'deadline'
+  // are sent SIGTERM together, and any still running 'terminate_timeout' later are killed.  Vaults
+  // which are backing off or quarantined are just dropped.  Subsequent calls, and AddProcess once
+  // this has been called, are no-ops and throw respectively.  Mustn't be called on a thread running
+  // 'io_service', as exits are handled there.
+  StopAllReport StopAll(
+      std::chrono::steady_clock::duration deadline = kVaultStopTimeout,
+      std::chrono::steady_clock::duration terminate_timeout = kVaultTerminateTimeout);
+  // True if vaults can be handed over to another ProcessManager, i.e. only on Linux with pidfds.
+  bool CanHandOff() const;
+  // Removes all vaults without stopping them or their resource limits, and as for StopAll, throws
+  // from AddProcess from then on.  Each running vault is returned with a duplicate of its pidfd,
+  // owned by the caller.  Each 'info.tcp_connection' is left open for the caller to close once the
+  // vaults have been handed over, prompting them to reconnect.  Throws if !CanHandOff().
+  std::vector<HandedOffVault> ReleaseAll();
+  // Takes over a running vault released by another ProcessManager, taking ownership of its pidfd.
+  // The vault is treated as starting until it reconnects via HandleVaultStarted, and is terminated
+  // if it doesn't within kVaultReconnectTimeout.  As the vault isn't our child, its exit code can't
+  // be retrieved.  Throws if !CanHandOff(), having closed the pidfd.
+  void AdoptProcess(HandedOffVault vault);
+  // Undoes ReleaseAll when its vaults couldn't be handed over after all: AddProcess works again,
+  // and each of 'vaults' is adopted as for AdoptProcess if running, or otherwise restored as for
+  // RestoreProcess.  A vault which can't be reclaimed is logged and dropped.
+  void ReclaimAll(std::vector<HandedOffVault> vaults);
+  // Includes vaults which are backing off or quarantined.
   std::vector<VaultInfo> GetAll() const;
-  void AddProcess(VaultInfo info, int restart_count = 0);
-  VaultInfo HandleVaultStarted(TcpConnectionPtr connection, ProcessId process_id);
+  // Vaults added from now on are started from 'vault_executable_path'.  Throws if it isn't a
+  // regular file.
+  void SetVaultExecutablePath(const boost::filesystem::path& vault_executable_path);
+  boost::filesystem::path VaultExecutablePath() const;
+  void AddProcess(VaultInfo info);
+  // As AddProcess, but used for vaults restored from the config file: a vault which fails to start
+  // is kept (and so stays in the config file), and is retried as if it had crashed.  Returns false
+  // in that case.  Only throws if 'info' is invalid or all vaults are being stopped.
+  bool RestoreProcess(VaultInfo info);
+  // The vault will be started from 'vault_executable_path' from now on.  If it's running, it's
+  // asked to stop and is restarted as soon as it exits (being terminated if it doesn't within
+  // kVaultStopTimeout), and true is returned.  Throws if 'vault_executable_path' isn't a regular
+  // file or the vault doesn't exist.
+  bool RestartVault(const NonEmptyString& label,
+                    const boost::filesystem::path& vault_executable_path);
+  // The vault is identified by its connection if that is an inherited channel, otherwise by
+  // 'process_id'.  It's only probed while running if it 'answers_health_probes'.
+  VaultInfo HandleVaultStarted(TcpConnectionPtr connection, ProcessId process_id,
+                               bool answers_health_probes);
+  // Responses to probes other than the vault's latest are ignored.
+  void HandleHealthProbeResponse(TcpConnectionPtr connection, uint64_t sequence);
+  VaultHealth GetHealth(const NonEmptyString& label) const;
   void AssignOwner(const NonEmptyString& label, const passport::PublicMaid::Name& owner_name,
                    DiskUsage max_disk_usage);
+  // Records that the vault has moved its chunkstore.  Throws if another vault uses 'vault_dir'.
+  void SetVaultDir(const NonEmptyString& label, const boost::filesystem::path& vault_dir);
   void StopProcess(TcpConnectionPtr connection, OnExitFunctor on_exit_functor = nullptr);
   // Returns false if the process doesn't exist.
   bool HandleConnectionClosed(TcpConnectionPtr connection);
   VaultInfo Find(const NonEmptyString& label) const;
   VaultInfo Find(TcpConnectionPtr connection) const;
+  // Takes effect immediately if the vault is running.
+  void SetResourceLimits(const NonEmptyString& label, const ResourceLimits& resource_limits);
+  ResourceUsage GetResourceUsage(const NonEmptyString& label) const;
 
  private:
   ProcessManager(boost::asio::io_service &io_service, boost::filesystem::path vault_executable_path,
-                 Port listening_port);
+                 Port listening_port, boost::filesystem::path local_socket_path,
+                 AdoptChannelFunctor adopt_channel, OnQuarantinedFunctor on_quarantined,
+                 OnUnexpectedExitFunctor on_unexpected_exit, RestartPolicy restart_policy,
+                 PlacementPolicy placement_policy, HealthPolicy health_policy);
 
   ProcessManager(const ProcessManager&) = delete;
   ProcessManager(ProcessManager&&) = delete;
   ProcessManager& operator=(ProcessManager) = delete;
 
   struct Child {
-    Child(VaultInfo info, boost::asio::io_service &io_service, int restarts);
+    Child(VaultInfo info, boost::asio::io_service &io_service);
     Child(Child&& other);
     Child& operator=(Child other);
     VaultInfo info;
+    ProcessId process_id;
     OnExitFunctor on_exit;
-    std::unique_ptr<Timer> timer;
-    int restart_count;
+    // The vault's current startup, stop or backoff timeout, or 0 if it has none.
+    TimerWheel::TimeoutId timeout;
+    // Times of unexpected exits within the crash window, oldest first.
+    std::deque<std::chrono::steady_clock::time_point> crash_times;
+    // True from being restarted until reporting in or exiting.
+    bool restarting;
+    boost::filesystem::path executable_path;
     std::vector<std::string> process_args;
     ProcessStatus status;
+    VaultHealth health;
+    bool answers_health_probes;
+    // The sequence number of the probe awaiting an answer, or 0 if none is.
+    uint64_t awaited_probe;
+    std::chrono::steady_clock::time_point probe_sent_time;
 #ifdef MAIDSAFE_WIN32
     boost::asio::windows::object_handle handle;
+#endif
+#ifdef MAIDSAFE_LINUX
+    // Becomes readable once the process exits.  Null if exits are detected via SIGCHLD instead.
+    std::shared_ptr<boost::asio::posix::stream_descriptor> pidfd;
 #endif
     boost::process::child process;
    private:
     Child(const Child&) = delete;
   };
   friend void swap(Child& lhs, Child& rhs);
+  typedef VaultRegistry<Child> Registry;
 
-  void StartProcess(std::vector<Child>::iterator itr);
+  // Must be called with the lock held.  Adds the vault, placing it if need be.
+  Registry::iterator DoAddProcess(VaultInfo info);
+  void StartProcess(Registry::iterator itr);
   void InitSignalHandler();
+#ifndef MAIDSAFE_WIN32
+  // SIGCHLDs coalesce, so each one may stand for several exited children.  This reaps all of them.
+  void ReapExitedChildren();
+#endif
+#ifdef MAIDSAFE_LINUX
+  // Each vault's exit is notified via its own pidfd rather than SIGCHLD.  As the pidfd stays open
+  // until the process has been reaped, its process ID can't be reused in the meantime.  The pidfd
+  // is opened here unless 'native_pidfd' (of which ownership is taken) is given.
+  void WatchPidfd(Registry::iterator itr, int native_pidfd = -1);
+  void OnPidfdReadable(const NonEmptyString& label,
+                       std::shared_ptr<boost::asio::posix::stream_descriptor> pidfd);
+#endif
 
-  std::vector<Child>::const_iterator DoFind(const NonEmptyString& label) const;
-  std::vector<Child>::iterator DoFind(const NonEmptyString& label);
-  std::vector<Child>::const_iterator DoFind(TcpConnectionPtr connection) const;
-  std::vector<Child>::iterator DoFind(TcpConnectionPtr connection);
-  ProcessId GetProcessId(const Child& vault) const;
+  // These throw if there's no such vault.
+  Registry::const_iterator DoFind(const NonEmptyString& label) const;
+  Registry::iterator DoFind(const NonEmptyString& label);
+  Registry::const_iterator DoFind(TcpConnectionPtr connection) const;
+  Registry::iterator DoFind(TcpConnectionPtr connection);
   bool IsRunning(const Child& vault) const;
+  void EraseVault(Registry::iterator itr);
   void OnProcessExit(const NonEmptyString& label, int exit_code, bool terminate = false);
-  void TerminateProcess(std::vector<Child>::iterator itr);
+  void TerminateProcess(Registry::iterator itr);
+  // Must be called with the lock held.  Restarts a vault which has exited while kRestarting.
+  void RestartExitedProcess(Registry::iterator itr, std::vector<VaultInfo>& quarantined);
+#ifndef MAIDSAFE_WIN32
+  void SignalProcess(Registry::iterator itr, int signal_number);
+#endif
   void InvokeOnExitFunctor(OnExitFunctor on_exit, int exit_code, bool terminate);
-  void RestartIfRequired(int restart_count, VaultInfo vault_info);
+  // These must be called with the lock held.  Each appends any newly quarantined vaults to
+  // 'quarantined' so that the caller can notify them once it has released the lock.
+  void ScheduleRestart(Registry::iterator itr, std::vector<VaultInfo>& quarantined);
+  void StartPendingRestarts(std::vector<VaultInfo>& quarantined);
+  void EndRestart(Registry::iterator itr, std::vector<VaultInfo>& quarantined);
+  std::chrono::milliseconds RestartBackoff(size_t crash_count) const;
+
+  void QueueRestart(const NonEmptyString& label);
+  void NotifyQuarantined(const std::vector<VaultInfo>& quarantined) const;
+
+  // These must be called with the lock held.  A vault has at most one timeout at a time, so arming
+  // one replaces any it already has.
+  void ArmTimeout(Child& vault, std::chrono::steady_clock::duration timeout,
+                  TimerWheel::ExpiryFunctor on_expiry);
+  void CancelTimeout(Child& vault);
+
+  // A single timeout drives the probes of all vaults.
+  void ScheduleHealthProbes();
+  void ProbeVaults();
+  // Must be called with the lock held.  Returns true if the vault is now deemed hung.
+  bool RecordMissedProbe(Child& vault);
 
   boost::asio::io_service &io_service_;
 #ifndef MAIDSAFE_WIN32
   boost::asio::signal_set signal_set_;
+#endif
+#ifdef MAIDSAFE_LINUX
+  const bool kUsePidfds_;
 #endif
   std::once_flag stop_all_flag_;
+  mutable std::mutex mutex_;
+  // Notified whenever a vault is removed from vaults_.
+  std::condition_variable vault_erased_;
+  bool stopping_all_;
   const Port kListeningPort_;
-  const boost::filesystem::path kVaultExecutablePath_;
-  std::vector<Child> vaults_;
+  const boost::filesystem::path kLocalSocketPath_;
+  const AdoptChannelFunctor kAdoptChannel_;
+  const OnQuarantinedFunctor kOnQuarantined_;
+  const OnUnexpectedExitFunctor kOnUnexpectedExit_;
+  const RestartPolicy kRestartPolicy_;
+  const PlacementEngine kPlacementEngine_;
+  const HealthPolicy kHealthPolicy_;
+  TimerWheel& timer_wheel_;
+  TimerWheel::TimeoutId probe_timeout_;
+  uint64_t next_probe_sequence_;
+  boost::filesystem::path vault_executable_path_;
+  const ResourceController resource_controller_;
+  Registry vaults_;
+  // Labels of vaults whose backoff has expired, waiting for a free restart slot.
+  std::deque<std::string> pending_restarts_;
+  int restarts_in_progress_;
 };
 
 }  // namespace vault_manager
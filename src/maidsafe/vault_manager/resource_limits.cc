@@ -0,0 +1,309 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/resource_limits.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef MAIDSAFE_WIN32
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace {
+
+#ifdef MAIDSAFE_LINUX
+const fs::path kCgroupMountPoint("/sys/fs/cgroup");
+const std::vector<std::string> kControllers{ "cpu", "memory", "io" };
+
+std::string ReadControlFile(const fs::path& path) {
+  std::ifstream stream{ path.string() };
+  return std::string{ std::istreambuf_iterator<char>{ stream }, std::istreambuf_iterator<char>{} };
+}
+
+// Unlike an ofstream, reports the kernel's reason for rejecting the write.
+bool WriteControlFile(const fs::path& path, const std::string& value) {
+  int descriptor{ open(path.c_str(), O_WRONLY | O_CLOEXEC) };
+  if (descriptor == -1) {
+    LOG(kWarning) << "Failed to open " << path << ": " << std::strerror(errno);
+    return false;
+  }
+  bool written{ write(descriptor, value.data(), value.size()) ==
+                static_cast<ssize_t>(value.size()) };
+  if (!written) {
+    LOG(kWarning) << "Failed to write \"" << value << "\" to " << path << ": "
+                  << std::strerror(errno);
+  }
+  close(descriptor);
+  return written;
+}
+
+// Returns the value following 'key' in a file of "key value" lines, or 0 if 'key' isn't present.
+uint64_t ReadKeyedValue(const std::string& contents, const std::string& key) {
+  std::istringstream stream{ contents };
+  std::string name;
+  uint64_t value{ 0 };
+  while (stream >> name >> value) {
+    if (name == key)
+      return value;
+  }
+  return 0;
+}
+
+// Enables as many of kControllers as are available in 'cgroup' for its children, returning false if
+// none could be.
+bool EnableControllers(const fs::path& cgroup) {
+  std::istringstream available{ ReadControlFile(cgroup / "cgroup.controllers") };
+  std::vector<std::string> controllers{ std::istream_iterator<std::string>{ available },
+                                        std::istream_iterator<std::string>{} };
+  bool enabled{ false };
+  for (const auto& controller : kControllers) {
+    if (std::find(std::begin(controllers), std::end(controllers), controller) !=
+        std::end(controllers)) {
+      enabled = WriteControlFile(cgroup / "cgroup.subtree_control", "+" + controller) || enabled;
+    }
+  }
+  return enabled;
+}
+
+// Returns the cgroup under which vaults' cgroups are to be created, or an empty path if there's no
+// delegated cgroup v2 subtree.
+fs::path SetUpVaultsCgroup() {
+  std::ifstream proc_cgroup{ "/proc/self/cgroup" };
+  std::string line, own_path;
+  while (std::getline(proc_cgroup, line)) {
+    if (line.compare(0, 3, "0::") == 0)
+      own_path = line.substr(3);
+  }
+  if (own_path.empty() || !fs::exists(kCgroupMountPoint / "cgroup.controllers")) {
+    LOG(kInfo) << "cgroup v2 isn't available.";
+    return fs::path{};
+  }
+
+  const fs::path kOwnCgroup{ kCgroupMountPoint / own_path };
+  boost::system::error_code error_code;
+  if (own_path != "/") {
+    // The root cgroup is exempt from the "no internal processes" rule.
+    const fs::path kLeaf{ kOwnCgroup / "vault_manager" };
+    fs::create_directory(kLeaf, error_code);
+    if (error_code || !WriteControlFile(kLeaf / "cgroup.procs", std::to_string(getpid()))) {
+      LOG(kInfo) << "cgroup " << kOwnCgroup << " hasn't been delegated to this process.";
+      return fs::path{};
+    }
+  }
+  const fs::path kVaultsCgroup{ kOwnCgroup / "vaults" };
+  fs::create_directory(kVaultsCgroup, error_code);
+  if (error_code || !EnableControllers(kOwnCgroup) || !EnableControllers(kVaultsCgroup)) {
+    LOG(kInfo) << "Failed to enable cgroup controllers for vaults under " << kOwnCgroup;
+    return fs::path{};
+  }
+
+  // Tidy up cgroups of vaults which were running when this process last exited.
+  for (fs::directory_iterator itr{ kVaultsCgroup, error_code }; !error_code &&
+       itr != fs::directory_iterator{}; itr.increment(error_code)) {
+    if (fs::is_directory(itr->status())) {
+      boost::system::error_code ignored_ec;
+      fs::remove(itr->path(), ignored_ec);
+    }
+  }
+  LOG(kInfo) << "Applying vaults' resource limits via cgroups under " << kVaultsCgroup;
+  return kVaultsCgroup;
+}
+
+// glibc declares the resources as an enum rather than as ints.
+typedef decltype(RLIMIT_NOFILE) RlimitResource;
+
+void SetRlimit(RlimitResource resource, uint64_t limit, uint64_t process_id) {
+  rlimit value;
+  value.rlim_cur = value.rlim_max = static_cast<rlim_t>(limit);
+  if (prlimit(static_cast<pid_t>(process_id), resource, &value, nullptr) != 0) {
+    LOG(kWarning) << "Failed to set rlimit " << resource << " to " << limit << " for process "
+                  << process_id << ": " << std::strerror(errno);
+  }
+}
+#endif
+
+#ifndef MAIDSAFE_WIN32
+// Each nice level is a factor of roughly 1.25 in CPU share, with the default weight of 100 matching
+// a nice value of 0.
+void SetNiceValue(uint64_t cpu_weight, uint64_t process_id) {
+  double nice_value{ -std::log(static_cast<double>(cpu_weight) / 100.0) / std::log(1.25) };
+  int clamped{ static_cast<int>(std::max(-20.0, std::min(19.0, std::round(nice_value)))) };
+  if (setpriority(PRIO_PROCESS, static_cast<id_t>(process_id), clamped) != 0) {
+    LOG(kWarning) << "Failed to set nice value " << clamped << " for process " << process_id << ": "
+                  << std::strerror(errno);
+  }
+}
+#endif
+
+}  // unnamed namespace
+
+ResourceController::ResourceController(bool use_cgroups)
+#ifdef MAIDSAFE_LINUX
+    : kVaultsCgroup_(use_cgroups ? SetUpVaultsCgroup() : fs::path{}) {}
+#else
+    : kVaultsCgroup_() {
+  static_cast<void>(use_cgroups);
+}
+#endif
+
+fs::path ResourceController::VaultCgroup(const NonEmptyString& label) const {
+  // Labels are chosen by clients, so only use them verbatim if they're safe as a directory name.
+  const std::string& kLabel(label.string());
+  bool safe{ std::all_of(std::begin(kLabel), std::end(kLabel), [](char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '-';
+  }) };
+  return kVaultsCgroup_ / ("vault-" + (safe ? kLabel : HexEncode(kLabel)));
+}
+
+void ResourceController::SetLimits(const NonEmptyString& label, const ResourceLimits& limits,
+                                   uint64_t process_id) const {
+#ifdef MAIDSAFE_WIN32
+  static_cast<void>(label);
+  static_cast<void>(limits);
+  static_cast<void>(process_id);
+  LOG(kWarning) << "Vault resource limits aren't supported on Windows.";
+#else
+  bool in_cgroup{ false };
+#ifdef MAIDSAFE_LINUX
+  if (UsesCgroups()) {
+    const fs::path kCgroup{ VaultCgroup(label) };
+    boost::system::error_code error_code;
+    fs::create_directory(kCgroup, error_code);
+    if (error_code) {
+      LOG(kError) << "Failed to create cgroup " << kCgroup << ": " << error_code.message();
+    } else {
+      WriteControlFile(kCgroup / "cpu.weight",
+                       std::to_string(limits.cpu_weight == 0 ? 100 : limits.cpu_weight));
+      WriteControlFile(kCgroup / "memory.max",
+                       limits.memory_max == 0 ? "max" : std::to_string(limits.memory_max));
+      WriteControlFile(kCgroup / "io.weight",
+                       "default " + std::to_string(limits.io_weight == 0 ? 100 : limits.io_weight));
+      in_cgroup = process_id == 0 ||
+                  WriteControlFile(kCgroup / "cgroup.procs", std::to_string(process_id));
+    }
+  }
+#else
+  static_cast<void>(label);
+#endif
+  if (process_id == 0)
+    return;
+
+#ifdef MAIDSAFE_LINUX
+  if (limits.max_open_files != 0)
+    SetRlimit(RLIMIT_NOFILE, limits.max_open_files, process_id);
+  if (!in_cgroup && limits.memory_max != 0)
+    SetRlimit(RLIMIT_AS, limits.memory_max, process_id);
+#else
+  if (limits.max_open_files != 0 || limits.memory_max != 0)
+    LOG(kWarning) << "Vault memory and open file limits aren't supported on this platform.";
+#endif
+  if (!in_cgroup) {
+    if (limits.cpu_weight != 0)
+      SetNiceValue(limits.cpu_weight, process_id);
+    if (limits.io_weight != 0)
+      LOG(kWarning) << "Vault IO weights are only applied via cgroups.";
+  }
+#endif
+}
+
+void ResourceController::RemoveVault(const NonEmptyString& label) const {
+  if (!UsesCgroups())
+    return;
+  boost::system::error_code error_code;
+  fs::remove(VaultCgroup(label), error_code);
+  if (error_code)
+    LOG(kVerbose) << "Failed to remove cgroup of vault " << label.string() << ": "
+                  << error_code.message();
+}
+
+ResourceUsage ResourceController::GetUsage(const NonEmptyString& label,
+                                           uint64_t process_id) const {
+  ResourceUsage usage;
+#ifdef MAIDSAFE_LINUX
+  if (UsesCgroups()) {
+    const fs::path kCgroup{ VaultCgroup(label) };
+    usage.cpu_time_usec = ReadKeyedValue(ReadControlFile(kCgroup / "cpu.stat"), "usage_usec");
+    std::istringstream{ ReadControlFile(kCgroup / "memory.current") } >> usage.memory_bytes;
+    // Each line is "<major>:<minor> rbytes=<n> wbytes=<n> ..." for one device.
+    std::istringstream io_stat{ ReadControlFile(kCgroup / "io.stat") };
+    std::string field;
+    while (io_stat >> field) {
+      if (field.compare(0, 7, "rbytes=") == 0)
+        usage.io_read_bytes += std::stoull(field.substr(7));
+      else if (field.compare(0, 7, "wbytes=") == 0)
+        usage.io_write_bytes += std::stoull(field.substr(7));
+    }
+    return usage;
+  }
+  if (process_id == 0)
+    return usage;
+
+  const fs::path kProcDir{ fs::path{ "/proc" } / std::to_string(process_id) };
+  // The command name field may contain spaces, so skip to its closing parenthesis; user and system
+  // times are then the 12th and 13th fields.
+  std::string stat{ ReadControlFile(kProcDir / "stat") };
+  std::istringstream stat_fields{ stat.substr(std::min(stat.rfind(')') + 1, stat.size())) };
+  std::vector<std::string> fields{ std::istream_iterator<std::string>{ stat_fields },
+                                   std::istream_iterator<std::string>{} };
+  if (fields.size() > 12) {
+    const uint64_t kTicksPerSecond(sysconf(_SC_CLK_TCK));
+    usage.cpu_time_usec = (std::stoull(fields[11]) + std::stoull(fields[12])) * 1000000 /
+                          kTicksPerSecond;
+  }
+  uint64_t size_pages{ 0 }, resident_pages{ 0 };
+  std::istringstream{ ReadControlFile(kProcDir / "statm") } >> size_pages >> resident_pages;
+  usage.memory_bytes = resident_pages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  std::string io{ ReadControlFile(kProcDir / "io") };
+  std::replace(std::begin(io), std::end(io), ':', ' ');
+  usage.io_read_bytes = ReadKeyedValue(io, "read_bytes");
+  usage.io_write_bytes = ReadKeyedValue(io, "write_bytes");
+#else
+  static_cast<void>(label);
+  static_cast<void>(process_id);
+  LOG(kWarning) << "Vault resource usage isn't available on this platform.";
+  BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unknown));
+#endif
+  return usage;
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,86 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_RESOURCE_LIMITS_H_
+#define MAIDSAFE_VAULT_MANAGER_RESOURCE_LIMITS_H_
+
+#include <cstdint>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/types.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// Limits applied to a vault process.  A value of 0 means "not limited" (or the default weight).
+struct ResourceLimits {
+  ResourceLimits() : cpu_weight(0), memory_max(0), io_weight(0), max_open_files(0) {}
+
+  // Relative share of CPU and IO bandwidth, as for cgroup v2 'cpu.weight' and 'io.weight', i.e.
+  // from 1 to 10000 with 100 being the default.
+  uint64_t cpu_weight;
+  uint64_t memory_max;  // bytes
+  uint64_t io_weight;
+  uint64_t max_open_files;
+};
+
+struct ResourceUsage {
+  ResourceUsage() : cpu_time_usec(0), memory_bytes(0), io_read_bytes(0), io_write_bytes(0) {}
+
+  uint64_t cpu_time_usec;
+  uint64_t memory_bytes;
+  uint64_t io_read_bytes;
+  uint64_t io_write_bytes;
+};
+
+// Applies ResourceLimits to vault processes.  On Linux, if this process' cgroup v2 subtree has been
+// delegated to it, each vault gets its own cgroup in that subtree (and this process moves into a
+// leaf of it, since a cgroup with processes can't distribute its resources to child cgroups).
+// Otherwise, the limits are approximated with rlimits and nice values; IO weights then aren't
+// applied.  The open files limit is always applied as an rlimit.
+//
+// Failures to apply limits are logged rather than thrown, since running a vault with only some of
+// its limits is better than not running it at all.  All functions are thread-safe.
+class ResourceController {
+ public:
+  explicit ResourceController(bool use_cgroups = true);
+
+  bool UsesCgroups() const { return !kVaultsCgroup_.empty(); }
+  // Applies 'limits' to the vault's cgroup (creating it if required), and if 'process_id' isn't 0,
+  // moves that process into the cgroup and sets its rlimits.
+  void SetLimits(const NonEmptyString& label, const ResourceLimits& limits,
+                 uint64_t process_id) const;
+  // Removes the vault's cgroup, which must no longer contain any processes.
+  void RemoveVault(const NonEmptyString& label) const;
+  // Reads the vault's usage from its cgroup, or without cgroups, that of its process (i.e. zero if
+  // 'process_id' is 0).  Throws if usage can't be read on this platform.
+  ResourceUsage GetUsage(const NonEmptyString& label, uint64_t process_id) const;
+
+ private:
+  boost::filesystem::path VaultCgroup(const NonEmptyString& label) const;
+
+  const boost::filesystem::path kVaultsCgroup_;
+};
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_RESOURCE_LIMITS_H_
@@ -0,0 +1,134 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/ring_drainer.h"
+
+#include <utility>
+#include <vector>
+
+#include "boost/asio/error.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/process.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/vault_manager/shared_memory_ring.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+RingDrainer::RingDrainer(boost::asio::io_service& io_service, RecordFunctor on_record)
+    : kOnRecord_(on_record),
+      timer_(io_service),
+      mutex_(),
+      timer_armed_(false),
+      closed_(false),
+      rings_(),
+      drain_mutex_() {}
+
+std::shared_ptr<RingDrainer> RingDrainer::MakeShared(boost::asio::io_service& io_service,
+                                                     RecordFunctor on_record) {
+  return std::shared_ptr<RingDrainer>{ new RingDrainer{ io_service, on_record } };
+}
+
+std::string RingDrainer::Add(TcpConnectionPtr connection) {
+  std::string name{ "maidsafe_vault_manager_" + std::to_string(process::GetProcessId()) + "_" +
+                    RandomAlphaNumericString(16) };
+  std::shared_ptr<SharedMemoryRing> ring{ SharedMemoryRing::Create(name, kRingCapacity) };
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  if (closed_) {
+    LOG(kWarning) << "Can't add shared memory ring after closing.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unknown));
+  }
+  if (!rings_.emplace(connection, ring).second) {
+    LOG(kError) << "Connection already has a shared memory ring.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+  }
+  ScheduleDrain();
+  return name;
+}
+
+bool RingDrainer::Remove(TcpConnectionPtr connection) {
+  std::shared_ptr<SharedMemoryRing> ring;
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    auto itr(rings_.find(connection));
+    if (itr == std::end(rings_))
+      return false;
+    ring = itr->second;
+    rings_.erase(itr);
+  }
+  std::lock_guard<std::mutex> lock{ drain_mutex_ };
+  while (ring->Drain(kRingDrainBatchSize,
+                     [&](MessageType type, const std::string& payload) {
+                       kOnRecord_(connection, type, payload);
+                     }) != 0) {}
+  return true;
+}
+
+void RingDrainer::CloseAll() {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  closed_ = true;
+  rings_.clear();
+  boost::system::error_code ignored_ec;
+  timer_.cancel(ignored_ec);
+}
+
+void RingDrainer::ScheduleDrain() {
+  // Must be called with 'mutex_' locked.
+  if (timer_armed_ || closed_ || rings_.empty())
+    return;
+  timer_armed_ = true;
+  timer_.expires_from_now(kRingDrainInterval);
+  std::shared_ptr<RingDrainer> this_ptr{ shared_from_this() };
+  timer_.async_wait([this_ptr](const boost::system::error_code& error_code) {
+    {
+      std::lock_guard<std::mutex> lock{ this_ptr->mutex_ };
+      this_ptr->timer_armed_ = false;
+    }
+    if (error_code && error_code == boost::asio::error::operation_aborted)
+      return;
+    this_ptr->DrainAll();
+  });
+}
+
+void RingDrainer::DrainAll() {
+  std::vector<std::pair<TcpConnectionPtr, std::shared_ptr<SharedMemoryRing>>> rings;
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    rings.assign(std::begin(rings_), std::end(rings_));
+  }
+  {
+    std::lock_guard<std::mutex> lock{ drain_mutex_ };
+    for (const auto& connection_and_ring : rings) {
+      const TcpConnectionPtr& connection(connection_and_ring.first);
+      connection_and_ring.second->Drain(kRingDrainBatchSize,
+          [&](MessageType type, const std::string& payload) {
+            kOnRecord_(connection, type, payload);
+          });
+    }
+  }
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  ScheduleDrain();
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,81 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_RING_DRAINER_H_
+#define MAIDSAFE_VAULT_MANAGER_RING_DRAINER_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "boost/asio/io_service.hpp"
+
+#include "maidsafe/vault_manager/config.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+class SharedMemoryRing;
+
+// Owns the shared memory rings via which vaults send fire-and-forget messages, and drains them all
+// every 'kRingDrainInterval' in batches of up to 'kRingDrainBatchSize' records per ring.  Each
+// record is passed to 'on_record' along with the connection of the vault which wrote it.  Thread-
+// safe, but 'on_record' mustn't call back into this.
+class RingDrainer : public std::enable_shared_from_this<RingDrainer> {
+ public:
+  typedef std::function<void(TcpConnectionPtr, MessageType, const std::string&)> RecordFunctor;
+
+  static std::shared_ptr<RingDrainer> MakeShared(boost::asio::io_service& io_service,
+                                                 RecordFunctor on_record);
+  // Creates a ring for the vault on 'connection' and returns its name.  Throws on failure.
+  std::string Add(TcpConnectionPtr connection);
+  // Drains any records left in the vault's ring, then destroys it.  Returns false if it didn't have
+  // one.
+  bool Remove(TcpConnectionPtr connection);
+  void CloseAll();
+
+ private:
+  typedef std::map<TcpConnectionPtr, std::shared_ptr<SharedMemoryRing>,
+                   std::owner_less<TcpConnectionPtr>> Rings;
+
+  RingDrainer(boost::asio::io_service& io_service, RecordFunctor on_record);
+
+  RingDrainer(const RingDrainer&) = delete;
+  RingDrainer(RingDrainer&&) = delete;
+  RingDrainer& operator=(RingDrainer) = delete;
+
+  void ScheduleDrain();
+  void DrainAll();
+
+  const RecordFunctor kOnRecord_;
+  Timer timer_;
+  std::mutex mutex_;
+  bool timer_armed_, closed_;
+  Rings rings_;
+  // Serialises draining, since each ring must only have a single consumer.
+  std::mutex drain_mutex_;
+};
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_RING_DRAINER_H_
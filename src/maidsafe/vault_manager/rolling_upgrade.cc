@@ -0,0 +1,175 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/rolling_upgrade.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "boost/asio/error.hpp"
+
+#include "maidsafe/common/log.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+RollingUpgrade::RollingUpgrade(boost::asio::io_service& io_service,
+                               std::vector<NonEmptyString> labels, fs::path old_executable_path,
+                               fs::path new_executable_path, size_t batch_size,
+                               RestartFunctor restart_vault, OnFinishedFunctor on_finished,
+                               std::chrono::steady_clock::duration health_timeout)
+    : io_service_(io_service),
+      kOldExecutablePath_(std::move(old_executable_path)),
+      kBatchSize_(std::max(batch_size, size_t(1))),
+      kRestartVault_(restart_vault),
+      kOnFinished_(on_finished),
+      kHealthTimeout_(health_timeout),
+      kStartTime_(std::chrono::steady_clock::now()),
+      mutex_(),
+      timer_(io_service),
+      target_executable_path_(std::move(new_executable_path)),
+      pending_(std::begin(labels), std::end(labels)),
+      restarted_(),
+      batch_(),
+      batch_number_(0),
+      rolling_back_(false),
+      finished_(false),
+      rollback_cause_(MakeError(CommonErrors::success)) {}
+
+std::shared_ptr<RollingUpgrade> RollingUpgrade::MakeShared(
+    boost::asio::io_service& io_service, std::vector<NonEmptyString> labels,
+    fs::path old_executable_path, fs::path new_executable_path, size_t batch_size,
+    RestartFunctor restart_vault, OnFinishedFunctor on_finished,
+    std::chrono::steady_clock::duration health_timeout) {
+  return std::shared_ptr<RollingUpgrade>{ new RollingUpgrade{ io_service, std::move(labels),
+      std::move(old_executable_path), std::move(new_executable_path), batch_size, restart_vault,
+      on_finished, health_timeout } };
+}
+
+void RollingUpgrade::Start() {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  LOG(kInfo) << "Upgrading " << pending_.size() << " vault(s) to " << target_executable_path_
+             << " in batches of " << kBatchSize_;
+  StartNextBatch();
+}
+
+void RollingUpgrade::HandleJoinedNetwork(const NonEmptyString& label) {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  if (finished_ || batch_.erase(label.string()) == 0U || !batch_.empty())
+    return;
+  timer_.cancel();
+  StartNextBatch();
+}
+
+void RollingUpgrade::Stop() {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  if (!finished_)
+    Finish(MakeError(VaultManagerErrors::vault_terminated));
+}
+
+void RollingUpgrade::StartNextBatch() {
+  while (!finished_) {
+    if (pending_.empty())
+      return Finish(rollback_cause_);
+
+    for (size_t i(0); i < kBatchSize_ && !pending_.empty(); ++i) {
+      NonEmptyString label{ pending_.front() };
+      pending_.pop_front();
+      // Even if restarting it fails, it may already use the target executable.
+      restarted_.push_back(label);
+      try {
+        if (kRestartVault_(label, target_executable_path_))
+          batch_.insert(label.string());
+      }
+      catch (const maidsafe_error& error) {
+        LOG(kError) << "Failed restarting vault " << label.string() << ": "
+                    << boost::diagnostic_information(error);
+        return Fail(error);
+      }
+      catch (const std::exception& e) {
+        LOG(kError) << "Failed restarting vault " << label.string() << ": "
+                    << boost::diagnostic_information(e);
+        return Fail(MakeError(CommonErrors::unknown));
+      }
+    }
+    if (batch_.empty())  // None of the batch was running, so there's nothing to wait for.
+      continue;
+
+    const uint64_t kBatchNumber{ ++batch_number_ };
+    LOG(kVerbose) << "Waiting for " << batch_.size() << " restarted vault(s) to join the network; "
+                  << pending_.size() << " more to restart.";
+    std::shared_ptr<RollingUpgrade> this_ptr{ shared_from_this() };
+    timer_.expires_from_now(kHealthTimeout_);
+    timer_.async_wait([this_ptr, kBatchNumber](const boost::system::error_code& error_code) {
+      if (error_code && error_code == boost::asio::error::operation_aborted)
+        return;
+      std::lock_guard<std::mutex> lock{ this_ptr->mutex_ };
+      // The batch may have completed just as the timer expired.
+      if (this_ptr->finished_ || this_ptr->batch_number_ != kBatchNumber)
+        return;
+      LOG(kError) << this_ptr->batch_.size() << " restarted vault(s) failed to join the network.";
+      this_ptr->Fail(MakeError(VaultManagerErrors::timed_out));
+    });
+    return;
+  }
+}
+
+void RollingUpgrade::Fail(maidsafe_error error) {
+  ++batch_number_;
+  timer_.cancel();
+  batch_.clear();
+  if (!rolling_back_) {
+    LOG(kWarning) << "Rolling back " << restarted_.size() << " vault(s) to "
+                  << kOldExecutablePath_;
+    rolling_back_ = true;
+    rollback_cause_ = error;
+    pending_.assign(restarted_.rbegin(), restarted_.rend());
+    restarted_.clear();
+    target_executable_path_ = kOldExecutablePath_;
+  } else {
+    LOG(kError) << "Abandoning a batch while rolling back; carrying on with the rest.";
+  }
+  StartNextBatch();
+}
+
+void RollingUpgrade::Finish(maidsafe_error error) {
+  finished_ = true;
+  timer_.cancel();
+  pending_.clear();
+  batch_.clear();
+  auto elapsed(std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - kStartTime_));
+  if (error.code() == make_error_code(CommonErrors::success)) {
+    LOG(kSuccess) << "Upgraded " << restarted_.size() << " vault(s) in " << elapsed.count()
+                  << " ms.";
+  } else {
+    LOG(kError) << "Vault upgrade " << (rolling_back_ ? "rolled back" : "stopped") << " after "
+                << elapsed.count() << " ms: " << boost::diagnostic_information(error);
+  }
+  OnFinishedFunctor on_finished{ kOnFinished_ };
+  if (on_finished)
+    io_service_.post([on_finished, error] { on_finished(error); });
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,109 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_ROLLING_UPGRADE_H_
+#define MAIDSAFE_VAULT_MANAGER_ROLLING_UPGRADE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "boost/asio/io_service.hpp"
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/types.h"
+
+#include "maidsafe/vault_manager/config.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// Restarts vaults from a new executable in batches of up to 'batch_size', only moving on to the
+// next batch once every vault in the current one has reported joining the network.  If a batch
+// doesn't do so within 'health_timeout', or a vault can't be restarted, the vaults restarted so far
+// are rolled back to the old executable in reverse order, again batch by batch.  So at most one
+// batch of vaults is ever down at a time.  Batches which fail while rolling back are abandoned.
+//
+// 'on_finished' is posted to 'io_service' once, with success or the cause of the rollback (or
+// vault_terminated if stopped).  Thread-safe.
+class RollingUpgrade : public std::enable_shared_from_this<RollingUpgrade> {
+ public:
+  // Restarts the vault from the given executable.  Returns false if the vault isn't running, so
+  // won't be reporting in.  Throws on failure.
+  typedef std::function<bool(const NonEmptyString& label,
+                             const boost::filesystem::path& executable_path)> RestartFunctor;
+  typedef std::function<void(maidsafe_error)> OnFinishedFunctor;
+
+  static std::shared_ptr<RollingUpgrade> MakeShared(
+      boost::asio::io_service& io_service, std::vector<NonEmptyString> labels,
+      boost::filesystem::path old_executable_path, boost::filesystem::path new_executable_path,
+      size_t batch_size, RestartFunctor restart_vault, OnFinishedFunctor on_finished,
+      std::chrono::steady_clock::duration health_timeout = kVaultUpgradeHealthTimeout);
+  void Start();
+  void HandleJoinedNetwork(const NonEmptyString& label);
+  void Stop();
+
+ private:
+  RollingUpgrade(boost::asio::io_service& io_service, std::vector<NonEmptyString> labels,
+                 boost::filesystem::path old_executable_path,
+                 boost::filesystem::path new_executable_path, size_t batch_size,
+                 RestartFunctor restart_vault, OnFinishedFunctor on_finished,
+                 std::chrono::steady_clock::duration health_timeout);
+
+  RollingUpgrade(const RollingUpgrade&) = delete;
+  RollingUpgrade(RollingUpgrade&&) = delete;
+  RollingUpgrade& operator=(RollingUpgrade) = delete;
+
+  // These must be called with the lock held.
+  void StartNextBatch();
+  void Fail(maidsafe_error error);
+  void Finish(maidsafe_error error);
+
+  boost::asio::io_service& io_service_;
+  const boost::filesystem::path kOldExecutablePath_;
+  const size_t kBatchSize_;
+  const RestartFunctor kRestartVault_;
+  const OnFinishedFunctor kOnFinished_;
+  const std::chrono::steady_clock::duration kHealthTimeout_;
+  const std::chrono::steady_clock::time_point kStartTime_;
+  std::mutex mutex_;
+  Timer timer_;
+  boost::filesystem::path target_executable_path_;
+  std::deque<NonEmptyString> pending_;
+  // Vaults restarted from 'target_executable_path_' so far.
+  std::vector<NonEmptyString> restarted_;
+  // Labels of the current batch's vaults which haven't yet joined the network.
+  std::set<std::string> batch_;
+  uint64_t batch_number_;
+  bool rolling_back_, finished_;
+  maidsafe_error rollback_cause_;
+};
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_ROLLING_UPGRADE_H_
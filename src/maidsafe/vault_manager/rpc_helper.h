@@ -25,15 +25,14 @@
 #include <mutex>
 #include <string>
 
-#include "boost/asio/error.hpp"
 #include "boost/asio/io_service.hpp"
-#include "boost/asio/steady_timer.hpp"
 #include "boost/exception/diagnostic_information.hpp"
 
 #include "maidsafe/common/error.h"
 #include "maidsafe/common/log.h"
 
 #include "maidsafe/vault_manager/config.h"
+#include "maidsafe/vault_manager/timer_wheel.h"
 #include "maidsafe/vault_manager/utils.h"
 
 namespace maidsafe {
@@ -42,6 +41,7 @@ namespace vault_manager {
 
 namespace detail {
 
+// The timeout is on the io_service's TimerWheel, and is only armed once 'timeout' is set.
 template <typename ResultType>
 struct PromiseAndTimer {
   explicit PromiseAndTimer(boost::asio::io_service& io_service);
@@ -49,17 +49,18 @@ struct PromiseAndTimer {
   void SetValue(ResultType&& result);  // Check
   void SetException(std::exception_ptr exception);
   void SetException(maidsafe_error error);
-  void SetException(boost::system::error_code error_code);
 
   std::promise<ResultType> promise;
-  Timer timer;
+  TimerWheel& timer_wheel;
+  TimerWheel::TimeoutId timeout;
   std::once_flag once_flag;
 };
 
 template <typename ResultType>
 PromiseAndTimer<ResultType>::PromiseAndTimer(boost::asio::io_service& io_service)
     : promise(),
-      timer(io_service, kRpcTimeout),
+      timer_wheel(GetTimerWheel(io_service)),
+      timeout(0),
       once_flag() {}
 
 template <typename ResultType>
@@ -83,13 +84,6 @@ void PromiseAndTimer<ResultType>::SetException(maidsafe_error error) {
   std::call_once(once_flag, [&] { this->promise.set_exception(std::make_exception_ptr(error)); });
 }
 
-template <typename ResultType>
-void PromiseAndTimer<ResultType>::SetException(boost::system::error_code error_code) {
-  std::call_once(once_flag, [&] {
-    this->promise.set_exception(std::make_exception_ptr(boost::system::system_error(error_code)));
-  });
-}
-
 }  // namespace detail
 
 template <typename ResultType>
@@ -110,23 +104,18 @@ std::future<ResultType> SetResponseCallback(std::function<void(std::string)>& ca
         LOG(kError) << boost::diagnostic_information(e);
         promise_and_timer->SetException(std::current_exception());
       }
-      promise_and_timer->timer.cancel();
+      promise_and_timer->timer_wheel.Cancel(promise_and_timer->timeout);
     };
+    // Armed under the lock so that the callback can't run before 'timeout' is set.
+    promise_and_timer->timeout = promise_and_timer->timer_wheel.Arm(kRpcTimeout,
+        [promise_and_timer, &callback, &mutex] {
+          LOG(kVerbose) << "Timer expired - i.e. timed out";
+          std::lock_guard<std::mutex> lock{ mutex };
+          if (callback)
+            callback = nullptr;
+          promise_and_timer->SetException(MakeError(VaultManagerErrors::timed_out));
+        });
   }
-  promise_and_timer->timer.async_wait([=, &callback, &mutex](const boost::system::error_code& ec) {
-    if (ec && ec == boost::asio::error::operation_aborted) {
-      LOG(kVerbose) << "Timer cancelled";
-      return;
-    }
-    LOG(kVerbose) << "Timer expired - i.e. timed out";
-    std::lock_guard<std::mutex> lock{ mutex };
-    if (callback)
-      callback = nullptr;
-    if (ec)
-      promise_and_timer->SetException(ec);
-    else
-      promise_and_timer->SetException(MakeError(VaultManagerErrors::timed_out));
-  });
   return promise_and_timer->promise.get_future();
 }
 
@@ -0,0 +1,201 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/shared_memory_ring.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include "boost/interprocess/exceptions.hpp"
+#include "boost/interprocess/permissions.hpp"
+#include "boost/interprocess/shared_memory_object.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+namespace bi = boost::interprocess;
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace {
+
+const uint32_t kMagic(0x4d53524e);  // "MSRN"
+// Each record is an 8-byte header (payload size then message type) followed by the payload, padded
+// to a multiple of 8 bytes.  Since the capacity is too, a record header never wraps.
+const uint64_t kRecordHeaderSize(8);
+
+uint64_t RecordSize(uint64_t payload_size) {
+  return kRecordHeaderSize + ((payload_size + 7) & ~uint64_t{ 7 });
+}
+
+uint64_t RoundUpToPowerOfTwo(uint64_t value) {
+  uint64_t result{ 64 };
+  while (result < value)
+    result <<= 1;
+  return result;
+}
+
+}  // unnamed namespace
+
+// The positions increase monotonically; each is only written by one side.  They're kept on separate
+// cache lines so the producer and consumer don't contend.
+struct SharedMemoryRing::Header {
+  std::atomic<uint64_t> write_position;
+  char padding0[64 - sizeof(std::atomic<uint64_t>)];
+  std::atomic<uint64_t> read_position;
+  char padding1[64 - sizeof(std::atomic<uint64_t>)];
+  uint64_t capacity;
+  uint32_t magic;
+};
+
+SharedMemoryRing::SharedMemoryRing(std::string name, bi::mapped_region region, bool owner)
+    : kName_(std::move(name)),
+      kOwner_(owner),
+      region_(std::move(region)),
+      header_(static_cast<Header*>(region_.get_address())),
+      data_(static_cast<char*>(region_.get_address()) + sizeof(Header)),
+      capacity_(header_->capacity),
+      corrupt_(false),
+      payload_() {}
+
+std::unique_ptr<SharedMemoryRing> SharedMemoryRing::Create(const std::string& name,
+                                                           size_t capacity) {
+  if (!std::atomic<uint64_t>{}.is_lock_free()) {
+    LOG(kError) << "Shared memory ring needs lock-free 64-bit atomics.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unknown));
+  }
+  uint64_t rounded_capacity{ RoundUpToPowerOfTwo(capacity) };
+  try {
+    bi::shared_memory_object::remove(name.c_str());  // In case it's left over from a crash.
+    bi::permissions permissions;
+#ifndef MAIDSAFE_WIN32
+    permissions.set_permissions(0600);  // Vaults run as the same user as the VaultManager.
+#endif
+    bi::shared_memory_object shared_memory{ bi::create_only, name.c_str(), bi::read_write,
+                                            permissions };
+    shared_memory.truncate(static_cast<bi::offset_t>(sizeof(Header) + rounded_capacity));
+    bi::mapped_region region{ shared_memory, bi::read_write };
+    Header* header{ new (region.get_address()) Header };
+    header->write_position = 0;
+    header->read_position = 0;
+    header->capacity = rounded_capacity;
+    header->magic = kMagic;
+    return std::unique_ptr<SharedMemoryRing>{
+        new SharedMemoryRing{ name, std::move(region), true } };
+  }
+  catch (const bi::interprocess_exception& e) {
+    LOG(kError) << "Failed to create shared memory ring " << name << ": " << e.what();
+    bi::shared_memory_object::remove(name.c_str());
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unknown));
+  }
+}
+
+std::unique_ptr<SharedMemoryRing> SharedMemoryRing::Open(const std::string& name) {
+  try {
+    bi::shared_memory_object shared_memory{ bi::open_only, name.c_str(), bi::read_write };
+    bi::mapped_region region{ shared_memory, bi::read_write };
+    const Header* header{ static_cast<const Header*>(region.get_address()) };
+    if (region.get_size() < sizeof(Header) || header->magic != kMagic ||
+        header->capacity != RoundUpToPowerOfTwo(header->capacity) ||
+        region.get_size() < sizeof(Header) + header->capacity) {
+      LOG(kError) << "Shared memory ring " << name << " is malformed.";
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+    }
+    return std::unique_ptr<SharedMemoryRing>{
+        new SharedMemoryRing{ name, std::move(region), false } };
+  }
+  catch (const bi::interprocess_exception& e) {
+    LOG(kError) << "Failed to open shared memory ring " << name << ": " << e.what();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unknown));
+  }
+}
+
+SharedMemoryRing::~SharedMemoryRing() {
+  if (kOwner_)
+    bi::shared_memory_object::remove(kName_.c_str());
+}
+
+bool SharedMemoryRing::TryPush(MessageType type, const std::string& payload) {
+  uint64_t record_size{ RecordSize(payload.size()) };
+  uint64_t write_position{ header_->write_position.load(std::memory_order_relaxed) };
+  uint64_t read_position{ header_->read_position.load(std::memory_order_acquire) };
+  uint64_t used{ write_position - read_position };
+  if (used > capacity_ || capacity_ - used < record_size)
+    return false;
+
+  uint32_t record_header[2] = { static_cast<uint32_t>(payload.size()),
+                                static_cast<uint32_t>(static_cast<int32_t>(type)) };
+  CopyIn(write_position, reinterpret_cast<const char*>(record_header), kRecordHeaderSize);
+  CopyIn(write_position + kRecordHeaderSize, payload.data(), payload.size());
+  header_->write_position.store(write_position + record_size, std::memory_order_release);
+  return true;
+}
+
+size_t SharedMemoryRing::Drain(size_t max_records, const RecordFunctor& functor) {
+  if (corrupt_)
+    return 0;
+  uint64_t read_position{ header_->read_position.load(std::memory_order_relaxed) };
+  uint64_t write_position{ header_->write_position.load(std::memory_order_acquire) };
+  size_t count{ 0 };
+  while (count < max_records && read_position != write_position) {
+    uint64_t available{ write_position - read_position };
+    uint32_t record_header[2];
+    if (available > capacity_ || available < kRecordHeaderSize) {
+      corrupt_ = true;
+      break;
+    }
+    CopyOut(read_position, reinterpret_cast<char*>(record_header), kRecordHeaderSize);
+    uint64_t record_size{ RecordSize(record_header[0]) };
+    if (record_size > available) {
+      corrupt_ = true;
+      break;
+    }
+    payload_.resize(record_header[0]);
+    if (!payload_.empty())
+      CopyOut(read_position + kRecordHeaderSize, &payload_[0], payload_.size());
+    read_position += record_size;
+    // Release the space before handling the record so that the producer isn't held up.
+    header_->read_position.store(read_position, std::memory_order_release);
+    functor(static_cast<MessageType>(static_cast<int32_t>(record_header[1])), payload_);
+    ++count;
+  }
+  if (corrupt_)
+    LOG(kError) << "Shared memory ring " << kName_ << " is corrupt; ignoring further records.";
+  return count;
+}
+
+void SharedMemoryRing::CopyIn(uint64_t position, const char* data, size_t size) {
+  uint64_t offset{ position & (capacity_ - 1) };
+  size_t first_part{ static_cast<size_t>(std::min<uint64_t>(size, capacity_ - offset)) };
+  std::memcpy(data_ + offset, data, first_part);
+  std::memcpy(data_, data + first_part, size - first_part);
+}
+
+void SharedMemoryRing::CopyOut(uint64_t position, char* data, size_t size) const {
+  uint64_t offset{ position & (capacity_ - 1) };
+  size_t first_part{ static_cast<size_t>(std::min<uint64_t>(size, capacity_ - offset)) };
+  std::memcpy(data, data_ + offset, first_part);
+  std::memcpy(data + first_part, data_, size - first_part);
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,90 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_SHARED_MEMORY_RING_H_
+#define MAIDSAFE_VAULT_MANAGER_SHARED_MEMORY_RING_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "boost/interprocess/mapped_region.hpp"
+
+#include "maidsafe/vault_manager/config.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// A single-producer, single-consumer ring of (MessageType, payload) records in a named shared
+// memory object.  The VaultManager creates one per vault and is the consumer; the vault opens it by
+// name and is the producer.  Neither side blocks: 'TryPush' fails if there isn't room, and 'Drain'
+// returns once the ring is empty or 'max_records' have been handled.
+//
+// The consumer treats the ring's contents as untrusted; a record which couldn't have been written
+// by a well-behaved producer marks the ring as corrupt, after which it yields nothing more.
+class SharedMemoryRing {
+ public:
+  typedef std::function<void(MessageType, const std::string&)> RecordFunctor;
+
+  // Consumer side.  The shared memory object is removed when the returned ring is destroyed.
+  // 'capacity' is rounded up to a power of two.
+  static std::unique_ptr<SharedMemoryRing> Create(const std::string& name, size_t capacity);
+  // Producer side.
+  static std::unique_ptr<SharedMemoryRing> Open(const std::string& name);
+
+  ~SharedMemoryRing();
+
+  // Returns false if there isn't enough free space, in which case the record isn't written.
+  bool TryPush(MessageType type, const std::string& payload);
+  // Invokes 'functor' for up to 'max_records' records, returning the number handled.  The payload
+  // is only valid for the duration of the call.
+  size_t Drain(size_t max_records, const RecordFunctor& functor);
+
+  const std::string& Name() const { return kName_; }
+  bool Corrupt() const { return corrupt_; }
+
+ private:
+  struct Header;
+
+  SharedMemoryRing(std::string name, boost::interprocess::mapped_region region, bool owner);
+
+  SharedMemoryRing(const SharedMemoryRing&) = delete;
+  SharedMemoryRing(SharedMemoryRing&&) = delete;
+  SharedMemoryRing& operator=(SharedMemoryRing) = delete;
+
+  void CopyIn(uint64_t position, const char* data, size_t size);
+  void CopyOut(uint64_t position, char* data, size_t size) const;
+
+  const std::string kName_;
+  const bool kOwner_;
+  boost::interprocess::mapped_region region_;
+  Header* header_;
+  char* data_;
+  uint64_t capacity_;
+  bool corrupt_;
+  std::string payload_;
+};
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_SHARED_MEMORY_RING_H_
@@ -0,0 +1,143 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/spawn.h"
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifndef MAIDSAFE_WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+
+extern "C" char **environ;
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4702)
+#endif
+#include "boost/process/execute.hpp"
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+#include "boost/process/executor.hpp"
+#include "boost/process/initializers.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/on_scope_exit.h"
+#include "maidsafe/common/process.h"
+
+#include "maidsafe/vault_manager/config.h"
+
+namespace bp = boost::process;
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+#ifndef MAIDSAFE_WIN32
+namespace {
+
+void ThrowIfSpawnError(int result, const char* action) {
+  if (result != 0) {
+    LOG(kError) << "Failed to " << action << ": " << std::strerror(result);
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unknown));
+  }
+}
+
+}  // unnamed namespace
+
+bp::child PosixSpawn(const fs::path& executable_path, const std::vector<std::string>& args,
+                     int inherited_socket) {
+  std::vector<char*> argv;
+  for (const auto& arg : args)
+    argv.push_back(const_cast<char*>(arg.c_str()));
+  argv.push_back(nullptr);
+
+  posix_spawn_file_actions_t file_actions;
+  ThrowIfSpawnError(posix_spawn_file_actions_init(&file_actions), "initialise spawn file actions");
+  on_scope_exit destroy_file_actions{ [&] { posix_spawn_file_actions_destroy(&file_actions); } };
+  posix_spawnattr_t attributes;
+  ThrowIfSpawnError(posix_spawnattr_init(&attributes), "initialise spawn attributes");
+  on_scope_exit destroy_attributes{ [&] { posix_spawnattr_destroy(&attributes); } };
+
+  int source_socket{ inherited_socket };
+  on_scope_exit close_duplicate{ [&] {
+    if (source_socket != inherited_socket)
+      close(source_socket);
+  } };
+  if (inherited_socket != -1) {
+    // dup2 clears close-on-exec on the new descriptor, but isn't guaranteed to if the old and new
+    // descriptor numbers are the same.
+    if (inherited_socket == kInheritedChannelDescriptor) {
+      source_socket = fcntl(inherited_socket, F_DUPFD_CLOEXEC, kInheritedChannelDescriptor + 1);
+      if (source_socket == -1)
+        ThrowIfSpawnError(errno, "duplicate inherited socket");
+    }
+    ThrowIfSpawnError(posix_spawn_file_actions_adddup2(&file_actions, source_socket,
+                                                       kInheritedChannelDescriptor),
+                      "add inherited socket to spawn file actions");
+  }
+
+  // The spawning thread may have signals blocked (e.g. by asio); the vault shouldn't inherit that.
+  sigset_t no_signals;
+  sigemptyset(&no_signals);
+  ThrowIfSpawnError(posix_spawnattr_setsigmask(&attributes, &no_signals), "set spawn signal mask");
+  ThrowIfSpawnError(posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGMASK),
+                    "set spawn flags");
+
+  pid_t process_id;
+  ThrowIfSpawnError(posix_spawn(&process_id, executable_path.c_str(), &file_actions, &attributes,
+                                argv.data(), environ),
+                    ("spawn " + executable_path.string()).c_str());
+  return bp::child{ process_id };
+}
+#endif
+
+bp::child ForkAndExec(boost::asio::io_service& io_service, const fs::path& executable_path,
+                      const std::vector<std::string>& args, int inherited_socket) {
+#ifdef MAIDSAFE_WIN32
+  static_cast<void>(io_service);
+  static_cast<void>(inherited_socket);
+#endif
+  return bp::execute(
+      bp::initializers::run_exe(executable_path),
+      bp::initializers::set_cmd_line(process::ConstructCommandLine(args)),
+#ifndef MAIDSAFE_WIN32
+      bp::initializers::notify_io_service(io_service),
+      bp::initializers::on_exec_setup([inherited_socket](bp::executor&) {
+        if (inherited_socket == kInheritedChannelDescriptor)
+          fcntl(inherited_socket, F_SETFD, 0);
+        else if (inherited_socket != -1)
+          dup2(inherited_socket, kInheritedChannelDescriptor);
+      }),
+#endif
+      bp::initializers::throw_on_error(),
+      bp::initializers::inherit_env());
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
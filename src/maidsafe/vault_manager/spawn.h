@@ -0,0 +1,55 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_SPAWN_H_
+#define MAIDSAFE_VAULT_MANAGER_SPAWN_H_
+
+#include <string>
+#include <vector>
+
+#include "boost/asio/io_service.hpp"
+#include "boost/filesystem/path.hpp"
+#include "boost/process/child.hpp"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// Both functions start 'executable_path' with the given arguments ('args[0]' being the program
+// name) and this process' environment, and throw if the process can't be started.  Other than on
+// Windows, if 'inherited_socket' isn't -1 it's inherited by the new process as descriptor
+// kInheritedChannelDescriptor.  No other descriptors are affected, so those not to be inherited
+// must be close-on-exec.
+
+#ifndef MAIDSAFE_WIN32
+// Uses posix_spawn, which (unlike fork) doesn't copy this process' page tables, so its cost doesn't
+// grow with the memory used by this process.
+boost::process::child PosixSpawn(const boost::filesystem::path& executable_path,
+                                 const std::vector<std::string>& args, int inherited_socket = -1);
+#endif
+
+// Uses boost::process::execute, i.e. fork and exec other than on Windows.
+boost::process::child ForkAndExec(boost::asio::io_service& io_service,
+                                  const boost::filesystem::path& executable_path,
+                                  const std::vector<std::string>& args, int inherited_socket = -1);
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_SPAWN_H_
@@ -18,9 +18,21 @@
 
 #include "maidsafe/vault_manager/tcp_connection.h"
 
+#include <algorithm>
 #include <condition_variable>
+#include <functional>
+
+#ifndef MAIDSAFE_WIN32
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
 
 #include "boost/asio/error.hpp"
+#include "boost/asio/ip/tcp.hpp"
+#ifndef MAIDSAFE_WIN32
+#include "boost/asio/local/stream_protocol.hpp"
+#endif
 #include "boost/asio/read.hpp"
 #include "boost/asio/write.hpp"
 
@@ -29,6 +41,7 @@
 #include "maidsafe/common/utils.h"
 
 namespace asio = boost::asio;
+namespace generic = asio::generic;
 namespace ip = asio::ip;
 namespace args = std::placeholders;
 
@@ -38,47 +51,64 @@ namespace vault_manager {
 
 TcpConnection::TcpConnection(AsioService& asio_service)
     : io_service_(asio_service.service()),
+      strand_(io_service_),
       start_flag_(),
       socket_close_flag_(),
       socket_(io_service_),
       on_message_received_(),
       on_connection_closed_(),
+      buffer_pool_(kMaxPooledBytesPerConnection, kMaxPooledBytesPerConnection),
       receiving_message_(),
-      send_queue_() {
+      receiving_paused_(false),
+      holding_message_(false),
+      held_message_(),
+      send_queue_(),
+      send_buffers_(),
+      max_message_size_(MaxMessageSize()),
+      sending_count_(0),
+      max_send_batch_bytes_(kMaxSendBatchBytes),
+      max_send_batch_messages_(kMaxSendBatchMessages),
+      send_stats_mutex_(),
+      send_stats_() {
   static_assert((sizeof(DataSize)) == 4, "DataSize must be 4 bytes.");
   assert(!socket_.is_open());
-  if (asio_service.ThreadCount() != 1U) {
-    LOG(kError) << "This must be a single-threaded io_service, or an asio strand will be required.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
-  }
 }
 
 TcpConnection::TcpConnection(AsioService& asio_service, uint16_t remote_port)
-    : io_service_(asio_service.service()),
-      start_flag_(),
-      socket_close_flag_(),
-      socket_(io_service_),
-      on_message_received_(),
-      on_connection_closed_(),
-      receiving_message_(),
-      send_queue_() {
-  if (asio_service.ThreadCount() != 1U) {
-    LOG(kError) << "This must be a single-threaded io_service, or an asio strand will be required.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
-  }
-
+    : TcpConnection(asio_service) {
   boost::system::error_code ec;
   // Try IPv6 first.
-  socket_.connect(ip::tcp::endpoint{ ip::address_v6::loopback(), remote_port }, ec);
-  if (ec && ec == asio::error::make_error_code(asio::error::address_family_not_supported))
+  socket_.connect(generic::stream_protocol::endpoint{
+      ip::tcp::endpoint{ ip::address_v6::loopback(), remote_port } }, ec);
+  if (ec && ec == asio::error::make_error_code(asio::error::address_family_not_supported)) {
     // Try IPv4 now.
-    socket_.connect(ip::tcp::endpoint{ ip::address_v4::loopback(), remote_port }, ec);
+    socket_.connect(generic::stream_protocol::endpoint{
+        ip::tcp::endpoint{ ip::address_v4::loopback(), remote_port } }, ec);
+  }
   if (!socket_.is_open()) {
     LOG(kError) << "Failed to connect to " << remote_port << ": " << ec.message();
     BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::failed_to_connect));
   }
 }
 
+#ifndef MAIDSAFE_WIN32
+TcpConnection::TcpConnection(AsioService& asio_service, const boost::filesystem::path& socket_path)
+    : TcpConnection(asio_service) {
+  boost::system::error_code ec;
+  try {
+    socket_.connect(generic::stream_protocol::endpoint{
+        asio::local::stream_protocol::endpoint{ socket_path.string() } }, ec);
+  }
+  catch (const boost::system::system_error& error) {  // Thrown if the path is too long.
+    ec = error.code();
+  }
+  if (ec || !socket_.is_open()) {
+    LOG(kVerbose) << "Failed to connect to " << socket_path << ": " << ec.message();
+    BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::failed_to_connect));
+  }
+}
+#endif
+
 TcpConnectionPtr TcpConnection::MakeShared(AsioService& asio_service) {
   return TcpConnectionPtr{ new TcpConnection{ asio_service } };
 }
@@ -87,25 +117,44 @@ TcpConnectionPtr TcpConnection::MakeShared(AsioService& asio_service, uint16_t r
   return TcpConnectionPtr{ new TcpConnection{ asio_service, remote_port } };
 }
 
+#ifndef MAIDSAFE_WIN32
+TcpConnectionPtr TcpConnection::MakeShared(AsioService& asio_service,
+                                           const boost::filesystem::path& socket_path) {
+  return TcpConnectionPtr{ new TcpConnection{ asio_service, socket_path } };
+}
+
+TcpConnectionPtr TcpConnection::MakeSharedFromNativeSocket(AsioService& asio_service,
+                                                           int native_socket) {
+  TcpConnectionPtr connection{ new TcpConnection{ asio_service } };
+  boost::system::error_code ec;
+  connection->socket_.assign(generic::stream_protocol{ AF_UNIX, 0 }, native_socket, ec);
+  if (ec) {
+    LOG(kError) << "Failed to adopt native socket " << native_socket << ": " << ec.message();
+    BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::failed_to_connect));
+  }
+  return connection;
+}
+#endif
+
 void TcpConnection::Start(MessageReceivedFunctor on_message_received,
                           ConnectionClosedFunctor on_connection_closed) {
   std::call_once(start_flag_, [=] {
     on_message_received_ = on_message_received;
     on_connection_closed_ = on_connection_closed;
     TcpConnectionPtr this_ptr{ shared_from_this() };
-    io_service_.dispatch([this_ptr] { this_ptr->ReadSize(); });
+    strand_.dispatch([this_ptr] { this_ptr->ReadSize(); });
   });
 }
 
 void TcpConnection::Close() {
   TcpConnectionPtr this_ptr{ shared_from_this() };
-  io_service_.post([this_ptr] { this_ptr->DoClose(); });
+  strand_.post([this_ptr] { this_ptr->DoClose(); });
 }
 
 void TcpConnection::DoClose() {
   std::call_once(socket_close_flag_, [this] {
     boost::system::error_code ignored_ec;
-    socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_send, ignored_ec);
+    socket_.shutdown(asio::socket_base::shutdown_send, ignored_ec);
     socket_.close(ignored_ec);
     if (on_connection_closed_)
       on_connection_closed_();
@@ -114,7 +163,7 @@ void TcpConnection::DoClose() {
 
 void TcpConnection::ReadSize() {
   TcpConnectionPtr this_ptr{ shared_from_this() };
-  asio::async_read(socket_, asio::buffer(receiving_message_.size_buffer),
+  asio::async_read(socket_, asio::buffer(receiving_message_.size_buffer), strand_.wrap(
                    [this_ptr](const boost::system::error_code& ec, size_t bytes_transferred) {
     if (ec) {
       LOG(kInfo) << ec.message();
@@ -128,21 +177,22 @@ void TcpConnection::ReadSize() {
                      this_ptr->receiving_message_.size_buffer[1]) << 8) |
                      this_ptr->receiving_message_.size_buffer[2]) << 8) |
                      this_ptr->receiving_message_.size_buffer[3];
-    if (data_size > MaxMessageSize()) {
-      LOG(kError) << "Incoming message size of " << data_size
-                  << " bytes exceeds maximum allowed of " << MaxMessageSize() << " bytes.";
+    if (data_size > this_ptr->max_message_size_) {
+      LOG(kError) << "Incoming message size of " << data_size << " bytes exceeds maximum allowed of "
+                  << this_ptr->max_message_size_ << " bytes.";
       this_ptr->receiving_message_.data_buffer.clear();
       return this_ptr->DoClose();
     }
 
-    this_ptr->receiving_message_.data_buffer.resize(data_size);
+    this_ptr->receiving_message_.data_buffer = this_ptr->buffer_pool_.Acquire(data_size);
     this_ptr->ReadData();
-  });
+  }));
 }
 
 void TcpConnection::ReadData() {
   TcpConnectionPtr this_ptr{ shared_from_this() };
-  asio::async_read(socket_, asio::buffer(receiving_message_.data_buffer), io_service_.wrap(
+  asio::async_read(socket_, asio::buffer(&receiving_message_.data_buffer[0],
+                                         receiving_message_.data_buffer.size()), strand_.wrap(
                    [this_ptr](const boost::system::error_code& ec, size_t bytes_transferred) {
     if (ec) {
       LOG(kError) << "Failed to read message body: " << ec.message();
@@ -151,41 +201,143 @@ void TcpConnection::ReadData() {
     assert(bytes_transferred == this_ptr->receiving_message_.data_buffer.size());
     static_cast<void>(bytes_transferred);
 
-    // Dispatch the message outside the strand.
-    std::string data{ std::begin(this_ptr->receiving_message_.data_buffer),
-                      std::end(this_ptr->receiving_message_.data_buffer) };
-    this_ptr->io_service_.post([=] { this_ptr->on_message_received_(std::move(data)); });
-    this_ptr->io_service_.dispatch([this_ptr] { this_ptr->ReadSize(); });
+    std::string data;
+    data.swap(this_ptr->receiving_message_.data_buffer);
+    if (this_ptr->receiving_paused_) {
+      // Stop reading until resumed.
+      this_ptr->held_message_.swap(data);
+      this_ptr->holding_message_ = true;
+      return;
+    }
+    this_ptr->DeliverMessage(std::move(data));
   }));
 }
 
+void TcpConnection::DeliverMessage(std::string data) {
+  // Start reading the next message before lending the buffer to the message handler.  We're
+  // already running in the strand, so this connection's messages are still handled one at a time
+  // and in order.
+  ReadSize();
+  on_message_received_(data);
+  buffer_pool_.Release(std::move(data));
+}
+
+void TcpConnection::PauseReceiving() {
+  TcpConnectionPtr this_ptr{ shared_from_this() };
+  strand_.dispatch([this_ptr] { this_ptr->receiving_paused_ = true; });
+}
+
+void TcpConnection::ResumeReceiving() {
+  TcpConnectionPtr this_ptr{ shared_from_this() };
+  strand_.dispatch([this_ptr] {
+    this_ptr->receiving_paused_ = false;
+    if (!this_ptr->holding_message_)
+      return;
+    this_ptr->holding_message_ = false;
+    std::string data;
+    data.swap(this_ptr->held_message_);
+    if (this_ptr->socket_.is_open())
+      this_ptr->DeliverMessage(std::move(data));
+  });
+}
+
 void TcpConnection::Send(std::string data) {
-  SendingMessage message(EncodeData(std::move(data)));
+  // Bind the message rather than capturing it in a lambda so that it's moved, not copied.
+  strand_.post(std::bind(&TcpConnection::QueueForSending, shared_from_this(),
+                         EncodeData(std::move(data))));
+}
+
+void TcpConnection::QueueForSending(SendingMessage& message) {
+  bool currently_sending{ !send_queue_.empty() };
+  send_queue_.emplace_back(std::move(message));
+  if (!currently_sending)
+    DoSend();
+}
+
+void TcpConnection::SetSendBatchLimits(size_t max_bytes, size_t max_messages) {
   TcpConnectionPtr this_ptr{ shared_from_this() };
-  io_service_.post([this_ptr, message] {
-    bool currently_sending{ !this_ptr->send_queue_.empty() };
-    this_ptr->send_queue_.emplace_back(std::move(message));
-    if (!currently_sending)
-      this_ptr->DoSend();
+  strand_.dispatch([this_ptr, max_bytes, max_messages] {
+    this_ptr->max_send_batch_bytes_ = max_bytes;
+    this_ptr->max_send_batch_messages_ = std::max(max_messages, size_t{ 1 });
   });
 }
 
+void TcpConnection::SetMaxMessageSize(size_t max_message_size) {
+  TcpConnectionPtr this_ptr{ shared_from_this() };
+  strand_.dispatch([this_ptr, max_message_size] {
+    this_ptr->max_message_size_ = std::min(max_message_size, MaxMessageSize());
+  });
+}
+
+TcpConnection::PeerCredentials TcpConnection::GetPeerCredentials() {
+  PeerCredentials credentials;
+#ifndef MAIDSAFE_WIN32
+  boost::system::error_code ec;
+  if (!socket_.is_open() || socket_.local_endpoint(ec).protocol().family() != AF_UNIX || ec)
+    return credentials;
+#ifdef MAIDSAFE_LINUX
+  ucred peer;
+  socklen_t peer_length{ sizeof(peer) };
+  if (getsockopt(socket_.native_handle(), SOL_SOCKET, SO_PEERCRED, &peer, &peer_length) == 0) {
+    credentials.valid = true;
+    credentials.process_id = static_cast<uint64_t>(peer.pid);
+    credentials.user_id = static_cast<uint32_t>(peer.uid);
+  }
+#else
+  uid_t user_id;
+  gid_t group_id;
+  if (getpeereid(socket_.native_handle(), &user_id, &group_id) == 0) {
+    credentials.valid = true;
+    credentials.user_id = static_cast<uint32_t>(user_id);
+  }
+#endif
+#endif
+  return credentials;
+}
+
+TcpConnection::SendStats TcpConnection::GetSendStats() const {
+  std::lock_guard<std::mutex> lock{ send_stats_mutex_ };
+  return send_stats_;
+}
+
 void TcpConnection::DoSend() {
-  std::array<asio::const_buffer, 2> buffers;
-  buffers[0] = asio::buffer(send_queue_.front().size_buffer);
-  buffers[1] = asio::buffer(send_queue_.front().data.data(), send_queue_.front().data.size());
+  // Gather as many queued messages as the batch limits allow into a single write.  Elements of a
+  // std::deque aren't moved by later additions to the queue, so the buffers remain valid.
+  assert(sending_count_ == 0);
+  send_buffers_.clear();
+  size_t batch_size{ 0 };
+  for (const auto& message : send_queue_) {
+    size_t message_size{ message.size_buffer.size() + message.data.size() };
+    if (sending_count_ != 0 && (sending_count_ == max_send_batch_messages_ ||
+                                batch_size + message_size > max_send_batch_bytes_)) {
+      break;
+    }
+    send_buffers_.push_back(asio::buffer(message.size_buffer));
+    send_buffers_.push_back(asio::buffer(message.data.data(), message.data.size()));
+    batch_size += message_size;
+    ++sending_count_;
+  }
+  {
+    std::lock_guard<std::mutex> lock{ send_stats_mutex_ };
+    ++send_stats_.write_count;
+    send_stats_.message_count += sending_count_;
+  }
+
   TcpConnectionPtr this_ptr{ shared_from_this() };
-  asio::async_write(socket_, buffers, io_service_.wrap(
-                    [this_ptr](const boost::system::error_code& ec, size_t bytes_transferred) {
+  asio::async_write(socket_, send_buffers_, strand_.wrap(
+      [this_ptr, batch_size](const boost::system::error_code& ec, size_t bytes_transferred) {
     if (ec) {
       LOG(kError) << "Failed to send message: " << ec.message();
       return this_ptr->DoClose();
     }
-    assert(bytes_transferred == this_ptr->send_queue_.front().size_buffer.size() +
-                                this_ptr->send_queue_.front().data.size());
+    assert(bytes_transferred == batch_size);
     static_cast<void>(bytes_transferred);
+    static_cast<void>(batch_size);
 
-    this_ptr->send_queue_.pop_front();
+    for (; this_ptr->sending_count_ != 0; --this_ptr->sending_count_) {
+      this_ptr->buffer_pool_.Release(std::move(this_ptr->send_queue_.front().data));
+      this_ptr->send_queue_.pop_front();
+    }
     if (!this_ptr->send_queue_.empty())
       this_ptr->DoSend();
   }));
@@ -29,18 +29,36 @@
 #include <vector>
 
 #include "boost/asio/buffer.hpp"
+#include "boost/asio/generic/stream_protocol.hpp"
 #include "boost/asio/io_service.hpp"
-#include "boost/asio/ip/tcp.hpp"
+#include "boost/asio/strand.hpp"
+#include "boost/filesystem/path.hpp"
 
 #include "maidsafe/common/asio_service.h"
 #include "maidsafe/common/error.h"
 
+#include "maidsafe/vault_manager/buffer_pool.h"
 #include "maidsafe/vault_manager/config.h"
 
 namespace maidsafe {
 
 namespace vault_manager {
 
+// Despite the name, the underlying socket may be either a loopback TCP socket or (other than on
+// Windows) a Unix domain stream socket.  The message framing is the same for both.
+//
+// All operations on the socket and the send queue are serialised through a per-connection strand,
+// so the connection is safe to use with a multi-threaded AsioService.  Received messages are also
+// dispatched through the strand, i.e. a single connection's messages are handled one at a time and
+// in order, while different connections' messages may be handled concurrently.
+//
+// Message buffers are drawn from and returned to a per-connection BufferPool: received messages
+// are only lent to the MessageReceivedFunctor for the duration of the call, and the buffers of sent
+// messages are recycled once written.  Each pool holds at most kMaxPooledBytesPerConnection, so an
+// idle connection doesn't pin the buffers of the largest messages it has handled.
+//
+// All messages queued for sending are written together in a single scatter-gather write, up to the
+// limits set via 'SetSendBatchLimits'.
 class TcpConnection : public std::enable_shared_from_this<TcpConnection> {
  public:
   typedef uint32_t DataSize;
@@ -49,29 +67,76 @@ class TcpConnection : public std::enable_shared_from_this<TcpConnection> {
   static TcpConnectionPtr MakeShared(AsioService &asio_service);
   // Used to attempt to connect to 'remote_port' on loopback address.
   static TcpConnectionPtr MakeShared(AsioService &asio_service, uint16_t remote_port);
+#ifndef MAIDSAFE_WIN32
+  // Used to attempt to connect to a Unix domain socket bound to 'socket_path'.
+  static TcpConnectionPtr MakeShared(AsioService &asio_service,
+                                     const boost::filesystem::path& socket_path);
+  // Takes ownership of 'native_socket', an already-connected Unix domain stream socket (e.g. one
+  // end of a socketpair).
+  static TcpConnectionPtr MakeSharedFromNativeSocket(AsioService &asio_service, int native_socket);
+#endif
 
   void Start(MessageReceivedFunctor on_message_received,
              ConnectionClosedFunctor on_connection_closed);
 
   void Close();
 
+  // While paused, received messages aren't passed to the MessageReceivedFunctor.  At most one
+  // further message is read and held back until resumed; later ones are left unread in the socket.
+  // Pausing from within the MessageReceivedFunctor takes effect before the next message is passed.
+  void PauseReceiving();
+  void ResumeReceiving();
+
   void Send(std::string data);
 
-  boost::asio::ip::tcp::socket& Socket() { return socket_; }
+  boost::asio::generic::stream_protocol::socket& Socket() { return socket_; }
 
   static size_t MaxMessageSize() { return 1024 * 1024; }  // bytes
 
+  // Lowers (or restores) the size limit for incoming messages from MaxMessageSize().  If the peer
+  // sends a larger message, the connection is closed.
+  void SetMaxMessageSize(size_t max_message_size);
+
+  // The credentials of the peer process, as reported by the OS.  Only available for Unix domain
+  // sockets, and 'process_id' is only set on Linux (it's 0 otherwise).
+  struct PeerCredentials {
+    PeerCredentials() : valid(false), process_id(0), user_id(0) {}
+    bool valid;
+    uint64_t process_id;
+    uint32_t user_id;
+  };
+  // Must be called before Start or from the MessageReceivedFunctor.
+  PeerCredentials GetPeerCredentials();
+
+  BufferPool::Stats BufferPoolStats() const { return buffer_pool_.GetStats(); }
+
+  // Limits the number of queued messages (and their total size) written in a single write.  At
+  // least one message is always written, regardless of 'max_bytes'.
+  void SetSendBatchLimits(size_t max_bytes, size_t max_messages);
+
+  struct SendStats {
+    SendStats() : write_count(0), message_count(0) {}
+    uint64_t write_count;
+    uint64_t message_count;
+  };
+  SendStats GetSendStats() const;
+
  private:
   explicit TcpConnection(AsioService &asio_service);
   TcpConnection(AsioService &asio_service, uint16_t remote_port);
+#ifndef MAIDSAFE_WIN32
+  TcpConnection(AsioService &asio_service, const boost::filesystem::path& socket_path);
+#endif
 
   TcpConnection(const TcpConnection&) = delete;
   TcpConnection(TcpConnection&&) = delete;
   TcpConnection& operator=(TcpConnection) = delete;
 
+  // 'data_buffer' is a std::string so that it can be passed directly to the message handler,
+  // avoiding any copy of the message body.
   struct ReceivingMessage {
     std::array<unsigned char, 4> size_buffer;
-    std::vector<unsigned char> data_buffer;
+    std::string data_buffer;
   };
 
   struct SendingMessage {
@@ -83,17 +148,27 @@ class TcpConnection : public std::enable_shared_from_this<TcpConnection> {
 
   void ReadSize();
   void ReadData();
+  void DeliverMessage(std::string data);
 
+  void QueueForSending(SendingMessage& message);
   void DoSend();
   SendingMessage EncodeData(std::string data) const;
 
   boost::asio::io_service& io_service_;
+  boost::asio::io_service::strand strand_;
   std::once_flag start_flag_, socket_close_flag_;
-  boost::asio::ip::tcp::socket socket_;
+  boost::asio::generic::stream_protocol::socket socket_;
   MessageReceivedFunctor on_message_received_;
   ConnectionClosedFunctor on_connection_closed_;
+  BufferPool buffer_pool_;
   ReceivingMessage receiving_message_;
+  bool receiving_paused_, holding_message_;
+  std::string held_message_;
   std::deque<SendingMessage> send_queue_;
+  std::vector<boost::asio::const_buffer> send_buffers_;
+  size_t max_message_size_, sending_count_, max_send_batch_bytes_, max_send_batch_messages_;
+  mutable std::mutex send_stats_mutex_;
+  SendStats send_stats_;
 };
 
 }  // namespace vault_manager
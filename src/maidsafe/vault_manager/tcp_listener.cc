@@ -18,9 +18,27 @@
 
 #include "maidsafe/vault_manager/tcp_listener.h"
 
+#include <cerrno>
 #include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <future>
 #include <limits>
 
+#ifndef MAIDSAFE_WIN32
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "boost/asio/ip/tcp.hpp"
+#ifndef MAIDSAFE_WIN32
+#include "boost/asio/local/stream_protocol.hpp"
+#include "boost/filesystem/operations.hpp"
+#endif
+
 #include "maidsafe/common/error.h"
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/on_scope_exit.h"
@@ -28,6 +46,7 @@
 #include "maidsafe/vault_manager/tcp_connection.h"
 
 namespace asio = boost::asio;
+namespace fs = boost::filesystem;
 
 namespace maidsafe {
 
@@ -35,14 +54,14 @@ namespace vault_manager {
 
 TcpListener::TcpListener(AsioService &asio_service, NewConnectionFunctor on_new_connection)
     : asio_service_(asio_service),
-      stop_listening_flag_(),
+      strand_(asio_service_.service()),
       on_new_connection_(on_new_connection),
-      acceptor_(asio_service_.service()) {
-  if (asio_service.ThreadCount() != 1U) {
-    LOG(kError) << "This must be a single-threaded io_service, or an asio strand will be required.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
-  }
-}
+      acceptor_(asio_service_.service()),
+      local_socket_path_(),
+      stopped_(false),
+      released_(false),
+      paused_(false),
+      accept_pending_(false) {}
 
 TcpListenerPtr TcpListener::MakeShared(AsioService &asio_service,
                                        NewConnectionFunctor on_new_connection, Port desired_port) {
@@ -51,8 +70,40 @@ TcpListenerPtr TcpListener::MakeShared(AsioService &asio_service,
   return listener;
 }
 
+#ifndef MAIDSAFE_WIN32
+TcpListenerPtr TcpListener::MakeShared(AsioService &asio_service,
+                                       NewConnectionFunctor on_new_connection,
+                                       const fs::path& socket_path) {
+  TcpListenerPtr listener{ new TcpListener{ asio_service, on_new_connection } };
+  listener->StartListening(socket_path);
+  return listener;
+}
+
+TcpListenerPtr TcpListener::MakeSharedFromNativeSocket(AsioService &asio_service,
+                                                       NewConnectionFunctor on_new_connection,
+                                                       int native_socket) {
+  TcpListenerPtr listener{ new TcpListener{ asio_service, on_new_connection } };
+  listener->StartListening(native_socket);
+  return listener;
+}
+#endif
+
 Port TcpListener::ListeningPort() const {
-  return acceptor_.local_endpoint().port();
+  // The acceptor's protocol is generic, so the endpoint is only reinterpreted as a TCP one if it is
+  // one (i.e. not a Unix domain socket).
+  boost::system::error_code ec;
+  const asio::generic::stream_protocol::endpoint kEndpoint{ acceptor_.local_endpoint(ec) };
+  const int kFamily{ kEndpoint.protocol().family() };
+  if (ec || (kFamily != asio::ip::tcp::v6().family() && kFamily != asio::ip::tcp::v4().family()))
+    return 0;
+  asio::ip::tcp::endpoint tcp_endpoint;
+  std::memcpy(tcp_endpoint.data(), kEndpoint.data(), kEndpoint.size());
+  tcp_endpoint.resize(kEndpoint.size());
+  return tcp_endpoint.port();
+}
+
+fs::path TcpListener::LocalSocketPath() const {
+  return local_socket_path_;
 }
 
 void TcpListener::StartListening(Port desired_port) {
@@ -77,20 +128,20 @@ void TcpListener::StartListening(Port desired_port) {
 
 void TcpListener::DoStartListening(Port port) {
   // Try IPv6 first.
-  asio::ip::tcp::endpoint endpoint{ asio::ip::address_v6::loopback(), port };
+  asio::ip::tcp::endpoint tcp_endpoint{ asio::ip::address_v6::loopback(), port };
   on_scope_exit cleanup_on_error([&] {
     boost::system::error_code ec;
     acceptor_.close(ec);
   });
 
   try {
-    acceptor_.open(endpoint.protocol());
+    acceptor_.open(tcp_endpoint.protocol());
   }
   catch (const boost::system::system_error& error) {
     if (error.code() == asio::error::make_error_code(asio::error::address_family_not_supported)) {
       // Try IPv4 now.
-      endpoint = asio::ip::tcp::endpoint{ asio::ip::address_v4::loopback(), port };
-      acceptor_.open(endpoint.protocol());
+      tcp_endpoint = asio::ip::tcp::endpoint{ asio::ip::address_v4::loopback(), port };
+      acceptor_.open(tcp_endpoint.protocol());
     } else {
       throw;
     }
@@ -105,24 +156,98 @@ void TcpListener::DoStartListening(Port port) {
   // http://www.unixguide.net/network/socketfaq/4.5.shtml
   // http://old.nabble.com/Port-allocation-problem-on-windows-(incl.-patch)-td28241079.html
 #ifndef MAIDSAFE_WIN32
-  acceptor_.set_option(asio::ip::tcp::acceptor::reuse_address(true));
+  acceptor_.set_option(asio::socket_base::reuse_address(true));
 #endif
-  acceptor_.bind(endpoint);
+  acceptor_.bind(asio::generic::stream_protocol::endpoint{ tcp_endpoint });
   acceptor_.listen(asio::socket_base::max_connections);
+  DoAccept();
+  cleanup_on_error.Release();
+}
+
+#ifndef MAIDSAFE_WIN32
+void TcpListener::StartListening(const fs::path& socket_path) {
+  boost::system::error_code ec;
+  if (fs::exists(socket_path, ec)) {
+    // If a live listener owns the file, we mustn't steal it; otherwise it's left over from a
+    // process which didn't exit cleanly and can be replaced.
+    try {
+      TcpConnection::MakeShared(asio_service_, socket_path)->Close();
+      LOG(kError) << "Another process is already listening on " << socket_path;
+      BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::failed_to_listen));
+    }
+    catch (const maidsafe_error& error) {
+      if (error.code() != make_error_code(VaultManagerErrors::failed_to_connect))
+        throw;
+    }
+    fs::remove(socket_path, ec);
+  }
+
+  on_scope_exit cleanup_on_error([&] {
+    acceptor_.close(ec);
+    fs::remove(socket_path, ec);
+  });
+  try {
+    asio::local::stream_protocol::endpoint endpoint{ socket_path.string() };
+    acceptor_.open(endpoint.protocol());
+    acceptor_.bind(endpoint);
+    // Only processes run by this user may connect; others (e.g. clients run by other users) fall
+    // back to TCP.  Nothing can connect before 'listen', so there's no window with wider access.
+    fs::permissions(socket_path, fs::owner_read | fs::owner_write);
+    acceptor_.listen(asio::socket_base::max_connections);
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed to start listening on " << socket_path << ": "
+                << boost::diagnostic_information(e);
+    BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::failed_to_listen));
+  }
+  local_socket_path_ = socket_path;
+  DoAccept();
+  cleanup_on_error.Release();
+}
 
+void TcpListener::StartListening(int native_socket) {
+  sockaddr_storage address;
+  socklen_t address_length{ sizeof(address) };
+  std::memset(&address, 0, sizeof(address));
+  if (getsockname(native_socket, reinterpret_cast<sockaddr*>(&address), &address_length) != 0) {
+    LOG(kError) << "Failed to adopt listening socket: " << std::strerror(errno);
+    close(native_socket);
+    BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::failed_to_listen));
+  }
+  const int kFamily{ address.ss_family };
+  boost::system::error_code ec;
+  acceptor_.assign(asio::generic::stream_protocol{ kFamily, kFamily == AF_UNIX ? 0 : IPPROTO_TCP },
+                   native_socket, ec);
+  if (ec) {
+    LOG(kError) << "Failed to adopt listening socket: " << ec.message();
+    close(native_socket);
+    BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::failed_to_listen));
+  }
+  if (kFamily == AF_UNIX)
+    local_socket_path_ = reinterpret_cast<const sockaddr_un*>(&address)->sun_path;
+  DoAccept();
+}
+#endif
+
+void TcpListener::DoAccept() {
+  if (paused_)
+    return;
+  accept_pending_ = true;
   // The connection object is kept alive in the acceptor handler until HandleAccept() is called.
   TcpConnectionPtr connection{ TcpConnection::MakeShared(asio_service_) };
   TcpListenerPtr this_ptr{ shared_from_this() };
-  acceptor_.async_accept(connection->Socket(), asio_service_.service().wrap(
+  acceptor_.async_accept(connection->Socket(), strand_.wrap(
       [this_ptr, connection](const boost::system::error_code& error) {
         this_ptr->HandleAccept(connection, error);
       }));
-
-  cleanup_on_error.Release();
 }
 
 void TcpListener::HandleAccept(TcpConnectionPtr accepted_connection,
                                const boost::system::error_code& ec) {
+  // The acceptor was closed, and may since have been reopened by Reclaim with a new accept pending.
+  if (ec == asio::error::operation_aborted)
+    return;
+  accept_pending_ = false;
   if (!acceptor_.is_open() || asio_service_.service().stopped())
     return;
 
@@ -131,29 +256,91 @@ void TcpListener::HandleAccept(TcpConnectionPtr accepted_connection,
   else
     on_new_connection_(accepted_connection);
 
-  // The connection object is kept alive in the acceptor handler until HandleAccept() is called.
-  TcpConnectionPtr connection{ TcpConnection::MakeShared(asio_service_) };
-  TcpListenerPtr this_ptr{ shared_from_this() };
-  acceptor_.async_accept(connection->Socket(), asio_service_.service().wrap(
-      [this_ptr, connection](const boost::system::error_code& error) {
-        this_ptr->HandleAccept(connection, error);
-      }));
+  DoAccept();
 }
 
 void TcpListener::StopListening() {
-  asio_service_.service().post([this] { DoStopListening(); });
+  TcpListenerPtr this_ptr{ shared_from_this() };
+  strand_.post([this_ptr] { this_ptr->DoStopListening(); });
 }
 
-void TcpListener::DoStopListening() {
-  std::call_once(stop_listening_flag_, [this] {
-    boost::system::error_code ec;
-    if (acceptor_.is_open())
-      acceptor_.close(ec);
-    if (ec.value() != 0)
-      LOG(kError) << "Acceptor close error: " << ec.message();
+void TcpListener::PauseAccepting() {
+  TcpListenerPtr this_ptr{ shared_from_this() };
+  strand_.dispatch([this_ptr] { this_ptr->paused_ = true; });
+}
+
+void TcpListener::ResumeAccepting() {
+  TcpListenerPtr this_ptr{ shared_from_this() };
+  strand_.dispatch([this_ptr] {
+    if (!this_ptr->paused_)
+      return;
+    this_ptr->paused_ = false;
+    if (this_ptr->acceptor_.is_open() && !this_ptr->accept_pending_ &&
+        !this_ptr->asio_service_.service().stopped()) {
+      this_ptr->DoAccept();
+    }
   });
 }
 
+#ifndef MAIDSAFE_WIN32
+int TcpListener::Release() {
+  std::promise<int> promise;
+  TcpListenerPtr this_ptr{ shared_from_this() };
+  strand_.post([this_ptr, &promise] {
+    int native_socket{ -1 };
+    if (!this_ptr->stopped_ && this_ptr->acceptor_.is_open()) {
+      native_socket = fcntl(this_ptr->acceptor_.native_handle(), F_DUPFD_CLOEXEC, 0);
+      if (native_socket == -1)
+        LOG(kError) << "Failed to duplicate listening socket: " << std::strerror(errno);
+      // The duplicate keeps the socket listening once the acceptor has been closed.
+      boost::system::error_code ec;
+      this_ptr->acceptor_.close(ec);
+      this_ptr->released_ = native_socket != -1;
+    }
+    this_ptr->stopped_ = true;
+    promise.set_value(native_socket);
+  });
+  return promise.get_future().get();
+}
+
+void TcpListener::Reclaim(int native_socket) {
+  std::promise<void> promise;
+  TcpListenerPtr this_ptr{ shared_from_this() };
+  strand_.post([this_ptr, native_socket, &promise] {
+    try {
+      if (!this_ptr->released_) {
+        LOG(kError) << "Can't reclaim listening socket: it wasn't released.";
+        close(native_socket);
+        BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::failed_to_listen));
+      }
+      this_ptr->accept_pending_ = false;
+      this_ptr->StartListening(native_socket);
+      this_ptr->stopped_ = this_ptr->released_ = false;
+      promise.set_value();
+    }
+    catch (...) {
+      promise.set_exception(std::current_exception());
+    }
+  });
+  promise.get_future().get();
+}
+#endif
+
+void TcpListener::DoStopListening() {
+  if (stopped_)
+    return;
+  stopped_ = true;
+  boost::system::error_code ec;
+  if (acceptor_.is_open())
+    acceptor_.close(ec);
+  if (ec.value() != 0)
+    LOG(kError) << "Acceptor close error: " << ec.message();
+#ifndef MAIDSAFE_WIN32
+  if (!local_socket_path_.empty())
+    fs::remove(local_socket_path_, ec);
+#endif
+}
+
 }  // namespace vault_manager
 
 }  // namespace maidsafe
@@ -21,9 +21,11 @@
 
 #include <functional>
 #include <memory>
-#include <mutex>
 
-#include "boost/asio/ip/tcp.hpp"
+#include "boost/asio/basic_socket_acceptor.hpp"
+#include "boost/asio/generic/stream_protocol.hpp"
+#include "boost/asio/strand.hpp"
+#include "boost/filesystem/path.hpp"
 
 #include "maidsafe/common/asio_service.h"
 
@@ -33,12 +35,44 @@ namespace maidsafe {
 
 namespace vault_manager {
 
+// Despite the name, the listener may accept either loopback TCP connections or (other than on
+// Windows) connections to a Unix domain socket.
 class TcpListener : public std::enable_shared_from_this<TcpListener> {
  public:
   static TcpListenerPtr MakeShared(AsioService &asio_service,
                                    NewConnectionFunctor on_new_connection, Port desired_port);
+#ifndef MAIDSAFE_WIN32
+  // Binds to 'socket_path', replacing a stale socket file if one exists.  Throws if another
+  // process is already listening there.  The socket file is removed when listening stops.
+  static TcpListenerPtr MakeShared(AsioService &asio_service,
+                                   NewConnectionFunctor on_new_connection,
+                                   const boost::filesystem::path& socket_path);
+  // Takes ownership of 'native_socket', which must already be listening (e.g. having been handed
+  // over by another process).
+  static TcpListenerPtr MakeSharedFromNativeSocket(AsioService &asio_service,
+                                                   NewConnectionFunctor on_new_connection,
+                                                   int native_socket);
+#endif
+  // Returns 0 if listening on a Unix domain socket.
   Port ListeningPort() const;
+  // Returns an empty path if listening on a TCP port.
+  boost::filesystem::path LocalSocketPath() const;
   void StopListening();
+  // While paused, incoming connections wait in the listen backlog rather than being accepted.  A
+  // connection already being accepted is still passed to the NewConnectionFunctor.
+  void PauseAccepting();
+  void ResumeAccepting();
+#ifndef MAIDSAFE_WIN32
+  // Stops accepting and returns a duplicate of the listening socket, which keeps queueing incoming
+  // connections for whichever process it's passed to.  Unlike StopListening, leaves the socket file
+  // in place.  Returns -1 if already stopped.  Blocks until the strand has run, so mustn't be
+  // called from a handler on 'asio_service'.
+  int Release();
+  // Undoes Release (e.g. if the socket couldn't be handed over after all), taking ownership of
+  // 'native_socket' as returned by it.  Throws, having closed 'native_socket', if not released.
+  // Blocks as Release does.
+  void Reclaim(int native_socket);
+#endif
 
  private:
   TcpListener(AsioService &asio_service, NewConnectionFunctor on_new_connection);
@@ -49,13 +83,22 @@ class TcpListener : public std::enable_shared_from_this<TcpListener> {
 
   void StartListening(Port desired_port);
   void DoStartListening(Port port);
+#ifndef MAIDSAFE_WIN32
+  void StartListening(const boost::filesystem::path& socket_path);
+  void StartListening(int native_socket);
+#endif
+  void DoAccept();
   void HandleAccept(TcpConnectionPtr accepted_connection, const boost::system::error_code& ec);
   void DoStopListening();
 
   AsioService& asio_service_;
-  std::once_flag stop_listening_flag_;
+  boost::asio::io_service::strand strand_;
   NewConnectionFunctor on_new_connection_;
-  boost::asio::ip::tcp::acceptor acceptor_;
+  boost::asio::basic_socket_acceptor<boost::asio::generic::stream_protocol> acceptor_;
+  boost::filesystem::path local_socket_path_;
+  // Only accessed on 'strand_'.  'stopped_' is set by StopListening and Release, 'released_' only
+  // by Release.
+  bool stopped_, released_, paused_, accept_pending_;
 };
 
 }  // namespace vault_manager
@@ -0,0 +1,76 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/buffer_pool.h"
+
+#include <string>
+
+#include "maidsafe/common/test.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+TEST(BufferPoolTest, BEH_AcquireAndRelease) {
+  BufferPool pool{ 1024 * 1024, 1024 * 1024 };
+  std::string buffer{ pool.Acquire(1000) };
+  EXPECT_EQ(1000U, buffer.size());
+  EXPECT_EQ(0U, pool.GetStats().hits);
+  EXPECT_EQ(1U, pool.GetStats().misses);
+
+  const char* const kData{ buffer.data() };
+  pool.Release(std::move(buffer));
+  // Any size in the same size class should reuse the released buffer.
+  buffer = pool.Acquire(600);
+  EXPECT_EQ(600U, buffer.size());
+  EXPECT_EQ(kData, buffer.data());
+  EXPECT_EQ(1U, pool.GetStats().hits);
+  EXPECT_EQ(1U, pool.GetStats().misses);
+
+  // A larger size class can't be satisfied by the smaller pooled buffer.
+  pool.Release(std::move(buffer));
+  buffer = pool.Acquire(100000);
+  EXPECT_EQ(100000U, buffer.size());
+  EXPECT_EQ(1U, pool.GetStats().hits);
+  EXPECT_EQ(2U, pool.GetStats().misses);
+  EXPECT_EQ(0U, pool.GetStats().discards);
+}
+
+TEST(BufferPoolTest, BEH_PoolLimit) {
+  const size_t kMaxPooledBytes{ 4096 };
+  BufferPool pool{ 1024 * 1024, kMaxPooledBytes };
+  pool.Release(pool.Acquire(kMaxPooledBytes * 2));
+  EXPECT_EQ(1U, pool.GetStats().discards);
+
+  // Buffers smaller than the minimum size class aren't worth pooling and are silently dropped.
+  pool.Release(std::string{});
+  EXPECT_EQ(1U, pool.GetStats().discards);
+
+  pool.Release(pool.Acquire(kMaxPooledBytes / 2));
+  pool.Release(pool.Acquire(kMaxPooledBytes / 2));
+  EXPECT_EQ(1U, pool.GetStats().discards);
+  EXPECT_EQ(1U, pool.GetStats().hits);
+}
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
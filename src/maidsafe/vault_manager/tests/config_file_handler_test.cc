@@ -0,0 +1,84 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/config_file_handler.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/passport/passport.h"
+
+#include "maidsafe/vault_manager/utils.h"
+#include "maidsafe/vault_manager/vault_info.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+TEST(ConfigFileHandlerTest, BEH_WriteAndReadVaults) {
+  std::shared_ptr<fs::path> test_dir{
+      maidsafe::test::CreateTestPath("MaidSafe_TestConfigFileHandler") };
+  const fs::path kConfigFilePath{ *test_dir / "config" };
+  const int kVaultCount(17);  // Not a multiple of the number of decrypting workers.
+
+  std::vector<VaultInfo> vaults;
+  for (int i(0); i < kVaultCount; ++i) {
+    VaultInfo vault_info;
+    vault_info.pmid_and_signer =
+        std::make_shared<passport::PmidAndSigner>(passport::CreatePmidAndSigner());
+    vault_info.vault_dir = *test_dir / ("vault_" + std::to_string(i));
+    vault_info.max_disk_usage = DiskUsage{ static_cast<uint64_t>(1000 + i) };
+    vault_info.label = GenerateLabel();
+    vaults.push_back(vault_info);
+  }
+
+  {
+    ConfigFileHandler config_file_handler{ kConfigFilePath };
+    EXPECT_TRUE(config_file_handler.ReadConfigFile().empty());
+    config_file_handler.WriteConfigFile(vaults);
+  }
+
+  ConfigFileHandler config_file_handler{ kConfigFilePath };
+  std::vector<VaultInfo> read_vaults{ config_file_handler.ReadConfigFile() };
+  ASSERT_EQ(vaults.size(), read_vaults.size());
+  for (int i(0); i < kVaultCount; ++i) {
+    EXPECT_EQ(vaults[i].label, read_vaults[i].label);
+    EXPECT_EQ(vaults[i].vault_dir, read_vaults[i].vault_dir);
+    EXPECT_EQ(vaults[i].max_disk_usage, read_vaults[i].max_disk_usage);
+    ASSERT_TRUE(read_vaults[i].pmid_and_signer != nullptr);
+    EXPECT_EQ(vaults[i].pmid_and_signer->first.name(),
+              read_vaults[i].pmid_and_signer->first.name());
+    EXPECT_EQ(vaults[i].pmid_and_signer->second.name(),
+              read_vaults[i].pmid_and_signer->second.name());
+  }
+}
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
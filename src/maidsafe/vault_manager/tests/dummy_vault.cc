@@ -19,11 +19,17 @@
 #include <chrono>
 #include <cstdint>
 #include <future>
+#include <memory>
+#include <string>
+
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
 
 #include "maidsafe/common/error.h"
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/utils.h"
 
+#include "maidsafe/vault_manager/config.h"
 #include "maidsafe/vault_manager/vault_config.h"
 #include "maidsafe/vault_manager/vault_interface.h"
 
@@ -35,9 +41,17 @@ int main(int argc, char* argv[]) {
     auto unuseds(maidsafe::log::Logging::Instance().Initialise(argc, argv));
     if (unuseds.size() != 2U)
       BOOST_THROW_EXCEPTION(maidsafe::MakeError(maidsafe::CommonErrors::invalid_parameter));
-    uint16_t port{ static_cast<uint16_t>(std::stoi(std::string{ &unuseds[1][0] })) };
-    maidsafe::vault_manager::VaultInterface vault_interface{ port };
+    std::unique_ptr<maidsafe::vault_manager::VaultInterface> vault_interface_ptr{
+        maidsafe::vault_manager::VaultInterface::MakeUnique(std::string{ &unuseds[1][0] }) };
+    auto& vault_interface(*vault_interface_ptr);
     connected_to_vault_manager = true;
+    // There's no chunkstore to move, so just create the new location.
+    vault_interface.SetMoveChunkstoreFunctor(
+        [](const boost::filesystem::path& new_vault_dir, maidsafe::DiskUsage,
+           maidsafe::vault_manager::VaultInterface::MoveProgressFunctor report_progress) {
+          boost::filesystem::create_directories(new_vault_dir);
+          report_progress(0, 0);
+        });
 
     std::future<void> worker;
     VaultConfig config{ vault_interface.GetConfiguration() };
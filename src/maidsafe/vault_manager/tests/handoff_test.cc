@@ -0,0 +1,198 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/handoff.h"
+
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef MAIDSAFE_LINUX
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/passport/passport.h"
+
+#include "maidsafe/vault_manager/utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+#ifdef MAIDSAFE_LINUX
+namespace {
+
+// Any open descriptor will do in place of a listening socket or pidfd.
+int OpenDescriptor() {
+  int descriptor{ open("/dev/null", O_RDONLY | O_CLOEXEC) };
+  EXPECT_NE(-1, descriptor);
+  return descriptor;
+}
+
+ino_t Inode(int descriptor) {
+  struct stat status;
+  EXPECT_EQ(0, fstat(descriptor, &status));
+  return status.st_ino;
+}
+
+VaultInfo MakeVaultInfo(std::shared_ptr<passport::PmidAndSigner> pmid_and_signer, int index) {
+  VaultInfo vault_info;
+  vault_info.pmid_and_signer = pmid_and_signer;
+  vault_info.vault_dir = fs::path{ "vault_" + std::to_string(index) };
+  vault_info.max_disk_usage = DiskUsage{ static_cast<uint64_t>(1000 + index) };
+  vault_info.label = GenerateLabel();
+  return vault_info;
+}
+
+// Sends 'handoff' over a socketpair, returning what's received at the other end.
+Handoff SendAndReceive(const Handoff& handoff) {
+  int sockets[2];
+  EXPECT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets));
+  auto sent(std::async(std::launch::async, [&] { SendHandoff(sockets[0], handoff); }));
+  Handoff received{ ReceiveHandoff(sockets[1]) };
+  sent.get();
+  close(sockets[0]);
+  close(sockets[1]);
+  return received;
+}
+
+}  // unnamed namespace
+
+TEST(HandoffTest, BEH_SendAndReceive) {
+  auto pmid_and_signer(
+      std::make_shared<passport::PmidAndSigner>(passport::CreatePmidAndSigner()));
+  Handoff handoff;
+  handoff.listener = OpenDescriptor();
+  handoff.handoff_listener = OpenDescriptor();
+  HandedOffVault running;
+  running.info = MakeVaultInfo(pmid_and_signer, 0);
+  running.process_id = 1234;
+  running.pidfd = OpenDescriptor();
+  running.executable_path = fs::path{ "/path/to/vault" };
+  running.stopping = true;
+  handoff.vaults.push_back(running);
+  HandedOffVault stopped;
+  stopped.info = MakeVaultInfo(pmid_and_signer, 1);
+  handoff.vaults.push_back(stopped);
+
+  Handoff received{ SendAndReceive(handoff) };
+  EXPECT_EQ(Inode(handoff.listener), Inode(received.listener));
+  EXPECT_EQ(-1, received.local_listener);
+  EXPECT_EQ(Inode(handoff.handoff_listener), Inode(received.handoff_listener));
+  // Received descriptors are new ones, close-on-exec like all of ours.
+  EXPECT_NE(handoff.listener, received.listener);
+  EXPECT_EQ(FD_CLOEXEC, fcntl(received.listener, F_GETFD) & FD_CLOEXEC);
+
+  ASSERT_EQ(2U, received.vaults.size());
+  const HandedOffVault& received_running(received.vaults[0]);
+  EXPECT_EQ(running.info.label, received_running.info.label);
+  EXPECT_EQ(running.info.vault_dir, received_running.info.vault_dir);
+  EXPECT_EQ(running.info.max_disk_usage, received_running.info.max_disk_usage);
+  EXPECT_EQ(pmid_and_signer->first.name(), received_running.info.pmid_and_signer->first.name());
+  EXPECT_EQ(running.process_id, received_running.process_id);
+  EXPECT_EQ(Inode(running.pidfd), Inode(received_running.pidfd));
+  EXPECT_EQ(running.executable_path, received_running.executable_path);
+  EXPECT_TRUE(received_running.stopping);
+  EXPECT_FALSE(received_running.restarting);
+
+  const HandedOffVault& received_stopped(received.vaults[1]);
+  EXPECT_EQ(stopped.info.label, received_stopped.info.label);
+  EXPECT_EQ(0U, received_stopped.process_id);
+  EXPECT_EQ(-1, received_stopped.pidfd);
+}
+
+TEST(HandoffTest, BEH_ManyVaults) {
+  // More than can be passed in a single message.
+  const int kVaultCount(300);
+  auto pmid_and_signer(
+      std::make_shared<passport::PmidAndSigner>(passport::CreatePmidAndSigner()));
+  Handoff handoff;
+  for (int i(0); i < kVaultCount; ++i) {
+    HandedOffVault vault;
+    vault.info = MakeVaultInfo(pmid_and_signer, i);
+    vault.process_id = static_cast<ProcessId>(i + 1);
+    vault.pidfd = OpenDescriptor();
+    handoff.vaults.push_back(std::move(vault));
+  }
+
+  Handoff received{ SendAndReceive(handoff) };
+  ASSERT_EQ(static_cast<size_t>(kVaultCount), received.vaults.size());
+  for (int i(0); i < kVaultCount; ++i) {
+    EXPECT_EQ(handoff.vaults[i].info.label, received.vaults[i].info.label);
+    EXPECT_EQ(handoff.vaults[i].process_id, received.vaults[i].process_id);
+    EXPECT_NE(-1, fcntl(received.vaults[i].pidfd, F_GETFD));
+  }
+}
+
+TEST(HandoffTest, BEH_ReceiverGone) {
+  int sockets[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets));
+  close(sockets[1]);
+  Handoff handoff;
+  handoff.listener = OpenDescriptor();
+  EXPECT_THROW(SendHandoff(sockets[0], handoff), maidsafe_error);
+  // Without an acknowledgement, the descriptors are still ours.
+  EXPECT_NE(-1, fcntl(handoff.listener, F_GETFD));
+  close(sockets[0]);
+}
+
+TEST(HandoffTest, BEH_NotAcknowledged) {
+  int sockets[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets));
+  Handoff handoff;
+  handoff.listener = OpenDescriptor();
+  // The receiver takes the handoff but closes without acknowledging it.
+  auto sent(std::async(std::launch::async, [&] { SendHandoff(sockets[0], handoff); }));
+  char byte;
+  EXPECT_LT(0, recv(sockets[1], &byte, 1, 0));
+  close(sockets[1]);
+  EXPECT_THROW(sent.get(), maidsafe_error);
+  close(sockets[0]);
+}
+
+TEST(HandoffTest, BEH_SenderGone) {
+  int sockets[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets));
+  close(sockets[0]);
+  EXPECT_THROW(ReceiveHandoff(sockets[1]), maidsafe_error);
+  close(sockets[1]);
+}
+#endif
+
+TEST(HandoffTest, BEH_NoPredecessor) {
+  std::shared_ptr<fs::path> test_dir{ maidsafe::test::CreateTestPath("MaidSafe_TestHandoff") };
+  EXPECT_FALSE(ReceiveHandoff(*test_dir / "no_such.sock"));
+}
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,192 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+#include "maidsafe/vault_manager/new_connections.h"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#ifndef MAIDSAFE_WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/on_scope_exit.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/vault_manager/tcp_connection.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+#ifndef MAIDSAFE_WIN32
+namespace {
+
+// Returns the VaultManager's end of a new Unix domain socket pair, whose peer is this process.
+TcpConnectionPtr MakeLocalConnection(AsioService& asio_service, std::vector<int>& peer_ends) {
+  std::array<int, 2> channel;
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, channel.data()) != 0)
+    return nullptr;
+  peer_ends.push_back(channel[1]);
+  return TcpConnection::MakeSharedFromNativeSocket(asio_service, channel[0]);
+}
+
+}  // unnamed namespace
+
+TEST(NewConnectionsTest, BEH_PeerCredentials) {
+  AsioService asio_service(1);
+  std::vector<int> peer_ends;
+  on_scope_exit close_peer_ends{ [&] {
+    for (int peer_end : peer_ends)
+      close(peer_end);
+  } };
+  TcpConnectionPtr connection{ MakeLocalConnection(asio_service, peer_ends) };
+  ASSERT_TRUE(connection != nullptr);
+  TcpConnection::PeerCredentials credentials{ connection->GetPeerCredentials() };
+  EXPECT_TRUE(credentials.valid);
+  EXPECT_EQ(static_cast<uint32_t>(getuid()), credentials.user_id);
+#ifdef MAIDSAFE_LINUX
+  EXPECT_EQ(static_cast<uint64_t>(getpid()), credentials.process_id);
+#endif
+  connection->Close();
+}
+
+TEST(NewConnectionsTest, BEH_PerPeerLimits) {
+  AsioService asio_service(1);
+  AdmissionPolicy policy;
+  policy.max_pending_per_process = 2;
+  policy.max_pending_per_user = 3;
+  policy.exempt_own_user = false;
+  auto new_connections(NewConnections::MakeShared(asio_service.service(), policy));
+  std::vector<int> peer_ends;
+  std::vector<TcpConnectionPtr> connections;
+  on_scope_exit cleanup{ [&] {
+    for (auto connection : connections) {
+      new_connections->Remove(connection);
+      connection->Close();
+    }
+    for (int peer_end : peer_ends)
+      close(peer_end);
+  } };
+
+  for (int i(0); i != 3; ++i) {
+    connections.push_back(MakeLocalConnection(asio_service, peer_ends));
+    ASSERT_TRUE(connections.back() != nullptr);
+  }
+#ifdef MAIDSAFE_LINUX
+  // All connections are from this process, so only two are admitted.
+  EXPECT_TRUE(new_connections->Add(connections[0]));
+  EXPECT_TRUE(new_connections->Add(connections[1]));
+  EXPECT_FALSE(new_connections->Add(connections[2]));
+  NewConnections::Stats stats{ new_connections->GetStats() };
+  EXPECT_EQ(2U, stats.admitted);
+  EXPECT_EQ(1U, stats.rejected_per_process);
+  EXPECT_EQ(0U, stats.rejected_per_user);
+  EXPECT_EQ(2U, stats.pending);
+
+  // Once one has identified itself, there's room for another.
+  EXPECT_TRUE(new_connections->Remove(connections[0]));
+  EXPECT_TRUE(new_connections->Add(connections[2]));
+  EXPECT_EQ(2U, new_connections->GetStats().pending);
+#else
+  // The process ID isn't known, so only the per-user limit applies.
+  for (auto connection : connections)
+    EXPECT_TRUE(new_connections->Add(connection));
+  connections.push_back(MakeLocalConnection(asio_service, peer_ends));
+  ASSERT_TRUE(connections.back() != nullptr);
+  EXPECT_FALSE(new_connections->Add(connections.back()));
+  EXPECT_EQ(1U, new_connections->GetStats().rejected_per_user);
+#endif
+}
+
+TEST(NewConnectionsTest, BEH_OwnUserExempt) {
+  AsioService asio_service(1);
+  AdmissionPolicy policy;
+  policy.max_pending_per_user = 1;
+  auto new_connections(NewConnections::MakeShared(asio_service.service(), policy));
+  std::vector<int> peer_ends;
+  std::vector<TcpConnectionPtr> connections;
+  on_scope_exit cleanup{ [&] {
+    for (auto connection : connections) {
+      new_connections->Remove(connection);
+      connection->Close();
+    }
+    for (int peer_end : peer_ends)
+      close(peer_end);
+  } };
+
+  // All connections are from this process's user, so the per-user limit doesn't apply.
+  for (int i(0); i != 3; ++i) {
+    connections.push_back(MakeLocalConnection(asio_service, peer_ends));
+    ASSERT_TRUE(connections.back() != nullptr);
+    EXPECT_TRUE(new_connections->Add(connections.back()));
+  }
+  NewConnections::Stats stats{ new_connections->GetStats() };
+  EXPECT_EQ(3U, stats.admitted);
+  EXPECT_EQ(0U, stats.rejected_per_user);
+}
+
+TEST(NewConnectionsTest, BEH_DeferWhenFull) {
+  AsioService asio_service(1);
+  AdmissionPolicy policy;
+  policy.max_pending = 2;
+  policy.when_full = AdmissionPolicy::WhenFull::kDefer;
+  std::vector<bool> capacity_changes;
+  auto new_connections(NewConnections::MakeShared(asio_service.service(), policy,
+      [&](bool available) { capacity_changes.push_back(available); }));
+  std::vector<int> peer_ends;
+  std::vector<TcpConnectionPtr> connections;
+  on_scope_exit cleanup{ [&] {
+    for (auto connection : connections) {
+      new_connections->Remove(connection);
+      connection->Close();
+    }
+    for (int peer_end : peer_ends)
+      close(peer_end);
+  } };
+
+  for (int i(0); i != 3; ++i) {
+    connections.push_back(MakeLocalConnection(asio_service, peer_ends));
+    ASSERT_TRUE(connections.back() != nullptr);
+  }
+  EXPECT_TRUE(new_connections->Add(connections[0]));
+  EXPECT_TRUE(capacity_changes.empty());
+  EXPECT_TRUE(new_connections->Add(connections[1]));
+  ASSERT_EQ(1U, capacity_changes.size());
+  EXPECT_FALSE(capacity_changes[0]);
+  // A connection accepted before the listeners paused is shed.
+  EXPECT_FALSE(new_connections->Add(connections[2]));
+  EXPECT_EQ(1U, new_connections->GetStats().rejected_full);
+
+  EXPECT_TRUE(new_connections->Remove(connections[1]));
+  ASSERT_EQ(2U, capacity_changes.size());
+  EXPECT_TRUE(capacity_changes[1]);
+  EXPECT_TRUE(new_connections->Add(connections[2]));
+  EXPECT_EQ(3U, capacity_changes.size());
+}
+#endif
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
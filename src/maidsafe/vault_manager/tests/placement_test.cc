@@ -0,0 +1,161 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/placement.h"
+
+#include <memory>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+namespace {
+
+// Two nodes of four CPUs each.
+CpuTopology TwoNodes() {
+  CpuTopology topology;
+  topology.node_cpus.push_back(std::vector<int>{ 0, 1, 2, 3 });
+  topology.node_cpus.push_back(std::vector<int>{ 4, 5, 6, 7 });
+  return topology;
+}
+
+}  // unnamed namespace
+
+TEST(PlacementTest, BEH_ParseCpuList) {
+  EXPECT_EQ((std::vector<int>{ 0, 1, 2, 3, 8, 10, 11 }), ParseCpuList("0-3,8,10-11\n"));
+  EXPECT_TRUE(ParseCpuList("\n").empty());
+  EXPECT_THROW(ParseCpuList("3-1"), common_error);
+  EXPECT_THROW(ParseCpuList("a-b"), common_error);
+}
+
+TEST(PlacementTest, BEH_SparseNodes) {
+  std::shared_ptr<boost::filesystem::path> nodes_dir{
+      maidsafe::test::CreateTestPath("MaidSafe_TestPlacement") };
+  ASSERT_TRUE(WriteFile(*nodes_dir / "online", "0,2\n"));
+  boost::filesystem::create_directories(*nodes_dir / "node0");
+  boost::filesystem::create_directories(*nodes_dir / "node2");
+  ASSERT_TRUE(WriteFile(*nodes_dir / "node0" / "cpulist", "0-1\n"));
+  ASSERT_TRUE(WriteFile(*nodes_dir / "node2" / "cpulist", "2-3\n"));
+
+  CpuTopology topology{ ReadCpuTopology(*nodes_dir) };
+  ASSERT_EQ(3U, topology.node_cpus.size());
+  EXPECT_EQ((std::vector<int>{ 0, 1 }), topology.node_cpus[0]);
+  EXPECT_TRUE(topology.node_cpus[1].empty());
+  EXPECT_EQ((std::vector<int>{ 2, 3 }), topology.node_cpus[2]);
+
+  // Vaults are only placed on the nodes which exist.
+  PlacementPolicy policy;
+  policy.mode = PlacementPolicy::Mode::kRoundRobinNode;
+  PlacementEngine engine{ policy, topology };
+  std::vector<Placement> existing;
+  for (int i(0); i < 2; ++i)
+    existing.push_back(engine.Place(existing));
+  EXPECT_EQ(std::vector<int>{ 0 }, existing[0].numa_nodes);
+  EXPECT_EQ(std::vector<int>{ 2 }, existing[1].numa_nodes);
+  Placement on_missing_node;
+  on_missing_node.numa_nodes = std::vector<int>{ 1 };
+  EXPECT_FALSE(engine.IsValid(on_missing_node));
+
+  // Without the list of online nodes, there's a single node.
+  EXPECT_EQ(1U, ReadCpuTopology(*nodes_dir / "missing").node_cpus.size());
+}
+
+TEST(PlacementTest, BEH_Unpinned) {
+  PlacementPolicy policy;
+  PlacementEngine engine{ policy, TwoNodes() };
+  Placement placement{ engine.Place(std::vector<Placement>{}) };
+  EXPECT_TRUE(placement.cpus.empty());
+  EXPECT_TRUE(placement.numa_nodes.empty());
+
+  policy.reserve_manager_core = true;
+  PlacementEngine reserving_engine{ policy, TwoNodes() };
+  placement = reserving_engine.Place(std::vector<Placement>{});
+  EXPECT_EQ((std::vector<int>{ 1, 2, 3, 4, 5, 6, 7 }), placement.cpus);
+  EXPECT_TRUE(placement.numa_nodes.empty());
+}
+
+TEST(PlacementTest, BEH_RoundRobinNode) {
+  PlacementPolicy policy;
+  policy.mode = PlacementPolicy::Mode::kRoundRobinNode;
+  PlacementEngine engine{ policy, TwoNodes() };
+  std::vector<Placement> existing;
+  for (int i(0); i < 4; ++i)
+    existing.push_back(engine.Place(existing));
+  EXPECT_EQ(std::vector<int>{ 0 }, existing[0].numa_nodes);
+  EXPECT_EQ(std::vector<int>{ 1 }, existing[1].numa_nodes);
+  EXPECT_EQ(std::vector<int>{ 0 }, existing[2].numa_nodes);
+  EXPECT_EQ((std::vector<int>{ 4, 5, 6, 7 }), existing[3].cpus);
+
+  // Filling the gap left by a removed vault.
+  existing.erase(std::begin(existing) + 1);
+  EXPECT_EQ(std::vector<int>{ 1 }, engine.Place(existing).numa_nodes);
+}
+
+TEST(PlacementTest, BEH_DedicatedCores) {
+  PlacementPolicy policy;
+  policy.mode = PlacementPolicy::Mode::kDedicatedCores;
+  policy.cores_per_vault = 2;
+  policy.reserve_manager_core = true;
+  PlacementEngine engine{ policy, TwoNodes() };
+  std::vector<Placement> existing;
+  for (int i(0); i < 3; ++i)
+    existing.push_back(engine.Place(existing));
+  // Node 1 has the most spare cores to start with, as node 0's first is reserved.
+  EXPECT_EQ((std::vector<int>{ 4, 5 }), existing[0].cpus);
+  EXPECT_EQ((std::vector<int>{ 1, 2 }), existing[1].cpus);
+  EXPECT_EQ(std::vector<int>{ 0 }, existing[1].numa_nodes);
+  EXPECT_EQ((std::vector<int>{ 6, 7 }), existing[2].cpus);
+
+  // Only CPU 3 is spare now, so the next vault shares a node.
+  Placement shared{ engine.Place(existing) };
+  EXPECT_EQ(std::vector<int>{ 0 }, shared.numa_nodes);
+  EXPECT_EQ((std::vector<int>{ 1, 2, 3 }), shared.cpus);
+}
+
+TEST(PlacementTest, BEH_IsValid) {
+  PlacementEngine engine{ PlacementPolicy{}, TwoNodes() };
+  Placement placement;
+  EXPECT_TRUE(engine.IsValid(placement));
+  placement.cpus = std::vector<int>{ 6, 7 };
+  placement.numa_nodes = std::vector<int>{ 1 };
+  EXPECT_TRUE(engine.IsValid(placement));
+  placement.numa_nodes = std::vector<int>{ 2 };
+  EXPECT_FALSE(engine.IsValid(placement));
+  placement.numa_nodes.clear();
+  placement.cpus.push_back(8);
+  EXPECT_FALSE(engine.IsValid(placement));
+
+  PlacementPolicy policy;
+  policy.cores_per_vault = 0;
+  EXPECT_THROW(PlacementEngine(policy, TwoNodes()), common_error);
+}
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -18,10 +18,15 @@
 
 #include "maidsafe/vault_manager/process_manager.h"
 
+#include <atomic>
+#include <chrono>
 #include <thread>
 #include <string>
 #include <vector>
 
+#ifndef MAIDSAFE_WIN32
+#include "boost/asio/local/stream_protocol.hpp"
+#endif
 #include "boost/filesystem/path.hpp"
 
 #include "maidsafe/common/asio_service.h"
@@ -29,6 +34,7 @@
 #include "maidsafe/common/process.h"
 #include "maidsafe/common/test.h"
 #include "maidsafe/common/utils.h"
+#include "maidsafe/passport/passport.h"
 
 #include "maidsafe/vault_manager/config.h"
 #include "maidsafe/vault_manager/utils.h"
@@ -47,11 +53,200 @@ TEST(ProcessManagerTest, BEH_Constructor) {
   std::unique_ptr<AsioService> asio_service{ maidsafe::make_unique<AsioService>(1) };
   std::shared_ptr<ProcessManager> process_manager{ ProcessManager::MakeShared(
       asio_service->service(), path_to_vault, Port{ 7777 }) };
-  process_manager->StopAll();
+  StopAllReport report{ process_manager->StopAll() };
+  EXPECT_EQ(0U, report.vault_count);
   LOG(kInfo) << "Destroying asio...";
   asio_service.reset();
 }
 
+#ifndef MAIDSAFE_WIN32
+// Each vault fails to connect to the non-existent socket and exits straight away, as do all its
+// restarts, until it's quarantined.  Each exit must be noticed promptly, whether via the vault's
+// pidfd or SIGCHLD (which coalesce); otherwise a missed exit is only handled once the vault's
+// startup timer expires.  Only a few vaults may be restarting at any one time.
+TEST(ProcessManagerTest, FUNC_ReapMassExit) {
+  std::shared_ptr<fs::path> test_dir{
+      maidsafe::test::CreateTestPath("MaidSafe_TestProcessManager") };
+  fs::path path_to_vault{ process::GetOtherExecutablePath("dummy_vault") };
+  std::unique_ptr<AsioService> asio_service{ maidsafe::make_unique<AsioService>(2) };
+  RestartPolicy restart_policy;
+  restart_policy.initial_backoff = std::chrono::milliseconds(10);
+  restart_policy.max_backoff = std::chrono::milliseconds(40);
+  restart_policy.max_crashes_in_window = 3;
+  restart_policy.max_concurrent_restarts = 4;
+  std::atomic<int> quarantined_count(0);
+  std::shared_ptr<ProcessManager> process_manager{ ProcessManager::MakeShared(
+      asio_service->service(), path_to_vault, Port{ 7777 }, *test_dir / "no_such.sock", nullptr,
+      [&](const VaultInfo&) { ++quarantined_count; }, nullptr, restart_policy) };
+
+  const int kVaultCount(16);
+  for (int i(0); i < kVaultCount; ++i) {
+    VaultInfo vault_info;
+    vault_info.pmid_and_signer =
+        std::make_shared<passport::PmidAndSigner>(passport::CreatePmidAndSigner());
+    vault_info.vault_dir = *test_dir / ("vault_" + std::to_string(i));
+    vault_info.label = GenerateLabel();
+    process_manager->AddProcess(std::move(vault_info));
+  }
+
+  const auto kStart(std::chrono::steady_clock::now());
+  const auto kDeadline(kStart + kRpcTimeout);
+  while (quarantined_count < kVaultCount && std::chrono::steady_clock::now() < kDeadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(kVaultCount, quarantined_count.load());
+  LOG(kInfo) << "All vaults and their restarts exited and were reaped in "
+             << std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - kStart).count() << " ms.";
+  // Quarantined vaults are kept until stopped.
+  EXPECT_EQ(static_cast<size_t>(kVaultCount), process_manager->GetAll().size());
+
+  process_manager->StopAll();
+  EXPECT_TRUE(process_manager->GetAll().empty());
+  asio_service.reset();
+}
+
+// Each vault connects to a socket which never answers, so it's still waiting for its config when
+// StopAll's deadline passes.  SIGTERM must then end all of them together, well within the timeout.
+TEST(ProcessManagerTest, FUNC_StopAllEscalates) {
+  std::shared_ptr<fs::path> test_dir{
+      maidsafe::test::CreateTestPath("MaidSafe_TestProcessManager") };
+  fs::path path_to_vault{ process::GetOtherExecutablePath("dummy_vault") };
+  std::unique_ptr<AsioService> asio_service{ maidsafe::make_unique<AsioService>(2) };
+  const fs::path kSocketPath{ *test_dir / "silent.sock" };
+  boost::asio::local::stream_protocol::acceptor silent_listener{ asio_service->service(),
+      boost::asio::local::stream_protocol::endpoint{ kSocketPath.string() } };
+  std::shared_ptr<ProcessManager> process_manager{ ProcessManager::MakeShared(
+      asio_service->service(), path_to_vault, Port{ 7777 }, kSocketPath) };
+
+  auto make_vault_info([&](size_t index) {
+    VaultInfo vault_info;
+    vault_info.pmid_and_signer =
+        std::make_shared<passport::PmidAndSigner>(passport::CreatePmidAndSigner());
+    vault_info.vault_dir = *test_dir / ("vault_" + std::to_string(index));
+    vault_info.label = GenerateLabel();
+    return vault_info;
+  });
+  const size_t kVaultCount(8);
+  for (size_t i(0); i < kVaultCount; ++i)
+    process_manager->AddProcess(make_vault_info(i));
+
+  const std::chrono::seconds kTerminateTimeout(2);
+  StopAllReport report{ process_manager->StopAll(std::chrono::milliseconds(100),
+                                                 kTerminateTimeout) };
+  LOG(kInfo) << "Stopped " << report.vault_count << " vaults in "
+             << std::chrono::duration_cast<std::chrono::milliseconds>(report.drain_time).count()
+             << " ms.";
+  EXPECT_EQ(kVaultCount, report.vault_count);
+  EXPECT_EQ(kVaultCount, report.stopped + report.terminated + report.killed);
+  EXPECT_EQ(0U, report.killed);
+  EXPECT_LT(report.drain_time, std::chrono::steady_clock::duration{ kTerminateTimeout });
+  EXPECT_TRUE(process_manager->GetAll().empty());
+  EXPECT_THROW(process_manager->AddProcess(make_vault_info(kVaultCount)), maidsafe_error);
+  silent_listener.close();
+  asio_service.reset();
+}
+
+// Vaults released by one ProcessManager and adopted by another are stopped by the adopter, which
+// learns of their exits through the handed-over pidfds.
+TEST(ProcessManagerTest, FUNC_HandOver) {
+  std::shared_ptr<fs::path> test_dir{
+      maidsafe::test::CreateTestPath("MaidSafe_TestProcessManager") };
+  fs::path path_to_vault{ process::GetOtherExecutablePath("dummy_vault") };
+  std::unique_ptr<AsioService> asio_service{ maidsafe::make_unique<AsioService>(2) };
+  const fs::path kSocketPath{ *test_dir / "silent.sock" };
+  boost::asio::local::stream_protocol::acceptor silent_listener{ asio_service->service(),
+      boost::asio::local::stream_protocol::endpoint{ kSocketPath.string() } };
+  std::shared_ptr<ProcessManager> releasing_manager{ ProcessManager::MakeShared(
+      asio_service->service(), path_to_vault, Port{ 7777 }, kSocketPath) };
+  std::shared_ptr<ProcessManager> adopting_manager{ ProcessManager::MakeShared(
+      asio_service->service(), path_to_vault, Port{ 7777 }, kSocketPath) };
+  if (!releasing_manager->CanHandOff()) {
+    LOG(kWarning) << "Handing over vaults isn't supported on this system.";
+    releasing_manager->StopAll();
+    adopting_manager->StopAll();
+    silent_listener.close();
+    asio_service.reset();
+    return;
+  }
+
+  const size_t kVaultCount(3);
+  for (size_t i(0); i < kVaultCount; ++i) {
+    VaultInfo vault_info;
+    vault_info.pmid_and_signer =
+        std::make_shared<passport::PmidAndSigner>(passport::CreatePmidAndSigner());
+    vault_info.vault_dir = *test_dir / ("vault_" + std::to_string(i));
+    vault_info.label = GenerateLabel();
+    releasing_manager->AddProcess(vault_info);
+  }
+
+  std::vector<HandedOffVault> vaults{ releasing_manager->ReleaseAll() };
+  ASSERT_EQ(kVaultCount, vaults.size());
+  EXPECT_TRUE(releasing_manager->GetAll().empty());
+  for (auto& vault : vaults) {
+    EXPECT_NE(0U, vault.process_id);
+    EXPECT_NE(-1, vault.pidfd);
+    adopting_manager->AdoptProcess(std::move(vault));
+  }
+  EXPECT_EQ(kVaultCount, adopting_manager->GetAll().size());
+
+  StopAllReport report{ adopting_manager->StopAll(std::chrono::milliseconds(100),
+                                                  std::chrono::seconds(2)) };
+  EXPECT_EQ(kVaultCount, report.vault_count);
+  EXPECT_EQ(kVaultCount, report.stopped + report.terminated + report.killed);
+  EXPECT_EQ(0U, report.killed);
+  EXPECT_TRUE(adopting_manager->GetAll().empty());
+  EXPECT_EQ(0U, releasing_manager->StopAll().vault_count);
+  silent_listener.close();
+  asio_service.reset();
+}
+
+// Vaults released for a handoff which then fails are taken back, still running.
+TEST(ProcessManagerTest, FUNC_ReclaimAfterFailedHandOver) {
+  std::shared_ptr<fs::path> test_dir{
+      maidsafe::test::CreateTestPath("MaidSafe_TestProcessManager") };
+  fs::path path_to_vault{ process::GetOtherExecutablePath("dummy_vault") };
+  std::unique_ptr<AsioService> asio_service{ maidsafe::make_unique<AsioService>(2) };
+  const fs::path kSocketPath{ *test_dir / "silent.sock" };
+  boost::asio::local::stream_protocol::acceptor silent_listener{ asio_service->service(),
+      boost::asio::local::stream_protocol::endpoint{ kSocketPath.string() } };
+  std::shared_ptr<ProcessManager> process_manager{ ProcessManager::MakeShared(
+      asio_service->service(), path_to_vault, Port{ 7777 }, kSocketPath) };
+  if (!process_manager->CanHandOff()) {
+    LOG(kWarning) << "Handing over vaults isn't supported on this system.";
+    process_manager->StopAll();
+    silent_listener.close();
+    asio_service.reset();
+    return;
+  }
+
+  auto make_vault_info([&](size_t index) {
+    VaultInfo vault_info;
+    vault_info.pmid_and_signer =
+        std::make_shared<passport::PmidAndSigner>(passport::CreatePmidAndSigner());
+    vault_info.vault_dir = *test_dir / ("vault_" + std::to_string(index));
+    vault_info.label = GenerateLabel();
+    return vault_info;
+  });
+  const size_t kVaultCount(3);
+  for (size_t i(0); i < kVaultCount; ++i)
+    process_manager->AddProcess(make_vault_info(i));
+
+  std::vector<HandedOffVault> vaults{ process_manager->ReleaseAll() };
+  ASSERT_EQ(kVaultCount, vaults.size());
+  EXPECT_THROW(process_manager->AddProcess(make_vault_info(kVaultCount)), maidsafe_error);
+  process_manager->ReclaimAll(std::move(vaults));
+  EXPECT_EQ(kVaultCount, process_manager->GetAll().size());
+  process_manager->AddProcess(make_vault_info(kVaultCount));
+
+  StopAllReport report{ process_manager->StopAll(std::chrono::milliseconds(100),
+                                                 std::chrono::seconds(2)) };
+  EXPECT_EQ(kVaultCount + 1, report.vault_count);
+  EXPECT_EQ(0U, report.killed);
+  silent_listener.close();
+  asio_service.reset();
+}
+#endif
+
 }  // namespace test
 
 }  // namespace vault_manager
@@ -0,0 +1,89 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/resource_limits.h"
+
+#ifdef MAIDSAFE_LINUX
+
+#include <signal.h>
+#include <sys/wait.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/vault_manager/spawn.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+namespace {
+
+// Returns the soft limit from the given row of /proc/<pid>/limits.
+std::string ReadSoftLimit(pid_t process_id, const std::string& row) {
+  std::ifstream limits{ "/proc/" + std::to_string(process_id) + "/limits" };
+  std::string line;
+  while (std::getline(limits, line)) {
+    if (line.compare(0, row.size(), row) == 0) {
+      std::istringstream fields{ line.substr(row.size()) };
+      std::string soft_limit;
+      fields >> soft_limit;
+      return soft_limit;
+    }
+  }
+  return std::string{};
+}
+
+}  // unnamed namespace
+
+// Exercises the fallback used where no cgroup subtree has been delegated to the VaultManager.
+TEST(ResourceLimitsTest, BEH_RlimitFallback) {
+  ResourceController resource_controller{ false };
+  EXPECT_FALSE(resource_controller.UsesCgroups());
+  boost::process::child child{ PosixSpawn("/bin/sleep", { "sleep", "10" }) };
+
+  ResourceLimits limits;
+  limits.max_open_files = 64;
+  limits.memory_max = 1024 * 1024 * 1024;
+  const NonEmptyString kLabel{ "TEST-LABEL" };
+  resource_controller.SetLimits(kLabel, limits, child.pid);
+  EXPECT_EQ("64", ReadSoftLimit(child.pid, "Max open files"));
+  EXPECT_EQ(std::to_string(limits.memory_max), ReadSoftLimit(child.pid, "Max address space"));
+
+  ResourceUsage usage{ resource_controller.GetUsage(kLabel, child.pid) };
+  EXPECT_GT(usage.memory_bytes, 0U);
+  usage = resource_controller.GetUsage(kLabel, 0);
+  EXPECT_EQ(0U, usage.memory_bytes);
+
+  kill(child.pid, SIGKILL);
+  int status{ 0 };
+  EXPECT_EQ(child.pid, waitpid(child.pid, &status, 0));
+}
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif
@@ -0,0 +1,166 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/rolling_upgrade.h"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/test.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+namespace {
+
+const fs::path kOldPath{ "/old/vault" };
+const fs::path kNewPath{ "/new/vault" };
+
+// Records each restart and pretends the vault was running unless it's listed in 'stopped_vaults'.
+class FakeVaults {
+ public:
+  explicit FakeVaults(std::vector<std::string> stopped_vaults = std::vector<std::string>{})
+      : mutex_(), stopped_vaults_(std::move(stopped_vaults)), restarts_() {}
+
+  RollingUpgrade::RestartFunctor Restarter() {
+    return [this](const NonEmptyString& label, const fs::path& executable_path) {
+      std::lock_guard<std::mutex> lock{ mutex_ };
+      restarts_.emplace_back(label.string(), executable_path);
+      return std::find(std::begin(stopped_vaults_), std::end(stopped_vaults_), label.string()) ==
+             std::end(stopped_vaults_);
+    };
+  }
+
+  std::vector<std::pair<std::string, fs::path>> Restarts() {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    return restarts_;
+  }
+
+ private:
+  std::mutex mutex_;
+  const std::vector<std::string> stopped_vaults_;
+  std::vector<std::pair<std::string, fs::path>> restarts_;
+};
+
+std::vector<NonEmptyString> Labels(int count) {
+  std::vector<NonEmptyString> labels;
+  for (int i(0); i < count; ++i)
+    labels.emplace_back(std::to_string(i));
+  return labels;
+}
+
+}  // unnamed namespace
+
+TEST(RollingUpgradeTest, BEH_UpgradesInBatches) {
+  AsioService asio_service{ 1 };
+  FakeVaults vaults;
+  std::promise<maidsafe_error> result;
+  auto upgrade(RollingUpgrade::MakeShared(asio_service.service(), Labels(5), kOldPath, kNewPath, 2,
+      vaults.Restarter(), [&](maidsafe_error error) { result.set_value(error); }));
+  upgrade->Start();
+  typedef std::vector<std::pair<std::string, fs::path>> Restarts;
+  EXPECT_EQ((Restarts{ { "0", kNewPath }, { "1", kNewPath } }), vaults.Restarts());
+
+  // The next batch only starts once the whole of the current one has joined.
+  upgrade->HandleJoinedNetwork(NonEmptyString{ "1" });
+  upgrade->HandleJoinedNetwork(NonEmptyString{ "3" });
+  EXPECT_EQ(2U, vaults.Restarts().size());
+  upgrade->HandleJoinedNetwork(NonEmptyString{ "0" });
+  EXPECT_EQ(4U, vaults.Restarts().size());
+  upgrade->HandleJoinedNetwork(NonEmptyString{ "2" });
+  upgrade->HandleJoinedNetwork(NonEmptyString{ "3" });
+  EXPECT_EQ((Restarts{ { "0", kNewPath }, { "1", kNewPath }, { "2", kNewPath },
+                       { "3", kNewPath }, { "4", kNewPath } }), vaults.Restarts());
+  upgrade->HandleJoinedNetwork(NonEmptyString{ "4" });
+
+  auto result_future(result.get_future());
+  ASSERT_EQ(std::future_status::ready, result_future.wait_for(std::chrono::seconds(1)));
+  EXPECT_EQ(make_error_code(CommonErrors::success), result_future.get().code());
+}
+
+TEST(RollingUpgradeTest, BEH_SkipsStoppedVaults) {
+  AsioService asio_service{ 1 };
+  FakeVaults vaults{ std::vector<std::string>{ "0", "1", "2" } };
+  std::promise<maidsafe_error> result;
+  auto upgrade(RollingUpgrade::MakeShared(asio_service.service(), Labels(3), kOldPath, kNewPath, 2,
+      vaults.Restarter(), [&](maidsafe_error error) { result.set_value(error); }));
+  upgrade->Start();
+  // None of the vaults will report in, so all are switched to the new executable straight away.
+  EXPECT_EQ(3U, vaults.Restarts().size());
+  auto result_future(result.get_future());
+  ASSERT_EQ(std::future_status::ready, result_future.wait_for(std::chrono::seconds(1)));
+  EXPECT_EQ(make_error_code(CommonErrors::success), result_future.get().code());
+}
+
+TEST(RollingUpgradeTest, BEH_RollsBackUnhealthyBatch) {
+  AsioService asio_service{ 1 };
+  FakeVaults vaults;
+  std::promise<maidsafe_error> result;
+  auto upgrade(RollingUpgrade::MakeShared(asio_service.service(), Labels(4), kOldPath, kNewPath, 2,
+      vaults.Restarter(), [&](maidsafe_error error) { result.set_value(error); },
+      std::chrono::milliseconds(100)));
+  upgrade->Start();
+  upgrade->HandleJoinedNetwork(NonEmptyString{ "0" });
+  upgrade->HandleJoinedNetwork(NonEmptyString{ "1" });
+  // Vault 3 never joins, so once the second batch times out, all are rolled back in reverse order
+  // and still one batch at a time.
+  upgrade->HandleJoinedNetwork(NonEmptyString{ "2" });
+
+  auto result_future(result.get_future());
+  ASSERT_EQ(std::future_status::ready, result_future.wait_for(std::chrono::seconds(2)));
+  EXPECT_EQ(make_error_code(VaultManagerErrors::timed_out), result_future.get().code());
+  typedef std::vector<std::pair<std::string, fs::path>> Restarts;
+  EXPECT_EQ((Restarts{ { "0", kNewPath }, { "1", kNewPath }, { "2", kNewPath },
+                       { "3", kNewPath }, { "3", kOldPath }, { "2", kOldPath },
+                       { "1", kOldPath }, { "0", kOldPath } }), vaults.Restarts());
+}
+
+TEST(RollingUpgradeTest, BEH_Stop) {
+  AsioService asio_service{ 1 };
+  FakeVaults vaults;
+  std::promise<maidsafe_error> result;
+  auto upgrade(RollingUpgrade::MakeShared(asio_service.service(), Labels(4), kOldPath, kNewPath, 2,
+      vaults.Restarter(), [&](maidsafe_error error) { result.set_value(error); }));
+  upgrade->Start();
+  upgrade->Stop();
+  upgrade->HandleJoinedNetwork(NonEmptyString{ "0" });
+  upgrade->HandleJoinedNetwork(NonEmptyString{ "1" });
+  EXPECT_EQ(2U, vaults.Restarts().size());
+  auto result_future(result.get_future());
+  ASSERT_EQ(std::future_status::ready, result_future.wait_for(std::chrono::seconds(1)));
+  EXPECT_EQ(make_error_code(VaultManagerErrors::vault_terminated), result_future.get().code());
+}
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
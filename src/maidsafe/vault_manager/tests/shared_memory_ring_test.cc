@@ -0,0 +1,102 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/shared_memory_ring.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+namespace {
+
+std::string RingName() { return "maidsafe_ring_test_" + RandomAlphaNumericString(16); }
+
+}  // unnamed namespace
+
+TEST(SharedMemoryRingTest, BEH_PushAndDrain) {
+  const size_t kCapacity{ 4096 };
+  std::unique_ptr<SharedMemoryRing> consumer{ SharedMemoryRing::Create(RingName(), kCapacity) };
+  std::unique_ptr<SharedMemoryRing> producer{ SharedMemoryRing::Open(consumer->Name()) };
+
+  // Push and drain enough records to wrap round the ring several times, with odd payload sizes so
+  // that payloads straddle the end of the buffer.
+  std::vector<std::pair<MessageType, std::string>> received;
+  auto on_record([&](MessageType type, const std::string& payload) {
+    received.emplace_back(type, payload);
+  });
+  for (int round(0); round < 20; ++round) {
+    std::vector<std::pair<MessageType, std::string>> sent;
+    for (int i(0); i < 5; ++i) {
+      sent.emplace_back(i % 2 == 0 ? MessageType::kLogMessage : MessageType::kBootstrapContact,
+                        RandomString(97 + round * 11 + i));
+      ASSERT_TRUE(producer->TryPush(sent.back().first, sent.back().second));
+    }
+    received.clear();
+    EXPECT_EQ(3U, consumer->Drain(3, on_record));
+    EXPECT_EQ(2U, consumer->Drain(100, on_record));
+    EXPECT_EQ(0U, consumer->Drain(100, on_record));
+    EXPECT_EQ(sent, received);
+  }
+  EXPECT_TRUE(producer->TryPush(MessageType::kLogMessage, std::string{}));
+  EXPECT_EQ(1U, consumer->Drain(100, on_record));
+  EXPECT_TRUE(received.back().second.empty());
+  EXPECT_FALSE(consumer->Corrupt());
+}
+
+TEST(SharedMemoryRingTest, BEH_Full) {
+  const size_t kCapacity{ 1024 };
+  std::unique_ptr<SharedMemoryRing> consumer{ SharedMemoryRing::Create(RingName(), kCapacity) };
+  std::unique_ptr<SharedMemoryRing> producer{ SharedMemoryRing::Open(consumer->Name()) };
+
+  // A record which could never fit is refused.
+  EXPECT_FALSE(producer->TryPush(MessageType::kLogMessage, RandomString(kCapacity)));
+
+  // Each of these records takes up a quarter of the ring.
+  const std::string kPayload(RandomString(kCapacity / 4 - 8));
+  for (int i(0); i < 4; ++i)
+    EXPECT_TRUE(producer->TryPush(MessageType::kLogMessage, kPayload));
+  EXPECT_FALSE(producer->TryPush(MessageType::kLogMessage, std::string{}));
+
+  // Draining one frees up room for exactly one more.
+  EXPECT_EQ(1U, consumer->Drain(1, [](MessageType, const std::string&) {}));
+  EXPECT_TRUE(producer->TryPush(MessageType::kLogMessage, kPayload));
+  EXPECT_FALSE(producer->TryPush(MessageType::kLogMessage, std::string{}));
+  EXPECT_EQ(4U, consumer->Drain(100, [](MessageType, const std::string&) {}));
+}
+
+TEST(SharedMemoryRingTest, BEH_RemovedWithConsumer) {
+  std::string name{ RingName() };
+  SharedMemoryRing::Create(name, 1024);
+  EXPECT_THROW(SharedMemoryRing::Open(name), maidsafe_error);
+}
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
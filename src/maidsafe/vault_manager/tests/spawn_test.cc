@@ -0,0 +1,123 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/spawn.h"
+
+#ifndef MAIDSAFE_WIN32
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "boost/asio/io_service.hpp"
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/vault_manager/config.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+namespace {
+
+typedef std::function<boost::process::child(const std::vector<std::string>&, int)> Spawner;
+
+std::vector<Spawner> Spawners(boost::asio::io_service& io_service) {
+  return std::vector<Spawner>{
+      [](const std::vector<std::string>& args, int inherited_socket) {
+        return PosixSpawn("/bin/sh", args, inherited_socket);
+      },
+      [&io_service](const std::vector<std::string>& args, int inherited_socket) {
+        return ForkAndExec(io_service, "/bin/sh", args, inherited_socket);
+      } };
+}
+
+// ForkAndExec passes arguments via a command line, so these are kept free of spaces.
+std::string WriteScript(const fs::path& dir, const std::string& contents) {
+  fs::path script_path{ dir / fs::unique_path("%%%%%%%%.sh") };
+  EXPECT_TRUE(WriteFile(script_path, contents));
+  return script_path.string();
+}
+
+int WaitForExitCode(const boost::process::child& child) {
+  int status{ 0 };
+  EXPECT_EQ(child.pid, waitpid(child.pid, &status, 0));
+  EXPECT_TRUE(WIFEXITED(status));
+  return WEXITSTATUS(status);
+}
+
+}  // unnamed namespace
+
+TEST(SpawnTest, BEH_ExitCode) {
+  std::shared_ptr<fs::path> test_dir{ maidsafe::test::CreateTestPath("MaidSafe_TestSpawn") };
+  const std::string kScript{ WriteScript(*test_dir, "exit 7\n") };
+  boost::asio::io_service io_service;
+  for (const auto& spawn : Spawners(io_service))
+    EXPECT_EQ(7, WaitForExitCode(spawn({ "sh", kScript }, -1)));
+}
+
+TEST(SpawnTest, BEH_PosixSpawnArguments) {
+  // Each argument is passed as is, including any spaces.
+  boost::process::child child{ PosixSpawn(
+      "/bin/sh", { "sh", "-c", "test \"$0\" = 'a b' && exit 7", "a b" }) };
+  EXPECT_EQ(7, WaitForExitCode(child));
+}
+
+TEST(SpawnTest, BEH_InheritedSocket) {
+  std::shared_ptr<fs::path> test_dir{ maidsafe::test::CreateTestPath("MaidSafe_TestSpawn") };
+  const std::string kScript{ WriteScript(
+      *test_dir, "echo ready >&" + std::to_string(kInheritedChannelDescriptor) + "\n") };
+  boost::asio::io_service io_service;
+  for (const auto& spawn : Spawners(io_service)) {
+    std::array<int, 2> channel{ { -1, -1 } };
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, channel.data()));
+    ASSERT_EQ(0, fcntl(channel[0], F_SETFD, FD_CLOEXEC));
+    ASSERT_EQ(0, fcntl(channel[1], F_SETFD, FD_CLOEXEC));
+    boost::process::child child{ spawn({ "sh", kScript }, channel[1]) };
+    close(channel[1]);
+    EXPECT_EQ(0, WaitForExitCode(child));
+
+    std::array<char, 16> buffer;
+    ssize_t size{ read(channel[0], buffer.data(), buffer.size()) };
+    EXPECT_EQ("ready\n", std::string(buffer.data(), size > 0 ? size : 0));
+    close(channel[0]);
+  }
+}
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif
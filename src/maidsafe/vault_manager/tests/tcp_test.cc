@@ -19,17 +19,31 @@
 #include <algorithm>
 #include <array>
 #include <chrono>
+#include <condition_variable>
 #include <future>
+#include <memory>
 #include <mutex>
+#include <ostream>
 #include <string>
 #include <utility>
 #include <vector>
 
+#ifndef MAIDSAFE_WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
 #include "boost/asio/buffer.hpp"
 #include "boost/asio/error.hpp"
+#include "boost/asio/generic/stream_protocol.hpp"
 #include "boost/asio/io_service.hpp"
 #include "boost/asio/ip/tcp.hpp"
+#ifndef MAIDSAFE_WIN32
+#include "boost/asio/local/stream_protocol.hpp"
+#endif
 #include "boost/asio/write.hpp"
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
 
 #include "maidsafe/common/asio_service.h"
 #include "maidsafe/common/make_unique.h"
@@ -99,14 +113,22 @@ class Messages {
   mutable std::mutex mutex_;
 };
 
-class TcpTest : public testing::Test {
+enum class Transport { kTcp, kLocal };
+
+std::ostream& operator<<(std::ostream& ostream, Transport transport) {
+  return ostream << (transport == Transport::kTcp ? "TCP" : "Unix domain socket");
+}
+
+// Each test runs over both loopback TCP and (other than on Windows) a Unix domain socket.
+class TcpTest : public testing::TestWithParam<Transport> {
  protected:
   TcpTest() : to_client_messages_(),
               to_server_messages_(),
               messages_received_by_client_(),
               messages_received_by_server_(),
               client_asio_service_(1),
-              server_asio_service_(1) {}
+              server_asio_service_(1),
+              test_dir_(maidsafe::test::CreateTestPath("MaidSafe_TestTcp")) {}
 
   typedef std::pair<TcpConnectionPtr, std::unique_ptr<on_scope_exit>> ConnectionAndCloser;
   typedef std::pair<TcpListenerPtr, std::unique_ptr<on_scope_exit>> ListenerAndCloser;
@@ -119,27 +141,55 @@ class TcpTest : public testing::Test {
   }
 
   ConnectionAndCloser GenerateClientConnection(
-      AsioService& asio_service, uint16_t port, MessageReceivedFunctor on_message_received,
-      ConnectionClosedFunctor on_connection_closed) {
-    TcpConnectionPtr connection{ TcpConnection::MakeShared(asio_service, port) };
+      AsioService& asio_service, TcpListenerPtr listener,
+      MessageReceivedFunctor on_message_received, ConnectionClosedFunctor on_connection_closed) {
+#ifdef MAIDSAFE_WIN32
+    TcpConnectionPtr connection{ TcpConnection::MakeShared(asio_service,
+                                                           listener->ListeningPort()) };
+#else
+    TcpConnectionPtr connection{ GetParam() == Transport::kTcp ?
+        TcpConnection::MakeShared(asio_service, listener->ListeningPort()) :
+        TcpConnection::MakeShared(asio_service, listener->LocalSocketPath()) };
+#endif
     connection->Start(on_message_received, on_connection_closed);
     return std::make_pair(connection,
         maidsafe::make_unique<on_scope_exit>([connection] { connection->Close(); }));
   }
 
+  // For the Unix domain socket transport, 'port' is only used to name the socket file.
   ListenerAndCloser GenerateListener(AsioService& asio_service,
       NewConnectionFunctor on_new_connection, Port port) {
+#ifdef MAIDSAFE_WIN32
     TcpListenerPtr listener{ TcpListener::MakeShared(asio_service, on_new_connection, port) };
+#else
+    TcpListenerPtr listener{ GetParam() == Transport::kTcp ?
+        TcpListener::MakeShared(asio_service, on_new_connection, port) :
+        TcpListener::MakeShared(asio_service, on_new_connection,
+                                *test_dir_ / (std::to_string(port) + ".sock")) };
+#endif
     return std::make_pair(listener,
         maidsafe::make_unique<on_scope_exit>([listener] { listener->StopListening(); }));
   }
 
+  // Used to connect a raw socket to 'listener'.
+  boost::asio::generic::stream_protocol::endpoint ListenerEndpoint(TcpListenerPtr listener) {
+#ifndef MAIDSAFE_WIN32
+    if (GetParam() == Transport::kLocal) {
+      return boost::asio::generic::stream_protocol::endpoint{
+          boost::asio::local::stream_protocol::endpoint{ listener->LocalSocketPath().string() } };
+    }
+#endif
+    return boost::asio::generic::stream_protocol::endpoint{ boost::asio::ip::tcp::endpoint{
+        boost::asio::ip::address_v6::loopback(), listener->ListeningPort() } };
+  }
+
   std::vector<std::string> to_client_messages_, to_server_messages_;
   std::unique_ptr<Messages> messages_received_by_client_, messages_received_by_server_;
   AsioService client_asio_service_, server_asio_service_;
+  std::shared_ptr<boost::filesystem::path> test_dir_;
 };
 
-TEST_F(TcpTest, BEH_Basic) {
+TEST_P(TcpTest, BEH_Basic) {
   const size_t kMessageCount(10);
   to_client_messages_.emplace_back(RandomString(1));
   to_server_messages_.emplace_back(RandomString(1));
@@ -157,7 +207,7 @@ TEST_F(TcpTest, BEH_Basic) {
       [&](TcpConnectionPtr connection) { server_promise.set_value(std::move(connection)); },
       Port{ 7777 }) };
   ConnectionAndCloser client_connection_and_closer{ GenerateClientConnection(
-      client_asio_service_, listener_and_closer.first->ListeningPort(),
+      client_asio_service_, listener_and_closer.first,
       [&](std::string message) { messages_received_by_client_->AddMessage(std::move(message)); },
       [&] { LOG(kVerbose) << "Client connection closed."; }) };
 
@@ -176,7 +226,9 @@ TEST_F(TcpTest, BEH_Basic) {
   EXPECT_EQ(messages_received_by_server_->MessagesMatch(), Messages::Status::kSuccess);
 }
 
-TEST_F(TcpTest, BEH_UnavailablePort) {
+TEST_P(TcpTest, BEH_UnavailablePort) {
+  if (GetParam() == Transport::kLocal)
+    return;  // Port scanning only applies to TCP.
   to_client_messages_.emplace_back(RandomString(1000));
   to_server_messages_.emplace_back(RandomString(1000));
   InitialiseMessagesToClient();
@@ -190,7 +242,7 @@ TEST_F(TcpTest, BEH_UnavailablePort) {
       [&](TcpConnectionPtr connection) { server_promise.set_value(std::move(connection)); },
       listener_and_closer0.first->ListeningPort()) };
   ConnectionAndCloser client_connection_and_closer{ GenerateClientConnection(
-      client_asio_service_, listener_and_closer1.first->ListeningPort(),
+      client_asio_service_, listener_and_closer1.first,
       [&](std::string message) { messages_received_by_client_->AddMessage(std::move(message)); },
       [&] { LOG(kVerbose) << "Client connection closed."; }) };
 
@@ -205,7 +257,54 @@ TEST_F(TcpTest, BEH_UnavailablePort) {
   EXPECT_EQ(messages_received_by_server_->MessagesMatch(), Messages::Status::kSuccess);
 }
 
-TEST_F(TcpTest, BEH_InvalidMessageSizes) {
+TEST_P(TcpTest, BEH_ListeningAddress) {
+  std::promise<TcpConnectionPtr> server_promise;
+  ListenerAndCloser listener_and_closer{ GenerateListener(server_asio_service_,
+      [&](TcpConnectionPtr connection) { server_promise.set_value(std::move(connection)); },
+      Port{ 0 }) };
+  TcpListenerPtr listener{ listener_and_closer.first };
+  if (GetParam() == Transport::kTcp) {
+    // The port actually bound is reported, not the one requested.
+    EXPECT_NE(0, listener->ListeningPort());
+    EXPECT_TRUE(listener->LocalSocketPath().empty());
+  } else {
+    EXPECT_EQ(0, listener->ListeningPort());
+    EXPECT_EQ(boost::filesystem::owner_read | boost::filesystem::owner_write,
+              boost::filesystem::status(listener->LocalSocketPath()).permissions());
+  }
+  ConnectionAndCloser client_connection_and_closer{ GenerateClientConnection(
+      client_asio_service_, listener, [](std::string /*message*/) {}, [] {}) };
+  EXPECT_EQ(std::future_status::ready,
+            server_promise.get_future().wait_for(std::chrono::seconds(10)));
+}
+
+#ifndef MAIDSAFE_WIN32
+TEST_P(TcpTest, BEH_ReleaseAndReclaim) {
+  std::promise<TcpConnectionPtr> server_promise;
+  ListenerAndCloser listener_and_closer{ GenerateListener(server_asio_service_,
+      [&](TcpConnectionPtr connection) { server_promise.set_value(std::move(connection)); },
+      Port{ 0 }) };
+  TcpListenerPtr listener{ listener_and_closer.first };
+  const Port kPort{ listener->ListeningPort() };
+  EXPECT_THROW(listener->Reclaim(dup(0)), maidsafe_error);
+  int native_socket{ listener->Release() };
+  ASSERT_NE(-1, native_socket);
+  EXPECT_EQ(-1, listener->Release());
+  // While released, the socket keeps listening, so a connection made now is accepted on reclaiming.
+  TcpConnectionPtr client_connection{ GetParam() == Transport::kTcp ?
+      TcpConnection::MakeShared(client_asio_service_, kPort) :
+      TcpConnection::MakeShared(client_asio_service_, listener->LocalSocketPath()) };
+  client_connection->Start([](std::string /*message*/) {}, [] {});
+  on_scope_exit close_client_connection{ [client_connection] { client_connection->Close(); } };
+  auto server_future(server_promise.get_future());
+  EXPECT_EQ(std::future_status::timeout, server_future.wait_for(std::chrono::milliseconds(100)));
+  listener->Reclaim(native_socket);
+  EXPECT_EQ(std::future_status::ready, server_future.wait_for(std::chrono::seconds(10)));
+  EXPECT_THROW(listener->Reclaim(dup(0)), maidsafe_error);
+}
+#endif
+
+TEST_P(TcpTest, BEH_InvalidMessageSizes) {
   to_client_messages_.emplace_back();
   to_server_messages_.emplace_back();
   to_client_messages_.emplace_back(RandomString(TcpConnection::MaxMessageSize() + 1));
@@ -224,7 +323,7 @@ TEST_F(TcpTest, BEH_InvalidMessageSizes) {
       },
       Port{ 7777 }) };
   ConnectionAndCloser client_connection_and_closer{ GenerateClientConnection(
-      client_asio_service_, listener_and_closer.first->ListeningPort(),
+      client_asio_service_, listener_and_closer.first,
       [&](std::string message) { messages_received_by_client_->AddMessage(std::move(message)); },
       [&] { LOG(kVerbose) << "Client connection closed."; }) };
 
@@ -236,9 +335,8 @@ TEST_F(TcpTest, BEH_InvalidMessageSizes) {
 
   // Try to make server receive a message which shows its size as too large
   AsioService bad_asio_service{ 1 };
-  boost::asio::ip::tcp::socket bad_socket(bad_asio_service.service());
-  bad_socket.connect(boost::asio::ip::tcp::endpoint{ boost::asio::ip::address_v6::loopback(),
-                                                     listener_and_closer.first->ListeningPort() });
+  boost::asio::generic::stream_protocol::socket bad_socket(bad_asio_service.service());
+  bad_socket.connect(ListenerEndpoint(listener_and_closer.first));
   ASSERT_TRUE(bad_socket.is_open());
 
   to_server_messages_.erase(std::begin(to_server_messages_));
@@ -264,9 +362,8 @@ TEST_F(TcpTest, BEH_InvalidMessageSizes) {
 
   // Try to make server receive a message which is too large by lying about its size
   InitialiseMessagesToServer();
-  bad_socket = boost::asio::ip::tcp::socket(bad_asio_service.service());
-  bad_socket.connect(boost::asio::ip::tcp::endpoint{ boost::asio::ip::address_v6::loopback(),
-                     listener_and_closer.first->ListeningPort() });
+  bad_socket.close();
+  bad_socket.connect(ListenerEndpoint(listener_and_closer.first));
   ASSERT_TRUE(bad_socket.is_open());
   --size_buffer[3];
   buffers[0] = boost::asio::buffer(size_buffer);
@@ -274,7 +371,7 @@ TEST_F(TcpTest, BEH_InvalidMessageSizes) {
   EXPECT_EQ(messages_received_by_server_->MessagesMatch(), Messages::Status::kMismatch);
 }
 
-TEST_F(TcpTest, BEH_ServerConnectionAborts) {
+TEST_P(TcpTest, BEH_ServerConnectionAborts) {
   to_client_messages_.emplace_back(RandomString(1000));
   to_server_messages_.emplace_back(RandomString(1000));
   InitialiseMessagesToClient();
@@ -285,7 +382,7 @@ TEST_F(TcpTest, BEH_ServerConnectionAborts) {
       [&](TcpConnectionPtr connection) { server_promise.set_value(std::move(connection)); },
       Port{ 8888 }) };
   ConnectionAndCloser client_connection_and_closer{ GenerateClientConnection(
-      client_asio_service_, listener_and_closer.first->ListeningPort(),
+      client_asio_service_, listener_and_closer.first,
       [&](std::string message) { messages_received_by_client_->AddMessage(std::move(message)); },
       [&] { LOG(kVerbose) << "Client connection closed."; }) };
 
@@ -299,7 +396,7 @@ TEST_F(TcpTest, BEH_ServerConnectionAborts) {
   server_connection.reset();
 }
 
-TEST_F(TcpTest, BEH_ClientConnectionAborts) {
+TEST_P(TcpTest, BEH_ClientConnectionAborts) {
   to_client_messages_.emplace_back(RandomString(1000));
   to_server_messages_.emplace_back(RandomString(1000));
   InitialiseMessagesToClient();
@@ -310,7 +407,7 @@ TEST_F(TcpTest, BEH_ClientConnectionAborts) {
       [&](TcpConnectionPtr connection) { server_promise.set_value(std::move(connection)); },
       Port{ 9999 }) };
   ConnectionAndCloser client_connection_and_closer{ GenerateClientConnection(
-      client_asio_service_, listener_and_closer.first->ListeningPort(),
+      client_asio_service_, listener_and_closer.first,
       [&](std::string message) { messages_received_by_client_->AddMessage(std::move(message)); },
       [&] { LOG(kVerbose) << "Client connection closed."; }) };
 
@@ -324,7 +421,7 @@ TEST_F(TcpTest, BEH_ClientConnectionAborts) {
   client_connection_and_closer.first.reset();
 }
 
-TEST_F(TcpTest, BEH_MultipleConnectionsToServer) {
+TEST_P(TcpTest, BEH_MultipleConnectionsToServer) {
   const size_t kMessageCount(10), kClientCount(10);
   std::vector<std::string> to_server_messages_from_single_client;
   for (size_t i(0); i < kMessageCount; ++i) {
@@ -360,7 +457,7 @@ TEST_F(TcpTest, BEH_MultipleConnectionsToServer) {
   std::vector<ConnectionAndCloser> client_connections_and_closers;
   for (size_t i(0); i < kClientCount; ++i) {
     client_connections_and_closers.emplace_back(GenerateClientConnection(
-        client_asio_service_, listener_and_closer.first->ListeningPort(),
+        client_asio_service_, listener_and_closer.first,
         [&, i](std::string msg) {
           LOG(kVerbose) << "Client " << i << " received msg";
           messages_received_by_client[i]->AddMessage(std::move(msg));
@@ -390,6 +487,212 @@ TEST_F(TcpTest, BEH_MultipleConnectionsToServer) {
   server_connections.clear();
 }
 
+TEST_P(TcpTest, BEH_MultiThreadedService) {
+  AsioService multi_threaded_asio_service{ 4 };
+  const size_t kMessageCount(20), kClientCount(8);
+  for (size_t i(0); i < kMessageCount; ++i)
+    to_server_messages_.emplace_back(RandomString(1000 + i));
+  std::vector<std::unique_ptr<Messages>> messages_received_by_server;
+  for (size_t i(0); i < kClientCount; ++i)
+    messages_received_by_server.emplace_back(maidsafe::make_unique<Messages>(to_server_messages_));
+
+  // Each server connection must see its messages in the order they were sent, even though the
+  // server's io_service is run by several threads.
+  std::mutex mutex;
+  std::condition_variable cond_var;
+  std::vector<TcpConnectionPtr> server_connections;
+  std::vector<std::vector<std::string>> ordered_messages(kClientCount);
+  ListenerAndCloser listener_and_closer{ GenerateListener(multi_threaded_asio_service,
+      [&](TcpConnectionPtr connection) {
+        size_t index{ 0 };
+        {
+          std::lock_guard<std::mutex> lock{ mutex };
+          index = server_connections.size();
+          server_connections.push_back(connection);
+        }
+        connection->Start(
+            [&, index](std::string msg) {
+              {
+                std::lock_guard<std::mutex> lock{ mutex };
+                ordered_messages[index].push_back(msg);
+              }
+              messages_received_by_server[index]->AddMessage(std::move(msg));
+            },
+            [&] { LOG(kVerbose) << "Server connection closed."; });
+        cond_var.notify_one();
+      },
+      Port{ 7654 }) };
+
+  std::vector<ConnectionAndCloser> client_connections_and_closers;
+  for (size_t i(0); i < kClientCount; ++i) {
+    client_connections_and_closers.emplace_back(GenerateClientConnection(
+        client_asio_service_, listener_and_closer.first,
+        [&](std::string /*msg*/) {}, [&] { LOG(kVerbose) << "Client connection closed."; }));
+  }
+
+  {
+    std::unique_lock<std::mutex> lock{ mutex };
+    ASSERT_TRUE(cond_var.wait_for(lock, std::chrono::seconds(10),
+                                  [&] { return server_connections.size() == kClientCount; }));
+  }
+
+  for (size_t i(0); i < kMessageCount; ++i) {
+    for (auto& client_connection_and_closer : client_connections_and_closers)
+      client_connection_and_closer.first->Send(to_server_messages_[i]);
+  }
+  for (size_t i(0); i < kClientCount; ++i)
+    EXPECT_EQ(messages_received_by_server[i]->MessagesMatch(), Messages::Status::kSuccess);
+
+  std::lock_guard<std::mutex> lock{ mutex };
+  for (const auto& messages : ordered_messages)
+    EXPECT_EQ(to_server_messages_, messages);
+  for (auto& server_connection : server_connections)
+    server_connection->Close();
+}
+
+TEST_P(TcpTest, FUNC_BatchedSend) {
+  // Compares sending a burst of small messages one message per write against the default batching.
+  // The throughput of each is measured by the BatchedSend benchmark.
+  const size_t kMessageCount(5000), kMessageSize(200);
+  for (size_t i(0); i < kMessageCount; ++i)
+    to_server_messages_.emplace_back(RandomString(kMessageSize));
+
+  auto run_burst([&](size_t max_batch_messages)->TcpConnection::SendStats {
+    InitialiseMessagesToServer();
+    // Each run uses its own port, since the previous listener stops asynchronously.
+    std::promise<TcpConnectionPtr> server_promise;
+    ListenerAndCloser listener_and_closer{ GenerateListener(server_asio_service_,
+        [&](TcpConnectionPtr connection) { server_promise.set_value(std::move(connection)); },
+        static_cast<Port>(7700 + max_batch_messages)) };
+    ConnectionAndCloser client_connection_and_closer{ GenerateClientConnection(
+        client_asio_service_, listener_and_closer.first,
+        [&](std::string /*message*/) {}, [&] { LOG(kVerbose) << "Client connection closed."; }) };
+    TcpConnectionPtr server_connection{ server_promise.get_future().get() };
+    server_connection->Start(
+        [&](std::string message) { messages_received_by_server_->AddMessage(std::move(message)); },
+        [&] { LOG(kVerbose) << "Server connection closed."; });
+
+    TcpConnectionPtr client_connection{ client_connection_and_closer.first };
+    client_connection->SetSendBatchLimits(kMaxSendBatchBytes, max_batch_messages);
+    for (const auto& message : to_server_messages_)
+      client_connection->Send(message);
+    EXPECT_EQ(messages_received_by_server_->MessagesMatch(), Messages::Status::kSuccess);
+    server_connection->Close();
+    return client_connection->GetSendStats();
+  });
+
+  TcpConnection::SendStats unbatched(run_burst(1));
+  TcpConnection::SendStats batched(run_burst(kMaxSendBatchMessages));
+  EXPECT_EQ(kMessageCount, unbatched.message_count);
+  EXPECT_EQ(kMessageCount, unbatched.write_count);
+  EXPECT_EQ(kMessageCount, batched.message_count);
+  EXPECT_LT(batched.write_count, unbatched.write_count);
+  // No batch may exceed the limits.
+  EXPECT_GE(batched.write_count * kMaxSendBatchMessages, kMessageCount);
+}
+
+#ifndef MAIDSAFE_WIN32
+TEST(TcpInheritedChannelTest, BEH_SocketPair) {
+  AsioService asio_service{ 1 };
+  std::array<int, 2> channel;
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, channel.data()));
+  TcpConnectionPtr manager_end{
+      TcpConnection::MakeSharedFromNativeSocket(asio_service, channel[0]) };
+  TcpConnectionPtr vault_end{ TcpConnection::MakeSharedFromNativeSocket(asio_service, channel[1]) };
+  on_scope_exit closer{ [&] {
+    manager_end->Close();
+    vault_end->Close();
+  } };
+
+  const std::string kToVault(RandomString(1000)), kToManager(RandomString(1000));
+  std::promise<std::string> vault_received, manager_received;
+  manager_end->Start([&](const std::string& message) { manager_received.set_value(message); },
+                     [] {});
+  vault_end->Start([&](const std::string& message) { vault_received.set_value(message); }, [] {});
+  manager_end->Send(kToVault);
+  vault_end->Send(kToManager);
+  auto vault_future(vault_received.get_future()), manager_future(manager_received.get_future());
+  ASSERT_EQ(std::future_status::ready, vault_future.wait_for(std::chrono::seconds(5)));
+  ASSERT_EQ(std::future_status::ready, manager_future.wait_for(std::chrono::seconds(5)));
+  EXPECT_EQ(kToVault, vault_future.get());
+  EXPECT_EQ(kToManager, manager_future.get());
+}
+
+TEST(TcpInheritedChannelTest, BEH_LoweredMaxMessageSize) {
+  AsioService asio_service{ 1 };
+  std::array<int, 2> channel;
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, channel.data()));
+  TcpConnectionPtr manager_end{
+      TcpConnection::MakeSharedFromNativeSocket(asio_service, channel[0]) };
+  TcpConnectionPtr vault_end{ TcpConnection::MakeSharedFromNativeSocket(asio_service, channel[1]) };
+  on_scope_exit closer{ [&] {
+    manager_end->Close();
+    vault_end->Close();
+  } };
+
+  const size_t kMaxMessageSize(64);
+  std::vector<std::string> received;
+  std::promise<void> manager_closed;
+  manager_end->SetMaxMessageSize(kMaxMessageSize);
+  manager_end->Start([&](const std::string& message) { received.push_back(message); },
+                     [&] { manager_closed.set_value(); });
+  vault_end->Start([](const std::string&) {}, [] {});
+  const std::string kSmallMessage(RandomString(kMaxMessageSize));
+  vault_end->Send(kSmallMessage);
+  vault_end->Send(RandomString(kMaxMessageSize + 1));
+  ASSERT_EQ(std::future_status::ready,
+            manager_closed.get_future().wait_for(std::chrono::seconds(5)));
+  ASSERT_EQ(1U, received.size());
+  EXPECT_EQ(kSmallMessage, received.front());
+}
+
+TEST(TcpInheritedChannelTest, BEH_PauseReceiving) {
+  AsioService asio_service{ 2 };
+  std::array<int, 2> channel;
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, channel.data()));
+  TcpConnectionPtr manager_end{
+      TcpConnection::MakeSharedFromNativeSocket(asio_service, channel[0]) };
+  TcpConnectionPtr vault_end{ TcpConnection::MakeSharedFromNativeSocket(asio_service, channel[1]) };
+  on_scope_exit closer{ [&] {
+    manager_end->Close();
+    vault_end->Close();
+  } };
+
+  // The first message pauses receiving, as when a client's challenge response is being checked.
+  const std::vector<std::string> kMessages{ RandomString(10), RandomString(20), RandomString(30) };
+  std::mutex mutex;
+  std::vector<std::string> received;
+  std::promise<void> all_received;
+  manager_end->Start([&](const std::string& message) {
+                       std::lock_guard<std::mutex> lock{ mutex };
+                       if (received.empty())
+                         manager_end->PauseReceiving();
+                       received.push_back(message);
+                       if (received.size() == kMessages.size())
+                         all_received.set_value();
+                     }, [] {});
+  vault_end->Start([](const std::string&) {}, [] {});
+  for (const auto& message : kMessages)
+    vault_end->Send(message);
+  Sleep(std::chrono::milliseconds(200));
+  {
+    std::lock_guard<std::mutex> lock{ mutex };
+    EXPECT_EQ(1U, received.size());
+  }
+
+  manager_end->ResumeReceiving();
+  ASSERT_EQ(std::future_status::ready, all_received.get_future().wait_for(std::chrono::seconds(5)));
+  std::lock_guard<std::mutex> lock{ mutex };
+  EXPECT_EQ(kMessages, received);
+}
+#endif
+
+#ifdef MAIDSAFE_WIN32
+INSTANTIATE_TEST_CASE_P(Transports, TcpTest, testing::Values(Transport::kTcp));
+#else
+INSTANTIATE_TEST_CASE_P(Transports, TcpTest, testing::Values(Transport::kTcp, Transport::kLocal));
+#endif
+
 }  // namespace test
 
 }  // namespace vault_manager
@@ -0,0 +1,120 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/timer_wheel.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/vault_manager/config.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+TEST(TimerWheelTest, BEH_OneWheelPerIoService) {
+  AsioService asio_service(1), other_asio_service(1);
+  EXPECT_EQ(&GetTimerWheel(asio_service.service()), &GetTimerWheel(asio_service.service()));
+  EXPECT_NE(&GetTimerWheel(asio_service.service()),
+            &GetTimerWheel(other_asio_service.service()));
+}
+
+TEST(TimerWheelTest, BEH_ExpireNoSoonerThanDue) {
+  AsioService asio_service(2);
+  // A small wheel, added before first use in place of the default one.
+  const std::chrono::milliseconds kTick(10);
+  const size_t kSlotCount(8);
+  boost::asio::add_service(asio_service.service(),
+                           new TimerWheel{ asio_service.service(), kTick, kSlotCount });
+  TimerWheel& timer_wheel(GetTimerWheel(asio_service.service()));
+  // The timeouts span more than a revolution of the wheel, so some share a slot with later ones.
+  const int kCount(100);
+  const auto kStep(kTick * static_cast<int>(kSlotCount) / (kCount / 2));
+  std::atomic<int> early_count(0), expired_count(0);
+  std::promise<void> all_expired;
+  const auto kStart(std::chrono::steady_clock::now());
+  for (int i(0); i < kCount; ++i) {
+    const auto kTimeout(kStep * i);
+    timer_wheel.Arm(kTimeout, [&, kTimeout] {
+      if (std::chrono::steady_clock::now() - kStart < kTimeout)
+        ++early_count;
+      if (++expired_count == kCount)
+        all_expired.set_value();
+    });
+  }
+  ASSERT_EQ(std::future_status::ready,
+            all_expired.get_future().wait_for(kStep * kCount + std::chrono::seconds(5)));
+  EXPECT_EQ(0, early_count.load());
+  TimerWheel::Stats stats(timer_wheel.GetStats());
+  EXPECT_EQ(static_cast<uint64_t>(kCount), stats.expired);
+  EXPECT_EQ(0U, stats.pending);
+}
+
+TEST(TimerWheelTest, BEH_CancelAndRearm) {
+  AsioService asio_service(1);
+  TimerWheel& timer_wheel(GetTimerWheel(asio_service.service()));
+  std::atomic<int> expired_count(0);
+  std::vector<TimerWheel::TimeoutId> timeout_ids;
+  for (int i(0); i < 10; ++i)
+    timeout_ids.push_back(timer_wheel.Arm(kTimerWheelTick * 4, [&] { ++expired_count; }));
+  for (auto timeout_id : timeout_ids)
+    EXPECT_TRUE(timer_wheel.Cancel(timeout_id));
+  EXPECT_FALSE(timer_wheel.Cancel(timeout_ids.front()));
+  EXPECT_FALSE(timer_wheel.Rearm(timeout_ids.front(), kTimerWheelTick));
+
+  std::promise<void> expired;
+  const auto kStart(std::chrono::steady_clock::now());
+  TimerWheel::TimeoutId timeout_id{
+      timer_wheel.Arm(kTimerWheelTick * 4, [&] { expired.set_value(); }) };
+  const auto kRearmedTimeout(kTimerWheelTick * 20);
+  EXPECT_TRUE(timer_wheel.Rearm(timeout_id, kRearmedTimeout));
+  expired.get_future().get();
+  EXPECT_GE(std::chrono::steady_clock::now() - kStart, kRearmedTimeout);
+  EXPECT_FALSE(timer_wheel.Cancel(timeout_id));
+  EXPECT_EQ(0, expired_count.load());
+
+  TimerWheel::Stats stats(timer_wheel.GetStats());
+  EXPECT_EQ(11U, stats.armed);
+  EXPECT_EQ(10U, stats.cancelled);
+  EXPECT_EQ(1U, stats.expired);
+}
+
+TEST(TimerWheelTest, BEH_CancelReleasesFunctor) {
+  AsioService asio_service(1);
+  TimerWheel& timer_wheel(GetTimerWheel(asio_service.service()));
+  std::shared_ptr<int> owned{ std::make_shared<int>(0) };
+  TimerWheel::TimeoutId timeout_id{ timer_wheel.Arm(std::chrono::hours(1), [owned] {}) };
+  EXPECT_EQ(2, owned.use_count());
+  EXPECT_TRUE(timer_wheel.Cancel(timeout_id));
+  EXPECT_EQ(1, owned.use_count());
+  EXPECT_EQ(0U, timer_wheel.GetStats().pending);
+}
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
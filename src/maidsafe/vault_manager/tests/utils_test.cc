@@ -25,6 +25,8 @@
 
 #include "maidsafe/vault_manager/config.h"
 #include "maidsafe/vault_manager/interprocess_messages.pb.h"
+#include "maidsafe/vault_manager/resource_limits.h"
+#include "maidsafe/vault_manager/vault_info.pb.h"
 
 namespace maidsafe {
 
@@ -59,6 +61,24 @@ TEST(UtilsTest, BEH_WrapAndUnwrapMessage) {
   EXPECT_EQ(kPlainText, ParseProto<protobuf::Challenge>(message_and_type.first).plaintext());
 }
 
+TEST(UtilsTest, BEH_ResourceLimitsProtobuf) {
+  ResourceLimits limits;
+  limits.cpu_weight = 50;
+  limits.memory_max = 1024 * 1024 * 1024;
+  limits.max_open_files = 1024;
+  protobuf::ResourceLimits protobuf_limits;
+  ToProtobuf(limits, &protobuf_limits);
+  EXPECT_FALSE(protobuf_limits.has_io_weight());
+
+  ResourceLimits recovered;
+  FromProtobuf(ParseProto<protobuf::ResourceLimits>(protobuf_limits.SerializeAsString()),
+               recovered);
+  EXPECT_EQ(limits.cpu_weight, recovered.cpu_weight);
+  EXPECT_EQ(limits.memory_max, recovered.memory_max);
+  EXPECT_EQ(0U, recovered.io_weight);
+  EXPECT_EQ(limits.max_open_files, recovered.max_open_files);
+}
+
 }  // namespace test
 
 }  // namespace vault_manager
@@ -0,0 +1,146 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/vault_registry.h"
+
+#include <memory>
+#include <string>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/passport/passport.h"
+
+#include "maidsafe/vault_manager/vault_info.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+namespace {
+
+struct Entry {
+  VaultInfo info;
+  ProcessId process_id;
+};
+
+Entry MakeEntry(const std::string& name) {
+  Entry entry;
+  entry.info.label = NonEmptyString{ name };
+  entry.info.vault_dir = "/vaults/" + name;
+  entry.process_id = 0;
+  return entry;
+}
+
+}  // unnamed namespace
+
+TEST(VaultRegistryTest, BEH_AddAndFind) {
+  VaultRegistry<Entry> registry;
+  auto itr0(registry.Add(MakeEntry("0")));
+  auto itr1(registry.Add(MakeEntry("1")));
+  EXPECT_EQ(2U, registry.size());
+
+  EXPECT_TRUE(registry.FindByLabel(NonEmptyString{ "0" }) == itr0);
+  EXPECT_TRUE(registry.FindByLabel(NonEmptyString{ "1" }) == itr1);
+  EXPECT_TRUE(registry.FindByLabel(NonEmptyString{ "2" }) == std::end(registry));
+  // Unset process IDs and connections aren't indexed.
+  EXPECT_TRUE(registry.FindByProcessId(0) == std::end(registry));
+  EXPECT_TRUE(registry.FindByConnection(nullptr) == std::end(registry));
+
+  registry.SetProcessId(itr0, 100);
+  EXPECT_TRUE(registry.FindByProcessId(100) == itr0);
+  EXPECT_EQ(100U, itr0->process_id);
+  registry.SetProcessId(itr0, 101);
+  EXPECT_TRUE(registry.FindByProcessId(100) == std::end(registry));
+  EXPECT_TRUE(registry.FindByProcessId(101) == itr0);
+
+  // Entries have stable addresses.
+  const Entry* const kEntry1Address{ &*itr1 };
+  registry.Erase(itr0);
+  EXPECT_EQ(1U, registry.size());
+  EXPECT_TRUE(registry.FindByLabel(NonEmptyString{ "0" }) == std::end(registry));
+  EXPECT_TRUE(registry.FindByProcessId(101) == std::end(registry));
+  EXPECT_EQ(kEntry1Address, &*registry.FindByLabel(NonEmptyString{ "1" }));
+}
+
+TEST(VaultRegistryTest, BEH_Conflicts) {
+  VaultRegistry<Entry> registry;
+  Entry entry{ MakeEntry("0") };
+  entry.info.pmid_and_signer =
+      std::make_shared<passport::PmidAndSigner>(passport::CreatePmidAndSigner());
+  auto itr(registry.Add(entry));
+  registry.SetProcessId(itr, 100);
+
+  Entry same_label{ MakeEntry("1") };
+  same_label.info.label = entry.info.label;
+  EXPECT_THROW(registry.Add(same_label), maidsafe_error);
+
+  Entry same_vault_dir{ MakeEntry("1") };
+  same_vault_dir.info.vault_dir = entry.info.vault_dir;
+  EXPECT_THROW(registry.Add(same_vault_dir), maidsafe_error);
+
+  Entry same_pmid{ MakeEntry("1") };
+  same_pmid.info.pmid_and_signer = entry.info.pmid_and_signer;
+  EXPECT_THROW(registry.Add(same_pmid), maidsafe_error);
+
+  Entry same_process_id{ MakeEntry("1") };
+  same_process_id.process_id = 100;
+  EXPECT_THROW(registry.Add(same_process_id), maidsafe_error);
+
+  // A failed Add leaves the registry unchanged.
+  EXPECT_EQ(1U, registry.size());
+  EXPECT_TRUE(registry.FindByLabel(NonEmptyString{ "1" }) == std::end(registry));
+  EXPECT_NO_THROW(registry.Add(MakeEntry("1")));
+  EXPECT_EQ(2U, registry.size());
+
+  // Once erased, an entry's keys are free for reuse.
+  registry.Erase(itr);
+  EXPECT_NO_THROW(registry.Add(entry));
+}
+
+TEST(VaultRegistryTest, BEH_SetVaultDir) {
+  VaultRegistry<Entry> registry;
+  auto itr0(registry.Add(MakeEntry("0")));
+  auto itr1(registry.Add(MakeEntry("1")));
+  const boost::filesystem::path kOldVaultDir{ itr0->info.vault_dir };
+
+  // Can't move onto another entry's vault_dir, but setting the current one is a no-op.
+  EXPECT_THROW(registry.SetVaultDir(itr0, itr1->info.vault_dir), maidsafe_error);
+  EXPECT_EQ(kOldVaultDir, itr0->info.vault_dir);
+  EXPECT_NO_THROW(registry.SetVaultDir(itr0, kOldVaultDir));
+
+  registry.SetVaultDir(itr0, "/vaults/moved");
+  EXPECT_EQ(boost::filesystem::path{ "/vaults/moved" }, itr0->info.vault_dir);
+  EXPECT_TRUE(registry.FindByLabel(NonEmptyString{ "0" }) == itr0);
+
+  // The old vault_dir is free for reuse and the new one is taken.
+  Entry reuse_old{ MakeEntry("2") };
+  reuse_old.info.vault_dir = kOldVaultDir;
+  EXPECT_NO_THROW(registry.Add(reuse_old));
+  Entry reuse_new{ MakeEntry("3") };
+  reuse_new.info.vault_dir = "/vaults/moved";
+  EXPECT_THROW(registry.Add(reuse_new), maidsafe_error);
+}
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
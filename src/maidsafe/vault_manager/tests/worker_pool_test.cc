@@ -0,0 +1,120 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+#include "maidsafe/vault_manager/worker_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+
+#include "maidsafe/common/test.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+namespace test {
+
+TEST(WorkerPoolTest, BEH_RunsAllJobsInBatches) {
+  const int kJobCount(200);
+  const size_t kBatchSize(8);
+  std::atomic<int> run_count(0);
+  std::promise<void> all_run;
+  {
+    WorkerPool worker_pool(3, kJobCount, kBatchSize);
+    for (int i(0); i < kJobCount; ++i) {
+      ASSERT_TRUE(worker_pool.Submit([&] {
+        if (++run_count == kJobCount)
+          all_run.set_value();
+      }));
+    }
+    ASSERT_EQ(std::future_status::ready,
+              all_run.get_future().wait_for(std::chrono::seconds(10)));
+    // The last job may not have been counted yet.
+    while (worker_pool.GetStats().completed != static_cast<uint64_t>(kJobCount))
+      std::this_thread::yield();
+    WorkerPool::Stats stats(worker_pool.GetStats());
+    EXPECT_EQ(static_cast<uint64_t>(kJobCount), stats.submitted);
+    EXPECT_EQ(0U, stats.rejected);
+    EXPECT_GE(stats.batches, static_cast<uint64_t>(kJobCount / kBatchSize));
+    EXPECT_LE(stats.batches, static_cast<uint64_t>(kJobCount));
+    EXPECT_EQ(0U, stats.queue_depth);
+  }
+  EXPECT_EQ(kJobCount, run_count.load());
+}
+
+TEST(WorkerPoolTest, BEH_BoundedQueue) {
+  const size_t kMaxQueueDepth(2);
+  WorkerPool worker_pool(1, kMaxQueueDepth, 1);
+  std::promise<void> started, release;
+  std::shared_future<void> released(release.get_future());
+  ASSERT_TRUE(worker_pool.Submit([&] {
+    started.set_value();
+    released.wait();
+  }));
+  ASSERT_EQ(std::future_status::ready, started.get_future().wait_for(std::chrono::seconds(10)));
+
+  // The only worker is busy, so the next jobs are queued until the queue is full.
+  std::atomic<int> run_count(0);
+  for (size_t i(0); i < kMaxQueueDepth; ++i)
+    EXPECT_TRUE(worker_pool.Submit([&] { ++run_count; }));
+  EXPECT_FALSE(worker_pool.Submit([&] { ++run_count; }));
+  WorkerPool::Stats stats(worker_pool.GetStats());
+  EXPECT_EQ(1U, stats.active);
+  EXPECT_EQ(kMaxQueueDepth, stats.queue_depth);
+  EXPECT_EQ(kMaxQueueDepth, stats.max_queue_depth);
+  EXPECT_EQ(1U, stats.rejected);
+
+  release.set_value();
+  while (worker_pool.GetStats().completed != kMaxQueueDepth + 1)
+    std::this_thread::yield();
+  EXPECT_EQ(static_cast<int>(kMaxQueueDepth), run_count.load());
+  EXPECT_TRUE(worker_pool.Submit([] {}));
+}
+
+TEST(WorkerPoolTest, BEH_ThrowingJob) {
+  WorkerPool worker_pool(1, 10, 10);
+  std::promise<void> next_job_run;
+  EXPECT_TRUE(worker_pool.Submit([] { throw std::runtime_error("Job failed"); }));
+  EXPECT_TRUE(worker_pool.Submit([&] { next_job_run.set_value(); }));
+  EXPECT_EQ(std::future_status::ready,
+            next_job_run.get_future().wait_for(std::chrono::seconds(10)));
+}
+
+TEST(WorkerPoolTest, BEH_DestroyDiscardsQueuedJobs) {
+  std::atomic<int> run_count(0);
+  {
+    WorkerPool worker_pool(1, 10, 1);
+    std::promise<void> started;
+    ASSERT_TRUE(worker_pool.Submit([&] {
+      started.set_value();
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }));
+    started.get_future().wait();
+    for (int i(0); i < 5; ++i)
+      ASSERT_TRUE(worker_pool.Submit([&] { ++run_count; }));
+  }
+  EXPECT_EQ(0, run_count.load());
+}
+
+}  // namespace test
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,199 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/timer_wheel.h"
+
+#include <algorithm>
+#include <cassert>
+#include <exception>
+
+#include "boost/asio/error.hpp"
+#include "boost/exception/diagnostic_information.hpp"
+
+#include "maidsafe/common/log.h"
+
+#include "maidsafe/vault_manager/config.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+boost::asio::io_service::id TimerWheel::id;
+
+TimerWheel::TimerWheel(boost::asio::io_service& io_service)
+    : TimerWheel(io_service, kTimerWheelTick, kTimerWheelSlots) {}
+
+TimerWheel::TimerWheel(boost::asio::io_service& io_service, std::chrono::milliseconds tick,
+                       size_t slot_count)
+    : boost::asio::io_service::service(io_service),
+      kTick_(std::max(tick, std::chrono::milliseconds(1))),
+      kEpoch_(std::chrono::steady_clock::now()),
+      mutex_(),
+      slots_(std::max(slot_count, size_t(1))),
+      timeouts_(),
+      next_id_(1),
+      last_expired_tick_(0),
+      ticking_(false),
+      shut_down_(false),
+      stats_(),
+      timer_(io_service) {}
+
+TimerWheel::~TimerWheel() {
+  assert(timeouts_.empty());
+}
+
+void TimerWheel::shutdown_service() {
+  // The functors may own objects which must be destroyed before the io_service.
+  std::vector<Slot> slots;
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    shut_down_ = true;
+    slots.swap(slots_);
+    timeouts_.clear();
+  }
+  boost::system::error_code ignored_ec;
+  timer_.cancel(ignored_ec);
+}
+
+TimerWheel::TimeoutId TimerWheel::Arm(std::chrono::steady_clock::duration timeout,
+                                      ExpiryFunctor on_expiry) {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  const TimeoutId kId{ next_id_++ };
+  if (shut_down_)
+    return kId;  // It would never expire anyway.
+  // Nothing can have been due while the wheel was idle.
+  if (!ticking_)
+    last_expired_tick_ = std::max(last_expired_tick_, TickAt(std::chrono::steady_clock::now()));
+  Insert(kId, DueTick(timeout), std::move(on_expiry));
+  ++stats_.armed;
+  StartTicking();
+  return kId;
+}
+
+bool TimerWheel::Cancel(TimeoutId timeout_id) {
+  ExpiryFunctor on_expiry;  // Destroyed once the lock has been released.
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  auto itr(timeouts_.find(timeout_id));
+  if (itr == std::end(timeouts_))
+    return false;
+  on_expiry = std::move(itr->second.second->on_expiry);
+  slots_[itr->second.first].erase(itr->second.second);
+  timeouts_.erase(itr);
+  ++stats_.cancelled;
+  return true;
+}
+
+bool TimerWheel::Rearm(TimeoutId timeout_id, std::chrono::steady_clock::duration timeout) {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  auto itr(timeouts_.find(timeout_id));
+  if (itr == std::end(timeouts_))
+    return false;
+  ExpiryFunctor on_expiry{ std::move(itr->second.second->on_expiry) };
+  slots_[itr->second.first].erase(itr->second.second);
+  timeouts_.erase(itr);
+  Insert(timeout_id, DueTick(timeout), std::move(on_expiry));
+  return true;
+}
+
+TimerWheel::Stats TimerWheel::GetStats() const {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  Stats stats(stats_);
+  stats.pending = timeouts_.size();
+  return stats;
+}
+
+uint64_t TimerWheel::TickAt(std::chrono::steady_clock::time_point time) const {
+  return static_cast<uint64_t>((time - kEpoch_) / kTick_);
+}
+
+uint64_t TimerWheel::DueTick(std::chrono::steady_clock::duration timeout) const {
+  const auto kDue(std::chrono::steady_clock::now() - kEpoch_ +
+                  std::max(timeout, std::chrono::steady_clock::duration::zero()));
+  // Rounded up, so that the timeout never expires early.
+  const uint64_t kDueTick{ static_cast<uint64_t>(
+      (kDue + kTick_ - std::chrono::steady_clock::duration(1)) / kTick_) };
+  return std::max(kDueTick, last_expired_tick_ + 1);
+}
+
+void TimerWheel::Insert(TimeoutId timeout_id, uint64_t due_tick, ExpiryFunctor on_expiry) {
+  const size_t kSlot{ static_cast<size_t>(due_tick % slots_.size()) };
+  Slot& slot(slots_[kSlot]);
+  slot.emplace_back(timeout_id, due_tick, std::move(on_expiry));
+  timeouts_.emplace(timeout_id, std::make_pair(kSlot, std::prev(std::end(slot))));
+}
+
+void TimerWheel::StartTicking() {
+  if (ticking_ || timeouts_.empty())
+    return;
+  ticking_ = true;
+  timer_.expires_at(kEpoch_ + kTick_ * static_cast<int64_t>(last_expired_tick_ + 1));
+  timer_.async_wait([this](const boost::system::error_code& error_code) { OnTick(error_code); });
+}
+
+void TimerWheel::OnTick(const boost::system::error_code& error_code) {
+  if (error_code == boost::asio::error::operation_aborted)
+    return;
+  std::vector<ExpiryFunctor> expired;
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    ticking_ = false;
+    if (shut_down_)
+      return;
+    const uint64_t kNowTick{ TickAt(std::chrono::steady_clock::now()) };
+    if (kNowTick > last_expired_tick_) {
+      // If more than a revolution has passed, each slot need only be visited once.
+      const uint64_t kSlotsToVisit{
+          std::min<uint64_t>(kNowTick - last_expired_tick_, slots_.size()) };
+      for (uint64_t tick(last_expired_tick_ + 1); tick <= last_expired_tick_ + kSlotsToVisit;
+           ++tick) {
+        Slot& slot(slots_[static_cast<size_t>(tick % slots_.size())]);
+        auto itr(std::begin(slot));
+        while (itr != std::end(slot)) {
+          // Others in this slot are due in later revolutions.
+          if (itr->due_tick > kNowTick) {
+            ++itr;
+            continue;
+          }
+          expired.push_back(std::move(itr->on_expiry));
+          timeouts_.erase(itr->id);
+          itr = slot.erase(itr);
+        }
+      }
+      last_expired_tick_ = kNowTick;
+      stats_.expired += expired.size();
+    }
+    StartTicking();
+  }
+
+  for (auto& on_expiry : expired) {
+    try {
+      on_expiry();
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Error executing timeout functor: " << boost::diagnostic_information(e);
+    }
+  }
+}
+
+TimerWheel& GetTimerWheel(boost::asio::io_service& io_service) {
+  return boost::asio::use_service<TimerWheel>(io_service);
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,119 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_TIMER_WHEEL_H_
+#define MAIDSAFE_VAULT_MANAGER_TIMER_WHEEL_H_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "boost/asio/io_service.hpp"
+#include "boost/asio/steady_timer.hpp"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// A hashed timer wheel, owned by its io_service as an asio service (see GetTimerWheel), on which
+// timeouts can be armed, rearmed and cancelled in O(1) without each needing its own steady_timer.
+// Each timeout is placed in the slot for the tick at which it's due, and a single steady_timer
+// ticks (only while any timeout is pending) to expire the due timeouts of each slot in turn.
+// Timeouts due more than a revolution of the wheel ahead simply stay in their slot for the
+// intervening revolutions.  Thread-safe.
+class TimerWheel : public boost::asio::io_service::service {
+ public:
+  // Never 0, so 0 can be used to mean "no timeout".
+  typedef uint64_t TimeoutId;
+  typedef std::function<void()> ExpiryFunctor;
+
+  struct Stats {
+    Stats() : armed(0), cancelled(0), expired(0), pending(0) {}
+    uint64_t armed, cancelled, expired;
+    size_t pending;
+  };
+
+  static boost::asio::io_service::id id;
+
+  explicit TimerWheel(boost::asio::io_service& io_service);
+  TimerWheel(boost::asio::io_service& io_service, std::chrono::milliseconds tick,
+             size_t slot_count);
+  ~TimerWheel();
+
+  // 'on_expiry' is invoked on a thread running the io_service, without any lock held, no sooner
+  // than 'timeout' from now and at most one tick later.  If it throws, the exception is logged.
+  TimeoutId Arm(std::chrono::steady_clock::duration timeout, ExpiryFunctor on_expiry);
+  // Returns false (doing nothing) if the timeout has already expired or been cancelled.  As with a
+  // cancelled steady_timer, a timeout which has just expired may still have its functor invoked.
+  bool Cancel(TimeoutId timeout_id);
+  // Makes the timeout due 'timeout' from now instead, keeping its ID and functor.  Returns false
+  // (doing nothing) if it has already expired or been cancelled.
+  bool Rearm(TimeoutId timeout_id, std::chrono::steady_clock::duration timeout);
+  Stats GetStats() const;
+
+ private:
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel(TimerWheel&&) = delete;
+  TimerWheel& operator=(TimerWheel) = delete;
+
+  struct Timeout {
+    Timeout(TimeoutId id_in, uint64_t due_tick_in, ExpiryFunctor on_expiry_in)
+        : id(id_in), due_tick(due_tick_in), on_expiry(std::move(on_expiry_in)) {}
+    TimeoutId id;
+    uint64_t due_tick;
+    ExpiryFunctor on_expiry;
+  };
+  typedef std::list<Timeout> Slot;
+
+  void shutdown_service();
+
+  // These must be called with the lock held.
+  uint64_t TickAt(std::chrono::steady_clock::time_point time) const;
+  uint64_t DueTick(std::chrono::steady_clock::duration timeout) const;
+  void Insert(TimeoutId timeout_id, uint64_t due_tick, ExpiryFunctor on_expiry);
+  void StartTicking();
+
+  void OnTick(const boost::system::error_code& error_code);
+
+  const std::chrono::steady_clock::duration kTick_;
+  const std::chrono::steady_clock::time_point kEpoch_;
+  mutable std::mutex mutex_;
+  std::vector<Slot> slots_;
+  std::unordered_map<TimeoutId, std::pair<size_t, Slot::iterator>> timeouts_;
+  TimeoutId next_id_;
+  // All ticks up to and including this one have been expired.
+  uint64_t last_expired_tick_;
+  bool ticking_, shut_down_;
+  Stats stats_;
+  boost::asio::steady_timer timer_;
+};
+
+// Returns the wheel owned by 'io_service', creating it with the default tick and size from
+// config.h if it doesn't yet exist.
+TimerWheel& GetTimerWheel(boost::asio::io_service& io_service);
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_TIMER_WHEEL_H_
@@ -27,6 +27,7 @@
 
 #include "boost/filesystem/operations.hpp"
 
+#include "maidsafe/common/application_support_directories.h"
 #include "maidsafe/common/error.h"
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/make_unique.h"
@@ -114,6 +115,22 @@ std::unique_ptr<asymm::PlainText> Parse<std::unique_ptr<asymm::PlainText>>(
   return maidsafe::make_unique<asymm::PlainText>(challenge.plaintext());
 }
 
+template <>
+ResourceUsage Parse<ResourceUsage>(const std::string& message) {
+  protobuf::VaultUsageResponse vault_usage_response{
+      ParseProto<protobuf::VaultUsageResponse>(message) };
+  if (vault_usage_response.has_serialised_maidsafe_error()) {
+    BOOST_THROW_EXCEPTION(maidsafe::Parse(maidsafe_error::serialised_type(
+        vault_usage_response.serialised_maidsafe_error())));
+  }
+  ResourceUsage usage;
+  usage.cpu_time_usec = vault_usage_response.cpu_time_usec();
+  usage.memory_bytes = vault_usage_response.memory_bytes();
+  usage.io_read_bytes = vault_usage_response.io_read_bytes();
+  usage.io_write_bytes = vault_usage_response.io_write_bytes();
+  return usage;
+}
+
 }  // namespace detail
 
 void ToProtobuf(crypto::AES256Key symm_key, crypto::AES256InitialisationVector symm_iv,
@@ -128,6 +145,11 @@ void ToProtobuf(crypto::AES256Key symm_key, crypto::AES256InitialisationVector s
     protobuf_vault_info->set_max_disk_usage(vault_info.max_disk_usage.data);
   if (vault_info.owner_name->IsInitialised())
     protobuf_vault_info->set_owner_name(vault_info.owner_name->string());
+  ToProtobuf(vault_info.resource_limits, protobuf_vault_info->mutable_resource_limits());
+  for (int cpu : vault_info.placement.cpus)
+    protobuf_vault_info->mutable_placement()->add_cpus(cpu);
+  for (int node : vault_info.placement.numa_nodes)
+    protobuf_vault_info->mutable_placement()->add_numa_nodes(node);
 }
 
 void FromProtobuf(crypto::AES256Key symm_key, crypto::AES256InitialisationVector symm_iv,
@@ -145,6 +167,34 @@ void FromProtobuf(crypto::AES256Key symm_key, crypto::AES256InitialisationVector
     vault_info.owner_name =
         passport::PublicMaid::Name{ Identity{ protobuf_vault_info.owner_name() } };
   }
+  if (protobuf_vault_info.has_resource_limits())
+    FromProtobuf(protobuf_vault_info.resource_limits(), vault_info.resource_limits);
+  if (protobuf_vault_info.has_placement()) {
+    const auto& placement(protobuf_vault_info.placement());
+    vault_info.placement.cpus.assign(std::begin(placement.cpus()), std::end(placement.cpus()));
+    vault_info.placement.numa_nodes.assign(std::begin(placement.numa_nodes()),
+                                           std::end(placement.numa_nodes()));
+  }
+}
+
+void ToProtobuf(const ResourceLimits& resource_limits,
+                protobuf::ResourceLimits* protobuf_resource_limits) {
+  if (resource_limits.cpu_weight != 0U)
+    protobuf_resource_limits->set_cpu_weight(resource_limits.cpu_weight);
+  if (resource_limits.memory_max != 0U)
+    protobuf_resource_limits->set_memory_max(resource_limits.memory_max);
+  if (resource_limits.io_weight != 0U)
+    protobuf_resource_limits->set_io_weight(resource_limits.io_weight);
+  if (resource_limits.max_open_files != 0U)
+    protobuf_resource_limits->set_max_open_files(resource_limits.max_open_files);
+}
+
+void FromProtobuf(const protobuf::ResourceLimits& protobuf_resource_limits,
+                  ResourceLimits& resource_limits) {
+  resource_limits.cpu_weight = protobuf_resource_limits.cpu_weight();
+  resource_limits.memory_max = protobuf_resource_limits.memory_max();
+  resource_limits.io_weight = protobuf_resource_limits.io_weight();
+  resource_limits.max_open_files = protobuf_resource_limits.max_open_files();
 }
 
 std::string WrapMessage(MessageAndType message_and_type) {
@@ -154,14 +204,16 @@ std::string WrapMessage(MessageAndType message_and_type) {
   return wrapper_message.SerializeAsString();
 }
 
-MessageAndType UnwrapMessage(std::string wrapped_message) {
+MessageAndType UnwrapMessage(const std::string& wrapped_message) {
   protobuf::WrapperMessage wrapper;
   if (!wrapper.ParseFromString(wrapped_message)) {
     LOG(kError) << "Failed to unwrap message";
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
   }
 
-  return std::make_pair(wrapper.payload(), static_cast<MessageType>(wrapper.type()));
+  MessageAndType message_and_type{ std::string{}, static_cast<MessageType>(wrapper.type()) };
+  message_and_type.first.swap(*wrapper.mutable_payload());
+  return message_and_type;
 }
 
 NonEmptyString GenerateLabel() {
@@ -181,6 +233,28 @@ Port GetInitialListeningPort() {
 #endif
 }
 
+fs::path GetLocalSocketPath() {
+#ifdef MAIDSAFE_WIN32
+  return fs::path{};
+#elif defined TESTING
+  return (GetTestEnvironmentRootDir().empty() ? GetUserAppDir() : GetTestEnvironmentRootDir()) /
+         kLocalSocketFilename;
+#else
+  return GetSystemAppSupportDir() / kLocalSocketFilename;
+#endif
+}
+
+fs::path GetHandoffSocketPath() {
+#ifndef MAIDSAFE_LINUX
+  return fs::path{};
+#elif defined TESTING
+  return (GetTestEnvironmentRootDir().empty() ? GetUserAppDir() : GetTestEnvironmentRootDir()) /
+         kHandoffSocketFilename;
+#else
+  return GetSystemAppSupportDir() / kHandoffSocketFilename;
+#endif
+}
+
 #ifdef TESTING
 namespace test {
 
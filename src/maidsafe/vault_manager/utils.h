@@ -43,7 +43,9 @@ namespace vault_manager {
 
 class LocalTcpTransport;
 struct VaultInfo;
-namespace protobuf { class VaultInfo; }
+struct ResourceLimits;
+struct ResourceUsage;
+namespace protobuf { class VaultInfo; class ResourceLimits; }
 
 namespace detail {
 
@@ -67,6 +69,10 @@ template <>
 std::unique_ptr<passport::PmidAndSigner> Parse<std::unique_ptr<passport::PmidAndSigner>>(
     const std::string& message);
 
+// Throws the error if the VaultUsageResponse carries one.
+template <>
+ResourceUsage Parse<ResourceUsage>(const std::string& message);
+
 }  // namespace detail
 
 
@@ -85,14 +91,27 @@ void ToProtobuf(crypto::AES256Key symm_key, crypto::AES256InitialisationVector s
 void FromProtobuf(crypto::AES256Key symm_key, crypto::AES256InitialisationVector symm_iv,
                   const protobuf::VaultInfo& protobuf_vault_info, VaultInfo& vault_info);
 
+void ToProtobuf(const ResourceLimits& resource_limits,
+                protobuf::ResourceLimits* protobuf_resource_limits);
+
+void FromProtobuf(const protobuf::ResourceLimits& protobuf_resource_limits,
+                  ResourceLimits& resource_limits);
+
 std::string WrapMessage(MessageAndType message_and_type);
 
-MessageAndType UnwrapMessage(std::string wrapped_message);
+// The payload is moved out of the parsed wrapper rather than copied.
+MessageAndType UnwrapMessage(const std::string& wrapped_message);
 
 NonEmptyString GenerateLabel();
 
 Port GetInitialListeningPort();
 
+// Returns an empty path on Windows, where Unix domain sockets aren't used.
+boost::filesystem::path GetLocalSocketPath();
+
+// Returns an empty path other than on Linux, where VaultManagers can hand over their vaults.
+boost::filesystem::path GetHandoffSocketPath();
+
 #ifdef TESTING
 namespace test {
 
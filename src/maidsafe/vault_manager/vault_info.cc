@@ -30,7 +30,9 @@ VaultInfo::VaultInfo()
       max_disk_usage(0),
       owner_name(),
       label(),
-      tcp_connection() {}
+      tcp_connection(),
+      resource_limits(),
+      placement() {}
 
 VaultInfo::VaultInfo(const VaultInfo& other)
     : pmid_and_signer(other.pmid_and_signer),
@@ -38,7 +40,9 @@ VaultInfo::VaultInfo(const VaultInfo& other)
       max_disk_usage(other.max_disk_usage),
       owner_name(other.owner_name),
       label(other.label),
-      tcp_connection(other.tcp_connection) {}
+      tcp_connection(other.tcp_connection),
+      resource_limits(other.resource_limits),
+      placement(other.placement) {}
 
 VaultInfo::VaultInfo(VaultInfo&& other)
     : pmid_and_signer(std::move(other.pmid_and_signer)),
@@ -46,7 +50,9 @@ VaultInfo::VaultInfo(VaultInfo&& other)
       max_disk_usage(std::move(other.max_disk_usage)),
       owner_name(std::move(other.owner_name)),
       label(std::move(other.label)),
-      tcp_connection(std::move(other.tcp_connection)) {}
+      tcp_connection(std::move(other.tcp_connection)),
+      resource_limits(std::move(other.resource_limits)),
+      placement(std::move(other.placement)) {}
 
 VaultInfo& VaultInfo::operator=(VaultInfo other) {
   swap(*this, other);
@@ -61,6 +67,8 @@ void swap(VaultInfo& lhs, VaultInfo& rhs) {
   swap(lhs.owner_name, rhs.owner_name);
   swap(lhs.label, rhs.label);
   swap(lhs.tcp_connection, rhs.tcp_connection);
+  swap(lhs.resource_limits, rhs.resource_limits);
+  swap(lhs.placement, rhs.placement);
 }
 
 }  // namespace vault_manager
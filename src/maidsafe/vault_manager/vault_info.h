@@ -30,6 +30,8 @@
 #include "maidsafe/passport/passport.h"
 
 #include "maidsafe/vault_manager/config.h"
+#include "maidsafe/vault_manager/placement.h"
+#include "maidsafe/vault_manager/resource_limits.h"
 
 namespace maidsafe {
 
@@ -47,6 +49,8 @@ struct VaultInfo {
   passport::PublicMaid::Name owner_name;
   NonEmptyString label;
   TcpConnectionPtr tcp_connection;
+  ResourceLimits resource_limits;
+  Placement placement;
 };
 
 void swap(VaultInfo& lhs, VaultInfo& rhs);
@@ -18,12 +18,20 @@
 
 #include "maidsafe/vault_manager/vault_interface.h"
 
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <limits>
+
 #include "maidsafe/common/make_unique.h"
 #include "maidsafe/common/on_scope_exit.h"
 #include "maidsafe/common/utils.h"
 
+#include "maidsafe/vault_manager/config.h"
 #include "maidsafe/vault_manager/dispatcher.h"
+#include "maidsafe/vault_manager/interprocess_messages.pb.h"
 #include "maidsafe/vault_manager/rpc_helper.h"
+#include "maidsafe/vault_manager/shared_memory_ring.h"
 #include "maidsafe/vault_manager/tcp_connection.h"
 #include "maidsafe/vault_manager/utils.h"
 
@@ -33,49 +41,246 @@ namespace maidsafe {
 
 namespace vault_manager {
 
+namespace {
+
+bool IsNumber(const std::string& text) {
+  return !text.empty() &&
+         std::all_of(std::begin(text), std::end(text), [](char c) { return std::isdigit(c) != 0; });
+}
+
+// 'address' is in the form of a vault's first positional argument: a port or a socket path.
+TcpConnectionPtr ConnectToVaultManager(AsioService& asio_service, const std::string& address) {
+#ifndef MAIDSAFE_WIN32
+  if (address.find_first_not_of("0123456789") != std::string::npos)
+    return TcpConnection::MakeShared(asio_service, fs::path{ address });
+#endif
+  return TcpConnection::MakeShared(asio_service, static_cast<Port>(std::stoi(address)));
+}
+
+}  // unnamed namespace
+
+std::unique_ptr<VaultInterface> VaultInterface::MakeUnique(
+    const std::string& vault_manager_argument) {
+#ifndef MAIDSAFE_WIN32
+  const std::string& kPrefix(kInheritedChannelArgPrefix);
+  if (vault_manager_argument.compare(0, kPrefix.size(), kPrefix) == 0) {
+    const std::string kDescriptor{ vault_manager_argument.substr(kPrefix.size()) };
+    if (!IsNumber(kDescriptor) || kDescriptor.size() > 9) {
+      LOG(kError) << "Invalid inherited channel " << vault_manager_argument;
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+    }
+    return maidsafe::make_unique<VaultInterface>(InheritedChannel{ std::stoi(kDescriptor) });
+  }
+  if (!vault_manager_argument.empty() && !IsNumber(vault_manager_argument))
+    return maidsafe::make_unique<VaultInterface>(fs::path{ vault_manager_argument });
+#endif
+  if (!IsNumber(vault_manager_argument) || vault_manager_argument.size() > 5 ||
+      std::stoi(vault_manager_argument) == 0 ||
+      std::stoi(vault_manager_argument) > std::numeric_limits<Port>::max()) {
+    LOG(kError) << "Invalid VaultManager port " << vault_manager_argument;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  return maidsafe::make_unique<VaultInterface>(
+      static_cast<Port>(std::stoi(vault_manager_argument)));
+}
+
 VaultInterface::VaultInterface(Port vault_manager_port)
+    : VaultInterface([vault_manager_port](AsioService& asio_service) {
+        TcpConnectionPtr tcp_connection{
+            TcpConnection::MakeShared(asio_service, vault_manager_port) };
+        LOG(kSuccess) << "Connected to VaultManager which is listening on port "
+                      << vault_manager_port;
+        return tcp_connection;
+      }) {}
+
+#ifndef MAIDSAFE_WIN32
+VaultInterface::VaultInterface(const fs::path& vault_manager_socket_path)
+    : VaultInterface([vault_manager_socket_path](AsioService& asio_service) {
+        TcpConnectionPtr tcp_connection{
+            TcpConnection::MakeShared(asio_service, vault_manager_socket_path) };
+        LOG(kSuccess) << "Connected to VaultManager which is listening on "
+                      << vault_manager_socket_path;
+        return tcp_connection;
+      }) {}
+
+VaultInterface::VaultInterface(InheritedChannel vault_manager_channel)
+    : VaultInterface([vault_manager_channel](AsioService& asio_service) {
+        TcpConnectionPtr tcp_connection{ TcpConnection::MakeSharedFromNativeSocket(
+            asio_service, vault_manager_channel.native_socket) };
+        LOG(kSuccess) << "Using channel to VaultManager inherited as descriptor "
+                      << vault_manager_channel.native_socket;
+        return tcp_connection;
+      }) {}
+#endif
+
+VaultInterface::VaultInterface(
+    std::function<TcpConnectionPtr(AsioService&)> connect_to_vault_manager)
     : exit_code_promise_(),
       exit_code_flag_(),
-      vault_manager_port_(vault_manager_port),
       on_vault_started_response_(),
+      mutex_(),
       vault_config_(),
+      move_chunkstore_(),
+      chunkstore_move_(),
+      ring_mutex_(),
+      ring_(),
+      dropped_message_count_(0),
+      connection_mutex_(),
+      reconnect_address_(),
+      exiting_(false),
+      reconnect_deadline_(),
       asio_service_(1),
-      tcp_connection_(TcpConnection::MakeShared(asio_service_, vault_manager_port_)),
-      connection_closer_([&] { tcp_connection_->Close(); }) {
-  tcp_connection_->Start([this](std::string message) { HandleReceivedMessage(message); },
+      reconnect_timer_(maidsafe::make_unique<boost::asio::steady_timer>(asio_service_.service())),
+      tcp_connection_(connect_to_vault_manager(asio_service_)),
+      connection_closer_([&] { Connection()->Close(); }) {
+  tcp_connection_->Start([this](const std::string& message) { HandleReceivedMessage(message); },
                          [this] { OnConnectionClosed(); });
-  LOG(kSuccess) << "Connected to VaultManager which is listening on port " << vault_manager_port_;
   std::mutex mutex;
   auto vault_config_future(SetResponseCallback<std::unique_ptr<VaultConfig>>(
       on_vault_started_response_, asio_service_.service(), mutex));
-  SendVaultStarted(tcp_connection_);
+  SendVaultStarted(tcp_connection_, true);
   vault_config_ = vault_config_future.get();
   LOG(kSuccess) << "Retrieved config info from VaultManager";
 }
 
+VaultInterface::~VaultInterface() {
+  {
+    std::lock_guard<std::mutex> lock{ connection_mutex_ };
+    exiting_ = true;  // The connection is about to be closed, and mustn't be replaced.
+  }
+  std::future<void> chunkstore_move;
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    chunkstore_move = std::move(chunkstore_move_);
+  }
+  if (chunkstore_move.valid())
+    chunkstore_move.wait();
+}
+
 VaultConfig VaultInterface::GetConfiguration() {
+  std::lock_guard<std::mutex> lock{ mutex_ };
   return *vault_config_;
 }
 
+void VaultInterface::SetMoveChunkstoreFunctor(MoveChunkstoreFunctor move_chunkstore) {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  move_chunkstore_ = move_chunkstore;
+}
+
 int VaultInterface::WaitForExit() {
   return exit_code_promise_.get_future().get();
 }
 
 void VaultInterface::SendBootstrapContactToVaultManager(const routing::BootstrapContact& contact) {
-  SendBootstrapContact(tcp_connection_, contact);
+  {
+    std::lock_guard<std::mutex> lock{ ring_mutex_ };
+    if (ring_) {
+      protobuf::BootstrapContact message;
+      message.set_serialised_contact(routing::SerialiseBootstrapContact(contact));
+      if (!ring_->TryPush(MessageType::kBootstrapContact, message.SerializeAsString())) {
+        ++dropped_message_count_;
+        LOG(kWarning) << "Dropped bootstrap contact since the shared memory ring is full.";
+      }
+      return;
+    }
+  }
+  SendBootstrapContact(Connection(), contact);
+}
+
+void VaultInterface::SendLogMessageToVaultManager(const std::string& log_message) {
+  {
+    std::lock_guard<std::mutex> lock{ ring_mutex_ };
+    if (ring_) {
+      // Not logged, since that could generate yet more log messages.
+      if (!ring_->TryPush(MessageType::kLogMessage, log_message))
+        ++dropped_message_count_;
+      return;
+    }
+  }
+  SendLogMessage(Connection(), log_message);
 }
 
 void VaultInterface::SendJoined() {
-  SendJoinedNetwork(tcp_connection_);
+  SendJoinedNetwork(Connection());
+}
+
+uint64_t VaultInterface::DroppedMessageCount() {
+  std::lock_guard<std::mutex> lock{ ring_mutex_ };
+  return dropped_message_count_;
+}
+
+TcpConnectionPtr VaultInterface::Connection() {
+  std::lock_guard<std::mutex> lock{ connection_mutex_ };
+  return tcp_connection_;
 }
 
 void VaultInterface::OnConnectionClosed() {
+  {
+    std::lock_guard<std::mutex> lock{ connection_mutex_ };
+    if (!exiting_ && !reconnect_address_.empty()) {
+      LOG(kWarning) << "Lost connection to Vault Manager; trying to reconnect.";
+      reconnect_deadline_ = std::chrono::steady_clock::now() + kVaultReconnectTimeout;
+      return ScheduleReconnect();
+    }
+  }
   LOG(kError) << "Lost connection to Vault Manager";
   std::call_once(exit_code_flag_, [this] {
       exit_code_promise_.set_value(ErrorToInt(MakeError(VaultManagerErrors::connection_aborted)));
   });
 }
 
+void VaultInterface::ScheduleReconnect() {
+  reconnect_timer_->expires_from_now(kVaultReconnectInterval);
+  reconnect_timer_->async_wait([this](const boost::system::error_code& error_code) {
+    if (error_code != boost::asio::error::operation_aborted)
+      Reconnect();
+  });
+}
+
+void VaultInterface::Reconnect() {
+  std::string reconnect_address;
+  {
+    std::lock_guard<std::mutex> lock{ connection_mutex_ };
+    if (exiting_)
+      return;
+    reconnect_address = reconnect_address_;
+  }
+  TcpConnectionPtr connection;
+  try {
+    connection = ConnectToVaultManager(asio_service_, reconnect_address);
+  }
+  catch (const std::exception&) {
+    {
+      std::lock_guard<std::mutex> lock{ connection_mutex_ };
+      if (exiting_)
+        return;
+      if (std::chrono::steady_clock::now() < reconnect_deadline_)
+        return ScheduleReconnect();
+    }
+    LOG(kError) << "Failed to reconnect to Vault Manager at " << reconnect_address;
+    std::call_once(exit_code_flag_, [this] {
+        exit_code_promise_.set_value(ErrorToInt(MakeError(VaultManagerErrors::connection_aborted)));
+    });
+    return;
+  }
+
+  {
+    // The ring was provided by the VaultManager we've lost.
+    std::lock_guard<std::mutex> lock{ ring_mutex_ };
+    ring_.reset();
+  }
+  {
+    std::lock_guard<std::mutex> lock{ connection_mutex_ };
+    if (exiting_)
+      return connection->Close();
+    tcp_connection_ = connection;
+  }
+  connection->Start([this](const std::string& message) { HandleReceivedMessage(message); },
+                    [this] { OnConnectionClosed(); });
+  SendVaultReconnected(connection);
+  LOG(kSuccess) << "Reconnected to VaultManager at " << reconnect_address;
+}
+
 void VaultInterface::HandleReceivedMessage(const std::string& wrapped_message) {
   try {
     MessageAndType message_and_type{ UnwrapMessage(wrapped_message) };
@@ -88,6 +293,12 @@ void VaultInterface::HandleReceivedMessage(const std::string& wrapped_message) {
         assert(message_and_type.first.empty());
         HandleVaultShutdownRequest();
         break;
+      case MessageType::kMoveChunkstoreRequest:
+        HandleMoveChunkstoreRequest(message_and_type.first);
+        break;
+      case MessageType::kHealthProbe:
+        HandleHealthProbe(message_and_type.first);
+        break;
       default:
         return;
     }
@@ -99,25 +310,107 @@ void VaultInterface::HandleReceivedMessage(const std::string& wrapped_message) {
 
 void VaultInterface::HandleVaultStartedResponse(const std::string& message) {
   if (on_vault_started_response_) {
+    ApplyConnectionDetails(message);
     on_vault_started_response_(message);
   } else {
     assert(false);  // already received vault configuration
   }
 }
 
+void VaultInterface::ApplyConnectionDetails(const std::string& vault_started_response) {
+  try {
+    protobuf::VaultStartedResponse response{
+        ParseProto<protobuf::VaultStartedResponse>(vault_started_response) };
+    if (response.has_reconnect_address()) {
+      std::lock_guard<std::mutex> lock{ connection_mutex_ };
+      reconnect_address_ = response.reconnect_address();
+    }
+    if (!response.has_shared_memory_ring_name())
+      return;
+    std::unique_ptr<SharedMemoryRing> ring{
+        SharedMemoryRing::Open(response.shared_memory_ring_name()) };
+    std::lock_guard<std::mutex> lock{ ring_mutex_ };
+    ring_ = std::move(ring);
+    LOG(kVerbose) << "Using shared memory ring " << ring_->Name();
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << "Not using shared memory ring: " << boost::diagnostic_information(e);
+  }
+}
+
 void VaultInterface::HandleVaultShutdownRequest() {
   LOG(kInfo) << "Received  ShutdownRequest from Vault Manager";
+  {
+    std::lock_guard<std::mutex> lock{ connection_mutex_ };
+    exiting_ = true;
+  }
   std::call_once(exit_code_flag_, [this] { exit_code_promise_.set_value(0); });
 }
 
+void VaultInterface::HandleHealthProbe(const std::string& message) {
+  protobuf::HealthProbe probe{ ParseProto<protobuf::HealthProbe>(message) };
+  SendHealthProbeResponse(Connection(), probe.sequence());
+}
+
+void VaultInterface::HandleMoveChunkstoreRequest(const std::string& message) {
+  protobuf::MoveChunkstoreRequest request{ ParseProto<protobuf::MoveChunkstoreRequest>(message) };
+  fs::path new_vault_dir{ request.vault_dir() };
+  DiskUsage max_disk_usage{ request.max_disk_usage() };
+  LOG(kInfo) << "Received MoveChunkstoreRequest to " << new_vault_dir;
+  maidsafe_error error{ MakeError(CommonErrors::uninitialised) };
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    if (chunkstore_move_.valid() &&
+        chunkstore_move_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      LOG(kError) << "Already moving the chunkstore.";
+      error = MakeError(CommonErrors::already_initialised);
+    } else if (move_chunkstore_) {
+      // The functor can take a long time, so it mustn't block the connection's only thread.
+      MoveChunkstoreFunctor move_chunkstore{ move_chunkstore_ };
+      chunkstore_move_ = std::async(std::launch::async, [=] {
+        MoveChunkstore(move_chunkstore, new_vault_dir, max_disk_usage);
+      });
+      return;
+    }
+  }
+  SendMoveChunkstoreResponse(Connection(), new_vault_dir, &error);
+}
+
+void VaultInterface::MoveChunkstore(MoveChunkstoreFunctor move_chunkstore, fs::path new_vault_dir,
+                                    DiskUsage max_disk_usage) {
+  maidsafe_error error{ MakeError(CommonErrors::unknown) };
+  try {
+    move_chunkstore(new_vault_dir, max_disk_usage, [this](uint64_t bytes_moved,
+                                                          uint64_t total_bytes) {
+      SendMoveChunkstoreProgress(Connection(), bytes_moved, total_bytes);
+    });
+    {
+      std::lock_guard<std::mutex> lock{ mutex_ };
+      vault_config_->vault_dir = new_vault_dir;
+      vault_config_->max_disk_usage = max_disk_usage;
+    }
+    LOG(kSuccess) << "Moved chunkstore to " << new_vault_dir;
+    return SendMoveChunkstoreResponse(Connection(), new_vault_dir);
+  }
+  catch (const maidsafe_error& e) {
+    LOG(kError) << "Failed to move chunkstore: " << boost::diagnostic_information(e);
+    error = e;
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed to move chunkstore: " << boost::diagnostic_information(e);
+  }
+  SendMoveChunkstoreResponse(Connection(), new_vault_dir, &error);
+}
+
 #ifdef TESTING
 void VaultInterface::KillConnection() {
   maidsafe::Sleep(std::chrono::seconds(1));
+  std::lock_guard<std::mutex> lock{ connection_mutex_ };
   tcp_connection_.reset();
 }
 
 void VaultInterface::SendInvalidMessage() {
-  tcp_connection_->Send("Rubbish");
+  Connection()->Send("Rubbish");
 }
 
 void VaultInterface::StopProcess() {
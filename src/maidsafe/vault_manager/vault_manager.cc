@@ -18,14 +18,22 @@
 
 #include "maidsafe/vault_manager/vault_manager.h"
 
+#include <chrono>
+#include <future>
 #include <string>
+#include <utility>
 #include <vector>
 
+#ifndef MAIDSAFE_WIN32
+#include <unistd.h>
+#endif
+
 #include "boost/filesystem/operations.hpp"
 
 #include "maidsafe/common/application_support_directories.h"
 #include "maidsafe/common/error.h"
 #include "maidsafe/common/log.h"
+#include "maidsafe/common/on_scope_exit.h"
 #include "maidsafe/common/process.h"
 #include "maidsafe/common/utils.h"
 #include "maidsafe/passport/passport.h"
@@ -33,13 +41,17 @@
 
 #include "maidsafe/vault_manager/client_connections.h"
 #include "maidsafe/vault_manager/dispatcher.h"
+#include "maidsafe/vault_manager/handoff.h"
 #include "maidsafe/vault_manager/interprocess_messages.pb.h"
 #include "maidsafe/vault_manager/new_connections.h"
 #include "maidsafe/vault_manager/process_manager.h"
+#include "maidsafe/vault_manager/ring_drainer.h"
+#include "maidsafe/vault_manager/rolling_upgrade.h"
 #include "maidsafe/vault_manager/tcp_connection.h"
 #include "maidsafe/vault_manager/tcp_listener.h"
 #include "maidsafe/vault_manager/utils.h"
 #include "maidsafe/vault_manager/vault_info.pb.h"
+#include "maidsafe/vault_manager/worker_pool.h"
 
 namespace fs = boost::filesystem;
 
@@ -65,12 +77,121 @@ fs::path GetBootstrapFilePath() {
   return GetPath(kBootstrapFilename);
 }
 
+// Returns 'descriptor', leaving -1 in its place.
+int TakeDescriptor(int& descriptor) {
+  int taken{ descriptor };
+  descriptor = -1;
+  return taken;
+}
+
+// Each of these adopts the corresponding listening socket handed over by 'predecessor' if possible.
+
+std::shared_ptr<TcpListener> StartListener(AsioService& asio_service,
+                                           NewConnectionFunctor on_new_connection,
+                                           Handoff* predecessor) {
+#ifndef MAIDSAFE_WIN32
+  if (predecessor && predecessor->listener != -1) {
+    return TcpListener::MakeSharedFromNativeSocket(asio_service, on_new_connection,
+                                                   TakeDescriptor(predecessor->listener));
+  }
+#else
+  static_cast<void>(predecessor);
+#endif
+  return TcpListener::MakeShared(asio_service, on_new_connection, GetInitialListeningPort());
+}
+
+std::shared_ptr<TcpListener> StartLocalListener(AsioService& asio_service,
+                                               NewConnectionFunctor on_new_connection,
+                                               Handoff* predecessor) {
+#ifdef MAIDSAFE_WIN32
+  static_cast<void>(asio_service);
+  static_cast<void>(on_new_connection);
+  static_cast<void>(predecessor);
+  return nullptr;
+#else
+  try {
+    if (predecessor && predecessor->local_listener != -1) {
+      return TcpListener::MakeSharedFromNativeSocket(asio_service, on_new_connection,
+                                                     TakeDescriptor(predecessor->local_listener));
+    }
+    return TcpListener::MakeShared(asio_service, on_new_connection, GetLocalSocketPath());
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << "Not listening on a Unix domain socket, falling back to TCP only: "
+                  << boost::diagnostic_information(e);
+    return nullptr;
+  }
+#endif
+}
+
+std::shared_ptr<TcpListener> StartHandoffListener(AsioService& asio_service,
+                                                 NewConnectionFunctor on_new_connection,
+                                                 Handoff* predecessor, bool can_hand_off) {
+#ifdef MAIDSAFE_LINUX
+  int native_socket{ predecessor ? TakeDescriptor(predecessor->handoff_listener) : -1 };
+  if (!can_hand_off) {
+    if (native_socket != -1)
+      close(native_socket);
+    return nullptr;
+  }
+  try {
+    if (native_socket != -1)
+      return TcpListener::MakeSharedFromNativeSocket(asio_service, on_new_connection,
+                                                     native_socket);
+    return TcpListener::MakeShared(asio_service, on_new_connection, GetHandoffSocketPath());
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << "Vaults can't be handed over to a successor: "
+                  << boost::diagnostic_information(e);
+    return nullptr;
+  }
+#else
+  static_cast<void>(asio_service);
+  static_cast<void>(on_new_connection);
+  static_cast<void>(predecessor);
+  static_cast<void>(can_hand_off);
+  return nullptr;
+#endif
+}
+
 #ifndef TESTING
 fs::path GetVaultDir(const std::string& debug_id) {
   return GetPath(debug_id);
 }
 #endif
 
+// Returns the process ID of the vault at the other end of 'connection' as reported by the OS, or if
+// that isn't available (i.e. other than for Unix domain sockets on Linux), 'claimed_process_id'.
+// Closes the connection and throws if the peer is shown to be an impostor, i.e. a process other
+// than the claimed one, or one run by a different user.  Only vaults connecting via the Unix domain
+// socket (VaultChannel::kLocalSocket) can be checked, so with the default kTcpPort, nothing is.
+ProcessId VaultProcessId(TcpConnectionPtr connection, ProcessId claimed_process_id) {
+  const TcpConnection::PeerCredentials kPeer{ connection->GetPeerCredentials() };
+  // TODO(Fraser#5#): 2014-05-20 - We should validate received ProcessID since a malicious process
+  //                  could have spotted a new vault process starting and jumped in with this TCP
+  //                  connection before the new vault can connect, passing itself off as the new
+  //                  vault (i.e. lying about its own Process ID).
+  if (!kPeer.valid)
+    return claimed_process_id;
+#ifndef MAIDSAFE_WIN32
+  if (kPeer.user_id != static_cast<uint32_t>(geteuid())) {
+    LOG(kError) << "Rejecting vault run by user " << kPeer.user_id << "; vaults are run by user "
+                << geteuid();
+    connection->Close();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+#endif
+  if (kPeer.process_id == 0)
+    return claimed_process_id;
+  if (kPeer.process_id != claimed_process_id) {
+    LOG(kError) << "Rejecting process " << kPeer.process_id << " claiming to be vault process "
+                << claimed_process_id;
+    connection->Close();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  return kPeer.process_id;
+}
+
 fs::path GetVaultExecutablePath() {
 #ifdef TESTING
   if (!GetPathToVault().empty())
@@ -81,61 +202,508 @@ fs::path GetVaultExecutablePath() {
 
 }  // unnamed namespace
 
-VaultManager::VaultManager()
+VaultManager::VaultManager(uint32_t thread_count, PlacementPolicy placement_policy,
+                           std::function<void()> on_handed_off, VaultChannel vault_channel,
+                           bool take_over)
     : kBootstrapFilePath_(GetBootstrapFilePath()),
       config_file_handler_(GetConfigFilePath()),
-      asio_service_(1),
-      listener_(TcpListener::MakeShared(asio_service_,
+      config_file_mutex_(),
+      config_file_finalised_(false),
+      startup_complete_(false),
+      config_file_write_pending_(false),
+      kOnHandedOff_(on_handed_off),
+      predecessor_(take_over ? ReceiveHandoff(GetHandoffSocketPath()) : nullptr),
+      asio_service_(thread_count),
+      listener_(StartListener(asio_service_,
           [this](TcpConnectionPtr connection) { HandleNewConnection(connection); },
-          GetInitialListeningPort())),
+          predecessor_.get())),
+      local_listener_(StartLocalListener(asio_service_,
+          [this](TcpConnectionPtr connection) { HandleNewConnection(connection); },
+          predecessor_.get())),
       process_manager_(ProcessManager::MakeShared(asio_service_.service(),
-                       GetVaultExecutablePath(), listener_->ListeningPort())),
-      client_connections_(ClientConnections::MakeShared(asio_service_.service())),
-      new_connections_(NewConnections::MakeShared(asio_service_.service())) {
-  std::vector<VaultInfo> vaults{ config_file_handler_.ReadConfigFile() };
-  if (vaults.empty()) {
-#ifndef TESTING
-    VaultInfo vault_info;
-    vault_info.pmid_and_signer =
-        std::make_shared<passport::PmidAndSigner>(passport::CreatePmidAndSigner());
-    vault_info.vault_dir = GetVaultDir(DebugId(vault_info.pmid_and_signer->first.name().value));
-    if (!fs::exists(vault_info.vault_dir))
-      fs::create_directories(vault_info.vault_dir);
-    auto space_info(fs::space(vault_info.vault_dir));
-    vault_info.max_disk_usage = DiskUsage{ (9 * space_info.available) / 10 };
-    vault_info.label = GenerateLabel();
-    process_manager_->AddProcess(std::move(vault_info));
-#endif
-  } else {
-    for (auto& vault_info : vaults)
-      process_manager_->AddProcess(std::move(vault_info));
-  }
+                       GetVaultExecutablePath(), listener_->ListeningPort(),
+                       local_listener_ && vault_channel == VaultChannel::kLocalSocket ?
+                           local_listener_->LocalSocketPath() : fs::path{},
+                       vault_channel == VaultChannel::kInheritedChannel ?
+                           ProcessManager::AdoptChannelFunctor{ [this](int native_socket) {
+                             return AdoptVaultChannel(native_socket);
+                           } } : nullptr,
+                       [this](const VaultInfo& info) { HandleVaultQuarantined(info); },
+                       [this](const NonEmptyString& label) {
+                         HandleConfiguredVaultReported(label, false);
+                       },
+                       RestartPolicy{}, placement_policy)),
+      handoff_listener_(StartHandoffListener(asio_service_,
+          [this](TcpConnectionPtr connection) { HandleHandoffConnection(connection); },
+          predecessor_.get(), process_manager_->CanHandOff())),
+      handoff_mutex_(),
+      handing_off_(false),
+      handoff_(),
+      verification_pool_(new WorkerPool{ kVerificationThreads, kMaxQueuedVerifications,
+                                         kVerificationBatchSize }),
+      client_connections_(ClientConnections::MakeShared(asio_service_.service(),
+                                                        *verification_pool_)),
+      new_connections_(NewConnections::MakeShared(asio_service_.service(), AdmissionPolicy{},
+          [this](bool available) { HandleAdmissionCapacityChanged(available); })),
+      ring_drainer_(RingDrainer::MakeShared(asio_service_.service(),
+          [this](TcpConnectionPtr connection, MessageType type, const std::string& payload) {
+            HandleRingRecord(connection, type, payload);
+          })),
+      upgrade_mutex_(),
+      rolling_upgrade_(),
+      rollback_executable_path_(),
+      replaced_executable_path_(),
+      chunkstore_moves_mutex_(),
+      chunkstore_moves_(),
+      startup_mutex_(),
+      configured_vaults_starting_(),
+      configured_vault_count_(0),
+      configured_vaults_running_(0),
+      startup_(std::async(std::launch::async, [this] {
+        SnapshotVaultExecutable();
+        StartConfiguredVaults();
+      })) {
   LOG(kInfo) << "VaultManager started";
 }
 
 VaultManager::~VaultManager() {
+  // Ensure all configured vaults are known to process_manager_ before stopping them.
+  startup_.wait();
+  std::future<void> handoff;
+  {
+    std::lock_guard<std::mutex> lock{ handoff_mutex_ };
+    handing_off_ = true;  // Refuse any further successor.
+    handoff = std::move(handoff_);
+  }
+  // If we've handed over, there are no vaults left to stop below.
+  if (handoff.valid())
+    handoff.wait();
   auto listener(listener_);
+  auto local_listener(local_listener_);
+  auto handoff_listener(handoff_listener_);
   auto new_connections(new_connections_);
   auto client_connections(client_connections_);
-  auto process_manager(process_manager_);
+  auto ring_drainer(ring_drainer_);
   asio_service_.service().post([=] {
     listener->StopListening();
+    if (local_listener)
+      local_listener->StopListening();
+    if (handoff_listener)
+      handoff_listener->StopListening();
     new_connections->CloseAll();
     client_connections->CloseAll();
-    process_manager->StopAll();
   });
+
+  {
+    std::lock_guard<std::mutex> lock{ upgrade_mutex_ };
+    if (rolling_upgrade_)
+      rolling_upgrade_->Stop();
+  }
+
+  // Record the vaults as they are before stopping them, so that they're all restarted next time.
+  try {
+    WriteConfigFile(true);
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed to write config file: " << boost::diagnostic_information(e);
+  }
+  StopAllReport report{ process_manager_->StopAll() };
+  LOG(kInfo) << "Stopped " << report.vault_count << " vault(s) in "
+             << std::chrono::duration_cast<std::chrono::milliseconds>(report.drain_time).count()
+             << " ms: " << report.stopped << " on request, " << report.terminated
+             << " after SIGTERM and " << report.killed << " killed.";
+  NewConnections::Stats admissions{ new_connections_->GetStats() };
+  LOG(kInfo) << "Admitted " << admissions.admitted << " new connection(s), of which "
+             << admissions.timed_out << " timed out; rejected " << admissions.rejected_full
+             << " while full, " << admissions.rejected_per_user << " over the per-user limit and "
+             << admissions.rejected_per_process << " over the per-process limit.";
+  WorkerPool::Stats verifications{ verification_pool_->GetStats() };
+  LOG(kInfo) << "Checked " << verifications.completed << " client challenge response(s) in "
+             << verifications.batches << " batch(es), with at most "
+             << verifications.max_queue_depth << " queued; rejected "
+             << verifications.rejected << " while the queue was full.";
+
+  asio_service_.service().post([ring_drainer] { ring_drainer->CloseAll(); });
   asio_service_.Stop();
 }
 
+std::future<void> VaultManager::UpgradeVaults(const fs::path& vault_executable_path,
+                                              size_t batch_size) {
+  // Until then, process_manager_ may not yet hold all of the vaults listed in the config file.
+  startup_.wait();
+  std::lock_guard<std::mutex> lock{ upgrade_mutex_ };
+  if (rolling_upgrade_) {
+    LOG(kError) << "A vault upgrade is already in progress.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+  }
+  const fs::path kCurrentExecutablePath{ process_manager_->VaultExecutablePath() };
+  fs::path new_executable_path{ vault_executable_path };
+  if (new_executable_path.empty()) {
+    // Having rolled back an upgrade in place, the vaults run from the copy rather than from the
+    // executable which was replaced.
+    new_executable_path = replaced_executable_path_.empty() ? kCurrentExecutablePath :
+                                                              replaced_executable_path_;
+  }
+  const fs::path kNewExecutablePath{ new_executable_path };
+  // If the executable has been replaced in place, the vaults can only be rolled back to the copy.
+  const bool kInPlace{ kNewExecutablePath == kCurrentExecutablePath };
+  if (kInPlace && rollback_executable_path_.empty()) {
+    LOG(kWarning) << "No copy of the previous vault executable, so this upgrade can't be rolled "
+                  << "back; vaults would be restarted from " << kNewExecutablePath << " again.";
+  }
+  const fs::path kOldExecutablePath{ kInPlace && !rollback_executable_path_.empty() ?
+                                     rollback_executable_path_ : kCurrentExecutablePath };
+  // Vaults added during the upgrade start from the new executable; this also validates it.
+  process_manager_->SetVaultExecutablePath(kNewExecutablePath);
+
+  std::vector<NonEmptyString> labels;
+  for (const auto& vault_info : process_manager_->GetAll())
+    labels.push_back(vault_info.label);
+  auto process_manager(process_manager_);
+  auto promise(std::make_shared<std::promise<void>>());
+  rolling_upgrade_ = RollingUpgrade::MakeShared(asio_service_.service(), std::move(labels),
+      kOldExecutablePath, kNewExecutablePath, batch_size,
+      [process_manager](const NonEmptyString& label, const fs::path& executable_path) {
+        return process_manager->RestartVault(label, executable_path);
+      },
+      [this, process_manager, kOldExecutablePath, kNewExecutablePath,
+       promise](maidsafe_error error) {
+        const bool kSucceeded{ error.code() == make_error_code(CommonErrors::success) };
+        {
+          std::lock_guard<std::mutex> lock{ upgrade_mutex_ };
+          rolling_upgrade_.reset();
+          if (kSucceeded)
+            replaced_executable_path_.clear();
+          else if (kOldExecutablePath == rollback_executable_path_)
+            replaced_executable_path_ = kNewExecutablePath;
+        }
+        if (kSucceeded) {
+          SnapshotVaultExecutable();
+          return promise->set_value();
+        }
+        try {
+          process_manager->SetVaultExecutablePath(kOldExecutablePath);
+        }
+        catch (const std::exception& e) {
+          LOG(kError) << boost::diagnostic_information(e);
+        }
+        promise->set_exception(std::make_exception_ptr(error));
+      });
+  rolling_upgrade_->Start();
+  return promise->get_future();
+}
+
+void VaultManager::SnapshotVaultExecutable() {
+  const fs::path kExecutablePath{ process_manager_->VaultExecutablePath() };
+  const fs::path kRollbackPath{ GetPath("rollback") / kExecutablePath.filename() };
+  std::lock_guard<std::mutex> lock{ upgrade_mutex_ };
+  if (kExecutablePath == kRollbackPath)
+    return;  // Already running from the copy, having rolled back.
+  try {
+    // Renamed into place, since the previous copy may still be running.
+    const fs::path kTempPath{ kRollbackPath.string() + ".tmp" };
+    fs::create_directories(kRollbackPath.parent_path());
+    fs::copy_file(kExecutablePath, kTempPath, fs::copy_option::overwrite_if_exists);
+    fs::rename(kTempPath, kRollbackPath);
+    rollback_executable_path_ = kRollbackPath;
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << "Failed to copy the vault executable to " << kRollbackPath
+                  << "; upgrades replacing it in place can't be rolled back: "
+                  << boost::diagnostic_information(e);
+    rollback_executable_path_.clear();
+  }
+}
+
+void VaultManager::StartConfiguredVaults() {
+  on_scope_exit finish_startup{ [this] { FinishStartup(); } };
+  if (predecessor_)
+    return AdoptHandedOffVaults();
+  std::vector<VaultInfo> vaults;
+  try {
+    vaults = config_file_handler_.ReadConfigFile();
+    if (vaults.empty()) {
+#ifndef TESTING
+      VaultInfo vault_info;
+      vault_info.pmid_and_signer =
+          std::make_shared<passport::PmidAndSigner>(passport::CreatePmidAndSigner());
+      vault_info.vault_dir = GetVaultDir(DebugId(vault_info.pmid_and_signer->first.name().value));
+      if (!fs::exists(vault_info.vault_dir))
+        fs::create_directories(vault_info.vault_dir);
+      auto space_info(fs::space(vault_info.vault_dir));
+      vault_info.max_disk_usage = DiskUsage{ (9 * space_info.available) / 10 };
+      vault_info.label = GenerateLabel();
+      vaults.push_back(std::move(vault_info));
+#endif
+    }
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed to load vaults: " << boost::diagnostic_information(e);
+    return FreezeConfigFile();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock{ startup_mutex_ };
+    configured_vault_count_ = vaults.size();
+    for (const auto& vault_info : vaults)
+      configured_vaults_starting_.insert(vault_info.label.string());
+  }
+  // Each vault is only launched here; they all report in concurrently via HandleVaultStarted.
+  // Vaults which fail to launch are kept by process_manager_ (and retried), so they stay in the
+  // config file.
+  for (auto& vault_info : vaults) {
+    NonEmptyString label{ vault_info.label };
+    try {
+      if (!process_manager_->RestoreProcess(std::move(vault_info)))
+        HandleConfiguredVaultReported(label, false);
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Failed to restore vault " << label.string() << ": "
+                  << boost::diagnostic_information(e);
+      HandleConfiguredVaultReported(label, false);
+      FreezeConfigFile();
+    }
+  }
+}
+
+void VaultManager::FreezeConfigFile() {
+  LOG(kError) << "Not all vaults could be loaded from the config file; it won't be overwritten.";
+  std::lock_guard<std::mutex> lock{ config_file_mutex_ };
+  config_file_finalised_ = true;
+}
+
+void VaultManager::FinishStartup() {
+  bool write_pending{ false };
+  {
+    std::lock_guard<std::mutex> lock{ config_file_mutex_ };
+    startup_complete_ = true;
+    std::swap(write_pending, config_file_write_pending_);
+  }
+  if (!write_pending)
+    return;
+  try {
+    WriteConfigFile();
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed to write config file: " << boost::diagnostic_information(e);
+  }
+}
+
+void VaultManager::AdoptHandedOffVaults() {
+  std::vector<HandedOffVault> vaults;
+  vaults.swap(predecessor_->vaults);
+  predecessor_.reset();  // Closes any listening sockets which couldn't be adopted.
+  {
+    std::lock_guard<std::mutex> lock{ startup_mutex_ };
+    configured_vault_count_ = vaults.size();
+    for (const auto& vault : vaults)
+      configured_vaults_starting_.insert(vault.info.label.string());
+  }
+  // Running vaults report in as they reconnect; the rest are started as if from the config file.
+  for (auto& vault : vaults) {
+    NonEmptyString label{ vault.info.label };
+    try {
+      if (vault.pidfd == -1) {
+        if (!process_manager_->RestoreProcess(std::move(vault.info)))
+          HandleConfiguredVaultReported(label, false);
+      } else {
+        process_manager_->AdoptProcess(std::move(vault));
+      }
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Failed to take over vault " << label.string() << ": "
+                  << boost::diagnostic_information(e);
+      HandleConfiguredVaultReported(label, false);
+      FreezeConfigFile();
+    }
+  }
+}
+
+void VaultManager::HandleConfiguredVaultReported(const NonEmptyString& label, bool running) {
+  std::lock_guard<std::mutex> lock{ startup_mutex_ };
+  if (configured_vaults_starting_.erase(label.string()) == 0U)
+    return;
+  if (running)
+    ++configured_vaults_running_;
+  if (configured_vaults_starting_.empty()) {
+    LOG(kSuccess) << "Finished starting vaults from config file: " << configured_vaults_running_
+                  << " of " << configured_vault_count_ << " running.";
+  }
+}
+
 void VaultManager::HandleNewConnection(TcpConnectionPtr connection) {
-  new_connections_->Add(connection);
+  if (!new_connections_->Add(connection))
+    return connection->Close();
+  MessageReceivedFunctor on_message{ [=](const std::string& message) {
+    HandleReceivedMessage(connection, message);
+  } };
+  connection->Start(on_message, [=] { HandleConnectionClosed(connection); });
+}
+
+void VaultManager::HandleAdmissionCapacityChanged(bool available) {
+  // Only used if the AdmissionPolicy defers rather than sheds surplus connections.
+  for (auto listener : { listener_, local_listener_ }) {
+    if (!listener)
+      continue;
+    if (available)
+      listener->ResumeAccepting();
+    else
+      listener->PauseAccepting();
+  }
+}
+
+TcpConnectionPtr VaultManager::AdoptVaultChannel(int native_socket) {
+#ifdef MAIDSAFE_WIN32
+  static_cast<void>(native_socket);
+  BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unknown));
+#else
+  TcpConnectionPtr connection{
+      TcpConnection::MakeSharedFromNativeSocket(asio_service_, native_socket) };
   MessageReceivedFunctor on_message{ [=](const std::string& message) {
     HandleReceivedMessage(connection, message);
   } };
   connection->Start(on_message, [=] { HandleConnectionClosed(connection); });
+  return connection;
+#endif
+}
+
+void VaultManager::HandleHandoffConnection(TcpConnectionPtr connection) {
+#ifndef MAIDSAFE_WIN32
+  // Only this user can connect to the handoff socket, but nothing is released to anyone else even
+  // if its permissions are loosened.
+  const TcpConnection::PeerCredentials kPeer{ connection->GetPeerCredentials() };
+  if (!kPeer.valid || kPeer.user_id != static_cast<uint32_t>(geteuid())) {
+    LOG(kError) << "Refusing to hand over to a process not run by user " << geteuid();
+    return;
+  }
+#endif
+  {
+    // The vaults from the config file may not all be known to process_manager_ yet.
+    std::lock_guard<std::mutex> lock{ config_file_mutex_ };
+    if (!startup_complete_) {
+      LOG(kWarning) << "Still starting vaults from the config file; refusing successor.";
+      return;
+    }
+  }
+  std::lock_guard<std::mutex> lock{ handoff_mutex_ };
+  if (handing_off_) {
+    LOG(kWarning) << "Already handing over or stopping; ignoring successor.";
+    return;  // The connection is closed as it goes out of scope.
+  }
+  handing_off_ = true;
+  LOG(kInfo) << "Handing over to successor VaultManager.";
+  // Releasing the listeners blocks until their strands have run, so can't be done on this thread.
+  handoff_ = std::async(std::launch::async, [this, connection] { HandOff(connection); });
+}
+
+void VaultManager::HandOff(TcpConnectionPtr connection) {
+  {
+    std::lock_guard<std::mutex> lock{ upgrade_mutex_ };
+    if (rolling_upgrade_)
+      rolling_upgrade_->Stop();
+  }
+
+  Handoff handoff;
+  bool released{ false }, handed_off{ false };
+  try {
+    handoff.vaults = process_manager_->ReleaseAll();
+    released = true;
+  }
+  catch (const std::exception& e) {
+    // Nothing has been released, so we carry on as before.
+    LOG(kError) << "Failed to hand over vaults: " << boost::diagnostic_information(e);
+  }
+  std::vector<TcpConnectionPtr> vault_connections;
+  for (const auto& vault : handoff.vaults) {
+    if (vault.info.tcp_connection)
+      vault_connections.push_back(vault.info.tcp_connection);
+  }
+
+#ifdef MAIDSAFE_LINUX
+  if (released) {
+    // Once the successor acknowledges the handoff, the config file is its to update, so it's no
+    // longer written from here.  A config file which was frozen stays as it is.
+    bool config_file_was_finalised{ false };
+    try {
+      std::vector<VaultInfo> vault_infos;
+      for (const auto& vault : handoff.vaults)
+        vault_infos.push_back(vault.info);
+      std::lock_guard<std::mutex> lock{ config_file_mutex_ };
+      config_file_was_finalised = config_file_finalised_;
+      config_file_finalised_ = true;
+      if (!config_file_was_finalised)
+        config_file_handler_.WriteConfigFile(vault_infos);
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Failed to write config file: " << boost::diagnostic_information(e);
+    }
+
+    try {
+      handoff.listener = listener_->Release();
+      if (local_listener_)
+        handoff.local_listener = local_listener_->Release();
+      handoff.handoff_listener = handoff_listener_->Release();
+      SendHandoff(connection->Socket().native_handle(), handoff);
+      handed_off = true;
+      LOG(kSuccess) << "Handed over to successor VaultManager.";
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Failed to hand over to successor, so keeping the vaults: "
+                  << boost::diagnostic_information(e);
+      ReclaimHandoff(handoff, config_file_was_finalised);
+    }
+  }
+#else
+  static_cast<void>(released);
+#endif
+  // Each vault now reconnects to whichever VaultManager holds the listening sockets.
+  for (const auto& vault_connection : vault_connections)
+    vault_connection->Close();
+  connection->Close();
+  if (handed_off) {
+    if (kOnHandedOff_)
+      kOnHandedOff_();
+    return;
+  }
+  std::lock_guard<std::mutex> lock{ handoff_mutex_ };
+  // Another successor may try again, unless we're being destroyed.
+  if (handoff_.valid())
+    handing_off_ = false;
+}
+
+void VaultManager::ReclaimHandoff(Handoff& handoff, bool config_file_was_finalised) {
+#ifndef MAIDSAFE_WIN32
+  for (auto listener_and_descriptor : { std::make_pair(listener_, &handoff.listener),
+                                        std::make_pair(local_listener_, &handoff.local_listener),
+                                        std::make_pair(handoff_listener_,
+                                                       &handoff.handoff_listener) }) {
+    if (*listener_and_descriptor.second == -1)
+      continue;
+    try {
+      listener_and_descriptor.first->Reclaim(TakeDescriptor(*listener_and_descriptor.second));
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Failed to reclaim listening socket: " << boost::diagnostic_information(e);
+    }
+  }
+#endif
+  process_manager_->ReclaimAll(std::move(handoff.vaults));
+  handoff.vaults.clear();
+  {
+    std::lock_guard<std::mutex> lock{ config_file_mutex_ };
+    config_file_finalised_ = config_file_was_finalised;
+  }
+  try {
+    WriteConfigFile();
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed to write config file: " << boost::diagnostic_information(e);
+  }
 }
 
 void VaultManager::HandleConnectionClosed(TcpConnectionPtr connection) {
+  // Handle anything the vault managed to write to its ring before the connection closed.
+  ring_drainer_->Remove(connection);
   if (process_manager_->HandleConnectionClosed(connection) ||
     client_connections_->Remove(connection)) {
     return;
@@ -165,6 +733,9 @@ void VaultManager::HandleReceivedMessage(TcpConnectionPtr connection,
       case MessageType::kVaultStarted:
         HandleVaultStarted(connection, message_and_type.first);
         break;
+      case MessageType::kVaultReconnected:
+        HandleVaultReconnected(connection, message_and_type.first);
+        break;
       case MessageType::kJoinedNetwork:
         assert(message_and_type.first.empty());
         HandleJoinedNetwork(connection);
@@ -176,6 +747,18 @@ void VaultManager::HandleReceivedMessage(TcpConnectionPtr connection,
       case MessageType::kLogMessage:
         HandleLogMessage(connection, message_and_type.first);
         break;
+      case MessageType::kVaultUsageRequest:
+        HandleVaultUsageRequest(connection, message_and_type.first);
+        break;
+      case MessageType::kMoveChunkstoreProgress:
+        HandleMoveChunkstoreProgress(connection, message_and_type.first);
+        break;
+      case MessageType::kMoveChunkstoreResponse:
+        HandleMoveChunkstoreResponse(connection, message_and_type.first);
+        break;
+      case MessageType::kHealthProbeResponse:
+        HandleHealthProbeResponse(connection, message_and_type.first);
+        break;
       default:
         return;
     }
@@ -218,6 +801,8 @@ void VaultManager::HandleStartVaultRequest(TcpConnectionPtr connection,
     vault_info.vault_dir = start_vault_message.vault_dir();
     vault_info.max_disk_usage = DiskUsage{ start_vault_message.max_disk_usage() };
     vault_info.owner_name = client_name;
+    if (start_vault_message.has_resource_limits())
+      FromProtobuf(start_vault_message.resource_limits(), vault_info.resource_limits);
 #ifdef TESTING
     if (start_vault_message.has_pmid_list_index()) {
       vault_info.pmid_and_signer = std::make_shared<passport::PmidAndSigner>(
@@ -230,7 +815,7 @@ void VaultManager::HandleStartVaultRequest(TcpConnectionPtr connection,
     }
 
     process_manager_->AddProcess(std::move(vault_info));
-    config_file_handler_.WriteConfigFile(process_manager_->GetAll());
+    WriteConfigFile();
     return;
   }
   catch (const maidsafe_error& e) {
@@ -255,6 +840,8 @@ void VaultManager::HandleTakeOwnershipRequest(TcpConnectionPtr connection,
     fs::path new_vault_dir{ take_ownership_request.vault_dir() };
     DiskUsage new_max_disk_usage{ take_ownership_request.max_disk_usage() };
     VaultInfo vault_info{ process_manager_->Find(label) };
+    if (take_ownership_request.has_resource_limits())
+      FromProtobuf(take_ownership_request.resource_limits(), vault_info.resource_limits);
 
     if (vault_info.vault_dir != new_vault_dir) {
       vault_info.vault_dir = new_vault_dir;
@@ -267,7 +854,9 @@ void VaultManager::HandleTakeOwnershipRequest(TcpConnectionPtr connection,
       SendMaxDiskUsageUpdate(vault_info.tcp_connection, new_max_disk_usage);
 
     process_manager_->AssignOwner(label, client_name, new_max_disk_usage);
-    config_file_handler_.WriteConfigFile(process_manager_->GetAll());
+    if (take_ownership_request.has_resource_limits())
+      process_manager_->SetResourceLimits(label, vault_info.resource_limits);
+    WriteConfigFile();
     SendVaultRunningResponse(connection, label, vault_info.pmid_and_signer.get());
     return;
   }
@@ -282,31 +871,82 @@ void VaultManager::HandleTakeOwnershipRequest(TcpConnectionPtr connection,
 }
 
 void VaultManager::ChangeChunkstorePath(VaultInfo vault_info) {
-  // TODO(Fraser#5#): 2014-05-13 - Handle sending a "MoveChunkstoreRequest" to avoid stopping then
-  //                               restarting the vault.
+  if (!vault_info.tcp_connection) {
+    LOG(kError) << "Vault " << vault_info.label.string() << " isn't connected.";
+    BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::connection_not_found));
+  }
+  {
+    std::lock_guard<std::mutex> lock{ chunkstore_moves_mutex_ };
+    auto itr(chunkstore_moves_.find(vault_info.label.string()));
+    // A pending move from a previous incarnation of the vault will never be confirmed.
+    if (itr != std::end(chunkstore_moves_) &&
+        itr->second.tcp_connection == vault_info.tcp_connection) {
+      LOG(kError) << "Vault " << vault_info.label.string() << " is already moving its chunkstore.";
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+    }
+    chunkstore_moves_[vault_info.label.string()] = vault_info;
+  }
+  SendMoveChunkstoreRequest(vault_info.tcp_connection, vault_info.vault_dir,
+                            vault_info.max_disk_usage);
+}
+
+void VaultManager::RestartInNewChunkstore(VaultInfo vault_info) {
   SendVaultShutdownRequest(vault_info.tcp_connection);
   ProcessManager::OnExitFunctor on_exit{ [this, vault_info](maidsafe_error error, int exit_code) {
     LOG(kVerbose) << "Process returned " << exit_code << " with error message: "
                   << boost::diagnostic_information(error);
     process_manager_->AddProcess(std::move(vault_info));
-    config_file_handler_.WriteConfigFile(process_manager_->GetAll());
+    WriteConfigFile();
   } };
   process_manager_->StopProcess(vault_info.tcp_connection, on_exit);
 }
 
 void VaultManager::HandleVaultStarted(TcpConnectionPtr connection, const std::string& message) {
-  // TODO(Fraser#5#): 2014-05-20 - We should validate received ProcessID since a malicious process
-  //                  could have spotted a new vault process starting and jumped in with this TCP
-  //                  connection before the new vault can connect, passing itself off as the new
-  //                  vault (i.e. lying about its own Process ID).
-  RemoveFromNewConnections(connection);
+  // A vault spawned with an inherited channel never passes through new_connections_, and is
+  // already bound to its connection.
+  const bool kInheritedChannel{ !new_connections_->Remove(connection) };
+  if (kInheritedChannel)
+    process_manager_->Find(connection);  // Throws if this isn't such a vault's channel.
   protobuf::VaultStarted vault_started{ ParseProto<protobuf::VaultStarted>(message) };
-  VaultInfo vault_info{
-      process_manager_->HandleVaultStarted(connection, { vault_started.process_id() }) };
+  // Otherwise a process which spotted a new vault starting could connect first and pass itself off
+  // as the vault.  The OS-reported process ID rules this out other than over TCP, where the claimed
+  // one has to be trusted.
+  const ProcessId kProcessId{ kInheritedChannel ? vault_started.process_id() :
+                                                  VaultProcessId(connection,
+                                                                 vault_started.process_id()) };
+  VaultInfo vault_info;
+  try {
+    vault_info = process_manager_->HandleVaultStarted(connection, kProcessId,
+                                                      vault_started.answers_health_probes());
+  }
+  catch (const std::exception&) {
+    // No longer subject to new_connections_' timeout, so mustn't be left open.
+    if (!kInheritedChannel)
+      connection->Close();
+    throw;
+  }
+
+  std::string ring_name;
+  if (vault_started.request_shared_memory_ring()) {
+    try {
+      ring_name = ring_drainer_->Add(connection);
+    }
+    catch (const std::exception& e) {
+      LOG(kWarning) << "Vault will use TCP only: " << boost::diagnostic_information(e);
+    }
+  }
+
+  // Only a vault which might be handed over to a successor needs to be able to reconnect.
+  std::string reconnect_address;
+  if (handoff_listener_) {
+    reconnect_address = local_listener_ ? local_listener_->LocalSocketPath().string() :
+                                          std::to_string(listener_->ListeningPort());
+  }
 
   // Send vault its credentials
   SendVaultStartedResponse(vault_info, config_file_handler_.SymmKey(),
-      config_file_handler_.SymmIv(), routing::ReadBootstrapFile(kBootstrapFilePath_));
+      config_file_handler_.SymmIv(), routing::ReadBootstrapFile(kBootstrapFilePath_), ring_name,
+      reconnect_address);
 
   // If the corresponding client is connected, send it the credentials too
   if (vault_info.owner_name->IsInitialised()) {
@@ -319,7 +959,140 @@ void VaultManager::HandleVaultStarted(TcpConnectionPtr connection, const std::st
 
   LOG(kSuccess) << "Vault started.  Pmid ID: "
       << DebugId(vault_info.pmid_and_signer->first.name().value) << "  Process ID: "
-      << vault_started.process_id() << "  Label: " << vault_info.label.string();
+      << kProcessId << "  Label: " << vault_info.label.string();
+  HandleConfiguredVaultReported(vault_info.label, true);
+}
+
+void VaultManager::HandleVaultReconnected(TcpConnectionPtr connection,
+                                          const std::string& message) {
+  RemoveFromNewConnections(connection);
+  protobuf::VaultReconnected vault_reconnected{ ParseProto<protobuf::VaultReconnected>(message) };
+  const ProcessId kProcessId{ VaultProcessId(connection, vault_reconnected.process_id()) };
+  VaultInfo vault_info;
+  try {
+    vault_info = process_manager_->HandleVaultStarted(connection, kProcessId,
+                                                      vault_reconnected.answers_health_probes());
+  }
+  catch (const std::exception&) {
+    // E.g. the vault's VaultManager crashed rather than handing over, so it has been replaced by a
+    // vault started from the config file.
+    LOG(kWarning) << "Unknown vault with process ID " << kProcessId
+                  << " reconnected; asking it to stop.";
+    return SendVaultShutdownRequest(connection);
+  }
+  LOG(kSuccess) << "Vault " << vault_info.label.string() << " with process ID " << kProcessId
+                << " reconnected.";
+  HandleConfiguredVaultReported(vault_info.label, true);
+}
+
+void VaultManager::HandleMoveChunkstoreProgress(TcpConnectionPtr connection,
+                                                const std::string& message) {
+  VaultInfo vault_info{ process_manager_->Find(connection) };
+  protobuf::MoveChunkstoreProgress progress{
+      ParseProto<protobuf::MoveChunkstoreProgress>(message) };
+  if (!vault_info.owner_name->IsInitialised())
+    return;
+  try {
+    TcpConnectionPtr client{ client_connections_->FindValidated(vault_info.owner_name) };
+    SendMoveChunkstoreProgress(client, progress.bytes_moved(), progress.total_bytes(),
+                               &vault_info.label);
+  }
+  catch (const std::exception&) {}  // We don't care if the client isn't connected.
+}
+
+void VaultManager::HandleMoveChunkstoreResponse(TcpConnectionPtr connection,
+                                                const std::string& message) {
+  NonEmptyString label{ process_manager_->Find(connection).label };
+  protobuf::MoveChunkstoreResponse response{
+      ParseProto<protobuf::MoveChunkstoreResponse>(message) };
+  VaultInfo vault_info;
+  {
+    std::lock_guard<std::mutex> lock{ chunkstore_moves_mutex_ };
+    auto itr(chunkstore_moves_.find(label.string()));
+    if (itr == std::end(chunkstore_moves_) || itr->second.tcp_connection != connection ||
+        itr->second.vault_dir != fs::path{ response.vault_dir() }) {
+      LOG(kWarning) << "Vault " << label.string() << " confirmed an unrequested chunkstore move.";
+      return;
+    }
+    vault_info = std::move(itr->second);
+    chunkstore_moves_.erase(itr);
+  }
+
+  maidsafe_error error{ MakeError(CommonErrors::success) };
+  if (response.has_serialised_maidsafe_error()) {
+    error = Parse(maidsafe_error::serialised_type(response.serialised_maidsafe_error()));
+    if (error.code() == make_error_code(CommonErrors::uninitialised)) {
+      LOG(kInfo) << "Vault " << label.string() << " can't move its chunkstore while running; "
+                 << "restarting it in " << vault_info.vault_dir;
+      return RestartInNewChunkstore(std::move(vault_info));
+    }
+    LOG(kError) << "Vault " << label.string() << " failed to move its chunkstore to "
+                << vault_info.vault_dir << ": " << boost::diagnostic_information(error);
+  } else {
+    try {
+      process_manager_->SetVaultDir(label, vault_info.vault_dir);
+      process_manager_->AssignOwner(label, vault_info.owner_name, vault_info.max_disk_usage);
+      process_manager_->SetResourceLimits(label, vault_info.resource_limits);
+      WriteConfigFile();
+      LOG(kSuccess) << "Vault " << label.string() << " moved its chunkstore to "
+                    << vault_info.vault_dir;
+    }
+    catch (const maidsafe_error& e) {
+      LOG(kError) << boost::diagnostic_information(e);
+      error = e;
+    }
+  }
+
+  try {
+    TcpConnectionPtr client{ client_connections_->FindValidated(vault_info.owner_name) };
+    if (error.code() == make_error_code(CommonErrors::success))
+      SendVaultRunningResponse(client, label, vault_info.pmid_and_signer.get());
+    else
+      SendVaultRunningResponse(client, label, nullptr, &error);
+  }
+  catch (const std::exception&) {}  // We don't care if the client isn't connected.
+}
+
+void VaultManager::HandleVaultQuarantined(const VaultInfo& vault_info) {
+  LOG(kError) << "Vault " << vault_info.label.string() << " keeps crashing and won't be restarted "
+              << "until the VaultManager is restarted.";
+  HandleConfiguredVaultReported(vault_info.label, false);
+  if (!vault_info.owner_name->IsInitialised())
+    return;
+  try {
+    TcpConnectionPtr client{ client_connections_->FindValidated(vault_info.owner_name) };
+    maidsafe_error error{ MakeError(VaultManagerErrors::vault_exited_with_error) };
+    SendVaultRunningResponse(client, vault_info.label, nullptr, &error);
+    SendLogMessage(client, "Vault " + vault_info.label.string() + " has been quarantined after " +
+                           "repeatedly crashing.");
+  }
+  catch (const std::exception&) {}  // We don't care if the client isn't connected.
+}
+
+void VaultManager::HandleVaultUsageRequest(TcpConnectionPtr connection,
+                                           const std::string& message) {
+  maidsafe_error error{ MakeError(CommonErrors::unknown) };
+  NonEmptyString label;
+  try {
+    passport::PublicMaid::Name client_name{ client_connections_->FindValidated(connection) };
+    label = NonEmptyString{ ParseProto<protobuf::VaultUsageRequest>(message).label() };
+    if (process_manager_->Find(label).owner_name != client_name) {
+      LOG(kWarning) << "Client requested usage of vault " << label.string() << " it doesn't own.";
+      BOOST_THROW_EXCEPTION(MakeError(VaultManagerErrors::unvalidated_client));
+    }
+    ResourceUsage usage{ process_manager_->GetResourceUsage(label) };
+    SendVaultUsageResponse(connection, label, &usage);
+    return;
+  }
+  catch (const maidsafe_error& e) {
+    LOG(kWarning) << boost::diagnostic_information(e);
+    error = e;
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << boost::diagnostic_information(e);
+  }
+  if (label.IsInitialised())
+    SendVaultUsageResponse(connection, label, nullptr, &error);
 }
 
 void VaultManager::HandleBootstrapContactsRequest(TcpConnectionPtr connection) {
@@ -329,8 +1102,13 @@ void VaultManager::HandleBootstrapContactsRequest(TcpConnectionPtr connection) {
 }
 
 void VaultManager::HandleJoinedNetwork(TcpConnectionPtr connection) {
+  VaultInfo vault_info(process_manager_->Find(connection));
+  {
+    std::lock_guard<std::mutex> lock{ upgrade_mutex_ };
+    if (rolling_upgrade_)
+      rolling_upgrade_->HandleJoinedNetwork(vault_info.label);
+  }
   try {
-    VaultInfo vault_info(process_manager_->Find(connection));
     // TODO(Prakash) do vault_info need joined field
     std::string log_message("Vault running as " +
                             HexSubstr(vault_info.pmid_and_signer->first.name().value));
@@ -341,6 +1119,12 @@ void VaultManager::HandleJoinedNetwork(TcpConnectionPtr connection) {
   catch (const std::exception&) {}  // We don't care if the client isn't connected.
 }
 
+void VaultManager::HandleHealthProbeResponse(TcpConnectionPtr connection,
+                                             const std::string& message) {
+  protobuf::HealthProbeResponse response{ ParseProto<protobuf::HealthProbeResponse>(message) };
+  process_manager_->HandleHealthProbeResponse(connection, response.sequence());
+}
+
 void VaultManager::HandleLogMessage(TcpConnectionPtr connection, const std::string& message) {
   LOG(kInfo) << message;
   try {
@@ -351,6 +1135,42 @@ void VaultManager::HandleLogMessage(TcpConnectionPtr connection, const std::stri
   catch (const std::exception&) {}  // We don't care if the client isn't connected.
 }
 
+void VaultManager::HandleRingRecord(TcpConnectionPtr connection, MessageType type,
+                                    const std::string& payload) {
+  // Only fire-and-forget messages are carried by the rings.  As over TCP, other types are ignored.
+  try {
+    switch (type) {
+      case MessageType::kLogMessage:
+        HandleLogMessage(connection, payload);
+        break;
+      default:
+        return;
+    }
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed to handle ring record: " << boost::diagnostic_information(e);
+  }
+}
+
+void VaultManager::WriteConfigFile(bool final_write) {
+  // Hold the lock across retrieving and writing, so that concurrent updates can't be written out of
+  // order.
+  std::lock_guard<std::mutex> lock{ config_file_mutex_ };
+  // Vaults being removed while stopping must stay in the config file.
+  if (config_file_finalised_)
+    return;
+  // Until then, process_manager_ may not yet hold all of the vaults listed in the config file.
+  // Rather than blocking the caller (often a handler on asio_service_), the write is left to
+  // FinishStartup.
+  if (!startup_complete_) {
+    assert(!final_write);
+    config_file_write_pending_ = true;
+    return;
+  }
+  config_file_finalised_ = final_write;
+  config_file_handler_.WriteConfigFile(process_manager_->GetAll());
+}
+
 void VaultManager::RemoveFromNewConnections(TcpConnectionPtr connection) {
   if (!new_connections_->Remove(connection)) {
     LOG(kWarning) << "Connection not found in new_connections_.";
@@ -19,7 +19,13 @@
 #ifndef MAIDSAFE_VAULT_MANAGER_VAULT_MANAGER_H_
 #define MAIDSAFE_VAULT_MANAGER_VAULT_MANAGER_H_
 
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
 
 #include "boost/filesystem/path.hpp"
@@ -30,6 +36,7 @@
 
 #include "maidsafe/vault_manager/config.h"
 #include "maidsafe/vault_manager/config_file_handler.h"
+#include "maidsafe/vault_manager/placement.h"
 #include "maidsafe/vault_manager/vault_info.h"
 
 namespace maidsafe {
@@ -38,26 +45,81 @@ namespace vault_manager {
 
 class TcpListener;
 class ClientConnections;
+struct Handoff;
 class NewConnections;
 class ProcessManager;
+class RingDrainer;
+class RollingUpgrade;
+class WorkerPool;
 
 // The VaultManager has several responsibilities:
-// * Reads config file on startup and restarts vaults listed in file.
+// * Reads config file on startup and restarts vaults listed in file.  This happens in the
+//   background once the listeners are up, so the constructor doesn't wait for the vaults to start.
 // * Writes details of all vaults to config file.
-// * Listens and responds to client and vault requests on the loopback address.
+// * Listens and responds to client and vault requests on the loopback address and (other than on
+//   Windows) on a Unix domain socket.
 // * Maintains the bootstrap list (peer contacts known to its vault(s)).
+//
+// 'thread_count' is the number of threads run by the internal AsioService.  Each connection is
+// serialised via its own strand, so with several threads a slow operation on one connection (e.g.
+// validating a client's signature) doesn't stall the others.
+//
+// 'placement_policy' determines the CPUs and NUMA node assigned to each new vault.  Placements are
+// stored in the config file, so vaults keep theirs across restarts.
+//
+// On Linux, a VaultManager constructed with 'take_over' set takes over the vaults and listening
+// sockets of the one already running (see handoff.h) rather than starting vaults from the config
+// file.  If none is running, it starts normally; if the handoff fails, the other keeps its vaults
+// and the constructor throws.  Only successors run by the same user are handed over to, and not
+// until the vaults from the config file have all been started.  Once this VaultManager has handed
+// over, 'on_handed_off' is invoked (on a thread of its own), after which this should be destroyed;
+// the vaults are then left running.
+//
+// 'vault_channel' determines how vaults started by this VaultManager are told to connect to it.
 class VaultManager {
  public:
-  VaultManager();
+  explicit VaultManager(uint32_t thread_count = 1,
+                        PlacementPolicy placement_policy = PlacementPolicy{},
+                        std::function<void()> on_handed_off = nullptr,
+                        VaultChannel vault_channel = VaultChannel::kTcpPort,
+                        bool take_over = false);
   ~VaultManager();
 
+  // Restarts all vaults from 'vault_executable_path' (or if empty, from the current executable
+  // path, e.g. once the executable there has been replaced) via a RollingUpgrade, and starts new
+  // vaults from it.  The future holds the cause of failure if the upgrade was rolled back.  Throws
+  // if the executable is invalid or an upgrade is already in progress.
+  //
+  // As the current executable may have been replaced in place, the vaults are rolled back to a copy
+  // of it taken on startup and after each successful upgrade.  If that copy couldn't be taken,
+  // upgrading in place can't be undone: rolling back restarts the vaults from the same executable.
+  std::future<void> UpgradeVaults(const boost::filesystem::path& vault_executable_path,
+                                  size_t batch_size = 1);
+
  private:
   VaultManager(const VaultManager&) = delete;
   VaultManager(VaultManager&&) = delete;
   VaultManager operator=(VaultManager) = delete;
 
+  // Copies the current vault executable aside for UpgradeVaults to roll back to.
+  void SnapshotVaultExecutable();
+  void StartConfiguredVaults();
+  void AdoptHandedOffVaults();
+  // Stops the config file being overwritten, e.g. when it couldn't be read, since writing would
+  // lose the vaults which failed to load.
+  void FreezeConfigFile();
+  // Marks the vaults from the config file as all added to process_manager_, and makes any write of
+  // the config file which was requested in the meantime.
+  void FinishStartup();
+  void HandleConfiguredVaultReported(const NonEmptyString& label, bool running);
   void HandleNewConnection(TcpConnectionPtr connection);
+  void HandleAdmissionCapacityChanged(bool available);
+  TcpConnectionPtr AdoptVaultChannel(int native_socket);
   void HandleConnectionClosed(TcpConnectionPtr connection);
+  void HandleHandoffConnection(TcpConnectionPtr connection);
+  void HandOff(TcpConnectionPtr connection);
+  // Takes back the listening sockets and vaults of a handoff which failed.
+  void ReclaimHandoff(Handoff& handoff, bool config_file_was_finalised);
   void HandleReceivedMessage(TcpConnectionPtr connection, const std::string& wrapped_message);
 
   // Messages from Client
@@ -69,19 +131,67 @@ class VaultManager {
 
   // Messages from Vault
   void HandleVaultStarted(TcpConnectionPtr connection, const std::string& message);
+  void HandleVaultReconnected(TcpConnectionPtr connection, const std::string& message);
+  void HandleVaultQuarantined(const VaultInfo& vault_info);
+  void HandleVaultUsageRequest(TcpConnectionPtr connection, const std::string& message);
   void HandleJoinedNetwork(TcpConnectionPtr connection);
+  void HandleMoveChunkstoreProgress(TcpConnectionPtr connection, const std::string& message);
+  void HandleMoveChunkstoreResponse(TcpConnectionPtr connection, const std::string& message);
+  void HandleHealthProbeResponse(TcpConnectionPtr connection, const std::string& message);
   void HandleLogMessage(TcpConnectionPtr connection, const std::string& message);
+  void HandleRingRecord(TcpConnectionPtr connection, MessageType type, const std::string& payload);
 
   void RemoveFromNewConnections(TcpConnectionPtr connection);
+  // Asks the running vault to move its chunkstore to 'vault_info.vault_dir', falling back to
+  // RestartInNewChunkstore if the vault doesn't support moving while running.
   void ChangeChunkstorePath(VaultInfo vault_info);
+  void RestartInNewChunkstore(VaultInfo vault_info);
+  // Once called with 'final_write' set, further calls are no-ops.  Until FinishStartup, the write
+  // is deferred rather than made.
+  void WriteConfigFile(bool final_write = false);
 
   const boost::filesystem::path kBootstrapFilePath_;
   ConfigFileHandler config_file_handler_;
+  std::mutex config_file_mutex_;
+  bool config_file_finalised_, startup_complete_, config_file_write_pending_;
+  const std::function<void()> kOnHandedOff_;
+  // Null unless taking over from another VaultManager, and only until its vaults have been adopted.
+  std::unique_ptr<Handoff> predecessor_;
   AsioService asio_service_;
   std::shared_ptr<TcpListener> listener_;
+  // Null if the Unix domain socket couldn't be bound; vaults and clients then use TCP.
+  std::shared_ptr<TcpListener> local_listener_;
   std::shared_ptr<ProcessManager> process_manager_;
+  // Null if vaults can't be handed over to a successor.
+  std::shared_ptr<TcpListener> handoff_listener_;
+  std::mutex handoff_mutex_;
+  // Set while handing over and once handed over or stopping.
+  bool handing_off_;
+  // Invalid once stopping.
+  std::future<void> handoff_;
+  // Checks clients' challenge responses; must outlive client_connections_.
+  std::unique_ptr<WorkerPool> verification_pool_;
   std::shared_ptr<ClientConnections> client_connections_;
   std::shared_ptr<NewConnections> new_connections_;
+  std::shared_ptr<RingDrainer> ring_drainer_;
+  std::mutex upgrade_mutex_;
+  // Null unless an upgrade is in progress.
+  std::shared_ptr<RollingUpgrade> rolling_upgrade_;
+  // The copy taken by SnapshotVaultExecutable, or empty if there's none.  Guarded by
+  // 'upgrade_mutex_', as is 'replaced_executable_path_'.
+  boost::filesystem::path rollback_executable_path_;
+  // Set once an upgrade in place has been rolled back to the copy, and is where the next upgrade
+  // with no executable given comes from.
+  boost::filesystem::path replaced_executable_path_;
+  std::mutex chunkstore_moves_mutex_;
+  // Keyed by label, the details to be applied once each vault confirms its chunkstore has moved.
+  std::map<std::string, VaultInfo> chunkstore_moves_;
+  std::mutex startup_mutex_;
+  // Labels of vaults from the config file which haven't yet reported in or failed to start.
+  std::set<std::string> configured_vaults_starting_;
+  std::size_t configured_vault_count_, configured_vaults_running_;
+  // Reads the config file and adds its vaults to process_manager_.
+  std::future<void> startup_;
 };
 
 }  // namespace vault_manager
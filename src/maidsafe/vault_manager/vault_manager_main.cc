@@ -22,6 +22,11 @@
 #include <signal.h>
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
 #include <future>
 #include <iostream>
 #include <string>
@@ -37,6 +42,7 @@
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/utils.h"
 
+#include "maidsafe/vault_manager/placement.h"
 #include "maidsafe/vault_manager/vault_manager.h"
 #include "maidsafe/vault_manager/utils.h"
 
@@ -52,6 +58,16 @@ void ShutDownVaultManager(int /*signal*/) {
   g_shutdown_promise.set_value();
 }
 
+#ifndef MAIDSAFE_WIN32
+volatile std::sig_atomic_t g_upgrade_requested(0);
+// Set once a successor VaultManager has taken over our vaults.
+std::atomic<bool> g_handed_off(false);
+
+void RequestVaultUpgrade(int /*signal*/) {
+  g_upgrade_requested = 1;
+}
+#endif
+
 #ifdef MAIDSAFE_WIN32
 
 enum {
@@ -138,7 +154,56 @@ BOOL CtrlHandler(DWORD control_type) {
 
 #endif
 
-void HandleProgramOptions(int argc, char** argv) {
+typedef maidsafe::vault_manager::PlacementPolicy PlacementPolicy;
+typedef maidsafe::vault_manager::VaultChannel VaultChannel;
+
+struct Options {
+  uint32_t thread_count;
+  PlacementPolicy placement_policy;
+  size_t upgrade_batch_size;
+  VaultChannel vault_channel;
+  bool take_over;
+};
+
+PlacementPolicy GetPlacementPolicy(const po::variables_map& variables_map) {
+  PlacementPolicy placement_policy;
+  if (variables_map.count("placement") != 0) {
+    std::string mode{ variables_map.at("placement").as<std::string>() };
+    if (mode == "numa_node") {
+      placement_policy.mode = PlacementPolicy::Mode::kRoundRobinNode;
+    } else if (mode == "dedicated_cores") {
+      placement_policy.mode = PlacementPolicy::Mode::kDedicatedCores;
+    } else if (mode != "unpinned") {
+      LOG(kError) << "placement must be one of unpinned, numa_node or dedicated_cores";
+      BOOST_THROW_EXCEPTION(maidsafe::MakeError(maidsafe::CommonErrors::invalid_parameter));
+    }
+  }
+  if (variables_map.count("cores_per_vault") != 0) {
+    if (variables_map.at("cores_per_vault").as<int>() < 1) {
+      LOG(kError) << "cores_per_vault must be at least 1";
+      BOOST_THROW_EXCEPTION(maidsafe::MakeError(maidsafe::CommonErrors::invalid_parameter));
+    }
+    placement_policy.cores_per_vault = variables_map.at("cores_per_vault").as<int>();
+  }
+  placement_policy.reserve_manager_core = variables_map.count("reserve_manager_core") != 0;
+  return placement_policy;
+}
+
+VaultChannel GetVaultChannel(const po::variables_map& variables_map) {
+  if (variables_map.count("vault_channel") == 0)
+    return VaultChannel::kTcpPort;
+  std::string channel{ variables_map.at("vault_channel").as<std::string>() };
+  if (channel == "port")
+    return VaultChannel::kTcpPort;
+  if (channel == "local_socket")
+    return VaultChannel::kLocalSocket;
+  if (channel == "inherited_channel")
+    return VaultChannel::kInheritedChannel;
+  LOG(kError) << "vault_channel must be one of port, local_socket or inherited_channel";
+  BOOST_THROW_EXCEPTION(maidsafe::MakeError(maidsafe::CommonErrors::invalid_parameter));
+}
+
+Options HandleProgramOptions(int argc, char** argv) {
   po::options_description options_description("Allowed options");
   options_description.add_options()
 #ifdef TESTING
@@ -146,6 +211,19 @@ void HandleProgramOptions(int argc, char** argv) {
       ("vault_path", po::value<std::string>(), "Path to the vault executable including name")
       ("root_dir", po::value<std::string>(), "Path to folder of config file and bootstrap file")
 #endif
+      ("thread_count", po::value<int>(), "Number of threads handling vault and client messages")
+      ("placement", po::value<std::string>(),
+       "Placement of new vaults: unpinned (default), numa_node or dedicated_cores")
+      ("cores_per_vault", po::value<int>(), "Number of cores per vault if placement is "
+       "dedicated_cores (default 1)")
+      ("reserve_manager_core", "Keep vaults off the first core, leaving it to the vault_manager")
+      ("upgrade_batch_size", po::value<int>(), "Number of vaults restarted at a time when SIGHUP "
+       "triggers a rolling upgrade to the (replaced) vault executable (default 1)")
+      ("vault_channel", po::value<std::string>(), "How vaults are told to connect: port "
+       "(default, understood by all vaults), local_socket (Unix domain socket path) or "
+       "inherited_channel (socketpair inherited by the vault)")
+      ("take_over", "Take over the vaults of the vault_manager already running, if any, without "
+       "restarting them (Linux only)")
       ("help", "produce help message");
   po::variables_map variables_map;
   po::store(
@@ -180,6 +258,25 @@ void HandleProgramOptions(int argc, char** argv) {
 
   maidsafe::vault_manager::test::SetEnvironment(port, root_dir, path_to_vault);
 #endif
+
+  uint32_t thread_count{ std::max(std::thread::hardware_concurrency(), 1U) };
+  if (variables_map.count("thread_count") != 0) {
+    if (variables_map.at("thread_count").as<int>() < 1) {
+      LOG(kError) << "thread_count must be at least 1";
+      BOOST_THROW_EXCEPTION(maidsafe::MakeError(maidsafe::CommonErrors::invalid_parameter));
+    }
+    thread_count = static_cast<uint32_t>(variables_map["thread_count"].as<int>());
+  }
+  size_t upgrade_batch_size{ 1 };
+  if (variables_map.count("upgrade_batch_size") != 0) {
+    if (variables_map.at("upgrade_batch_size").as<int>() < 1) {
+      LOG(kError) << "upgrade_batch_size must be at least 1";
+      BOOST_THROW_EXCEPTION(maidsafe::MakeError(maidsafe::CommonErrors::invalid_parameter));
+    }
+    upgrade_batch_size = static_cast<size_t>(variables_map["upgrade_batch_size"].as<int>());
+  }
+  return Options{ thread_count, GetPlacementPolicy(variables_map), upgrade_batch_size,
+                  GetVaultChannel(variables_map), variables_map.count("take_over") != 0 };
 }
 
 }  // unnamed namespace
@@ -189,9 +286,11 @@ int main(int argc, char** argv) {
 #ifdef MAIDSAFE_WIN32
 #ifdef TESTING
   try {
-    HandleProgramOptions(argc, argv);
+    Options options(HandleProgramOptions(argc, argv));
     if (SetConsoleCtrlHandler(reinterpret_cast<PHANDLER_ROUTINE>(CtrlHandler), TRUE)) {
-      maidsafe::vault_manager::VaultManager vault_manager;
+      maidsafe::vault_manager::VaultManager vault_manager{ options.thread_count,
+                                                           options.placement_policy, nullptr,
+                                                           options.vault_channel };
       g_shutdown_promise.get_future().get();
     } else {
       LOG(kError) << "Failed to set control handler.";
@@ -212,19 +311,41 @@ int main(int argc, char** argv) {
   StartServiceCtrlDispatcher(service_table);
 #endif
 #else
-  //  try {
-  HandleProgramOptions(argc, argv);
-  maidsafe::vault_manager::VaultManager vault_manager;
-  std::cout << "Successfully started vault_manager" << std::endl;
-  signal(SIGINT, ShutDownVaultManager);
-  signal(SIGTERM, ShutDownVaultManager);
-  g_shutdown_promise.get_future().get();
-  std::cout << "Successfully stopped vault_manager" << std::endl;
-  //  }
-  //  catch(const std::exception& e) {
-  //    LOG(kError) << "Error: " << e.what();
-  //    return -5;
-  //  }
+  try {
+    Options options(HandleProgramOptions(argc, argv));
+    // If taking over fails, the running vault_manager keeps its vaults and this one exits.
+    maidsafe::vault_manager::VaultManager vault_manager{ options.thread_count,
+                                                         options.placement_policy,
+                                                         [] { g_handed_off = true; },
+                                                         options.vault_channel,
+                                                         options.take_over };
+    std::cout << "Successfully started vault_manager" << std::endl;
+    signal(SIGINT, ShutDownVaultManager);
+    signal(SIGTERM, ShutDownVaultManager);
+    signal(SIGHUP, RequestVaultUpgrade);
+    auto shutdown(g_shutdown_promise.get_future());
+    while (shutdown.wait_for(std::chrono::milliseconds(500)) != std::future_status::ready) {
+      if (g_handed_off) {
+        std::cout << "Handed over to new vault_manager." << std::endl;
+        break;
+      }
+      if (!g_upgrade_requested)
+        continue;
+      g_upgrade_requested = 0;
+      try {
+        // Progress and the outcome are logged by the upgrade itself.
+        vault_manager.UpgradeVaults(fs::path{}, options.upgrade_batch_size);
+      }
+      catch (const std::exception& e) {
+        LOG(kError) << "Can't upgrade vaults: " << boost::diagnostic_information(e);
+      }
+    }
+    std::cout << "Successfully stopped vault_manager" << std::endl;
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Error: " << boost::diagnostic_information(e);
+    return -5;
+  }
   std::cout << "After try/catch, only return pending." << std::endl;
 #endif
   return 0;
@@ -0,0 +1,209 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_VAULT_REGISTRY_H_
+#define MAIDSAFE_VAULT_MANAGER_VAULT_REGISTRY_H_
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/types.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/vault_manager/config.h"
+#include "maidsafe/vault_manager/vault_info.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+typedef uint64_t ProcessId;
+
+// Holds the vaults managed by a ProcessManager, indexed by label, Pmid name, vault_dir, process ID
+// and connection so that each lookup is O(1).  'Entry' must have public members 'VaultInfo info'
+// and 'ProcessId process_id'.
+//
+// Entries have stable addresses; an iterator remains valid until its entry is erased.  The label,
+// Pmid and vault_dir of an entry must not be changed while it's registered, except for vault_dir via
+// SetVaultDir, and its process ID and connection may only be changed via SetProcessId and
+// SetConnection.  Not thread-safe.
+template <typename Entry>
+class VaultRegistry {
+ public:
+  typedef typename std::list<Entry>::iterator iterator;
+  typedef typename std::list<Entry>::const_iterator const_iterator;
+
+  VaultRegistry() : entries_(), by_label_(), by_pmid_name_(), by_vault_dir_(), by_process_id_(),
+                    by_connection_() {}
+
+  // Throws if the new entry has the same Pmid, vault_dir, label or connection as an existing one.
+  iterator Add(Entry entry);
+  void Erase(iterator itr);
+  // A process ID of 0 or a null connection means "none" and isn't indexed.
+  void SetProcessId(iterator itr, ProcessId process_id);
+  void SetConnection(iterator itr, TcpConnectionPtr connection);
+  // Throws if a different entry already uses 'vault_dir'.
+  void SetVaultDir(iterator itr, const boost::filesystem::path& vault_dir);
+
+  // These return end() if there's no such entry.
+  iterator FindByLabel(const NonEmptyString& label) { return Find(by_label_, label.string()); }
+  const_iterator FindByLabel(const NonEmptyString& label) const {
+    return Find(by_label_, label.string());
+  }
+  iterator FindByProcessId(ProcessId process_id) { return Find(by_process_id_, process_id); }
+  iterator FindByConnection(const TcpConnectionPtr& connection) {
+    return Find(by_connection_, connection.get());
+  }
+  const_iterator FindByConnection(const TcpConnectionPtr& connection) const {
+    return Find(by_connection_, connection.get());
+  }
+
+  iterator begin() { return std::begin(entries_); }
+  iterator end() { return std::end(entries_); }
+  const_iterator begin() const { return std::begin(entries_); }
+  const_iterator end() const { return std::end(entries_); }
+  bool empty() const { return entries_.empty(); }
+  size_t size() const { return entries_.size(); }
+
+ private:
+  VaultRegistry(const VaultRegistry&) = delete;
+  VaultRegistry(VaultRegistry&&) = delete;
+  VaultRegistry& operator=(VaultRegistry) = delete;
+
+  template <typename Index, typename Key>
+  iterator Find(Index& index, const Key& key) {
+    auto itr(index.find(key));
+    return itr == std::end(index) ? end() : itr->second;
+  }
+  template <typename Index, typename Key>
+  const_iterator Find(const Index& index, const Key& key) const {
+    auto itr(index.find(key));
+    return itr == std::end(index) ? end() : const_iterator{ itr->second };
+  }
+  template <typename Index, typename Key>
+  void Unindex(Index& index, const Key& key, iterator itr) {
+    auto index_itr(index.find(key));
+    if (index_itr != std::end(index) && index_itr->second == itr)
+      index.erase(index_itr);
+  }
+  static std::string PmidName(const VaultInfo& info) {
+    return info.pmid_and_signer ? info.pmid_and_signer->first.name().value.string() : std::string{};
+  }
+
+  std::list<Entry> entries_;
+  std::unordered_map<std::string, iterator> by_label_, by_pmid_name_, by_vault_dir_;
+  std::unordered_map<ProcessId, iterator> by_process_id_;
+  std::unordered_map<const TcpConnection*, iterator> by_connection_;
+};
+
+template <typename Entry>
+typename VaultRegistry<Entry>::iterator VaultRegistry<Entry>::Add(Entry entry) {
+  const VaultInfo& info(entry.info);
+  const std::string kPmidName{ PmidName(info) };
+  if (!kPmidName.empty() && by_pmid_name_.count(kPmidName) != 0U) {
+    LOG(kError) << "Vault process with Pmid " << HexSubstr(kPmidName) << " already exists.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+  }
+  if (by_vault_dir_.count(info.vault_dir.string()) != 0U) {
+    LOG(kError) << "Vault process with vault dir " << info.vault_dir << " already exists.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+  }
+  if (by_label_.count(info.label.string()) != 0U) {
+    LOG(kError) << "Vault process with label " << info.label.string() << " already exists.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+  }
+  if (info.tcp_connection && by_connection_.count(info.tcp_connection.get()) != 0U) {
+    LOG(kError) << "Vault process with this tcp_connection already exists.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+  }
+  if (entry.process_id != 0 && by_process_id_.count(entry.process_id) != 0U) {
+    LOG(kError) << "Vault process with process ID " << entry.process_id << " already exists.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+  }
+
+  auto itr(entries_.insert(std::end(entries_), std::move(entry)));
+  // Roll back any partial indexing if an allocation fails.
+  try {
+    by_label_.emplace(itr->info.label.string(), itr);
+    if (!kPmidName.empty())
+      by_pmid_name_.emplace(kPmidName, itr);
+    by_vault_dir_.emplace(itr->info.vault_dir.string(), itr);
+    if (itr->process_id != 0)
+      by_process_id_.emplace(itr->process_id, itr);
+    if (itr->info.tcp_connection)
+      by_connection_.emplace(itr->info.tcp_connection.get(), itr);
+  }
+  catch (...) {
+    Erase(itr);
+    throw;
+  }
+  return itr;
+}
+
+template <typename Entry>
+void VaultRegistry<Entry>::Erase(iterator itr) {
+  Unindex(by_label_, itr->info.label.string(), itr);
+  Unindex(by_pmid_name_, PmidName(itr->info), itr);
+  Unindex(by_vault_dir_, itr->info.vault_dir.string(), itr);
+  Unindex(by_process_id_, itr->process_id, itr);
+  Unindex(by_connection_, itr->info.tcp_connection.get(), itr);
+  entries_.erase(itr);
+}
+
+template <typename Entry>
+void VaultRegistry<Entry>::SetProcessId(iterator itr, ProcessId process_id) {
+  Unindex(by_process_id_, itr->process_id, itr);
+  itr->process_id = process_id;
+  if (process_id != 0)
+    by_process_id_[process_id] = itr;
+}
+
+template <typename Entry>
+void VaultRegistry<Entry>::SetConnection(iterator itr, TcpConnectionPtr connection) {
+  Unindex(by_connection_, itr->info.tcp_connection.get(), itr);
+  itr->info.tcp_connection = std::move(connection);
+  if (itr->info.tcp_connection)
+    by_connection_[itr->info.tcp_connection.get()] = itr;
+}
+
+template <typename Entry>
+void VaultRegistry<Entry>::SetVaultDir(iterator itr, const boost::filesystem::path& vault_dir) {
+  auto existing(by_vault_dir_.find(vault_dir.string()));
+  if (existing != std::end(by_vault_dir_)) {
+    if (existing->second == itr)
+      return;
+    LOG(kError) << "Vault process with vault dir " << vault_dir << " already exists.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::already_initialised));
+  }
+  by_vault_dir_.emplace(vault_dir.string(), itr);
+  Unindex(by_vault_dir_, itr->info.vault_dir.string(), itr);
+  itr->info.vault_dir = vault_dir;
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_VAULT_REGISTRY_H_
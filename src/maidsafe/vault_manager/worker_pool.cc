@@ -0,0 +1,117 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/vault_manager/worker_pool.h"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+#include "boost/exception/diagnostic_information.hpp"
+
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+WorkerPool::WorkerPool(size_t thread_count, size_t max_queue_depth, size_t max_batch_size)
+    : kMaxQueueDepth_(max_queue_depth),
+      kMaxBatchSize_(std::max(max_batch_size, size_t{ 1 })),
+      mutex_(),
+      condition_(),
+      stopped_(false),
+      jobs_(),
+      stats_(),
+      threads_() {
+  for (size_t i(0); i < std::max(thread_count, size_t{ 1 }); ++i)
+    threads_.emplace_back([this] { Run(); });
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    stopped_ = true;
+    jobs_.clear();
+  }
+  condition_.notify_all();
+  for (auto& thread : threads_)
+    thread.join();
+}
+
+bool WorkerPool::Submit(std::function<void()> job) {
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    if (stopped_ || jobs_.size() >= kMaxQueueDepth_) {
+      ++stats_.rejected;
+      return false;
+    }
+    jobs_.emplace_back(std::move(job));
+    ++stats_.submitted;
+    stats_.max_queue_depth = std::max(stats_.max_queue_depth, jobs_.size());
+  }
+  condition_.notify_one();
+  return true;
+}
+
+WorkerPool::Stats WorkerPool::GetStats() const {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  Stats stats{ stats_ };
+  stats.queue_depth = jobs_.size();
+  return stats;
+}
+
+void WorkerPool::Run() {
+  std::vector<std::function<void()>> batch;
+  std::unique_lock<std::mutex> lock{ mutex_ };
+  for (;;) {
+    condition_.wait(lock, [this] { return stopped_ || !jobs_.empty(); });
+    if (stopped_)
+      return;
+    const size_t kBatchSize{ std::min(jobs_.size(), kMaxBatchSize_) };
+    for (size_t i(0); i < kBatchSize; ++i) {
+      batch.emplace_back(std::move(jobs_.front()));
+      jobs_.pop_front();
+    }
+    ++stats_.batches;
+    ++stats_.active;
+    // Leave the rest of the queue to other idle workers.
+    if (!jobs_.empty())
+      condition_.notify_one();
+    lock.unlock();
+
+    for (auto& job : batch) {
+      try {
+        job();
+      }
+      catch (const std::exception& e) {
+        LOG(kError) << "Worker job failed: " << boost::diagnostic_information(e);
+      }
+    }
+    const size_t kCompleted{ batch.size() };
+    batch.clear();  // Destroys the jobs before re-taking the lock.
+
+    lock.lock();
+    --stats_.active;
+    stats_.completed += kCompleted;
+  }
+}
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
@@ -0,0 +1,82 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_VAULT_MANAGER_WORKER_POOL_H_
+#define MAIDSAFE_VAULT_MANAGER_WORKER_POOL_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace maidsafe {
+
+namespace vault_manager {
+
+// A fixed number of threads running jobs from a bounded queue, used to keep CPU-heavy work (e.g.
+// checking clients' signatures) off the AsioService threads.  An idle worker takes up to
+// 'max_batch_size' queued jobs at once and runs them in order, so that a burst of jobs doesn't
+// cost a wake-up and lock round trip per job.  Jobs needing to report back to a connection should
+// do so via the connection's strand.  Thread-safe.
+class WorkerPool {
+ public:
+  struct Stats {
+    Stats()
+        : submitted(0), rejected(0), completed(0), batches(0), queue_depth(0),
+          max_queue_depth(0), active(0) {}
+    uint64_t submitted;
+    uint64_t rejected;  // Submit found the queue full.
+    uint64_t completed, batches;
+    size_t queue_depth, max_queue_depth;
+    size_t active;  // Workers currently running jobs.
+  };
+
+  WorkerPool(size_t thread_count, size_t max_queue_depth, size_t max_batch_size);
+  // Waits for jobs already running to finish; jobs still queued are discarded.  Mustn't be called
+  // from a job.
+  ~WorkerPool();
+
+  // Returns false without queueing 'job' if the queue is full.  Exceptions thrown by 'job' are
+  // logged and otherwise ignored.
+  bool Submit(std::function<void()> job);
+  Stats GetStats() const;
+
+ private:
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool(WorkerPool&&) = delete;
+  WorkerPool& operator=(WorkerPool) = delete;
+
+  void Run();
+
+  const size_t kMaxQueueDepth_, kMaxBatchSize_;
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+  bool stopped_;
+  std::deque<std::function<void()>> jobs_;
+  Stats stats_;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace vault_manager
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_VAULT_MANAGER_WORKER_POOL_H_